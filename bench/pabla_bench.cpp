@@ -0,0 +1,1234 @@
+#include <QApplication>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QRegularExpression>
+#include <QScrollBar>
+#include <QStringList>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextEdit>
+#include <QTimer>
+#include <QVector>
+#include <cstdio>
+#include "diagnosticparser.h"
+#include "documentsearcher.h"
+#include "documentmanager.h"
+#include "editjournal.h"
+#include "fileloader.h"
+#include "filereloader.h"
+#include "filesaver.h"
+#include "filesearcher.h"
+#include "largefileview.h"
+#include "lexer.h"
+#include "lineindex.h"
+#include "outputconsole.h"
+#include "pathtable.h"
+#include "syntaxhighlighter.h"
+#include "terminalscreen.h"
+#include "vtparser.h"
+#include "theme.h"
+#include "undohistory.h"
+#include "wordindex.h"
+
+namespace {
+
+// Результаты для --json: ключ «группа.метрика», значение в единицах
+// из имени метрики.
+QJsonObject results;
+
+void record(const char *key, double value)
+{
+    results.insert(QLatin1String(key), value);
+}
+
+int mismatches = 0;
+
+// Проверка правильности рядом с замером: пишется в JSON как true/false,
+// любое несовпадение делает код выхода ненулевым. Возвращает подпись
+// для печати.
+const char *check(const char *key, bool ok, const char *good, const char *bad)
+{
+    results.insert(QLatin1String(key), ok);
+    if (!ok)
+        ++mismatches;
+    return ok ? good : bad;
+}
+
+QStringList makeLines(int count)
+{
+    const QStringList samples = {
+        "int main(int argc, char *argv[])",
+        "    float ratio = 0.75f * width / height; // пересчёт пропорций",
+        "    if (socket.port == 8080 && protocol == \"http\") return connect(ip, port);",
+        "    std::string path = \"build/\" + name + \".log\";",
+        "    while (index < list.size()) { print(list[index++]); }",
+        "    else if (status != 0) exit(status);",
+        "class Parser : public Method { void create(); void delete_all(); };",
+        "    return open(Path(\"config/ip-v4.json\"), \"r\");"};
+
+    QStringList lines;
+    lines.reserve(count);
+    for (int i = 0; i < count; ++i)
+        lines.append(samples[i % samples.size()]);
+    return lines;
+}
+
+// Прежняя реализация подсветки: по одному регулярному выражению на правило.
+double benchRuleList(const QStringList &lines)
+{
+    QVector<QRegularExpression> rules;
+    for (const QString &keyword : Lexer::defaultKeywords())
+        rules.append(QRegularExpression("\\b" + keyword + "\\b"));
+    rules.append(QRegularExpression("//[^\n]*"));
+    rules.append(QRegularExpression("\".*\""));
+
+    qint64 matches = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const QString &line : lines)
+    {
+        for (const QRegularExpression &rule : rules)
+        {
+            QRegularExpressionMatchIterator it = rule.globalMatch(line);
+            while (it.hasNext())
+            {
+                it.next();
+                ++matches;
+            }
+        }
+    }
+    const double seconds = timer.nsecsElapsed() / 1e9;
+    Q_UNUSED(matches);
+    return lines.size() / seconds;
+}
+
+double benchLexer(const QStringList &lines)
+{
+    const Lexer &lexer = Lexer::defaultLexer();
+    QVector<Token> tokens;
+    qint64 count = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const QString &line : lines)
+    {
+        lexer.tokenize(line, tokens);
+        count += tokens.size();
+    }
+    const double seconds = timer.nsecsElapsed() / 1e9;
+    Q_UNUSED(count);
+    return lines.size() / seconds;
+}
+
+// Ждёт, пока рабочий поток соберёт кэш подсветки под текущую версию.
+void waitForHighlightCache(SyntaxHighlighter &highlighter)
+{
+    if (highlighter.isCacheValid())
+        return;
+    QEventLoop loop;
+    QObject::connect(&highlighter, &SyntaxHighlighter::cacheUpdated, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+// Полная подсветка документа через SyntaxHighlighter по готовому кэшу:
+// разметка форматов в раскладке блоков без лексера.
+double benchHighlighter(const QStringList &lines)
+{
+    QTextDocument document;
+    document.setPlainText(lines.join('\n'));
+    SyntaxHighlighter highlighter(&document);
+    waitForHighlightCache(highlighter);
+    QElapsedTimer timer;
+    timer.start();
+    highlighter.rehighlight();
+    return lines.size() / (timer.nsecsElapsed() / 1e9);
+}
+
+// Вставка 200 тыс. строк в начало показанного документа: время до
+// отрисовки подсвеченного первого экрана и до готовности кэша всего
+// документа в рабочем потоке.
+void benchPaste(double *firstPaintMs, double *backgroundMs)
+{
+    QTextEdit editor;
+    editor.resize(1000, 800);
+    SyntaxHighlighter highlighter(editor.document());
+    editor.show();
+    QCoreApplication::processEvents();
+    const QString text = makeLines(200000).join('\n');
+
+    QElapsedTimer timer;
+    timer.start();
+    QTextCursor cursor(editor.document());
+    cursor.insertText(text);
+    editor.verticalScrollBar()->setValue(0);
+    highlighter.setViewport(editor.cursorForPosition(QPoint(0, 0)).block(),
+                            editor.cursorForPosition(QPoint(0, editor.viewport()->height())).block());
+    editor.viewport()->repaint();
+    *firstPaintMs = timer.nsecsElapsed() / 1e6;
+    waitForHighlightCache(highlighter);
+    *backgroundMs = timer.nsecsElapsed() / 1e6;
+}
+
+// Чтение и сохранение файла ~64 МБ через FileLoader и FileSaver, от
+// вызова до сигнала о завершении. snapshotMs — копия toRawText(), которую
+// сохранение берёт в потоке GUI, у документа на пороге больших файлов.
+void benchFileIo(double *loadMBs, double *saveMBs, double *snapshotMs)
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/large.cpp";
+    const QByteArray block = makeLines(10000).join('\n').append('\n').toUtf8();
+    qint64 bytes = 0;
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+        while (bytes < qint64(64) * 1024 * 1024)
+            bytes += file.write(block);
+    }
+
+    QEventLoop loop;
+    QString text;
+    FileLoader loader;
+    QObject::connect(&loader, &FileLoader::chunkReady, [&text](const QString &chunk)
+                     { text.append(chunk); });
+    QObject::connect(&loader, &FileLoader::finished, &loop, &QEventLoop::quit);
+    QElapsedTimer timer;
+    timer.start();
+    loader.load(fileName);
+    loop.exec();
+    *loadMBs = bytes / 1048576.0 / (timer.nsecsElapsed() / 1e9);
+
+    FileSaver saver;
+    QObject::connect(&saver, &FileSaver::saved, &loop, &QEventLoop::quit);
+    QObject::connect(&saver, &FileSaver::failed, &loop, &QEventLoop::quit);
+    timer.start();
+    saver.save(dir.path() + "/saved.cpp", text);
+    loop.exec();
+    *saveMBs = bytes / 1048576.0 / (timer.nsecsElapsed() / 1e9);
+
+    QTextDocument document;
+    document.setPlainText(text.left(32 * 1024 * 1024));
+    timer.start();
+    const QString snapshot = document.toRawText();
+    *snapshotMs = timer.nsecsElapsed() / 1e6;
+}
+
+// От нажатия клавиши в середине документа до перерисовки окна: правка,
+// повторная подсветка строки и раскладка видимой части.
+void benchKeystroke(int lineCount, double *averageUs, double *maxUs)
+{
+    QTextEdit editor;
+    editor.resize(1000, 800);
+    editor.setPlainText(makeLines(lineCount).join('\n'));
+    SyntaxHighlighter highlighter(editor.document());
+    editor.show();
+    QCoreApplication::processEvents();
+    editor.setTextCursor(QTextCursor(editor.document()->findBlockByNumber(lineCount / 2)));
+    editor.ensureCursorVisible();
+    highlighter.setViewport(editor.cursorForPosition(QPoint(0, 0)).block(),
+                            editor.cursorForPosition(QPoint(0, editor.viewport()->height())).block());
+    editor.viewport()->repaint();
+
+    constexpr int Keystrokes = 200;
+    QElapsedTimer timer;
+    qint64 total = 0;
+    qint64 worst = 0;
+    for (int i = 0; i < Keystrokes; ++i)
+    {
+        const QChar key = i % 20 == 19 ? QChar(' ') : QChar('a' + i % 26);
+        QKeyEvent press(QEvent::KeyPress, Qt::Key_A, Qt::NoModifier, QString(key));
+        timer.start();
+        QApplication::sendEvent(&editor, &press);
+        editor.viewport()->repaint();
+        const qint64 elapsed = timer.nsecsElapsed();
+        total += elapsed;
+        worst = qMax(worst, elapsed);
+    }
+    *averageUs = total / 1000.0 / Keystrokes;
+    *maxUs = worst / 1000.0;
+}
+
+// Индекс строк на 10 млн строк: сборка одним проходом, запросы
+// позиция↔строка и правки, затем переход к строке 9 000 000 в режиме
+// больших файлов вместе с отрисовкой.
+void benchLineIndex(double *scanMBs, double *queryNs, double *editUs, double *gotoMs, bool *landed)
+{
+    constexpr qint64 LineCount = 10000000;
+    QByteArray text;
+    text.reserve(LineCount * 14);
+    for (qint64 i = 0; i < LineCount; ++i)
+    {
+        text.append("line ");
+        text.append(QByteArray::number(i));
+        text.append('\n');
+    }
+
+    LineIndex index;
+    QElapsedTimer timer;
+    timer.start();
+    index.build(text.constData(), text.size());
+    *scanMBs = text.size() / 1048576.0 / (timer.nsecsElapsed() / 1e9);
+
+    constexpr int Queries = 1000000;
+    quint32 seed = 1;
+    qint64 checksum = 0;
+    timer.start();
+    for (int i = 0; i < Queries; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        checksum += index.lineOf(index.lineStart(seed % LineCount) + 2);
+    }
+    *queryNs = timer.nsecsElapsed() / 2.0 / Queries;
+    Q_UNUSED(checksum);
+
+    constexpr int Edits = 10000;
+    timer.start();
+    for (int i = 0; i < Edits; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const qint64 pos = index.lineStart(seed % index.lineCount());
+        if (i % 2 == 0)
+            index.insert(pos, "x\n", 2);
+        else
+            index.remove(pos, 2);
+    }
+    *editUs = timer.nsecsElapsed() / 1e3 / Edits;
+
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/lines.txt";
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+        file.write(text);
+    }
+    text.clear();
+
+    LargeFileView view;
+    view.resize(1000, 800);
+    view.show();
+    view.openFile(fileName);
+    if (!view.hasLineIndex())
+    {
+        QEventLoop loop;
+        QObject::connect(&view, &LargeFileView::lineIndexReady, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+    timer.start();
+    view.goToLine(9000000);
+    view.viewport()->repaint();
+    *gotoMs = timer.nsecsElapsed() / 1e6;
+    *landed = view.caretLine() == 9000000;
+}
+
+// Файл из одной строки в 10 МБ (минифицированный JSON) в режиме больших
+// файлов: открытие с первой отрисовкой, затем шаги каретки вправо и
+// вниз далеко от начала строки, каждый с перерисовкой.
+void benchLongLine(bool wrap, double *openMs, double *averageUs, double *maxUs)
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("minified.json");
+    {
+        QFile file(fileName);
+        file.open(QIODevice::WriteOnly);
+        const QByteArray item = "{\"id\":12345,\"name\":\"item\",\"tags\":[\"a\",\"b\"],\"value\":3.14},";
+        QByteArray line = "[" + item.repeated(10 * 1024 * 1024 / item.size()) + "{}]";
+        file.write(line);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    LargeFileView view;
+    view.resize(1000, 800);
+    view.setWordWrap(wrap);
+    view.openFile(fileName);
+    view.show();
+    view.viewport()->repaint();
+    *openMs = timer.nsecsElapsed() / 1e6;
+
+    // Каретка в конец строки, с переносом — ещё на 20 страниц выше.
+    QKeyEvent end(QEvent::KeyPress, Qt::Key_End, Qt::NoModifier);
+    QApplication::sendEvent(&view, &end);
+    for (int i = 0; i < 20; ++i)
+    {
+        QKeyEvent up(QEvent::KeyPress, Qt::Key_PageUp, Qt::NoModifier);
+        QApplication::sendEvent(&view, &up);
+    }
+    view.viewport()->repaint();
+
+    constexpr int Steps = 200;
+    qint64 total = 0;
+    qint64 worst = 0;
+    for (int i = 0; i < Steps; ++i)
+    {
+        QKeyEvent press(QEvent::KeyPress, i % 4 == 3 ? Qt::Key_Down : Qt::Key_Right, Qt::NoModifier);
+        timer.start();
+        QApplication::sendEvent(&view, &press);
+        view.viewport()->repaint();
+        const qint64 elapsed = timer.nsecsElapsed();
+        total += elapsed;
+        worst = qMax(worst, elapsed);
+    }
+    *averageUs = total / 1000.0 / Steps;
+    *maxUs = worst / 1000.0;
+}
+
+// Поток строк сборки в консоль вывода. Параллельно тикает таймер на 1 мс:
+// самый длинный промежуток между тиками показывает, насколько консоль
+// блокирует цикл событий.
+double benchConsole(qint64 lineCount, qint64 *maxStallMs)
+{
+    OutputConsole console;
+    console.resize(800, 600);
+    console.show();
+
+    const QByteArray line = "[ 42%] Building CXX object src/CMakeFiles/app.dir/module_0042.cpp.o\n";
+    constexpr int LinesPerChunk = 256;
+    const QByteArray chunk = line.repeated(LinesPerChunk);
+
+    QEventLoop loop;
+    qint64 sent = 0;
+    QTimer producer;
+    producer.setInterval(0);
+    QObject::connect(&producer, &QTimer::timeout, [&]
+                     {
+                         if (sent < lineCount)
+                         {
+                             console.write(chunk);
+                             sent += LinesPerChunk;
+                         }
+                         else if (console.linesAppended() + console.linesDropped() >= sent)
+                         {
+                             loop.quit();
+                         } });
+
+    QElapsedTimer heartbeat;
+    *maxStallMs = 0;
+    QTimer tick;
+    tick.setInterval(1);
+    QObject::connect(&tick, &QTimer::timeout, [&]
+                     {
+                         *maxStallMs = qMax(*maxStallMs, heartbeat.elapsed());
+                         heartbeat.restart(); });
+
+    QElapsedTimer timer;
+    timer.start();
+    heartbeat.start();
+    producer.start();
+    tick.start();
+    loop.exec();
+    return (console.linesAppended() + console.linesDropped()) / (timer.nsecsElapsed() / 1e9);
+}
+
+// Разбор вывода в экран терминала порциями по 64 КБ, как при cat большого
+// файла. Экран 120x40 с историей по умолчанию.
+double benchTerminal(const QByteArray &line, qint64 totalBytes)
+{
+    TerminalScreen screen(120, 40);
+    VtParser parser(screen);
+    const QByteArray chunk = line.repeated(qMax<qsizetype>(1, 64 * 1024 / line.size()));
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 fed = 0;
+    while (fed < totalBytes)
+    {
+        parser.feed(chunk.constData(), chunk.size());
+        screen.takeUpdate();
+        fed += chunk.size();
+    }
+    return fed / (1024.0 * 1024.0) / (timer.nsecsElapsed() / 1e9);
+}
+
+// Разбор вывода сборки: в основном строки прогресса, среди них сообщения GCC и MSVC.
+double benchDiagnostics(int lineCount, int *diagnostics)
+{
+    const QStringList samples = {
+        "[ 42%] Building CXX object src/CMakeFiles/app.dir/module_0042.cpp.o",
+        "[ 43%] Building CXX object src/CMakeFiles/app.dir/module_0043.cpp.o",
+        "../src/module_0042.cpp:118:17: warning: unused variable 'ratio' [-Wunused-variable]",
+        "  118 |     float ratio = 0.75f * width / height;",
+        "      |           ^~~~~",
+        "[ 44%] Linking CXX executable app",
+        "C:\\work\\src\\module_0043.cpp(57,9): error C2065: 'socket': undeclared identifier",
+        "../src/module_0042.h:12:7: note: 'class Parser' declared here"};
+
+    DiagnosticParser parser;
+    parser.setBaseDirectory("/work/build");
+    Diagnostic diagnostic;
+    *diagnostics = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < lineCount; ++i)
+    {
+        if (parser.parse(samples[i % samples.size()], diagnostic))
+            ++*diagnostics;
+    }
+    return lineCount / (timer.nsecsElapsed() / 1e9);
+}
+
+// Задержка запроса автодополнения на документе со ~100k идентификаторов.
+void benchCompletion(double *averageUs, double *maxUs, int *words)
+{
+    QStringList lines;
+    for (int i = 0; i < 35000; ++i)
+        lines.append(QString("    result_%1 = compute_%1(value_%1, buffer.size());").arg(i));
+    QTextDocument document;
+    document.setPlainText(lines.join('\n'));
+    WordIndex index(&document);
+    index.addKeywords(Lexer::defaultKeywords());
+    if (!index.isReady())
+    {
+        QEventLoop loop;
+        QObject::connect(&index, &WordIndex::ready, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+    *words = index.size();
+
+    const QStringList prefixes = {"res", "comp", "val", "buf", "rsl", "cmpt", "result_12", "compute_3", "vl9", "whi"};
+    constexpr int Rounds = 100;
+    QElapsedTimer timer;
+    qint64 total = 0;
+    qint64 worst = 0;
+    for (int round = 0; round < Rounds; ++round)
+    {
+        for (const QString &prefix : prefixes)
+        {
+            timer.start();
+            const QStringList result = index.complete(prefix);
+            const qint64 elapsed = timer.nsecsElapsed();
+            Q_UNUSED(result);
+            total += elapsed;
+            worst = qMax(worst, elapsed);
+        }
+    }
+    *averageUs = total / 1000.0 / (Rounds * prefixes.size());
+    *maxUs = worst / 1000.0;
+}
+
+// Набор в середине документа ~2 МБ с историей правок и одна замена всего
+// текста, отличающегося в каждой 50-й строке: сколько памяти занимает
+// история по сравнению с удалённым и вставленным текстом.
+void benchUndo(double *averageUs, double *maxUs, qint64 *historyBytes, qint64 *rawBytes, bool *restored)
+{
+    QStringList lines = makeLines(40000);
+    const QString original = lines.join('\n');
+    QTextEdit editor;
+    editor.setPlainText(original);
+    UndoHistory history(&editor, editor.document());
+
+    QTextCursor cursor(editor.document());
+    cursor.setPosition(original.size() / 2);
+    const QString typed = "value = compute(index, ratio); ";
+    constexpr int Keys = 20000;
+    QElapsedTimer timer;
+    qint64 total = 0;
+    qint64 worst = 0;
+    for (int i = 0; i < Keys; ++i)
+    {
+        timer.start();
+        cursor.insertText(typed.at(i % typed.size()));
+        const qint64 elapsed = timer.nsecsElapsed();
+        total += elapsed;
+        worst = qMax(worst, elapsed);
+    }
+    *averageUs = total / 1000.0 / Keys;
+    *maxUs = worst / 1000.0;
+
+    history.reset();
+    for (int i = 0; i < lines.size(); i += 50)
+        lines[i] += " // changed";
+    const QString replaced = lines.join('\n');
+    cursor.select(QTextCursor::Document);
+    const QString before = editor.toPlainText();
+    cursor.insertText(replaced);
+    *historyBytes = history.memoryUsage();
+    *rawBytes = (before.size() + replaced.size()) * qint64(sizeof(QChar));
+
+    history.undo();
+    *restored = editor.toPlainText() == before;
+}
+
+// Набор с журналом восстановления: стоимость нажатия вместе с записью в
+// журнал (запись на диск идёт по таймеру и сюда не входит), затем
+// восстановление текста из журнала, как после падения.
+void benchJournal(double *averageUs, double *maxUs, double *replayMs, qint64 *journalBytes, bool *recovered)
+{
+    QTemporaryDir dir;
+    const QString original = makeLines(40000).join('\n');
+    QTextEdit editor;
+    editor.setPlainText(original);
+    UndoHistory history(&editor, editor.document());
+    EditJournal journal(dir.path());
+    journal.setDocument(editor.document());
+    QObject::connect(&history, &UndoHistory::textChanged, &journal, &EditJournal::record);
+
+    QTextCursor cursor(editor.document());
+    cursor.setPosition(original.size() / 2);
+    cursor.insertText("// ");
+    journal.sync(); // основа — снимок, дальше только записи правок
+
+    const QString typed = "value = compute(index, ratio);\n";
+    constexpr int Keys = 20000;
+    QElapsedTimer timer;
+    qint64 total = 0;
+    qint64 worst = 0;
+    for (int i = 0; i < Keys; ++i)
+    {
+        timer.start();
+        if (i % 7 == 6)
+            cursor.deletePreviousChar();
+        else
+            cursor.insertText(typed.at(i % typed.size()));
+        const qint64 elapsed = timer.nsecsElapsed();
+        total += elapsed;
+        worst = qMax(worst, elapsed);
+    }
+    *averageUs = total / 1000.0 / Keys;
+    *maxUs = worst / 1000.0;
+    journal.sync();
+    *journalBytes = QFileInfo(journal.fileName()).size();
+
+    timer.start();
+    EditJournal::Recovery recovery;
+    QString error;
+    const bool ok = EditJournal::recover(journal.fileName(), &recovery, &error);
+    *replayMs = timer.nsecsElapsed() / 1e6;
+    *recovered = ok && recovery.complete && recovery.text == editor.toPlainText();
+}
+
+// Файл в 100 тыс. строк переписан снаружи с правкой 50 строк: сравнение
+// в рабочем потоке и применение правок в GUI. Затем одна отмена должна
+// вернуть прежний текст.
+void benchReload(double *diffMs, double *applyMs, int *edits, bool *matched, bool *undone)
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath("generated.cpp");
+    QStringList lines = makeLines(100000);
+    const QString original = lines.join('\n');
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    file.write(original.toUtf8());
+    file.close();
+
+    QTextEdit editor;
+    DocumentManager documents(&editor);
+    documents.setJournalDirectory(dir.path());
+    const int index = documents.add(path);
+    documents.activate(index);
+    QTextCursor(editor.document()).insertText(original);
+    documents.finishLoading(index, TextFormat());
+
+    for (int i = 1000; i < lines.size(); i += 2000)
+        lines[i] = "    regenerated(" + QString::number(i) + ");";
+    const QString changed = lines.join('\n');
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return;
+    file.write(changed.toUtf8());
+    file.close();
+
+    FileReloader reloader;
+    FileReloader::Result result;
+    QEventLoop loop;
+    QObject::connect(&reloader, &FileReloader::reloaded, &loop, [&](const FileReloader::Result &reloaded)
+                     {
+                         result = reloaded;
+                         loop.quit(); });
+    QElapsedTimer timer;
+    timer.start();
+    const DocumentManager::Document &document = documents.document(index);
+    reloader.reload(path, document.text->toRawText(), document.undo->revision());
+    loop.exec();
+    *diffMs = timer.nsecsElapsed() / 1e6;
+
+    timer.start();
+    documents.applyReload(index, result);
+    *applyMs = timer.nsecsElapsed() / 1e6;
+    *edits = result.edits.size();
+    *matched = editor.toPlainText() == changed;
+
+    documents.currentUndo()->undo();
+    *undone = editor.toPlainText() == original;
+}
+
+// Поиск в документе: строка и выражение по 100 тыс. строк QTextEdit и
+// замена всех совпадений одной правкой с отменой одним шагом.
+void benchFindText(double *literalMs, double *regexMs, double *replaceMs, int *matches, bool *undone)
+{
+    const QString original = makeLines(100000).join('\n');
+    QTextEdit editor;
+    editor.setPlainText(original);
+    UndoHistory history(&editor, editor.document());
+    const QString rawText = editor.document()->toRawText();
+
+    DocumentSearcher::Query query;
+    query.pattern = "INDEX";
+    QElapsedTimer timer;
+    timer.start();
+    *matches = DocumentSearcher::findAll(rawText, query).size();
+    *literalMs = timer.nsecsElapsed() / 1e6;
+
+    DocumentSearcher::Query regex;
+    regex.pattern = "\\b(\\w+)\\(";
+    regex.regex = true;
+    regex.caseSensitive = true;
+    timer.start();
+    DocumentSearcher::findAll(rawText, regex);
+    *regexMs = timer.nsecsElapsed() / 1e6;
+
+    timer.start();
+    const DocumentSearcher::Replacement replacement = DocumentSearcher::buildReplacement(rawText, regex, "call_\\1(");
+    QTextCursor cursor(editor.document());
+    cursor.setPosition(int(replacement.position));
+    cursor.setPosition(int(replacement.position + replacement.removed), QTextCursor::KeepAnchor);
+    cursor.beginEditBlock();
+    cursor.insertText(replacement.text);
+    cursor.endEditBlock();
+    *replaceMs = timer.nsecsElapsed() / 1e6;
+
+    history.undo();
+    *undone = editor.toPlainText() == original;
+}
+
+// Файл 100 МБ с миллионом вхождений в режиме больших файлов: поиск в
+// рабочем потоке до последней пачки, замена всех вхождений (сборка
+// текста и правка) и её отмена.
+void benchFindLarge(double *searchMs, double *replaceMs, int *matches, bool *replaced, bool *undone)
+{
+    constexpr int LineCount = 2000000;
+    QByteArray text;
+    text.reserve(qint64(LineCount) * 52);
+    for (int i = 0; i < LineCount; ++i)
+    {
+        text.append(i % 2 ? "    value = compute(needle, ratio); // " : "    total += weight * height;           // ");
+        text.append(QByteArray::number(i).rightJustified(8, '0'));
+        text.append('\n');
+    }
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/large.txt";
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+        file.write(text);
+    }
+    const qint64 originalSize = text.size();
+    text.clear();
+
+    LargeFileView view;
+    view.resize(1000, 800);
+    view.show();
+    view.openFile(fileName);
+    if (!view.hasLineIndex())
+    {
+        QEventLoop loop;
+        QObject::connect(&view, &LargeFileView::lineIndexReady, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    DocumentSearcher searcher;
+    DocumentSearcher::Query query;
+    query.pattern = "needle";
+    query.caseSensitive = true;
+    QEventLoop loop;
+    QObject::connect(&searcher, &DocumentSearcher::finished, &loop, &QEventLoop::quit);
+    QElapsedTimer timer;
+    timer.start();
+    searcher.search(view.snapshot(), query);
+    loop.exec();
+    *searchMs = timer.nsecsElapsed() / 1e6;
+    *matches = searcher.matches().size();
+
+    DocumentSearcher::Replacement replacement;
+    QObject::connect(&searcher, &DocumentSearcher::replaced, &loop, [&](const DocumentSearcher::Replacement &result)
+                     {
+                         replacement = result;
+                         loop.quit(); });
+    timer.start();
+    searcher.replaceAll(view.snapshot(), query, "pin");
+    loop.exec();
+    view.replace(replacement.position, replacement.removed, replacement.bytes);
+    view.viewport()->repaint();
+    *replaceMs = timer.nsecsElapsed() / 1e6;
+    *replaced = view.snapshot().size() == originalSize - qint64(*matches) * 3
+                && DocumentSearcher::findAll(view.snapshot(), query).isEmpty();
+
+    view.undo();
+    *undone = view.snapshot().size() == originalSize && view.snapshot().read(originalSize - 60, 60).contains("needle");
+}
+
+// 50 вкладок по ~600 КБ при бюджете 64 МБ: переключение на недавнюю
+// (тёплую) и на самую старую вкладку, которую пришлось выгрузить и
+// прочитать заново, и оценка памяти всех документов.
+void benchTabs(double *recentMs, double *coldMs, qint64 *memoryBytes, qint64 *allWarmBytes)
+{
+    constexpr int Tabs = 50;
+    const QString text = makeLines(10000).join('\n');
+    QTemporaryDir dir;
+    QTextEdit editor;
+    DocumentManager documents(&editor);
+    documents.setMemoryBudget(qint64(64) * 1024 * 1024);
+
+    const auto load = [&](int index)
+    {
+        if (documents.activate(index))
+            return;
+        QFile file(documents.document(index).filePath);
+        if (file.open(QIODevice::ReadOnly))
+            QTextCursor(editor.document()).insertText(QString::fromUtf8(file.readAll()));
+        documents.finishLoading(index, TextFormat());
+    };
+
+    for (int i = 0; i < Tabs; ++i)
+    {
+        const QString path = QString("%1/file_%2.cpp").arg(dir.path()).arg(i);
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+        file.write(text.toUtf8());
+        file.close();
+        load(documents.add(path));
+        QCoreApplication::processEvents();
+        if (i == 0)
+            *allWarmBytes = documents.memoryUsage() * Tabs;
+    }
+    *memoryBytes = documents.memoryUsage();
+
+    QElapsedTimer timer;
+    timer.start();
+    load(Tabs - 2);
+    QCoreApplication::processEvents(); // отложенная подсветка
+    *recentMs = timer.nsecsElapsed() / 1e6;
+
+    timer.start();
+    load(0);
+    QCoreApplication::processEvents();
+    *coldMs = timer.nsecsElapsed() / 1e6;
+}
+
+// Смена темы на документе в 100 тыс. строк, прокрученном до середины:
+// палитра и перекраска видимых строк против полной повторной подсветки.
+void benchTheme(int *themeCount, double *switchMs, double *maxSwitchMs, double *rehighlightMs)
+{
+    QTextEdit editor;
+    editor.resize(1000, 800);
+    editor.setPlainText(makeLines(100000).join('\n'));
+    SyntaxHighlighter *highlighter = new SyntaxHighlighter(editor.document());
+    editor.show();
+    waitForHighlightCache(*highlighter);
+    editor.verticalScrollBar()->setValue(editor.verticalScrollBar()->maximum() / 2);
+    highlighter->setViewport(editor.cursorForPosition(QPoint(0, 0)).block(),
+                             editor.cursorForPosition(QPoint(0, editor.viewport()->height())).block());
+    editor.viewport()->repaint();
+
+    const QPalette defaultPalette = QApplication::palette();
+    const QVector<Theme> themes = Theme::loadAll();
+    *themeCount = themes.size();
+    QElapsedTimer timer;
+    double total = 0;
+    int switches = 0;
+    for (int round = 0; round < 4; ++round)
+    {
+        for (const Theme &theme : themes)
+        {
+            timer.start();
+            Theme::setCurrent(theme);
+            QApplication::setPalette(theme.hasPalette ? theme.palette : defaultPalette);
+            highlighter->restyle(editor.cursorForPosition(QPoint(0, 0)).block(),
+                                 editor.cursorForPosition(QPoint(0, editor.viewport()->height())).block());
+            editor.viewport()->repaint();
+            const double ms = timer.nsecsElapsed() / 1e6;
+            total += ms;
+            *maxSwitchMs = qMax(*maxSwitchMs, ms);
+            ++switches;
+        }
+    }
+    *switchMs = switches > 0 ? total / switches : 0;
+
+    timer.start();
+    highlighter->rehighlight();
+    editor.viewport()->repaint();
+    *rehighlightMs = timer.nsecsElapsed() / 1e6;
+    QApplication::setPalette(defaultPalette);
+}
+
+// Фиксированный корпус: 400 файлов по ~256 КБ, редкая метка в каждой 97-й строке.
+qint64 makeSearchCorpus(const QString &root)
+{
+    const QStringList lines = makeLines(4000);
+    qint64 bytes = 0;
+    for (int file = 0; file < 400; ++file)
+    {
+        QDir(root).mkpath(QString("module_%1").arg(file % 20));
+        QFile out(QString("%1/module_%2/file_%3.cpp").arg(root).arg(file % 20).arg(file));
+        if (!out.open(QIODevice::WriteOnly))
+            return 0;
+        QByteArray content;
+        for (int i = 0; i < lines.size(); ++i)
+        {
+            content += lines[i].toUtf8();
+            if (i % 97 == 0)
+                content += " // needle_marker";
+            content += '\n';
+        }
+        bytes += out.write(content);
+    }
+    return bytes;
+}
+
+// Однопоточный обход тех же файлов с QByteArray::indexOf — точка отсчёта.
+double benchSearchBaseline(const QString &root, int *matches)
+{
+    QStringList files;
+    const QDir rootDir(root);
+    for (const QString &module : rootDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        for (const QString &name : QDir(rootDir.filePath(module)).entryList(QDir::Files))
+            files.append(rootDir.filePath(module + '/' + name));
+    }
+
+    qint64 bytes = 0;
+    *matches = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const QString &fileName : files)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+        const QByteArray content = file.readAll();
+        bytes += content.size();
+        for (qsizetype pos = content.indexOf("needle_marker"); pos >= 0; pos = content.indexOf("needle_marker", pos + 1))
+            ++*matches;
+    }
+    return bytes / 1048576.0 / (timer.nsecsElapsed() / 1e9);
+}
+
+double benchSearch(const QString &root, const QString &pattern, bool regex, bool caseSensitive, int *matches)
+{
+    FileSearcher searcher;
+    QEventLoop loop;
+    qint64 bytes = 0;
+    QObject::connect(&searcher, &FileSearcher::finished, [&](int, int found, qint64 searched, qint64)
+                     {
+                         *matches = found;
+                         bytes = searched;
+                         loop.quit(); });
+    QElapsedTimer timer;
+    timer.start();
+    searcher.start(root, pattern, regex, caseSensitive);
+    loop.exec();
+    return bytes / 1048576.0 / (timer.nsecsElapsed() / 1e9);
+}
+
+// Задержка Ctrl+P на 500k путях: набор запроса по буквам и отдельные запросы.
+void benchFileFinder(int *paths, double *averageMs, double *maxMs)
+{
+    const QStringList areas = {"src", "lib", "tests", "tools", "third_party", "docs"};
+    const QStringList words = {"widget", "parser", "network", "render", "storage", "model", "view", "client",
+                               "server", "cache", "thread", "buffer", "layout", "config", "codec", "index"};
+    const QStringList suffixes = {".cpp", ".h", ".py", ".json", ".md", ".txt"};
+    PathTable table;
+    table.reserve(500000, 500000 * 48);
+    for (int i = 0; i < 500000; ++i)
+    {
+        table.add(QString("%1/%2_%3/%4/%5%6%7")
+                      .arg(areas[i % areas.size()], words[i / 7 % words.size()])
+                      .arg(i % 500)
+                      .arg(words[i / 13 % words.size()], words[i % words.size()])
+                      .arg(i)
+                      .arg(suffixes[i / 3 % suffixes.size()]));
+    }
+    *paths = table.size();
+
+    const QStringList queries = {"w", "wi", "wid", "widg", "widge", "widget", "widgetcpp",
+                                 "p", "pa", "par", "pars", "parser1", "nc", "srcnet", "tpcache12", "rndr.h", "zzz"};
+    constexpr int Rounds = 20;
+    QElapsedTimer timer;
+    qint64 total = 0;
+    qint64 worst = 0;
+    for (int round = 0; round < Rounds; ++round)
+    {
+        for (const QString &query : queries)
+        {
+            timer.start();
+            const QVector<int> result = table.match(query);
+            const qint64 elapsed = timer.nsecsElapsed();
+            Q_UNUSED(result);
+            total += elapsed;
+            worst = qMax(worst, elapsed);
+        }
+    }
+    *averageMs = total / 1e6 / (Rounds * queries.size());
+    *maxMs = worst / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    // --json <файл>: результаты ещё и в JSON для сравнения между версиями
+    QString jsonPath;
+    const QStringList arguments = QCoreApplication::arguments();
+    const int jsonArgument = arguments.indexOf("--json");
+    if (jsonArgument > 0 && jsonArgument + 1 < arguments.size())
+        jsonPath = arguments[jsonArgument + 1];
+
+    const QStringList lines = makeLines(50000);
+    const double rules = benchRuleList(lines);
+    const double lexer = benchLexer(lines);
+    const double highlighter = benchHighlighter(lines);
+
+    std::printf("highlighter: rule list  %12.0f lines/s\n", rules);
+    std::printf("highlighter: lexer      %12.0f lines/s\n", lexer);
+    std::printf("highlighter: speedup    %12.1fx\n", lexer / rules);
+    std::printf("highlighter: document   %12.0f lines/s\n", highlighter);
+    record("highlighter.rule_list_lines_per_s", rules);
+    record("highlighter.lexer_lines_per_s", lexer);
+    record("highlighter.document_lines_per_s", highlighter);
+
+    double pasteMs = 0;
+    double backgroundMs = 0;
+    benchPaste(&pasteMs, &backgroundMs);
+    std::printf("highlighter: paste      %12.1f ms to first paint, %.1f ms whole document\n", pasteMs, backgroundMs);
+    record("highlighter.paste_first_paint_ms", pasteMs);
+    record("highlighter.paste_background_ms", backgroundMs);
+
+    double loadMBs = 0;
+    double saveMBs = 0;
+    double snapshotMs = 0;
+    benchFileIo(&loadMBs, &saveMBs, &snapshotMs);
+    std::printf("file:        load       %12.0f MB/s\n", loadMBs);
+    std::printf("file:        save       %12.0f MB/s, %.1f ms snapshot of 32M chars\n", saveMBs, snapshotMs);
+    record("file.load_mb_per_s", loadMBs);
+    record("file.save_mb_per_s", saveMBs);
+    record("file.save_snapshot_ms", snapshotMs);
+
+    for (int lineCount : {1000, 10000, 100000})
+    {
+        double keyAverageUs = 0;
+        double keyMaxUs = 0;
+        benchKeystroke(lineCount, &keyAverageUs, &keyMaxUs);
+        std::printf("keystroke:   %6dk    %12.1f us average, %.1f us max\n", lineCount / 1000, keyAverageUs, keyMaxUs);
+        results.insert(QString("keystroke.%1k_average_us").arg(lineCount / 1000), keyAverageUs);
+        results.insert(QString("keystroke.%1k_max_us").arg(lineCount / 1000), keyMaxUs);
+    }
+
+    for (bool wrap : {false, true})
+    {
+        double openMs = 0;
+        double stepAverageUs = 0;
+        double stepMaxUs = 0;
+        benchLongLine(wrap, &openMs, &stepAverageUs, &stepMaxUs);
+        const char *mode = wrap ? "wrapped" : "plain";
+        std::printf("long line:   %-8s   %12.1f ms open, %.1f us average step, %.1f us max\n", mode, openMs,
+                    stepAverageUs, stepMaxUs);
+        results.insert(QString("long_line.%1_open_ms").arg(mode), openMs);
+        results.insert(QString("long_line.%1_step_average_us").arg(mode), stepAverageUs);
+        results.insert(QString("long_line.%1_step_max_us").arg(mode), stepMaxUs);
+    }
+
+    double scanMBs = 0;
+    double lineQueryNs = 0;
+    double lineEditUs = 0;
+    double gotoMs = 0;
+    bool landed = false;
+    benchLineIndex(&scanMBs, &lineQueryNs, &lineEditUs, &gotoMs, &landed);
+    std::printf("lines:       scan       %12.0f MB/s (10M lines)\n", scanMBs);
+    std::printf("lines:       query      %12.1f ns\n", lineQueryNs);
+    std::printf("lines:       edit       %12.2f us\n", lineEditUs);
+    std::printf("lines:       goto       %12.2f ms to line 9000000 (%s)\n", gotoMs,
+                check("line_index.goto_landed", landed, "ok", "WRONG LINE"));
+    record("line_index.scan_mb_per_s", scanMBs);
+    record("line_index.query_ns", lineQueryNs);
+    record("line_index.edit_us", lineEditUs);
+    record("line_index.goto_ms", gotoMs);
+
+    qint64 maxStallMs = 0;
+    const double console = benchConsole(1000000, &maxStallMs);
+    std::printf("console:     append     %12.0f lines/s\n", console);
+    std::printf("console:     max stall  %12lld ms\n", maxStallMs);
+    record("console.append_lines_per_s", console);
+    record("console.max_stall_ms", maxStallMs);
+
+    const double terminalPlain = benchTerminal("  1234  src/module_0042.cpp: int value = compute(42); // comment\r\n",
+                                               256 * 1024 * 1024);
+    const double terminalColor = benchTerminal("\x1b[01;34mdirectory\x1b[0m  \x1b[01;32mscript.sh\x1b[0m  "
+                                               "\x1b[38;5;208mфайл.txt\x1b[0m  \x1b[38;2;255;128;0mdata\x1b[0m\r\n",
+                                               128 * 1024 * 1024);
+    std::printf("terminal:    plain      %12.1f MB/s\n", terminalPlain);
+    std::printf("terminal:    colored    %12.1f MB/s\n", terminalColor);
+    record("terminal.plain_mb_per_s", terminalPlain);
+    record("terminal.colored_mb_per_s", terminalColor);
+
+    int diagnostics = 0;
+    const double diagnosticLines = benchDiagnostics(1000000, &diagnostics);
+    std::printf("build:       parse      %12.0f lines/s (%d diagnostics)\n", diagnosticLines, diagnostics);
+    record("build.parse_lines_per_s", diagnosticLines);
+
+    double averageUs = 0;
+    double maxUs = 0;
+    int words = 0;
+    benchCompletion(&averageUs, &maxUs, &words);
+    std::printf("completion:  words      %12d\n", words);
+    std::printf("completion:  average    %12.1f us\n", averageUs);
+    std::printf("completion:  max        %12.1f us\n", maxUs);
+    record("completion.average_us", averageUs);
+    record("completion.max_us", maxUs);
+
+    double undoAverageUs = 0;
+    double undoMaxUs = 0;
+    qint64 historyBytes = 0;
+    qint64 rawBytes = 0;
+    bool restored = false;
+    benchUndo(&undoAverageUs, &undoMaxUs, &historyBytes, &rawBytes, &restored);
+    std::printf("undo:        keystroke  %12.1f us average, %.1f us max\n", undoAverageUs, undoMaxUs);
+    std::printf("undo:        replace    %12lld KB history for %lld KB raw (%s)\n", historyBytes / 1024,
+                rawBytes / 1024, check("undo.replace_undone", restored, "undo ok", "UNDO MISMATCH"));
+    record("undo.keystroke_average_us", undoAverageUs);
+    record("undo.keystroke_max_us", undoMaxUs);
+    record("undo.history_kb", historyBytes / 1024.0);
+
+    double journalAverageUs = 0;
+    double journalMaxUs = 0;
+    double replayMs = 0;
+    qint64 journalBytes = 0;
+    bool recovered = false;
+    benchJournal(&journalAverageUs, &journalMaxUs, &replayMs, &journalBytes, &recovered);
+    std::printf("journal:     keystroke  %12.1f us average, %.1f us max\n", journalAverageUs, journalMaxUs);
+    std::printf("journal:     replay     %12.2f ms for %lld KB (%s)\n", replayMs, journalBytes / 1024,
+                check("journal.recovered", recovered, "recovery ok", "RECOVERY MISMATCH"));
+    record("journal.keystroke_average_us", journalAverageUs);
+    record("journal.keystroke_max_us", journalMaxUs);
+    record("journal.replay_ms", replayMs);
+
+    double reloadDiffMs = 0;
+    double reloadApplyMs = 0;
+    int reloadEdits = 0;
+    bool reloadMatched = false;
+    bool reloadUndone = false;
+    benchReload(&reloadDiffMs, &reloadApplyMs, &reloadEdits, &reloadMatched, &reloadUndone);
+    std::printf("reload:      diff       %12.2f ms (100k lines, %d edits)\n", reloadDiffMs, reloadEdits);
+    std::printf("reload:      apply      %12.2f ms (%s, %s)\n", reloadApplyMs,
+                check("reload.text_matched", reloadMatched, "text ok", "TEXT MISMATCH"),
+                check("reload.undone", reloadUndone, "undo ok", "UNDO MISMATCH"));
+    record("reload.diff_ms", reloadDiffMs);
+    record("reload.apply_ms", reloadApplyMs);
+
+    double findLiteralMs = 0;
+    double findRegexMs = 0;
+    double findReplaceMs = 0;
+    int findMatches = 0;
+    bool findUndone = false;
+    benchFindText(&findLiteralMs, &findRegexMs, &findReplaceMs, &findMatches, &findUndone);
+    std::printf("find:        literal    %12.2f ms (100k lines, %d matches)\n", findLiteralMs, findMatches);
+    std::printf("find:        regex      %12.2f ms\n", findRegexMs);
+    std::printf("find:        replace    %12.2f ms (%s)\n", findReplaceMs,
+                check("find.text_replace_undone", findUndone, "undo ok", "UNDO MISMATCH"));
+    record("find.text_literal_ms", findLiteralMs);
+    record("find.text_regex_ms", findRegexMs);
+    record("find.text_replace_all_ms", findReplaceMs);
+
+    double largeSearchMs = 0;
+    double largeReplaceMs = 0;
+    int largeMatches = 0;
+    bool largeReplaced = false;
+    bool largeUndone = false;
+    benchFindLarge(&largeSearchMs, &largeReplaceMs, &largeMatches, &largeReplaced, &largeUndone);
+    std::printf("find:        large      %12.2f ms (100 MB, %d matches)\n", largeSearchMs, largeMatches);
+    std::printf("find:        replace    %12.2f ms (%s, %s)\n", largeReplaceMs,
+                check("find.large_replaced", largeReplaced, "text ok", "TEXT MISMATCH"),
+                check("find.large_undone", largeUndone, "undo ok", "UNDO MISMATCH"));
+    record("find.large_search_ms", largeSearchMs);
+    record("find.large_replace_all_ms", largeReplaceMs);
+
+    double recentTabMs = 0;
+    double coldTabMs = 0;
+    qint64 tabsBytes = 0;
+    qint64 allWarmBytes = 0;
+    benchTabs(&recentTabMs, &coldTabMs, &tabsBytes, &allWarmBytes);
+    std::printf("tabs:        recent     %12.2f ms\n", recentTabMs);
+    std::printf("tabs:        reload     %12.2f ms\n", coldTabMs);
+    std::printf("tabs:        memory     %12lld MB for 50 tabs (%lld MB if all warm)\n", tabsBytes / 1048576,
+                allWarmBytes / 1048576);
+    record("tabs.recent_ms", recentTabMs);
+    record("tabs.reload_ms", coldTabMs);
+    record("tabs.memory_mb", tabsBytes / 1048576.0);
+
+    int themeCount = 0;
+    double themeSwitchMs = 0;
+    double themeMaxMs = 0;
+    double rehighlightMs = 0;
+    benchTheme(&themeCount, &themeSwitchMs, &themeMaxMs, &rehighlightMs);
+    std::printf("theme:       switch     %12.2f ms average, %.2f ms max (%d themes, 100k lines)\n", themeSwitchMs,
+                themeMaxMs, themeCount);
+    std::printf("theme:       rehighlight%12.2f ms\n", rehighlightMs);
+    record("theme.switch_average_ms", themeSwitchMs);
+    record("theme.switch_max_ms", themeMaxMs);
+    record("theme.rehighlight_ms", rehighlightMs);
+
+    int paths = 0;
+    double finderAverageMs = 0;
+    double finderMaxMs = 0;
+    benchFileFinder(&paths, &finderAverageMs, &finderMaxMs);
+    std::printf("finder:      paths      %12d\n", paths);
+    std::printf("finder:      average    %12.2f ms\n", finderAverageMs);
+    std::printf("finder:      max        %12.2f ms\n", finderMaxMs);
+    record("finder.average_ms", finderAverageMs);
+    record("finder.max_ms", finderMaxMs);
+
+    QTemporaryDir corpus;
+    const qint64 corpusBytes = makeSearchCorpus(corpus.path());
+    int matches = 0;
+    benchSearchBaseline(corpus.path(), &matches); // прогрев кэша страниц
+    const double baseline = benchSearchBaseline(corpus.path(), &matches);
+    std::printf("search:      corpus     %12lld MB\n", corpusBytes / 1048576);
+    std::printf("search:      baseline   %12.0f MB/s (%d matches)\n", baseline, matches);
+    record("search.baseline_mb_per_s", baseline);
+    const double literal = benchSearch(corpus.path(), "needle_marker", false, true, &matches);
+    std::printf("search:      literal    %12.0f MB/s (%d matches)\n", literal, matches);
+    record("search.literal_mb_per_s", literal);
+    const double folded = benchSearch(corpus.path(), "NEEDLE_marker", false, false, &matches);
+    std::printf("search:      nocase     %12.0f MB/s (%d matches)\n", folded, matches);
+    record("search.nocase_mb_per_s", folded);
+    const double regex = benchSearch(corpus.path(), "needle_\\w+", true, true, &matches);
+    std::printf("search:      regex      %12.0f MB/s (%d matches)\n", regex, matches);
+    record("search.regex_mb_per_s", regex);
+
+    if (!jsonPath.isEmpty())
+    {
+        QJsonObject root;
+        root.insert("qt", QLatin1String(qVersion()));
+        root.insert("platform", QSysInfo::prettyProductName());
+        root.insert("cpu", QSysInfo::currentCpuArchitecture());
+        root.insert("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+        root.insert("results", results);
+        QFile out(jsonPath);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            std::fprintf(stderr, "cannot write %s\n", qPrintable(jsonPath));
+            return 1;
+        }
+        out.write(QJsonDocument(root).toJson());
+    }
+    if (mismatches > 0)
+    {
+        std::fprintf(stderr, "%d correctness check(s) failed\n", mismatches);
+        return 2;
+    }
+    return 0;
+}
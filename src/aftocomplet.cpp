@@ -1,13 +1,135 @@
 #include "aftocomplet.h"
+#include "lexer.h"
+#include "wordindex.h"
 #include <QStringList>
 #include <QCompleter>
+#include <QStringListModel>
+#include <QAbstractItemView>
+#include <QScrollBar>
+#include <QKeyEvent>
+#include <QTimer>
+#include <QTextBlock>
 #include <QTextEdit>
 
+namespace {
+
+constexpr int AutoPopupLength = 3;
+
+bool isWordChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == '_';
+}
+
+} // namespace
+
 aftocomplet::aftocomplet(QTextEdit *editor, QObject *parent)
-    : editor(editor)
+    : QObject(parent), editor(editor)
+{
+    keywords = Lexer::defaultKeywords();
+
+    model = new QStringListModel(this);
+    completer = new QCompleter(model, this);
+    completer->setWidget(editor);
+    completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    connect(completer, qOverload<const QString &>(&QCompleter::activated), this, &aftocomplet::insertCompletion);
+
+    editor->installEventFilter(this);
+    index();
+}
+
+WordIndex *aftocomplet::index()
 {
-    Q_UNUSED(parent); // Если parent не используется, можно игнорировать
-    QStringList keywords = {
-        "int", "float", "if", "else", "while", "return", "class",
-        "import", "start", "print", "function", "void", "break", "delete"};
-}
\ No newline at end of file
+    QTextDocument *document = editor->document();
+    WordIndex *wordIndex = document->findChild<WordIndex *>(QString(), Qt::FindDirectChildrenOnly);
+    if (!wordIndex)
+    {
+        wordIndex = new WordIndex(document);
+        wordIndex->addKeywords(keywords);
+    }
+    return wordIndex;
+}
+
+QList<QString> aftocomplet::suggestCompletions(const QString &text)
+{
+    return index()->complete(text);
+}
+
+void aftocomplet::showCompletionPopup(const QString &text)
+{
+    const QStringList suggestions = suggestCompletions(text);
+    if (suggestions.isEmpty())
+    {
+        completer->popup()->hide();
+        return;
+    }
+
+    model->setStringList(suggestions);
+    QRect rect = editor->cursorRect();
+    rect.setWidth(completer->popup()->sizeHintForColumn(0) + completer->popup()->verticalScrollBar()->sizeHint().width());
+    completer->complete(rect);
+    completer->popup()->setCurrentIndex(model->index(0, 0));
+}
+
+void aftocomplet::complete()
+{
+    showCompletionPopup(wordBeforeCursor());
+}
+
+QString aftocomplet::wordBeforeCursor() const
+{
+    const QTextCursor cursor = editor->textCursor();
+    const QString text = cursor.block().text();
+    const int end = cursor.positionInBlock();
+    int start = end;
+    while (start > 0 && isWordChar(text.at(start - 1)))
+        --start;
+    return text.mid(start, end - start);
+}
+
+void aftocomplet::insertCompletion(const QString &completion)
+{
+    const int prefixLength = wordBeforeCursor().size();
+    QTextCursor cursor = editor->textCursor();
+    cursor.setPosition(cursor.position() - prefixLength, QTextCursor::KeepAnchor);
+    cursor.insertText(completion);
+    editor->setTextCursor(cursor);
+}
+
+bool aftocomplet::eventFilter(QObject *obj, QEvent *event)
+{
+    if (obj == editor && event->type() == QEvent::KeyPress)
+    {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
+        if (completer->popup()->isVisible())
+        {
+            // Эти клавиши обрабатывает сам QCompleter.
+            switch (keyEvent->key())
+            {
+            case Qt::Key_Enter:
+            case Qt::Key_Return:
+            case Qt::Key_Escape:
+            case Qt::Key_Tab:
+            case Qt::Key_Backtab:
+                keyEvent->ignore();
+                return true;
+            default:
+                break;
+            }
+        }
+
+        // Подсказка появляется сама, когда набрано несколько букв слова.
+        const QString text = keyEvent->text();
+        if (!text.isEmpty() && (keyEvent->modifiers() & ~Qt::ShiftModifier) == Qt::NoModifier)
+        {
+            const bool wordKey = isWordChar(text.at(0));
+            QTimer::singleShot(0, this, [this, wordKey]
+                               {
+                                   const QString prefix = wordBeforeCursor();
+                                   if (wordKey && prefix.size() >= AutoPopupLength)
+                                       showCompletionPopup(prefix);
+                                   else
+                                       completer->popup()->hide(); });
+        }
+    }
+    return QObject::eventFilter(obj, event);
+}
@@ -1,19 +1,40 @@
 #ifndef AFTOCOMPLET_H
 #define AFTOCOMPLET_H
 
+#include <QObject>
 #include <QString>
 #include <QList>
 #include <QTextEdit>
 
-class aftocomplet {
+class QCompleter;
+class QStringListModel;
+class WordIndex;
+
+class aftocomplet : public QObject {
+    Q_OBJECT
+
 public:
     explicit aftocomplet(QTextEdit *editor, QObject *parent = nullptr);
     QList<QString> suggestCompletions(const QString &text);
     void showCompletionPopup(const QString &text);
 
+public slots:
+    void complete();
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event) override;
+
+private slots:
+    void insertCompletion(const QString &completion);
+
 private:
+    WordIndex *index();
+    QString wordBeforeCursor() const;
+
     QTextEdit *editor;
     QStringList keywords;
+    QCompleter *completer;
+    QStringListModel *model;
 };
 
-#endif // AFTOCOMPLET_H
\ No newline at end of file
+#endif // AFTOCOMPLET_H
@@ -0,0 +1,33 @@
+#ifndef BLOCKDATA_H
+#define BLOCKDATA_H
+
+#include <QTextBlockUserData>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include "wordindex.h"
+
+// Данные, которые подсветка и автодополнение хранят в блоке документа.
+// Целого userState не хватает, чтобы запомнить, чем закрывается строка
+// или комментарий, поэтому сама последовательность лежит здесь.
+class BlockData : public QTextBlockUserData {
+public:
+    ~BlockData() override
+    {
+        // Блок удалён из документа — его слова больше не встречаются.
+        if (wordIndex)
+            wordIndex->removeWords(words);
+    }
+
+    QString closing;
+    QStringList words;
+    QPointer<WordIndex> wordIndex;
+    int theme = 0; // поколение темы, которой раскрашен блок (Theme::generation)
+
+    // Чем раскрашен блок: Pending — ещё ничем, Lexed — лексером в потоке
+    // GUI, иначе — сборкой кэша подсветки с этим номером (HighlightCache::generation).
+    enum { Pending = -1, Lexed = 0 };
+    int highlighted = Pending;
+};
+
+#endif // BLOCKDATA_H
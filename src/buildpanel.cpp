@@ -0,0 +1,183 @@
+#include "buildpanel.h"
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QStyle>
+#include <QTabWidget>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+constexpr int LineRole = Qt::UserRole;
+constexpr int PathRole = Qt::UserRole + 1;
+constexpr int SlowestSteps = 30;
+
+QTreeWidgetItem *addTimeItem(QTreeWidgetItem *parent, const QString &name, qint64 ms)
+{
+    QTreeWidgetItem *item = new QTreeWidgetItem(parent, {name, QString::number(ms)});
+    item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+QString stepName(const BuildProfile::Step &step)
+{
+    return step.outputCount > 1 ? QString("%1 (+%2)").arg(step.output).arg(step.outputCount - 1) : step.output;
+}
+
+} // namespace
+
+BuildPanel::BuildPanel(QWidget *parent)
+    : QWidget(parent)
+{
+    problemTree = new QTreeWidget(this);
+    problemTree->setColumnCount(3);
+    problemTree->setHeaderLabels({"Сообщение", "Файл", "Строка"});
+    problemTree->setUniformRowHeights(true);
+    problemTree->header()->setStretchLastSection(false);
+    problemTree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    profileTree = new QTreeWidget(this);
+    profileTree->setColumnCount(2);
+    profileTree->setHeaderLabels({"Шаг", "мс"});
+    profileTree->setUniformRowHeights(true);
+    profileTree->header()->setStretchLastSection(false);
+    profileTree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    tabs = new QTabWidget(this);
+    tabs->addTab(problemTree, QString());
+    tabs->addTab(profileTree, "Время сборки");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(tabs);
+
+    connect(problemTree, &QTreeWidget::itemActivated, this, &BuildPanel::onItemActivated);
+    updateTitles();
+}
+
+void BuildPanel::clear()
+{
+    problemTree->clear();
+    profileTree->clear();
+    seen.clear();
+    lastMessage = nullptr;
+    lastMessageDuplicate = false;
+    errors = 0;
+    warnings = 0;
+    tabs->setCurrentWidget(problemTree);
+    updateTitles();
+}
+
+void BuildPanel::addDiagnostics(const QVector<Diagnostic> &diagnostics)
+{
+    problemTree->setUpdatesEnabled(false);
+    for (const Diagnostic &diagnostic : diagnostics)
+    {
+        QTreeWidgetItem *parentItem = nullptr;
+        QStyle::StandardPixmap icon = QStyle::SP_MessageBoxInformation;
+        if (diagnostic.severity == Diagnostic::Note)
+        {
+            // Примечание к уже показанному сообщению не повторяем.
+            if (lastMessageDuplicate)
+                continue;
+            parentItem = lastMessage;
+        }
+        else
+        {
+            const QString key = QString("%1|%2|%3|%4|%5")
+                                    .arg(int(diagnostic.severity))
+                                    .arg(diagnostic.filePath)
+                                    .arg(diagnostic.line)
+                                    .arg(diagnostic.column)
+                                    .arg(diagnostic.message);
+            lastMessageDuplicate = seen.contains(key);
+            if (lastMessageDuplicate)
+                continue;
+            seen.insert(key);
+            if (diagnostic.severity == Diagnostic::Error)
+            {
+                ++errors;
+                icon = QStyle::SP_MessageBoxCritical;
+            }
+            else
+            {
+                ++warnings;
+                icon = QStyle::SP_MessageBoxWarning;
+            }
+        }
+
+        QTreeWidgetItem *item = parentItem ? new QTreeWidgetItem(parentItem) : new QTreeWidgetItem(problemTree);
+        item->setIcon(0, style()->standardIcon(icon));
+        item->setText(0, diagnostic.code.isEmpty() ? diagnostic.message : diagnostic.code + ": " + diagnostic.message);
+        item->setToolTip(0, item->text(0));
+        if (!diagnostic.filePath.isEmpty())
+        {
+            item->setText(1, QFileInfo(diagnostic.filePath).fileName());
+            item->setToolTip(1, diagnostic.filePath);
+            item->setData(0, PathRole, diagnostic.filePath);
+        }
+        if (diagnostic.line > 0)
+        {
+            item->setText(2, diagnostic.column > 0 ? QString("%1:%2").arg(diagnostic.line).arg(diagnostic.column)
+                                                   : QString::number(diagnostic.line));
+            item->setData(0, LineRole, diagnostic.line);
+        }
+        if (diagnostic.severity != Diagnostic::Note)
+            lastMessage = item;
+    }
+    problemTree->setUpdatesEnabled(true);
+    updateTitles();
+}
+
+void BuildPanel::setProfile(const BuildProfile &profile)
+{
+    profileTree->clear();
+    if (profile.isEmpty())
+        return;
+
+    const double parallelism = profile.wallMs > 0 ? double(profile.totalMs) / profile.wallMs : 0.0;
+    QTreeWidgetItem *summary = new QTreeWidgetItem(profileTree, {QString("Сборка: %1 шагов, сумма %2 мс, параллельность %3")
+                                                                     .arg(profile.steps.size())
+                                                                     .arg(profile.totalMs)
+                                                                     .arg(parallelism, 0, 'f', 1),
+                                                                 QString::number(profile.wallMs)});
+    summary->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+
+    QTreeWidgetItem *slowest = new QTreeWidgetItem(profileTree, {"Самые долгие шаги"});
+    for (int i = 0; i < qMin(SlowestSteps, int(profile.steps.size())); ++i)
+        addTimeItem(slowest, stepName(profile.steps[i]), profile.steps[i].durationMs());
+    slowest->setExpanded(true);
+
+    QTreeWidgetItem *targets = new QTreeWidgetItem(profileTree, {"Цели"});
+    for (const BuildProfile::Target &target : profile.targets)
+        addTimeItem(targets, QString("%1 (%2 шагов)").arg(target.name).arg(target.steps), target.totalMs);
+
+    // Путь восстановлен по времени окончания шагов, зависимостей в журнале нет.
+    qint64 pathMs = 0;
+    QTreeWidgetItem *path = new QTreeWidgetItem(profileTree, {"Критический путь (оценка по времени)"});
+    for (int step : profile.criticalPath)
+    {
+        addTimeItem(path, stepName(profile.steps[step]), profile.steps[step].durationMs());
+        pathMs += profile.steps[step].durationMs();
+    }
+    path->setText(1, QString::number(pathMs));
+    path->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+    path->setExpanded(true);
+}
+
+void BuildPanel::showProfile()
+{
+    tabs->setCurrentWidget(profileTree);
+}
+
+void BuildPanel::onItemActivated(QTreeWidgetItem *item)
+{
+    const QString filePath = item->data(0, PathRole).toString();
+    if (!filePath.isEmpty())
+        emit locationActivated(filePath, qMax(1, item->data(0, LineRole).toInt()));
+}
+
+void BuildPanel::updateTitles()
+{
+    tabs->setTabText(tabs->indexOf(problemTree), QString("Проблемы (ошибок: %1, предупреждений: %2)").arg(errors).arg(warnings));
+}
@@ -0,0 +1,51 @@
+#ifndef BUILDPANEL_H
+#define BUILDPANEL_H
+
+#include <QSet>
+#include <QVector>
+#include <QWidget>
+#include "buildprofile.h"
+#include "diagnosticparser.h"
+
+class QTabWidget;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Панель сборки: вкладка "Проблемы" со списком ошибок и предупреждений
+// (пополняется по ходу сборки, примечания вкладываются в предыдущее
+// сообщение, повторы из разных единиц трансляции отбрасываются)
+// и вкладка "Время сборки" с профилем по журналу Ninja.
+class BuildPanel : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit BuildPanel(QWidget *parent = nullptr);
+
+    void clear();
+    void addDiagnostics(const QVector<Diagnostic> &diagnostics);
+    void setProfile(const BuildProfile &profile);
+    void showProfile();
+
+    int errorCount() const { return errors; }
+    int warningCount() const { return warnings; }
+
+signals:
+    void locationActivated(const QString &filePath, int line);
+
+private slots:
+    void onItemActivated(QTreeWidgetItem *item);
+
+private:
+    void updateTitles();
+
+    QTabWidget *tabs;
+    QTreeWidget *problemTree;
+    QTreeWidget *profileTree;
+    QSet<QString> seen;
+    QTreeWidgetItem *lastMessage = nullptr; // к нему крепятся примечания
+    bool lastMessageDuplicate = false;
+    int errors = 0;
+    int warnings = 0;
+};
+
+#endif // BUILDPANEL_H
@@ -0,0 +1,151 @@
+#include "buildprofile.h"
+#include <QByteArrayView>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+constexpr int LogFields = 5; // start, end, mtime, output, command hash
+
+} // namespace
+
+BuildProfile BuildProfile::fromNinjaLog(const QByteArray &log)
+{
+    QVector<Step> raw;
+    bool knownVersion = false;
+    qint64 lastEnd = -1;
+    QByteArrayView lastHash;
+
+    for (qsizetype from = 0; from < log.size();)
+    {
+        qsizetype newline = log.indexOf('\n', from);
+        if (newline < 0)
+            newline = log.size();
+        QByteArrayView line(log.constData() + from, newline - from);
+        from = newline + 1;
+        if (line.endsWith('\r'))
+            line.chop(1);
+
+        if (line.startsWith('#'))
+        {
+            const QByteArrayView header("# ninja log v");
+            if (line.startsWith(header))
+                knownVersion = line.sliced(header.size()).toInt() >= 5;
+            continue;
+        }
+        if (!knownVersion || line.isEmpty())
+            continue;
+
+        QByteArrayView fields[LogFields];
+        int count = 0;
+        for (qsizetype at = 0; count < LogFields;)
+        {
+            const qsizetype tab = line.indexOf('\t', at);
+            fields[count++] = tab < 0 ? line.sliced(at) : line.sliced(at, tab - at);
+            if (tab < 0)
+                break;
+            at = tab + 1;
+        }
+        if (count < 4)
+            continue;
+
+        bool startOk = false;
+        bool endOk = false;
+        const qint64 start = fields[0].toLongLong(&startOk);
+        const qint64 end = fields[1].toLongLong(&endOk);
+        if (!startOk || !endOk || end < start)
+            continue;
+
+        // Новая сборка начинает отсчёт заново.
+        if (end < lastEnd)
+            raw.clear();
+        lastEnd = end;
+
+        // Шаг с несколькими выходами записан подряд строками с одинаковым временем и хэшем.
+        const QByteArrayView hash = count > 4 ? fields[4] : QByteArrayView();
+        if (!raw.isEmpty() && raw.last().startMs == start && raw.last().endMs == end && hash == lastHash)
+        {
+            ++raw.last().outputCount;
+            continue;
+        }
+        lastHash = hash;
+        raw.append({start, end, QString::fromUtf8(fields[3]), 1});
+    }
+
+    BuildProfile profile;
+    if (raw.isEmpty())
+        return profile;
+
+    std::stable_sort(raw.begin(), raw.end(), [](const Step &a, const Step &b)
+                     { return a.endMs < b.endMs; });
+
+    // Критический путь: от последнего закончившегося шага назад,
+    // к шагу, который закончился последним до начала текущего.
+    QVector<int> path;
+    for (int at = raw.size() - 1; at >= 0;)
+    {
+        path.prepend(at);
+        const qint64 start = raw[at].startMs;
+        const auto previous = std::upper_bound(raw.begin(), raw.begin() + at, start, [](qint64 value, const Step &step)
+                                               { return value < step.endMs; });
+        at = int(previous - raw.begin()) - 1;
+    }
+
+    qint64 firstStart = raw.first().startMs;
+    QHash<QString, Target> targets;
+    for (const Step &step : std::as_const(raw))
+    {
+        firstStart = qMin(firstStart, step.startMs);
+        profile.totalMs += step.durationMs();
+        Target &target = targets[targetOf(step.output)];
+        target.totalMs += step.durationMs();
+        ++target.steps;
+    }
+    profile.wallMs = raw.last().endMs - firstStart;
+
+    QVector<int> order(raw.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&raw](int a, int b)
+                     { return raw[a].durationMs() > raw[b].durationMs(); });
+    QVector<int> rank(raw.size());
+    profile.steps.reserve(raw.size());
+    for (int i = 0; i < order.size(); ++i)
+    {
+        rank[order[i]] = i;
+        profile.steps.append(raw[order[i]]);
+    }
+    for (int at : std::as_const(path))
+        profile.criticalPath.append(rank[at]);
+
+    for (auto it = targets.begin(); it != targets.end(); ++it)
+        profile.targets.append({it.key(), it->totalMs, it->steps});
+    std::sort(profile.targets.begin(), profile.targets.end(), [](const Target &a, const Target &b)
+              { return a.totalMs != b.totalMs ? a.totalMs > b.totalMs : a.name < b.name; });
+    return profile;
+}
+
+bool BuildProfile::load(const QString &fileName, BuildProfile &profile)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    profile = fromNinjaLog(file.readAll());
+    return !profile.isEmpty();
+}
+
+QString BuildProfile::targetOf(const QString &output)
+{
+    const QLatin1StringView cmakeFiles("CMakeFiles/");
+    const qsizetype marker = output.indexOf(cmakeFiles);
+    if (marker >= 0)
+    {
+        const qsizetype nameStart = marker + cmakeFiles.size();
+        const qsizetype dir = output.indexOf(QLatin1StringView(".dir/"), nameStart);
+        if (dir > nameStart)
+            return output.mid(nameStart, dir - nameStart);
+    }
+    return QFileInfo(output).fileName();
+}
@@ -0,0 +1,44 @@
+#ifndef BUILDPROFILE_H
+#define BUILDPROFILE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Профиль последней сборки по журналу Ninja (.ninja_log). В журнал
+// дописываются все сборки подряд, отсчёт времени в каждой начинается
+// с нуля, поэтому последняя сборка — хвост, в котором время окончания
+// шагов не убывает. Зависимостей в журнале нет: критический путь
+// восстанавливается по времени — предшественником шага считается шаг,
+// закончившийся последним до его начала.
+struct BuildProfile {
+    struct Step {
+        qint64 startMs;
+        qint64 endMs;
+        QString output;   // первый выход шага
+        int outputCount;  // у шага может быть несколько выходов
+        qint64 durationMs() const { return endMs - startMs; }
+    };
+
+    struct Target {
+        QString name;
+        qint64 totalMs;
+        int steps;
+    };
+
+    QVector<Step> steps;          // по убыванию длительности
+    QVector<Target> targets;      // по убыванию суммарного времени
+    QVector<int> criticalPath;    // номера в steps, от начала сборки к концу
+    qint64 wallMs = 0;
+    qint64 totalMs = 0;
+
+    bool isEmpty() const { return steps.isEmpty(); }
+
+    static BuildProfile fromNinjaLog(const QByteArray &log);
+    static bool load(const QString &fileName, BuildProfile &profile);
+
+    // Имя цели CMake по выходу шага: CMakeFiles/<цель>.dir/... или сам выход.
+    static QString targetOf(const QString &output);
+};
+
+#endif // BUILDPROFILE_H
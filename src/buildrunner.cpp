@@ -0,0 +1,76 @@
+#include "buildrunner.h"
+
+BuildRunner::BuildRunner(TaskRunner *runner, QObject *parent)
+    : QObject(parent), runner(runner)
+{
+    connect(runner, &TaskRunner::taskOutput, this, &BuildRunner::onOutput);
+    connect(runner, &TaskRunner::taskFinished, this, &BuildRunner::onFinished);
+}
+
+int BuildRunner::start(const QString &buildDirectory, int jobs)
+{
+    TaskSpec spec;
+    spec.name = "Сборка";
+    spec.program = "cmake";
+    spec.arguments = {"--build", buildDirectory, "--parallel", QString::number(qMax(1, jobs))};
+    spec.workingDirectory = buildDirectory;
+    spec.group = "build";
+
+    // Прежняя сборка отменяется внутри submit и уже не относится к нам.
+    taskId = 0;
+    const int id = runner->submit(spec);
+    if (id == 0)
+        return 0;
+    taskId = id;
+    directory = buildDirectory;
+    parser.setBaseDirectory(buildDirectory);
+    partial.clear();
+    started = QDateTime::currentDateTime();
+    return id;
+}
+
+void BuildRunner::cancel()
+{
+    if (taskId)
+        runner->cancel(taskId);
+}
+
+void BuildRunner::onOutput(int id, const QByteArray &bytes)
+{
+    if (id != taskId)
+        return;
+    partial += bytes;
+    parseLines(false);
+}
+
+// Разбирает накопленные целые строки; all — и незавершённый хвост тоже.
+void BuildRunner::parseLines(bool all)
+{
+    QVector<Diagnostic> found;
+    Diagnostic diagnostic;
+    qsizetype start = 0;
+    for (qsizetype newline = partial.indexOf('\n'); newline >= 0; newline = partial.indexOf('\n', start))
+    {
+        if (parser.parse(QString::fromUtf8(partial.constData() + start, newline - start), diagnostic))
+            found.append(diagnostic);
+        start = newline + 1;
+    }
+    if (all && start < partial.size())
+    {
+        if (parser.parse(QString::fromUtf8(partial.constData() + start, partial.size() - start), diagnostic))
+            found.append(diagnostic);
+        start = partial.size();
+    }
+    partial.remove(0, start);
+    if (!found.isEmpty())
+        emit diagnosticsFound(found);
+}
+
+void BuildRunner::onFinished(int id, const TaskSpec &, const TaskResult &result)
+{
+    if (id != taskId)
+        return;
+    parseLines(true);
+    taskId = 0;
+    emit finished(result);
+}
@@ -0,0 +1,48 @@
+#ifndef BUILDRUNNER_H
+#define BUILDRUNNER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QObject>
+#include <QVector>
+#include "diagnosticparser.h"
+#include "taskrunner.h"
+
+// Сборка проекта через "cmake --build <каталог> --parallel <N>" задачей
+// TaskRunner в группе "build": новая сборка отменяет незаконченную.
+// Вывод задачи по пути режется на строки и разбирается на сообщения
+// компилятора — они приходят пачкой на каждое чтение, не дожидаясь
+// конца сборки.
+class BuildRunner : public QObject {
+    Q_OBJECT
+
+public:
+    explicit BuildRunner(TaskRunner *runner, QObject *parent = nullptr);
+
+    // Номер задачи сборки или 0, если очередь задач переполнена.
+    int start(const QString &buildDirectory, int jobs);
+    bool isRunning() const { return taskId != 0; }
+    QString buildDirectory() const { return directory; }
+    QDateTime startedAt() const { return started; }
+
+public slots:
+    void cancel();
+
+signals:
+    void diagnosticsFound(const QVector<Diagnostic> &diagnostics);
+    void finished(const TaskResult &result);
+
+private:
+    void onOutput(int id, const QByteArray &bytes);
+    void onFinished(int id, const TaskSpec &spec, const TaskResult &result);
+    void parseLines(bool all);
+
+    TaskRunner *runner;
+    DiagnosticParser parser;
+    QByteArray partial;
+    QString directory;
+    QDateTime started;
+    int taskId = 0;
+};
+
+#endif // BUILDRUNNER_H
@@ -0,0 +1,45 @@
+#include "bytering.h"
+#include <cstring>
+
+ByteRing::ByteRing(qsizetype capacity)
+{
+    quint64 size = 1;
+    while (size < quint64(capacity))
+        size <<= 1;
+    buffer.resize(size);
+    mask = size - 1;
+}
+
+qsizetype ByteRing::freeSpace() const
+{
+    return qsizetype(buffer.size() - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire)));
+}
+
+qsizetype ByteRing::available() const
+{
+    return qsizetype(head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed));
+}
+
+qsizetype ByteRing::write(const char *data, qsizetype size)
+{
+    const quint64 position = head.load(std::memory_order_relaxed);
+    const qsizetype count = qMin(size, freeSpace());
+    const quint64 offset = position & mask;
+    const qsizetype first = qMin<qsizetype>(count, qsizetype(buffer.size() - offset));
+    std::memcpy(buffer.data() + offset, data, first);
+    std::memcpy(buffer.data(), data + first, count - first);
+    head.store(position + count, std::memory_order_release);
+    return count;
+}
+
+qsizetype ByteRing::read(char *data, qsizetype size)
+{
+    const quint64 position = tail.load(std::memory_order_relaxed);
+    const qsizetype count = qMin(size, available());
+    const quint64 offset = position & mask;
+    const qsizetype first = qMin<qsizetype>(count, qsizetype(buffer.size() - offset));
+    std::memcpy(data, buffer.data() + offset, first);
+    std::memcpy(data + first, buffer.data(), count - first);
+    tail.store(position + count, std::memory_order_release);
+    return count;
+}
@@ -0,0 +1,29 @@
+#ifndef BYTERING_H
+#define BYTERING_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+// Кольцевой буфер байтов без блокировок для одного писателя и одного
+// читателя. Ёмкость округляется вверх до степени двойки.
+class ByteRing {
+public:
+    explicit ByteRing(qsizetype capacity);
+
+    // Вызываются только из потока писателя.
+    qsizetype write(const char *data, qsizetype size);
+    qsizetype freeSpace() const;
+
+    // Вызываются только из потока читателя.
+    qsizetype read(char *data, qsizetype size);
+    qsizetype available() const;
+
+private:
+    std::vector<char> buffer;
+    quint64 mask;
+    alignas(64) std::atomic<quint64> head{0}; // сколько записано
+    alignas(64) std::atomic<quint64> tail{0}; // сколько прочитано
+};
+
+#endif // BYTERING_H
@@ -0,0 +1,185 @@
+#include "diagnosticparser.h"
+#include <QDir>
+#include <QLatin1StringView>
+
+namespace {
+
+struct Marker {
+    QLatin1StringView text;
+    Diagnostic::Severity severity;
+};
+
+const Marker Markers[] = {
+    {QLatin1StringView(": fatal error"), Diagnostic::Error},
+    {QLatin1StringView(": error"), Diagnostic::Error},
+    {QLatin1StringView(": warning"), Diagnostic::Warning},
+    {QLatin1StringView(": note"), Diagnostic::Note},
+};
+
+// Неотрицательное число или -1.
+int toNumber(QStringView text)
+{
+    if (text.isEmpty() || !text.front().isDigit())
+        return -1;
+    bool ok = false;
+    const int value = text.toInt(&ok);
+    return ok ? value : -1;
+}
+
+// Код сообщения MSVC: буквы, затем цифры (C2065, LNK1104, D9025).
+bool isCode(QStringView text)
+{
+    qsizetype letters = 0;
+    while (letters < text.size() && text[letters] >= 'A' && text[letters] <= 'Z')
+        ++letters;
+    if (letters == 0 || letters == text.size() || text.size() > 12)
+        return false;
+    for (qsizetype i = letters; i < text.size(); ++i)
+    {
+        if (!text[i].isDigit())
+            return false;
+    }
+    return true;
+}
+
+// Убирает цветовые последовательности ESC[...m, которые добавляют
+// компиляторы при CMAKE_COLOR_DIAGNOSTICS.
+QString stripEscapes(QStringView line)
+{
+    QString result;
+    result.reserve(line.size());
+    for (qsizetype i = 0; i < line.size(); ++i)
+    {
+        if (line[i] == QChar(0x1b))
+        {
+            if (i + 1 < line.size() && line[i + 1] == '[')
+            {
+                i += 2;
+                while (i < line.size() && !(line[i] >= '@' && line[i] <= '~'))
+                    ++i;
+            }
+            continue;
+        }
+        result.append(line[i]);
+    }
+    return result;
+}
+
+} // namespace
+
+void DiagnosticParser::setBaseDirectory(const QString &directory)
+{
+    baseDirectory = directory;
+}
+
+QString DiagnosticParser::resolve(QStringView path) const
+{
+    const QString text = QDir::fromNativeSeparators(path.toString());
+    if (baseDirectory.isEmpty() || !QDir::isRelativePath(text))
+        return QDir::cleanPath(text);
+    return QDir::cleanPath(baseDirectory + '/' + text);
+}
+
+bool DiagnosticParser::parse(QStringView line, Diagnostic &diagnostic) const
+{
+    if (line.contains(QChar(0x1b)))
+    {
+        const QString plain = stripEscapes(line);
+        return parse(plain, diagnostic);
+    }
+
+    // Самый левый признак: в тексте сообщения может встретиться ещё один.
+    const Marker *found = nullptr;
+    qsizetype markerAt = -1;
+    for (const Marker &marker : Markers)
+    {
+        for (qsizetype at = line.indexOf(marker.text); at >= 0 && (markerAt < 0 || at < markerAt);
+             at = line.indexOf(marker.text, at + 1))
+        {
+            const qsizetype after = at + marker.text.size();
+            if (after < line.size() && (line[after] == ':' || line[after] == ' '))
+            {
+                found = &marker;
+                markerAt = at;
+                break;
+            }
+        }
+    }
+    if (!found)
+        return false;
+
+    QStringView tail = line.sliced(markerAt + found->text.size());
+    QString code;
+    if (tail.front() == ' ')
+    {
+        const qsizetype colon = tail.indexOf(':');
+        if (colon < 2 || !isCode(tail.sliced(1, colon - 1)))
+            return false;
+        code = tail.sliced(1, colon - 1).toString();
+        tail = tail.sliced(colon);
+    }
+    tail = tail.sliced(1).trimmed();
+
+    const QStringView location = line.first(markerAt).trimmed();
+    QStringView path;
+    int lineNumber = 0;
+    int column = 0;
+    if (location.endsWith(')'))
+    {
+        // MSVC: path(line) или path(line,col)
+        const qsizetype open = location.lastIndexOf('(');
+        if (open > 0)
+        {
+            const QStringView numbers = location.sliced(open + 1, location.size() - open - 2);
+            const qsizetype comma = numbers.indexOf(',');
+            const int first = toNumber(comma < 0 ? numbers : numbers.first(comma));
+            const int second = comma < 0 ? 0 : toNumber(numbers.sliced(comma + 1));
+            if (first > 0 && second >= 0)
+            {
+                path = location.first(open);
+                lineNumber = first;
+                column = second;
+            }
+        }
+    }
+    else
+    {
+        // GCC/Clang: path:line или path:line:col; путь может начинаться с буквы диска
+        const qsizetype colon = location.lastIndexOf(':');
+        const int last = colon > 0 ? toNumber(location.sliced(colon + 1)) : -1;
+        if (last > 0)
+        {
+            const QStringView head = location.first(colon);
+            const qsizetype previousColon = head.lastIndexOf(':');
+            const int beforeLast = previousColon > 0 ? toNumber(head.sliced(previousColon + 1)) : -1;
+            if (beforeLast > 0)
+            {
+                path = head.first(previousColon);
+                lineNumber = beforeLast;
+                column = last;
+            }
+            else
+            {
+                path = head;
+                lineNumber = last;
+            }
+        }
+    }
+
+    diagnostic.severity = found->severity;
+    diagnostic.code = code;
+    diagnostic.line = lineNumber;
+    diagnostic.column = column;
+    if (path.isEmpty())
+    {
+        // "ninja: error: ...", "LINK : fatal error LNK1104: ..." — места в файле нет.
+        diagnostic.filePath.clear();
+        diagnostic.message = location.isEmpty() ? tail.toString() : location.toString() + ": " + tail.toString();
+    }
+    else
+    {
+        diagnostic.filePath = resolve(path);
+        diagnostic.message = tail.toString();
+    }
+    return true;
+}
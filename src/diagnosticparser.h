@@ -0,0 +1,40 @@
+#ifndef DIAGNOSTICPARSER_H
+#define DIAGNOSTICPARSER_H
+
+#include <QString>
+#include <QStringView>
+
+struct Diagnostic {
+    enum Severity {
+        Error,
+        Warning,
+        Note
+    };
+
+    Severity severity;
+    QString filePath; // абсолютный; пустой, если место не указано
+    int line;         // с единицы, 0 — без строки
+    int column;
+    QString code;     // код MSVC (C2065, LNK1104), у GCC/Clang пустой
+    QString message;
+};
+
+// Разбор сообщений компилятора по одной строке вывода:
+//   GCC/Clang: path:line:col: error: message
+//   MSVC:      path(line,col): error C2065: message
+// Строки без признака ": error", ": warning", ": note" отбрасываются
+// одним поиском подстроки, поэтому разбор идёт прямо по мере прихода вывода.
+// Относительные пути считаются от каталога сборки.
+class DiagnosticParser {
+public:
+    void setBaseDirectory(const QString &directory);
+
+    bool parse(QStringView line, Diagnostic &diagnostic) const;
+
+private:
+    QString resolve(QStringView path) const;
+
+    QString baseDirectory;
+};
+
+#endif // DIAGNOSTICPARSER_H
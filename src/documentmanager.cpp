@@ -0,0 +1,503 @@
+#include "documentmanager.h"
+#include "editjournal.h"
+#include "largefileview.h"
+#include "latencytracer.h"
+#include "syntaxhighlighter.h"
+#include "undohistory.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QScrollBar>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextEdit>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// Грубая оценка памяти документа: текст, блоки с BlockData и, у тёплых
+// вкладок, раскладка строк с форматами подсветки.
+constexpr qint64 BlockBytes = 96;
+constexpr qint64 LayoutBytes = 1024;
+
+QString normalizedPath(const QString &filePath)
+{
+    return filePath.isEmpty() ? QString() : QDir::cleanPath(QFileInfo(filePath).absoluteFilePath());
+}
+
+// Позиция после замены отрезка: внутри заменённого — его начало.
+int shifted(int position, const FileReloader::Edit &edit)
+{
+    if (position <= edit.position)
+        return position;
+    if (position >= edit.position + edit.removed)
+        return position - edit.removed + int(edit.inserted.size());
+    return edit.position;
+}
+
+} // namespace
+
+DocumentManager::DocumentManager(QTextEdit *editor, QObject *parent)
+    : QObject(parent), editor(editor), undoMemoryBudget(UndoHistory::DefaultMemoryBudget),
+      undoDiskBudget(UndoHistory::DefaultDiskBudget), journalDirectory(EditJournal::defaultDirectory())
+{
+    placeholder = new QTextDocument(this);
+    placeholder->setUndoRedoEnabled(false);
+    placeholder->setDefaultFont(editor->font());
+    editor->setDocument(placeholder);
+}
+
+DocumentManager::~DocumentManager() = default;
+
+void DocumentManager::setWarmCount(int count)
+{
+    warmCount = qMax(1, count);
+    enforcePolicy();
+}
+
+void DocumentManager::setMemoryBudget(qint64 bytes)
+{
+    memoryBudget = qMax(qint64(0), bytes);
+    enforcePolicy();
+}
+
+void DocumentManager::setUndoBudgets(qint64 memoryBytes, qint64 diskBytes)
+{
+    undoMemoryBudget = memoryBytes;
+    undoDiskBudget = diskBytes;
+    for (Document &document : documents)
+    {
+        if (!document.undo)
+            continue;
+        document.undo->setDiskBudget(undoDiskBudget);
+        document.undo->setMemoryBudget(document.undo->isAttached() ? undoMemoryBudget : 0);
+    }
+}
+
+void DocumentManager::setJournalDirectory(const QString &directory)
+{
+    journalDirectory = directory;
+}
+
+int DocumentManager::indexOf(const QString &filePath) const
+{
+    const QString path = normalizedPath(filePath);
+    for (int i = 0; i < documents.size(); ++i)
+    {
+        if (!path.isEmpty() && documents[i].filePath == path)
+            return i;
+    }
+    return -1;
+}
+
+int DocumentManager::indexOf(const QTextDocument *text) const
+{
+    for (int i = 0; i < documents.size(); ++i)
+    {
+        if (documents[i].text == text)
+            return i;
+    }
+    return -1;
+}
+
+int DocumentManager::indexOf(const LargeFileView *view) const
+{
+    for (int i = 0; i < documents.size(); ++i)
+    {
+        if (documents[i].largeView == view)
+            return i;
+    }
+    return -1;
+}
+
+bool DocumentManager::isModified(int index) const
+{
+    const Document &document = documents[index];
+    if (document.largeView)
+        return document.largeView->isModified();
+    return document.text && document.text->isModified();
+}
+
+bool DocumentManager::isBlank(int index) const
+{
+    const Document &document = documents[index];
+    return document.filePath.isEmpty() && !document.largeView && document.text && document.loaded
+        && document.text->isEmpty() && !document.text->isModified();
+}
+
+UndoHistory *DocumentManager::currentUndo() const
+{
+    return active >= 0 ? documents[active].undo : nullptr;
+}
+
+int DocumentManager::add(const QString &filePath, LargeFileView *largeView)
+{
+    Document document;
+    document.filePath = normalizedPath(filePath);
+    document.largeView = largeView;
+    document.loaded = largeView != nullptr || filePath.isEmpty();
+    if (!largeView)
+    {
+        document.undo = new UndoHistory(editor, nullptr, this);
+        document.undo->setDiskBudget(undoDiskBudget);
+        connect(document.undo, &UndoHistory::usageChanged, this, &DocumentManager::reportUndoUsage);
+
+        EditJournal *journal = new EditJournal(journalDirectory, this);
+        journal->setFilePath(document.filePath);
+        connect(document.undo, &UndoHistory::textChanged, journal, &EditJournal::record);
+        connect(document.undo, &UndoHistory::diverged, journal, [journal]
+                {
+                    if (journal->isActive())
+                        journal->checkpoint(); });
+        connect(journal, &EditJournal::failed, this, &DocumentManager::journalFailed);
+        document.journal = journal;
+    }
+    documents.append(document);
+    return documents.size() - 1;
+}
+
+int DocumentManager::addRecovered(const QString &filePath, const QString &text, const TextFormat &format,
+                                  bool *journaled)
+{
+    const int index = add(filePath);
+    Document &document = documents[index];
+    QTextDocument *recovered = createText(document);
+    recovered->setPlainText(text);
+    recovered->setModified(true);
+    document.loaded = true;
+    document.format = format;
+    const QFileInfo info(document.filePath);
+    document.savedModified = info.lastModified();
+    document.savedSize = info.exists() ? info.size() : -1;
+    // Журнал, из которого документ восстановлен, удаляется, поэтому новый
+    // начинается со снимка и пишется сразу, а не по таймеру.
+    document.journal->setFormat(format);
+    document.journal->checkpoint();
+    *journaled = document.journal->isActive() && document.journal->sync();
+    return index;
+}
+
+void DocumentManager::remove(int index)
+{
+    Document &document = documents[index];
+    unload(document);
+    if (document.journal)
+        document.journal->discard(); // документ сохранён или правки отброшены
+    delete document.journal;
+    delete document.undo;
+    delete document.largeView;
+    documents.removeAt(index);
+    if (active == index)
+        active = -1;
+    else if (active > index)
+        --active;
+    reportUndoUsage();
+}
+
+void DocumentManager::move(int from, int to)
+{
+    documents.move(from, to);
+    if (active == from)
+        active = to;
+    else if (from < active && active <= to)
+        --active;
+    else if (to <= active && active < from)
+        ++active;
+}
+
+void DocumentManager::setFilePath(int index, const QString &filePath)
+{
+    documents[index].filePath = normalizedPath(filePath);
+    if (documents[index].journal)
+        documents[index].journal->setFilePath(documents[index].filePath);
+}
+
+bool DocumentManager::activate(int index)
+{
+    if (index == active)
+        return documents[index].loaded;
+
+    if (active >= 0)
+    {
+        Document &previous = documents[active];
+        if (previous.text && !previous.loaded)
+            unload(previous); // недочитанный текст при возврате читается заново
+        else if (previous.text && editor->document() == previous.text)
+            saveViewState(previous);
+    }
+
+    active = index;
+    Document &document = documents[index];
+    document.lastUsed = ++useCounter;
+    if (document.largeView)
+    {
+        enforcePolicy();
+        return true;
+    }
+
+    const bool ready = document.text || document.filePath.isEmpty();
+    if (!document.text)
+    {
+        createText(document);
+        document.loaded = document.filePath.isEmpty();
+    }
+    editor->setDocument(document.text);
+    warmUp(document);
+    if (document.loaded)
+        restoreViewState(document);
+    enforcePolicy();
+    return ready;
+}
+
+void DocumentManager::finishLoading(int index, const TextFormat &format)
+{
+    Document &document = documents[index];
+    document.loaded = true;
+    document.format = format;
+    document.journal->setFormat(format);
+    document.text->setModified(false);
+
+    // История выгруженного документа продолжается, только если файл тот же.
+    const QFileInfo info(document.filePath);
+    const bool unchanged = document.savedSize == info.size() && document.savedModified == info.lastModified()
+        && document.textLength == document.text->characterCount();
+    document.undo->setDocument(document.text);
+    if (!unchanged)
+        document.undo->reset();
+    document.undo->setMemoryBudget(undoMemoryBudget);
+    document.savedModified = info.lastModified();
+    document.savedSize = info.size();
+    document.journal->markClean(document.filePath, document.savedSize, document.savedModified.toMSecsSinceEpoch());
+    if (unchanged && editor->document() == document.text)
+        restoreViewState(document);
+    enforcePolicy();
+}
+
+void DocumentManager::markSaving(int index)
+{
+    if (documents[index].journal)
+        documents[index].journal->markSaving();
+}
+
+void DocumentManager::markSaved(int index, bool lastRequest)
+{
+    Document &document = documents[index];
+    const QFileInfo info(document.filePath);
+    document.savedModified = info.lastModified();
+    document.savedSize = info.size();
+    // Иначе записанный файл может оказаться не последним снимком: журнал
+    // продолжается от прежней основы, это тоже верно.
+    if (document.journal && lastRequest)
+        document.journal->markClean(document.filePath, document.savedSize, document.savedModified.toMSecsSinceEpoch());
+}
+
+bool DocumentManager::changedOnDisk(int index) const
+{
+    const Document &document = documents[index];
+    if (!document.text || !document.loaded || document.largeView || document.filePath.isEmpty())
+        return false;
+    const QFileInfo info(document.filePath);
+    return info.exists() && (info.size() != document.savedSize || info.lastModified() != document.savedModified);
+}
+
+void DocumentManager::ignoreDiskChange(int index)
+{
+    const QFileInfo info(documents[index].filePath);
+    documents[index].savedModified = info.lastModified();
+    documents[index].savedSize = info.size();
+}
+
+// Каждая правка — свой блок правки, чтобы подсветка и раскладка
+// пересчитывали только её строки; в истории отмены все правки — одна
+// команда. Правки идут от конца к началу и не сдвигают друг друга.
+void DocumentManager::applyReload(int index, const FileReloader::Result &result)
+{
+    Document &document = documents[index];
+    const bool shown = editor->document() == document.text;
+    // История остывшего документа отвязана: на время правок её тень
+    // нужна, иначе после возврата команды не совпадут с текстом.
+    const bool attached = document.undo->isAttached();
+    if (!attached)
+        document.undo->setDocument(document.text);
+
+    document.undo->beginGroup();
+    QTextCursor cursor(document.text);
+    for (const FileReloader::Edit &edit : result.edits)
+    {
+        cursor.beginEditBlock();
+        cursor.setPosition(edit.position);
+        cursor.setPosition(edit.position + edit.removed, QTextCursor::KeepAnchor);
+        if (edit.inserted.isEmpty())
+            cursor.removeSelectedText();
+        else
+            cursor.insertText(edit.inserted);
+        cursor.endEditBlock();
+        // Курсор редактора сдвигается сам, у скрытого документа — числа.
+        if (!shown)
+        {
+            document.cursorPosition = shifted(document.cursorPosition, edit);
+            document.anchorPosition = shifted(document.anchorPosition, edit);
+        }
+    }
+    document.undo->endGroup();
+    if (!attached)
+        document.undo->setDocument(nullptr);
+
+    document.format = result.format;
+    document.journal->setFormat(result.format);
+    document.savedSize = result.size;
+    document.savedModified = result.modified;
+    document.text->setModified(false);
+    document.journal->markClean(document.filePath, document.savedSize, document.savedModified.toMSecsSinceEpoch());
+}
+
+qint64 DocumentManager::estimate(const Document &document)
+{
+    if (!document.text)
+        return 0;
+    const qint64 characters = document.text->characterCount();
+    const qint64 blocks = document.text->blockCount();
+    qint64 bytes = characters * qint64(sizeof(QChar)) + blocks * BlockBytes;
+    if (document.highlighter)
+        bytes += blocks * LayoutBytes;
+    if (document.undo && document.undo->isAttached())
+        bytes += characters * qint64(sizeof(QChar)); // теневая копия истории
+    return bytes;
+}
+
+qint64 DocumentManager::memoryUsage() const
+{
+    qint64 bytes = 0;
+    for (const Document &document : documents)
+        bytes += estimate(document);
+    return bytes;
+}
+
+QTextDocument *DocumentManager::createText(Document &document)
+{
+    QTextDocument *text = new QTextDocument(this);
+    text->setUndoRedoEnabled(false);
+    text->setDefaultFont(editor->font());
+    LatencyTracer::watch(text);
+    connect(text, &QTextDocument::modificationChanged, this, [this, text]
+            {
+                const int index = indexOf(text);
+                if (index >= 0)
+                    emit modificationChanged(index); });
+    document.text = text;
+    if (document.journal)
+        document.journal->setDocument(text);
+    return text;
+}
+
+void DocumentManager::saveViewState(Document &document)
+{
+    const QTextCursor cursor = editor->textCursor();
+    document.cursorPosition = cursor.position();
+    document.anchorPosition = cursor.anchor();
+    document.scrollX = editor->horizontalScrollBar()->value();
+    document.scrollY = editor->verticalScrollBar()->value();
+}
+
+void DocumentManager::restoreViewState(const Document &document)
+{
+    const int last = document.text->characterCount() - 1;
+    QTextCursor cursor(document.text);
+    cursor.setPosition(qBound(0, document.anchorPosition, last));
+    cursor.setPosition(qBound(0, document.cursorPosition, last), QTextCursor::KeepAnchor);
+    editor->setTextCursor(cursor);
+
+    // Раскладка остывшего документа строится заново лениво, диапазон
+    // прокрутки может быть ещё мал: тогда видно хотя бы курсор.
+    editor->horizontalScrollBar()->setValue(document.scrollX);
+    QScrollBar *bar = editor->verticalScrollBar();
+    bar->setValue(document.scrollY);
+    if (bar->value() != document.scrollY)
+        editor->ensureCursorVisible();
+}
+
+void DocumentManager::warmUp(Document &document)
+{
+    if (!document.highlighter)
+        document.highlighter = new SyntaxHighlighter(document.text);
+    if (document.loaded && !document.undo->isAttached())
+        document.undo->setDocument(document.text);
+    document.undo->setMemoryBudget(document.loaded ? undoMemoryBudget : 0);
+}
+
+void DocumentManager::coolDown(Document &document)
+{
+    if (editor->document() == document.text)
+        editor->setDocument(placeholder);
+    document.undo->setDocument(nullptr);
+    document.undo->setMemoryBudget(0);
+    delete document.highlighter;
+    document.highlighter = nullptr;
+    // Вместе с раскладкой документа удаляются QTextLayout всех блоков.
+    document.text->setDocumentLayout(nullptr);
+}
+
+void DocumentManager::unload(Document &document)
+{
+    if (!document.text)
+        return;
+    if (editor->document() == document.text)
+        editor->setDocument(placeholder);
+    if (document.undo)
+    {
+        document.undo->setDocument(nullptr);
+        document.undo->setMemoryBudget(0);
+    }
+    if (document.journal)
+        document.journal->setDocument(nullptr);
+    if (document.loaded)
+        document.textLength = document.text->characterCount();
+    delete document.highlighter;
+    document.highlighter = nullptr;
+    delete document.text;
+    document.text = nullptr;
+    document.loaded = false;
+}
+
+// Тёплыми остаются warmCount последних вкладок. Сверх бюджета памяти
+// выгружаются давно не открывавшиеся документы, которые можно прочитать
+// из файла заново: сохранённые и без несохранённых правок.
+void DocumentManager::enforcePolicy()
+{
+    QVector<int> order(documents.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](int a, int b)
+              { return documents[a].lastUsed > documents[b].lastUsed; });
+
+    for (int rank = warmCount; rank < order.size(); ++rank)
+    {
+        Document &document = documents[order[rank]];
+        if (order[rank] != active && document.text && document.loaded && document.highlighter)
+            coolDown(document);
+    }
+
+    qint64 total = memoryUsage();
+    for (int rank = order.size() - 1; rank >= 0 && total > memoryBudget; --rank)
+    {
+        Document &document = documents[order[rank]];
+        if (order[rank] == active || !document.text || !document.loaded || document.filePath.isEmpty()
+            || document.text->isModified())
+            continue;
+        total -= estimate(document);
+        unload(document);
+    }
+}
+
+void DocumentManager::reportUndoUsage()
+{
+    qint64 memoryBytes = 0;
+    qint64 diskBytes = 0;
+    for (const Document &document : std::as_const(documents))
+    {
+        if (!document.undo)
+            continue;
+        memoryBytes += document.undo->memoryUsage();
+        diskBytes += document.undo->diskUsage();
+    }
+    emit undoUsageChanged(memoryBytes, diskBytes);
+}
@@ -0,0 +1,129 @@
+#ifndef DOCUMENTMANAGER_H
+#define DOCUMENTMANAGER_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include "filereloader.h"
+
+class EditJournal;
+class LargeFileView;
+class QTextDocument;
+class QTextEdit;
+class SyntaxHighlighter;
+class UndoHistory;
+
+// Открытые документы (вкладки). Активный показывается в общем QTextEdit
+// через setDocument(), у каждого свои курсор, прокрутка, история отмены
+// и подсветка. Последние warmCount вкладок держат раскладку и подсветку,
+// у остальных они освобождаются и строятся заново при возврате. Сверх
+// бюджета памяти неизменённые документы выгружаются совсем и читаются
+// из файла при следующем показе; история отмены при этом уходит на диск
+// и продолжается, если файл не изменился.
+//
+// Правки текстовых документов пишутся в EditJournal: после падения их
+// можно восстановить (addRecovered()). Большие файлы журнала не ведут.
+//
+// Файл, изменённый на диске, применяется к документу правками разницы
+// (applyReload()): курсор, история отмены и подсветка неизменённых мест
+// сохраняются, а перечитывание отменяется одним шагом.
+class DocumentManager : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultWarmCount = 4;
+    static constexpr qint64 DefaultMemoryBudget = 256 * 1024 * 1024;
+
+    struct Document {
+        QString filePath;                // пусто — новый файл без имени
+        QTextDocument *text = nullptr;   // nullptr — выгружен или большой файл
+        SyntaxHighlighter *highlighter = nullptr;
+        UndoHistory *undo = nullptr;
+        EditJournal *journal = nullptr;
+        LargeFileView *largeView = nullptr;
+        TextFormat format;
+        bool loaded = false;             // текст прочитан целиком
+        int cursorPosition = 0;
+        int anchorPosition = 0;
+        int scrollX = 0;
+        int scrollY = 0;
+        int textLength = -1;             // на момент выгрузки
+        QDateTime savedModified;         // файл на момент загрузки или сохранения
+        qint64 savedSize = -1;
+        quint64 lastUsed = 0;
+    };
+
+    explicit DocumentManager(QTextEdit *editor, QObject *parent = nullptr);
+    ~DocumentManager() override;
+
+    void setWarmCount(int count);
+    void setMemoryBudget(qint64 bytes);
+    void setUndoBudgets(qint64 memoryBytes, qint64 diskBytes);
+    void setJournalDirectory(const QString &directory); // для новых документов
+
+    int count() const { return documents.size(); }
+    int current() const { return active; }
+    const Document &document(int index) const { return documents[index]; }
+    int indexOf(const QString &filePath) const;
+    int indexOf(const QTextDocument *text) const;
+    int indexOf(const LargeFileView *view) const;
+    bool isModified(int index) const;
+    bool isBlank(int index) const;
+    UndoHistory *currentUndo() const;
+
+    int add(const QString &filePath, LargeFileView *largeView = nullptr);
+    // Документ из журнала восстановления: загружен и изменён. Его новый
+    // журнал записывается на диск сразу; journaled — удалось ли, только
+    // тогда старый журнал можно удалять.
+    int addRecovered(const QString &filePath, const QString &text, const TextFormat &format, bool *journaled);
+    void remove(int index);
+    void move(int from, int to);
+    void setFilePath(int index, const QString &filePath);
+
+    // Показывает документ в редакторе. false — текст нужно прочитать
+    // заново: редактор уже показывает пустой документ для загрузки.
+    bool activate(int index);
+    void finishLoading(int index, const TextFormat &format);
+    // lastRequest — в очереди сохранения ничего не осталось, и записанный
+    // файл соответствует последнему markSaving() документа.
+    void markSaving(int index);
+    void markSaved(int index, bool lastRequest = true);
+
+    // Файл на диске не тот, что загружен или сохранён. Проверяются только
+    // загруженные текстовые документы.
+    bool changedOnDisk(int index) const;
+    void ignoreDiskChange(int index); // принять версию на диске, не перечитывая
+    void applyReload(int index, const FileReloader::Result &result);
+
+    qint64 memoryUsage() const;
+
+signals:
+    void modificationChanged(int index);
+    void undoUsageChanged(qint64 memoryBytes, qint64 diskBytes);
+    void journalFailed(const QString &error);
+
+private:
+    static qint64 estimate(const Document &document);
+    QTextDocument *createText(Document &document);
+    void saveViewState(Document &document);
+    void restoreViewState(const Document &document);
+    void warmUp(Document &document);
+    void coolDown(Document &document);
+    void unload(Document &document);
+    void enforcePolicy();
+    void reportUndoUsage();
+
+    QTextEdit *editor;
+    QTextDocument *placeholder; // в редакторе, пока показан большой файл или документ выгружается
+    QVector<Document> documents;
+    int active = -1;
+    quint64 useCounter = 0;
+    int warmCount = DefaultWarmCount;
+    qint64 memoryBudget = DefaultMemoryBudget;
+    qint64 undoMemoryBudget;
+    qint64 undoDiskBudget;
+    QString journalDirectory;
+};
+
+#endif // DOCUMENTMANAGER_H
@@ -0,0 +1,543 @@
+#include "documentsearcher.h"
+#include "literalmatcher.h"
+#include "piecetable.h"
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QThread>
+#include <algorithm>
+
+namespace {
+
+using Query = DocumentSearcher::Query;
+using Replacement = DocumentSearcher::Replacement;
+
+constexpr qint64 ChunkBytes = 4 * 1024 * 1024;
+constexpr qint64 BatchMs = 50;
+
+QRegularExpression compile(const QString &pattern, bool caseSensitive)
+{
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+    if (!caseSensitive)
+        options |= QRegularExpression::CaseInsensitiveOption;
+    return QRegularExpression(pattern, options);
+}
+
+bool isAscii(const QString &text)
+{
+    return std::all_of(text.cbegin(), text.cend(), [](QChar c)
+                       { return c.unicode() < 0x80; });
+}
+
+// Длина в байтах UTF-8; суррогатная пара — 3 + 1 байт.
+qint64 utf8Length(QStringView text)
+{
+    qint64 length = 0;
+    for (QChar c : text)
+    {
+        const char16_t u = c.unicode();
+        length += u < 0x80 ? 1 : u < 0x800 ? 2 : c.isLowSurrogate() ? 1 : 3;
+    }
+    return length;
+}
+
+void appendText(QString &result, QStringView text)
+{
+    result.append(text);
+}
+
+void appendText(QByteArray &result, QStringView text)
+{
+    result.append(text.toUtf8());
+}
+
+// \0–\99 — захваченные группы, как в QString::replace() с выражением.
+// captured(group) — текст группы в том же виде, что и результат: у
+// большого файла это исходные байты, а не перекодированный текст.
+template <typename Result, typename Captured>
+Result expand(const QString &replacement, int groups, Captured captured)
+{
+    Result result;
+    qsizetype literal = 0;
+    for (qsizetype i = 0; i < replacement.size(); ++i)
+    {
+        if (replacement[i] != QLatin1Char('\\') || i + 1 >= replacement.size() || !replacement[i + 1].isDigit())
+            continue;
+        appendText(result, QStringView(replacement).mid(literal, i - literal));
+        int group = replacement[++i].digitValue();
+        if (i + 1 < replacement.size() && replacement[i + 1].isDigit()
+            && group * 10 + replacement[i + 1].digitValue() <= groups)
+            group = group * 10 + replacement[++i].digitValue();
+        if (group <= groups)
+            result.append(captured(group));
+        literal = i + 1;
+    }
+    appendText(result, QStringView(replacement).mid(literal));
+    return result;
+}
+
+QString expandText(const QString &replacement, const QRegularExpressionMatch &match)
+{
+    if (!replacement.contains(QLatin1Char('\\')))
+        return replacement;
+    return expand<QString>(replacement, match.lastCapturedIndex(), [&match](int group)
+                           { return match.capturedView(group); });
+}
+
+QByteArray expandBytes(const QString &replacement, const QVector<QByteArrayView> &groups)
+{
+    return expand<QByteArray>(replacement, int(groups.size()) - 1, [&groups](int group)
+                              { return groups[group]; });
+}
+
+// Декодирует UTF-8 так же, как QString::fromUtf8() декодирует верный
+// текст, но каждый неверный байт становится отдельным U+FFFD, и
+// offsets[i] — байт, с которого начинается символ i (offsets.last() —
+// размер). Так позиции выражения переводятся в байты точно.
+QString decodeUtf8(QByteArrayView bytes, QVector<qint64> *offsets)
+{
+    QString text;
+    text.reserve(bytes.size());
+    offsets->clear();
+    offsets->reserve(bytes.size() + 1);
+    const auto continuation = [&bytes](qsizetype i, uchar low = 0x80, uchar high = 0xbf)
+    {
+        return i < bytes.size() && uchar(bytes[i]) >= low && uchar(bytes[i]) <= high;
+    };
+    for (qsizetype i = 0; i < bytes.size();)
+    {
+        const uchar lead = uchar(bytes[i]);
+        char32_t code = QChar::ReplacementCharacter;
+        int length = 1;
+        if (lead < 0x80)
+        {
+            code = lead;
+        }
+        else if (lead >= 0xc2 && lead <= 0xdf && continuation(i + 1))
+        {
+            code = char32_t(lead & 0x1f) << 6 | (uchar(bytes[i + 1]) & 0x3f);
+            length = 2;
+        }
+        else if (lead >= 0xe0 && lead <= 0xef
+                 && continuation(i + 1, lead == 0xe0 ? 0xa0 : 0x80, lead == 0xed ? 0x9f : 0xbf)
+                 && continuation(i + 2))
+        {
+            code = char32_t(lead & 0x0f) << 12 | char32_t(uchar(bytes[i + 1]) & 0x3f) << 6
+                   | (uchar(bytes[i + 2]) & 0x3f);
+            length = 3;
+        }
+        else if (lead >= 0xf0 && lead <= 0xf4
+                 && continuation(i + 1, lead == 0xf0 ? 0x90 : 0x80, lead == 0xf4 ? 0x8f : 0xbf)
+                 && continuation(i + 2) && continuation(i + 3))
+        {
+            code = char32_t(lead & 0x07) << 18 | char32_t(uchar(bytes[i + 1]) & 0x3f) << 12
+                   | char32_t(uchar(bytes[i + 2]) & 0x3f) << 6 | (uchar(bytes[i + 3]) & 0x3f);
+            length = 4;
+        }
+        if (QChar::requiresSurrogates(code))
+        {
+            text.append(QChar(QChar::highSurrogate(code)));
+            text.append(QChar(QChar::lowSurrogate(code)));
+            offsets->append(i);
+            offsets->append(i);
+        }
+        else
+        {
+            text.append(QChar(char16_t(code)));
+            offsets->append(i);
+        }
+        i += length;
+    }
+    offsets->append(bytes.size());
+    return text;
+}
+
+// Группы совпадения как отрезки bytes; byteAt(i) — байт символа i.
+template <typename ByteAt>
+QVector<QByteArrayView> capturedBytes(const QRegularExpressionMatch &match, QByteArrayView bytes, ByteAt byteAt)
+{
+    QVector<QByteArrayView> groups(match.lastCapturedIndex() + 1);
+    for (int group = 0; group < groups.size(); ++group)
+    {
+        if (match.capturedStart(group) < 0)
+            continue; // группа не участвовала
+        const qint64 start = byteAt(match.capturedStart(group));
+        groups[group] = bytes.mid(start, byteAt(match.capturedEnd(group)) - start);
+    }
+    return groups;
+}
+
+// visit(position, length, match) для совпадений по порядку; match —
+// nullptr при поиске строки.
+template <typename Visit>
+void scanText(const QString &rawText, const Query &query, const std::atomic<bool> &cancelled, Visit visit)
+{
+    if (query.regex)
+    {
+        // Блоки разделены QChar::ParagraphSeparator; для выражения они
+        // становятся '\n', чтобы работали ^, $ и точка. Длина та же.
+        QString text = rawText;
+        text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+        const QRegularExpression expression = compile(query.pattern, query.caseSensitive);
+        QRegularExpressionMatchIterator it = expression.globalMatch(text);
+        while (!cancelled && it.hasNext())
+        {
+            const QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() > 0)
+                visit(match.capturedStart(), match.capturedLength(), &match);
+        }
+        return;
+    }
+
+    const Utf16Matcher matcher(query.pattern, query.caseSensitive);
+    const char16_t *data = reinterpret_cast<const char16_t *>(rawText.utf16());
+    qsizetype position = 0;
+    while (!cancelled && (position = matcher.find(data, rawText.size(), position)) >= 0)
+    {
+        visit(position, matcher.size(), nullptr);
+        position += matcher.size();
+    }
+}
+
+// Большой файл читается кусками, которые кончаются переводом строки:
+// в строке из поля поиска его нет, а выражение через границу куска не
+// ищется. visit(chunk, base, offset, length, groups): chunk начинается с
+// байта base, совпадение — с base + offset; groups — байты групп
+// выражения или nullptr при поиске строки.
+template <typename Visit>
+void scanBytes(const PieceTable &table, const Query &query, const std::atomic<bool> &cancelled, Visit visit)
+{
+    const bool literal = !query.regex && (query.caseSensitive || isAscii(query.pattern));
+    const LiteralMatcher matcher(literal ? query.pattern.toUtf8() : QByteArray(), query.caseSensitive);
+    const QRegularExpression expression = literal ? QRegularExpression()
+                                                  : compile(query.regex ? query.pattern : QRegularExpression::escape(query.pattern),
+                                                            query.caseSensitive);
+    const qint64 size = table.size();
+    for (qint64 base = 0; base < size && !cancelled;)
+    {
+        qint64 end = size;
+        if (base + ChunkBytes < size)
+        {
+            const qint64 newline = table.findForward(base + ChunkBytes, '\n');
+            if (newline >= 0)
+                end = newline + 1;
+        }
+        const QByteArray chunk = table.read(base, end - base);
+
+        if (literal)
+        {
+            qsizetype offset = 0;
+            while (!cancelled && (offset = matcher.find(chunk.constData(), chunk.size(), offset)) >= 0)
+            {
+                visit(chunk, base, offset, matcher.size(), nullptr);
+                offset += matcher.size();
+            }
+        }
+        else
+        {
+            // Верный UTF-8 переводится в байты по ходу: совпадения идут по
+            // порядку. В куске с неверными байтами U+FFFD заменяет от одного
+            // до трёх байт, поэтому позиции берутся из таблицы decodeUtf8().
+            QVector<qint64> offsets;
+            const QString text = chunk.isValidUtf8() ? QString::fromUtf8(chunk) : decodeUtf8(chunk, &offsets);
+            qsizetype textOffset = 0;
+            qint64 offset = 0;
+            const auto byteAt = [&](qsizetype index)
+            {
+                if (!offsets.isEmpty())
+                    return offsets[index];
+                return index >= textOffset ? offset + utf8Length(QStringView(text).mid(textOffset, index - textOffset))
+                                           : offset - utf8Length(QStringView(text).mid(index, textOffset - index));
+            };
+            QRegularExpressionMatchIterator it = expression.globalMatch(text);
+            while (!cancelled && it.hasNext())
+            {
+                const QRegularExpressionMatch match = it.next();
+                if (match.capturedLength() == 0)
+                    continue;
+                offset = byteAt(match.capturedStart());
+                textOffset = match.capturedStart();
+                const qint64 length = byteAt(match.capturedEnd()) - offset;
+                if (query.regex)
+                {
+                    const QVector<QByteArrayView> groups = capturedBytes(match, chunk, byteAt);
+                    visit(chunk, base, offset, length, &groups);
+                }
+                else
+                {
+                    visit(chunk, base, offset, length, nullptr);
+                }
+            }
+        }
+        base = end;
+    }
+}
+
+Replacement replaceInText(const QString &rawText, const Query &query, const QString &replacement,
+                          const std::atomic<bool> &cancelled)
+{
+    Replacement result;
+    QString output;
+    qint64 copied = -1;
+    scanText(rawText, query, cancelled, [&](qint64 position, qint64 length, const QRegularExpressionMatch *match)
+             {
+                 if (copied < 0)
+                     result.position = copied = position;
+                 output.append(QStringView(rawText).mid(copied, position - copied));
+                 output.append(match ? expandText(replacement, *match) : replacement);
+                 copied = position + length;
+                 ++result.count; });
+    if (result.count > 0)
+    {
+        result.removed = copied - result.position;
+        result.text = output;
+    }
+    return result;
+}
+
+Replacement replaceInTable(const PieceTable &table, const Query &query, const QString &replacement,
+                           const std::atomic<bool> &cancelled)
+{
+    Replacement result;
+    const QByteArray replacementBytes = replacement.toUtf8();
+    QByteArray output;
+    qint64 copied = -1;
+    scanBytes(table, query, cancelled, [&](const QByteArray &chunk, qint64 base, qint64 offset, qint64 length, const QVector<QByteArrayView> *groups)
+              {
+                  const qint64 position = base + offset;
+                  if (copied < 0)
+                      result.position = copied = position;
+                  // Промежуток от прошлого совпадения может начинаться в прошлом куске.
+                  if (copied >= base)
+                      output.append(chunk.constData() + (copied - base), position - copied);
+                  else
+                      output.append(table.read(copied, position - copied));
+                  output.append(groups ? expandBytes(replacement, *groups) : replacementBytes);
+                  copied = position + length;
+                  ++result.count; });
+    if (result.count > 0)
+    {
+        result.removed = copied - result.position;
+        result.bytes = output;
+    }
+    return result;
+}
+
+} // namespace
+
+DocumentSearcher::DocumentSearcher(QObject *parent)
+    : QObject(parent)
+{
+}
+
+DocumentSearcher::~DocumentSearcher()
+{
+    cancel();
+}
+
+template <typename Scan>
+void DocumentSearcher::startSearch(Scan scan)
+{
+    cancel();
+
+    const quint64 id = ++generation;
+    const std::shared_ptr<std::atomic<bool>> stop = std::make_shared<std::atomic<bool>>(false);
+    cancelled = stop;
+    worker = QThread::create([this, scan, stop, id]
+                             {
+        QElapsedTimer timer;
+        timer.start();
+        qint64 flushedAt = 0;
+        QVector<Match> batch;
+        auto flush = [this, id, &batch]
+        {
+            if (batch.isEmpty())
+                return;
+            QMetaObject::invokeMethod(this, [this, id, batch]
+                                      {
+                                          if (id != generation)
+                                              return;
+                                          found.append(batch);
+                                          emit matchesFound(int(found.size())); }, Qt::QueuedConnection);
+            batch.clear();
+        };
+        scan(*stop, [&](qint64 position, qint64 length)
+             {
+                 batch.append({position, length});
+                 if (timer.elapsed() - flushedAt >= BatchMs)
+                 {
+                     flush();
+                     flushedAt = timer.elapsed();
+                 } });
+        if (*stop)
+            return;
+        flush();
+        const qint64 elapsedMs = timer.elapsed();
+        QMetaObject::invokeMethod(this, [this, id, elapsedMs]
+                                  {
+                                      if (id != generation)
+                                          return;
+                                      finishWorker();
+                                      complete = true;
+                                      emit finished(int(found.size()), elapsedMs); }, Qt::QueuedConnection); });
+    worker->start();
+}
+
+template <typename Build>
+void DocumentSearcher::startReplace(Build build)
+{
+    cancel();
+
+    const quint64 id = ++generation;
+    const std::shared_ptr<std::atomic<bool>> stop = std::make_shared<std::atomic<bool>>(false);
+    cancelled = stop;
+    worker = QThread::create([this, build, stop, id]
+                             {
+        QElapsedTimer timer;
+        timer.start();
+        const Replacement replacement = build(*stop);
+        if (*stop)
+            return;
+        const qint64 elapsedMs = timer.elapsed();
+        QMetaObject::invokeMethod(this, [this, id, replacement, elapsedMs]
+                                  {
+                                      if (id != generation)
+                                          return;
+                                      finishWorker();
+                                      emit replaced(replacement, elapsedMs); }, Qt::QueuedConnection); });
+    worker->start();
+}
+
+void DocumentSearcher::search(const QString &rawText, const Query &query)
+{
+    startSearch([rawText, query](const std::atomic<bool> &stop, auto add)
+                { scanText(rawText, query, stop, [&add](qint64 position, qint64 length, const QRegularExpressionMatch *)
+                           { add(position, length); }); });
+}
+
+void DocumentSearcher::search(const PieceTable &table, const Query &query)
+{
+    startSearch([table, query](const std::atomic<bool> &stop, auto add)
+                { scanBytes(table, query, stop, [&add](const QByteArray &, qint64 base, qint64 offset, qint64 length, const QVector<QByteArrayView> *)
+                            { add(base + offset, length); }); });
+}
+
+void DocumentSearcher::replaceAll(const QString &rawText, const Query &query, const QString &replacement)
+{
+    startReplace([rawText, query, replacement](const std::atomic<bool> &stop)
+                 { return replaceInText(rawText, query, replacement, stop); });
+}
+
+void DocumentSearcher::replaceAll(const PieceTable &table, const Query &query, const QString &replacement)
+{
+    startReplace([table, query, replacement](const std::atomic<bool> &stop)
+                 { return replaceInTable(table, query, replacement, stop); });
+}
+
+void DocumentSearcher::cancel()
+{
+    found.clear();
+    complete = false;
+    if (!worker)
+        return;
+    *cancelled = true;
+    finishWorker();
+    ++generation;
+}
+
+void DocumentSearcher::finishWorker()
+{
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+    cancelled.reset();
+}
+
+int DocumentSearcher::indexAfter(qint64 pos) const
+{
+    // Совпадения не пересекаются, поэтому и концы идут по возрастанию.
+    return int(std::partition_point(found.cbegin(), found.cend(), [pos](const Match &match)
+                                    { return match.position + match.length <= pos; })
+               - found.cbegin());
+}
+
+bool DocumentSearcher::isValid(const Query &query, QString *error)
+{
+    if (!query.regex)
+        return true;
+    const QRegularExpression expression(query.pattern);
+    if (expression.isValid())
+        return true;
+    if (error)
+        *error = expression.errorString();
+    return false;
+}
+
+// Выражение заново сопоставляется в той же позиции того же текста и
+// даёт то же совпадение, что нашёл поиск: работают ^, $ и просмотр
+// вокруг, а группы берутся из него.
+QString DocumentSearcher::substitute(const QString &rawText, const Query &query, const Match &match,
+                                     const QString &replacement)
+{
+    if (!query.regex)
+        return replacement;
+    QString text = rawText;
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    const QRegularExpressionMatch found = compile(query.pattern, query.caseSensitive)
+                                              .match(text, match.position, QRegularExpression::NormalMatch,
+                                                     QRegularExpression::AnchorAtOffsetMatchOption);
+    return found.hasMatch() ? expandText(replacement, found) : replacement;
+}
+
+// Поиск видел кусок до 4 МБ, здесь — только строки совпадения: просмотр
+// вокруг дальше них не заглядывает.
+QByteArray DocumentSearcher::substitute(const PieceTable &table, const Query &query, const Match &match,
+                                        const QString &replacement)
+{
+    if (!query.regex)
+        return replacement.toUtf8();
+    const qint64 start = table.lineStart(match.position);
+    const qint64 next = table.nextLineStart(match.position + match.length);
+    const QByteArray lines = table.read(start, (next < 0 ? table.size() : next) - start);
+    QVector<qint64> offsets;
+    const QString text = decodeUtf8(lines, &offsets);
+    const qsizetype index = std::lower_bound(offsets.cbegin(), offsets.cend(), match.position - start) - offsets.cbegin();
+    const QRegularExpressionMatch found = compile(query.pattern, query.caseSensitive)
+                                              .match(text, index, QRegularExpression::NormalMatch,
+                                                     QRegularExpression::AnchorAtOffsetMatchOption);
+    if (!found.hasMatch())
+        return replacement.toUtf8();
+    return expandBytes(replacement, capturedBytes(found, lines, [&offsets](qsizetype i)
+                                                  { return offsets[i]; }));
+}
+
+QVector<DocumentSearcher::Match> DocumentSearcher::findAll(const QString &rawText, const Query &query)
+{
+    const std::atomic<bool> never{false};
+    QVector<Match> matches;
+    scanText(rawText, query, never, [&matches](qint64 position, qint64 length, const QRegularExpressionMatch *)
+             { matches.append({position, length}); });
+    return matches;
+}
+
+QVector<DocumentSearcher::Match> DocumentSearcher::findAll(const PieceTable &table, const Query &query)
+{
+    const std::atomic<bool> never{false};
+    QVector<Match> matches;
+    scanBytes(table, query, never, [&matches](const QByteArray &, qint64 base, qint64 offset, qint64 length, const QVector<QByteArrayView> *)
+              { matches.append({base + offset, length}); });
+    return matches;
+}
+
+DocumentSearcher::Replacement DocumentSearcher::buildReplacement(const QString &rawText, const Query &query,
+                                                                 const QString &replacement)
+{
+    const std::atomic<bool> never{false};
+    return replaceInText(rawText, query, replacement, never);
+}
+
+DocumentSearcher::Replacement DocumentSearcher::buildReplacement(const PieceTable &table, const Query &query,
+                                                                 const QString &replacement)
+{
+    const std::atomic<bool> never{false};
+    return replaceInTable(table, query, replacement, never);
+}
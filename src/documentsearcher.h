@@ -0,0 +1,108 @@
+#ifndef DOCUMENTSEARCHER_H
+#define DOCUMENTSEARCHER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+class PieceTable;
+class QThread;
+
+// Поиск и замена в открытом документе. Ищется снимок: toRawText()
+// обычного документа или копия PieceTable большого файла, которая делит
+// с ним буферы. Строка ищется SSE2 (Utf16Matcher, для большого файла —
+// LiteralMatcher по байтам), регулярное выражение — QRegularExpression.
+// Строка без учёта регистра с буквами не из ASCII ищется в большом файле
+// как экранированное выражение: LiteralMatcher сворачивает только ASCII.
+// Совпадения уходят в поток GUI пачками раз в 50 мс, так что счётчик
+// растёт, пока идёт поиск.
+//
+// Замена всех совпадений тоже считается в рабочем потоке за один проход:
+// текст от начала первого совпадения до конца последнего собирается
+// целиком и применяется одной правкой, которая отменяется одним шагом.
+//
+// Запущен только один поиск или одна замена; новый запрос отменяет старый.
+class DocumentSearcher : public QObject {
+    Q_OBJECT
+
+public:
+    struct Query {
+        QString pattern;
+        bool regex = false;
+        bool caseSensitive = false;
+    };
+
+    // В символах toRawText() для обычного документа и в байтах UTF-8
+    // для большого файла. Совпадения не пересекаются и идут по порядку;
+    // пустые совпадения регулярного выражения пропускаются.
+    struct Match {
+        qint64 position;
+        qint64 length;
+    };
+
+    // Отрезок [position, position + removed) заменяется на text (обычный
+    // документ, переводы строк — '\n') или на bytes (большой файл).
+    struct Replacement {
+        qint64 position = 0;
+        qint64 removed = 0;
+        QString text;
+        QByteArray bytes;
+        int count = 0;
+    };
+
+    explicit DocumentSearcher(QObject *parent = nullptr);
+    ~DocumentSearcher() override;
+
+    // rawText — QTextDocument::toRawText().
+    void search(const QString &rawText, const Query &query);
+    void search(const PieceTable &table, const Query &query);
+    void replaceAll(const QString &rawText, const Query &query, const QString &replacement);
+    void replaceAll(const PieceTable &table, const Query &query, const QString &replacement);
+    void cancel(); // и забывает найденное
+
+    bool isRunning() const { return worker != nullptr; }
+    bool isComplete() const { return complete; }
+    const QVector<Match> &matches() const { return found; }
+    // Первое совпадение, которое кончается после pos; matches().size(), если таких нет.
+    int indexAfter(qint64 pos) const;
+
+    static bool isValid(const Query &query, QString *error);
+    // Текст замены одного совпадения из найденных в rawText или в table:
+    // \1–\99 — группы выражения. rawText может быть и частью документа,
+    // например строками совпадения; позиция match тогда отсчитывается от
+    // её начала. Для большого файла — байты UTF-8, группы копируются из
+    // файла как есть.
+    static QString substitute(const QString &rawText, const Query &query, const Match &match,
+                              const QString &replacement);
+    static QByteArray substitute(const PieceTable &table, const Query &query, const Match &match,
+                                 const QString &replacement);
+
+    // Синхронные варианты; выполняются в рабочем потоке.
+    static QVector<Match> findAll(const QString &rawText, const Query &query);
+    static QVector<Match> findAll(const PieceTable &table, const Query &query);
+    static Replacement buildReplacement(const QString &rawText, const Query &query, const QString &replacement);
+    static Replacement buildReplacement(const PieceTable &table, const Query &query, const QString &replacement);
+
+signals:
+    void matchesFound(int count);
+    void finished(int count, qint64 elapsedMs);
+    void replaced(const DocumentSearcher::Replacement &replacement, qint64 elapsedMs);
+
+private:
+    template <typename Scan>
+    void startSearch(Scan scan);
+    template <typename Build>
+    void startReplace(Build build);
+    void finishWorker();
+
+    QThread *worker = nullptr;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    quint64 generation = 0;
+    QVector<Match> found;
+    bool complete = false;
+};
+
+#endif // DOCUMENTSEARCHER_H
@@ -0,0 +1,559 @@
+#include "editjournal.h"
+#include "fileloader.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextDocument>
+#include <QThread>
+#include <QUuid>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Файл: Magic, затем кадры «тип, длина payload (varint), payload,
+// qChecksum кадра». Оборванный или испорченный кадр завершает чтение.
+const QByteArray Magic("PJNL\x01", 5);
+const QString Suffix = QStringLiteral(".journal");
+
+enum RecordType : char {
+    FileBase = 'F',   // путь, размер, время изменения (мс)
+    Snapshot = 'C',   // путь, текст UTF-8, формат (в старых журналах его нет)
+    Insert = 'I',     // позиция, текст UTF-8
+    Remove = 'D',     // позиция, число символов
+};
+
+void appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const QByteArray &data, qsizetype *pos, quint64 *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && *pos < data.size(); shift += 7)
+    {
+        const uchar c = uchar(data[(*pos)++]);
+        *value |= quint64(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+void appendString(QByteArray &out, const QString &text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    appendVarint(out, quint64(utf8.size()));
+    out.append(utf8);
+}
+
+bool readString(const QByteArray &data, qsizetype *pos, QString *text)
+{
+    quint64 length = 0;
+    if (!readVarint(data, pos, &length) || length > quint64(data.size() - *pos))
+        return false;
+    *text = QString::fromUtf8(data.constData() + *pos, qsizetype(length));
+    *pos += qsizetype(length);
+    return true;
+}
+
+void appendFormat(QByteArray &out, const TextFormat &format)
+{
+    appendVarint(out, quint64(format.encoding));
+    appendVarint(out, format.bom ? 1 : 0);
+    appendString(out, format.lineEnding);
+}
+
+bool readFormat(const QByteArray &data, qsizetype *pos, TextFormat *format)
+{
+    quint64 encoding = 0;
+    quint64 bom = 0;
+    QString lineEnding;
+    if (!readVarint(data, pos, &encoding) || encoding > quint64(QStringConverter::LastEncoding)
+        || !readVarint(data, pos, &bom) || !readString(data, pos, &lineEnding))
+        return false;
+    format->encoding = QStringConverter::Encoding(encoding);
+    format->bom = bom != 0;
+    format->lineEnding = lineEnding;
+    return true;
+}
+
+void appendFrame(QByteArray &out, char type, const QByteArray &payload)
+{
+    const qsizetype start = out.size();
+    out.append(type);
+    appendVarint(out, quint64(payload.size()));
+    out.append(payload);
+    const quint16 sum = qChecksum(QByteArrayView(out).sliced(start));
+    out.append(char(sum & 0xff));
+    out.append(char(sum >> 8));
+}
+
+QByteArray fileBaseFrame(const QString &filePath, qint64 size, qint64 modifiedMs)
+{
+    QByteArray payload;
+    appendString(payload, filePath);
+    appendVarint(payload, quint64(size));
+    appendVarint(payload, quint64(modifiedMs));
+    QByteArray frame;
+    appendFrame(frame, FileBase, payload);
+    return frame;
+}
+
+bool syncToDisk(QFile &file)
+{
+    if (!file.flush())
+        return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+// Текст и формат файла так, как их показал бы FileLoader.
+bool readBaseFile(const QString &filePath, qint64 size, qint64 modifiedMs, QString *text, TextFormat *format,
+                  QString *error)
+{
+    const QFileInfo info(filePath);
+    if (!info.exists() || info.size() != size || info.lastModified().toMSecsSinceEpoch() != modifiedMs)
+    {
+        *error = QString("файл %1 изменился после сбоя").arg(filePath);
+        return false;
+    }
+    return FileLoader::readText(filePath, text, format, error);
+}
+
+} // namespace
+
+QString EditJournal::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/recovery";
+}
+
+// Журнал, чью блокировку удалось взять, никто не ведёт: владелец упал
+// или закрылся, не сохранив документ.
+QStringList EditJournal::orphans(const QString &directory)
+{
+    QStringList result;
+    const QDir dir(directory);
+    const QStringList names = dir.entryList({"*" + Suffix}, QDir::Files, QDir::Time | QDir::Reversed);
+    for (const QString &name : names)
+    {
+        const QString journal = dir.filePath(name);
+        QLockFile probe(journal + ".lock");
+        probe.setStaleLockTime(0); // чужая блокировка снимается, только если её процесс мёртв
+        if (probe.tryLock(0))
+            result.append(journal);
+    }
+    return result;
+}
+
+bool EditJournal::recover(const QString &journalPath, Recovery *recovery, QString *error)
+{
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    if (!data.startsWith(Magic))
+    {
+        *error = QString("%1 не является журналом правок").arg(journalPath);
+        return false;
+    }
+
+    QString text;
+    bool hasBase = false;
+    qsizetype pos = Magic.size();
+    while (pos < data.size())
+    {
+        const qsizetype frameStart = pos;
+        const char type = data[pos++];
+        quint64 length = 0;
+        if (!readVarint(data, &pos, &length) || length + 2 > quint64(data.size() - pos))
+        {
+            pos = frameStart;
+            break;
+        }
+        const qsizetype payloadStart = pos;
+        pos += qsizetype(length);
+        const quint16 stored = quint16(uchar(data[pos]) | uchar(data[pos + 1]) << 8);
+        if (stored != qChecksum(QByteArrayView(data).sliced(frameStart, pos - frameStart)))
+        {
+            pos = frameStart;
+            break;
+        }
+        pos += 2;
+
+        const QByteArray payload = data.sliced(payloadStart, qsizetype(length));
+        qsizetype at = 0;
+        quint64 position = 0;
+        quint64 count = 0;
+        QString value;
+        bool ok = false;
+        switch (type)
+        {
+        case FileBase:
+            ok = readString(payload, &at, &recovery->filePath) && readVarint(payload, &at, &count)
+                && readVarint(payload, &at, &position);
+            if (ok && !readBaseFile(recovery->filePath, qint64(count), qint64(position), &text, &recovery->format, error))
+                return false;
+            hasBase = ok;
+            break;
+        case Snapshot:
+            ok = readString(payload, &at, &recovery->filePath) && readString(payload, &at, &text)
+                && (at == payload.size() || readFormat(payload, &at, &recovery->format));
+            hasBase = ok;
+            break;
+        case Insert:
+            ok = hasBase && readVarint(payload, &at, &position) && readString(payload, &at, &value)
+                && position <= quint64(text.size());
+            if (ok)
+                text.insert(qsizetype(position), value);
+            break;
+        case Remove:
+            ok = hasBase && readVarint(payload, &at, &position) && readVarint(payload, &at, &count)
+                && position + count <= quint64(text.size());
+            if (ok)
+                text.remove(qsizetype(position), qsizetype(count));
+            break;
+        default:
+            break;
+        }
+        if (!ok)
+        {
+            pos = frameStart;
+            break;
+        }
+    }
+
+    if (!hasBase)
+    {
+        *error = QString("журнал %1 пуст или повреждён").arg(journalPath);
+        return false;
+    }
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    recovery->text = text;
+    recovery->complete = pos == data.size();
+    return true;
+}
+
+void EditJournal::remove(const QString &journalPath)
+{
+    QFile::remove(journalPath);
+    QFile::remove(journalPath + ".lock");
+}
+
+EditJournal::EditJournal(const QString &directory, QObject *parent)
+    : QObject(parent), directory(directory)
+{
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FlushInterval);
+    connect(&flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+}
+
+EditJournal::~EditJournal()
+{
+    sync();
+}
+
+void EditJournal::setDocument(QTextDocument *document)
+{
+    this->document = document;
+}
+
+void EditJournal::setFilePath(const QString &filePath)
+{
+    documentPath = filePath;
+}
+
+void EditJournal::setFormat(const TextFormat &format)
+{
+    documentFormat = format;
+}
+
+void EditJournal::markSaving()
+{
+    saving = true;
+    sinceSave.clear();
+}
+
+void EditJournal::markClean(const QString &filePath, qint64 size, qint64 modifiedMs)
+{
+    const bool afterSave = saving;
+    saving = false;
+    documentPath = filePath;
+    if (!afterSave || sinceSave.isEmpty() || !isActive())
+    {
+        discard();
+        clean = true;
+        cleanSize = size;
+        cleanModified = modifiedMs;
+        return;
+    }
+
+    // Пока файл писался, документ успели изменить: новый журнал — это
+    // сохранённый файл и правки, сделанные после снимка для сохранения.
+    Job job;
+    job.rewrite = true;
+    job.bytes = fileBaseFrame(filePath, size, modifiedMs) + sinceSave;
+    queued = {job};
+    buffer.clear();
+    needSnapshot = false;
+    logged = sinceSave.size();
+    sinceSave.clear();
+    clean = false;
+    if (!flushTimer.isActive())
+        flushTimer.start();
+}
+
+void EditJournal::checkpoint()
+{
+    if (!isActive() && !open())
+        return;
+    clean = false;
+    needSnapshot = true;
+    if (!flushTimer.isActive())
+        flushTimer.start();
+}
+
+void EditJournal::discard()
+{
+    flushTimer.stop();
+    if (worker)
+    {
+        finishWorker();
+        ++runId; // результат, уже стоящий в очереди, будет отброшен
+    }
+    queued.clear();
+    buffer.clear();
+    sinceSave.clear();
+    needSnapshot = false;
+    clean = false;
+    logged = 0;
+    if (isActive())
+    {
+        QFile::remove(path);
+        lock.reset();
+        path.clear();
+    }
+}
+
+bool EditJournal::sync()
+{
+    flushTimer.stop();
+    if (worker)
+    {
+        finishWorker();
+        ++runId;
+    }
+    const QVector<Job> jobs = takeJobs();
+    QString error;
+    if (!jobs.isEmpty() && !write(path, jobs, &error))
+    {
+        needSnapshot = true;
+        emit failed(error);
+        return false;
+    }
+    return true;
+}
+
+void EditJournal::record(int position, int removedLength, const QString &inserted)
+{
+    if (!isActive())
+    {
+        if (!open())
+            return;
+        // Основа журнала — файл, если текст до этой правки с ним совпадал,
+        // иначе снимок, в который попадёт и сама правка.
+        if (clean && !documentPath.isEmpty())
+        {
+            Job job;
+            job.rewrite = true;
+            job.bytes = fileBaseFrame(documentPath, cleanSize, cleanModified);
+            queued.append(job);
+        }
+        else
+        {
+            needSnapshot = true;
+        }
+    }
+    clean = false;
+
+    QByteArray entry;
+    QByteArray payload;
+    if (removedLength > 0)
+    {
+        appendVarint(payload, quint64(position));
+        appendVarint(payload, quint64(removedLength));
+        appendFrame(entry, Remove, payload);
+        payload.clear();
+    }
+    if (!inserted.isEmpty())
+    {
+        appendVarint(payload, quint64(position));
+        appendString(payload, inserted);
+        appendFrame(entry, Insert, payload);
+    }
+    if (saving)
+        sinceSave.append(entry);
+    if (!needSnapshot)
+    {
+        buffer.append(entry);
+        logged += entry.size();
+        // Журнал много больше текста: дешевле переписать его снимком.
+        if (document && logged > CompactBytes && logged > 2 * qint64(document->characterCount()))
+            needSnapshot = true;
+    }
+    if (!flushTimer.isActive())
+        flushTimer.start();
+}
+
+bool EditJournal::open()
+{
+    if (!QDir().mkpath(directory))
+    {
+        emit failed(QString("не удалось создать каталог %1").arg(directory));
+        return false;
+    }
+    const QString candidate = QDir(directory).filePath(QUuid::createUuid().toString(QUuid::WithoutBraces) + Suffix);
+    std::unique_ptr<QLockFile> candidateLock = std::make_unique<QLockFile>(candidate + ".lock");
+    candidateLock->setStaleLockTime(0);
+    if (!candidateLock->tryLock(0))
+    {
+        emit failed(QString("не удалось заблокировать %1").arg(candidate));
+        return false;
+    }
+    lock = std::move(candidateLock);
+    path = candidate;
+    logged = 0;
+    return true;
+}
+
+// Накопленное за интервал одним набором заданий. Снимок заменяет и
+// основу, и все записи до него.
+QVector<EditJournal::Job> EditJournal::takeJobs()
+{
+    if (needSnapshot && document)
+    {
+        Job job;
+        job.rewrite = true;
+        job.snapshot = true;
+        job.filePath = documentPath;
+        job.format = documentFormat;
+        job.rawText = document->toRawText();
+        queued = {job};
+        buffer.clear();
+        needSnapshot = false;
+        logged = 0;
+    }
+    else if (!buffer.isEmpty())
+    {
+        Job job;
+        job.bytes = buffer;
+        queued.append(job);
+        buffer.clear();
+    }
+    QVector<Job> jobs = std::move(queued);
+    queued.clear();
+    return jobs;
+}
+
+void EditJournal::flush()
+{
+    if (worker)
+        return; // таймер перезапустится по окончании записи
+    const QVector<Job> jobs = takeJobs();
+    if (jobs.isEmpty())
+        return;
+
+    const quint64 id = ++runId;
+    const QString target = path;
+    worker = QThread::create([this, target, jobs, id]
+                             {
+        QString error;
+        const bool ok = write(target, jobs, &error);
+        QMetaObject::invokeMethod(this, [this, ok, error, id]
+                                  {
+                                      if (id != runId)
+                                          return;
+                                      finishWorker();
+                                      if (!ok)
+                                      {
+                                          // Журнал мог остаться без части записей.
+                                          needSnapshot = true;
+                                          emit failed(error);
+                                      }
+                                      if (needSnapshot || !buffer.isEmpty() || !queued.isEmpty())
+                                          flushTimer.start(); }, Qt::QueuedConnection); });
+    worker->start();
+}
+
+void EditJournal::finishWorker()
+{
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+}
+
+// Выполняется в рабочем потоке (или в GUI из sync()).
+bool EditJournal::write(const QString &path, const QVector<Job> &jobs, QString *error)
+{
+    for (const Job &job : jobs)
+    {
+        if (job.rewrite)
+        {
+            QByteArray data = Magic;
+            if (job.snapshot)
+            {
+                QString text = job.rawText;
+                text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+                QByteArray payload;
+                appendString(payload, job.filePath);
+                appendString(payload, text);
+                appendFormat(payload, job.format);
+                appendFrame(data, Snapshot, payload);
+            }
+            data += job.bytes;
+
+            QSaveFile file(path);
+            if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size())
+            {
+                *error = file.errorString();
+                return false;
+            }
+            if (!file.commit())
+            {
+                *error = file.errorString();
+                return false;
+            }
+        }
+        else
+        {
+            QFile file(path);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Append) || file.write(job.bytes) != job.bytes.size()
+                || !syncToDisk(file))
+            {
+                *error = file.errorString();
+                return false;
+            }
+        }
+    }
+    return true;
+}
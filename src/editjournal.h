@@ -0,0 +1,118 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <memory>
+#include "fileloader.h"
+
+class QLockFile;
+class QTextDocument;
+class QThread;
+
+// Журнал правок документа для восстановления после падения. Файл журнала
+// начинается с основы — ссылки на сохранённый файл (путь, размер, время
+// изменения) или полного снимка текста с форматом файла (кодировка, BOM,
+// концы строк), — за ней идут короткие записи
+// вставки и удаления. Записи копятся в памяти и раз в FlushInterval
+// дописываются в рабочем потоке с fsync, так что на нажатие приходится
+// только кодирование записи. Когда журнал разрастается много больше
+// самого текста, он переписывается одним снимком; после сохранения
+// начинается заново от файла или удаляется.
+//
+// Пока журнал открыт, его держит QLockFile. Журналы без живого владельца
+// остались от упавшего (или закрытого без сохранения) процесса: их
+// находит orphans(), а recover() восстанавливает текст.
+class EditJournal : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int FlushInterval = 1000;               // мс
+    static constexpr qint64 CompactBytes = 4 * 1024 * 1024;
+
+    struct Recovery {
+        QString filePath; // пусто — документ без имени
+        QString text;     // концы строк — '\n'
+        TextFormat format; // как записывать файл при сохранении
+        bool complete = true; // false — хвост журнала оборван, последние правки потеряны
+    };
+
+    static QString defaultDirectory();
+    static QStringList orphans(const QString &directory);
+    static bool recover(const QString &journalPath, Recovery *recovery, QString *error);
+    static void remove(const QString &journalPath);
+
+    explicit EditJournal(const QString &directory, QObject *parent = nullptr);
+    ~EditJournal() override; // дописывает журнал, но не удаляет его
+
+    // Документ нужен для снимков; nullptr, пока текст выгружен.
+    void setDocument(QTextDocument *document);
+    void setFilePath(const QString &filePath);
+    void setFormat(const TextFormat &format); // попадает в снимки
+
+    // Текст документа совпадает с файлом на диске: журнал не нужен, а
+    // если понадобится, начнётся со ссылки на этот файл. Вызывается после
+    // загрузки и после сохранения; в последнем случае правки, сделанные
+    // с markSaving(), переносятся в новый журнал.
+    void markClean(const QString &filePath, qint64 size, qint64 modifiedMs);
+    void markSaving();
+
+    // Следующая запись журнала — полный снимок документа.
+    void checkpoint();
+    void discard();
+    bool sync(); // дописывает накопленное и ждёт записи на диск
+
+    bool isActive() const { return !path.isEmpty(); }
+    QString fileName() const { return path; }
+    qint64 loggedBytes() const { return logged; }
+
+public slots:
+    // position и тексты — в символах QTextDocument::toRawText().
+    void record(int position, int removedLength, const QString &inserted);
+
+signals:
+    void failed(const QString &error);
+
+private:
+    struct Job {
+        bool rewrite = false;   // true — файл пишется заново, иначе дописывается
+        bool snapshot = false;  // основа — снимок rawText
+        QString filePath;
+        QString rawText;
+        TextFormat format;
+        QByteArray bytes;
+    };
+
+    bool open();
+    QVector<Job> takeJobs();
+    void flush();
+    void finishWorker();
+    static bool write(const QString &path, const QVector<Job> &jobs, QString *error);
+
+    QString directory;
+    QString path;
+    std::unique_ptr<QLockFile> lock;
+    QTextDocument *document = nullptr;
+    QTimer flushTimer;
+    QThread *worker = nullptr;
+    quint64 runId = 0;
+
+    QVector<Job> queued;   // ждут рабочего потока
+    QByteArray buffer;     // записи после последнего задания
+    QByteArray sinceSave;  // записи с начала сохранения
+    bool needSnapshot = false;
+    bool saving = false;
+
+    QString documentPath;
+    TextFormat documentFormat;
+    bool clean = false;    // текст совпадает с файлом documentPath
+    qint64 cleanSize = 0;
+    qint64 cleanModified = 0;
+    qint64 logged = 0;     // байт журнала после основы
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,91 @@
+#include "filefinderdialog.h"
+#include "pathtable.h"
+#include "projectfiles.h"
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QVBoxLayout>
+
+FileFinderDialog::FileFinderDialog(ProjectFiles *files, QWidget *parent)
+    : QDialog(parent), files(files)
+{
+    setWindowTitle("Перейти к файлу");
+    resize(600, 400);
+
+    queryEdit = new QLineEdit(this);
+    queryEdit->setPlaceholderText("Имя файла...");
+    queryEdit->installEventFilter(this);
+    resultList = new QListWidget(this);
+    statusLabel = new QLabel(QString("Файлов в проекте: %1").arg(files->paths().size()), this);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(queryEdit);
+    layout->addWidget(resultList);
+    layout->addWidget(statusLabel);
+
+    connect(queryEdit, &QLineEdit::textChanged, this, &FileFinderDialog::updateResults);
+    connect(queryEdit, &QLineEdit::returnPressed, this, &QDialog::accept);
+    connect(resultList, &QListWidget::itemActivated, this, &QDialog::accept);
+    connect(files, &ProjectFiles::pathsChanged, this, &FileFinderDialog::refreshResults);
+}
+
+QString FileFinderDialog::selectedFile() const
+{
+    const int row = resultList->currentRow();
+    if (row < 0 || row >= results.size())
+        return QString();
+    return files->root() + '/' + results[row];
+}
+
+bool FileFinderDialog::eventFilter(QObject *watched, QEvent *event)
+{
+    // Стрелки в строке запроса двигают выделение в списке.
+    if (watched == queryEdit && event->type() == QEvent::KeyPress)
+    {
+        const int key = static_cast<QKeyEvent *>(event)->key();
+        if (key == Qt::Key_Down || key == Qt::Key_Up)
+        {
+            const int row = resultList->currentRow() + (key == Qt::Key_Down ? 1 : -1);
+            if (row >= 0 && row < resultList->count())
+                resultList->setCurrentRow(row);
+            return true;
+        }
+    }
+    return QDialog::eventFilter(watched, event);
+}
+
+void FileFinderDialog::updateResults(const QString &text)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const PathTable &paths = files->paths();
+    const QVector<int> ids = paths.match(text);
+    results.clear();
+    for (int id : ids)
+        results.append(paths.path(id));
+    const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+
+    resultList->clear();
+    for (const QString &path : std::as_const(results))
+    {
+        const qsizetype slash = path.lastIndexOf(QLatin1Char('/'));
+        resultList->addItem(slash < 0 ? path : QString("%1  —  %2").arg(path.mid(slash + 1), path.left(slash)));
+    }
+    if (!results.isEmpty())
+        resultList->setCurrentRow(0);
+    statusLabel->setText(QString("Найдено: %1 из %2 (%3 мкс)").arg(results.size()).arg(paths.size()).arg(elapsedUs));
+}
+
+// Таблица пересобрана, пока диалог открыт: выделение остаётся на том же
+// файле, если он ещё найден.
+void FileFinderDialog::refreshResults()
+{
+    const int row = resultList->currentRow();
+    const QString selected = row >= 0 && row < results.size() ? results[row] : QString();
+    updateResults(queryEdit->text());
+    const int kept = results.indexOf(selected);
+    if (kept > 0)
+        resultList->setCurrentRow(kept);
+}
@@ -0,0 +1,39 @@
+#ifndef FILEFINDERDIALOG_H
+#define FILEFINDERDIALOG_H
+
+#include <QDialog>
+#include <QStringList>
+
+class QLabel;
+class QLineEdit;
+class QListWidget;
+class ProjectFiles;
+
+// Переход к файлу по нечёткому запросу (Ctrl+P): поиск по таблице путей
+// проекта на каждое нажатие клавиши. Номера в таблице меняются при
+// пересмотре каталогов, поэтому найденное хранится путями, а при
+// изменении таблицы поиск повторяется.
+class FileFinderDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit FileFinderDialog(ProjectFiles *files, QWidget *parent = nullptr);
+
+    QString selectedFile() const;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void updateResults(const QString &text);
+    void refreshResults();
+
+private:
+    ProjectFiles *files;
+    QLineEdit *queryEdit;
+    QListWidget *resultList;
+    QLabel *statusLabel;
+    QStringList results;
+};
+
+#endif // FILEFINDERDIALOG_H
@@ -0,0 +1,232 @@
+#include "fileloader.h"
+#include <QFile>
+#include <QStringDecoder>
+#include <QThread>
+
+namespace {
+
+// Приводит CRLF и одиночные CR к '\n'. '\r' в конце порции откладывается
+// до следующей, чтобы не разорвать пару CRLF на границе чтения. Пустой
+// lineEnding получает первый встреченный перевод строки.
+QString normalizeLineEndings(QString text, bool *pendingCarriageReturn, bool lastChunk, QString *lineEnding)
+{
+    if (*pendingCarriageReturn)
+    {
+        text.prepend(QLatin1Char('\r'));
+        *pendingCarriageReturn = false;
+    }
+    if (!lastChunk && text.endsWith(QLatin1Char('\r')))
+    {
+        text.chop(1);
+        *pendingCarriageReturn = true;
+    }
+    if (lineEnding->isEmpty())
+    {
+        for (qsizetype i = 0; i < text.size(); ++i)
+        {
+            if (text[i] == QLatin1Char('\n'))
+            {
+                *lineEnding = QStringLiteral("\n");
+                break;
+            }
+            if (text[i] == QLatin1Char('\r'))
+            {
+                const bool pair = i + 1 < text.size() && text[i + 1] == QLatin1Char('\n');
+                *lineEnding = pair ? QStringLiteral("\r\n") : QStringLiteral("\r");
+                break;
+            }
+        }
+    }
+    if (text.contains(QLatin1Char('\r')))
+    {
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+        text.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+    }
+    return text;
+}
+
+bool startsWithBom(const QByteArray &bytes, QStringConverter::Encoding encoding)
+{
+    switch (encoding)
+    {
+    case QStringConverter::Utf8:
+        return bytes.startsWith("\xEF\xBB\xBF");
+    case QStringConverter::Utf16LE:
+        return bytes.startsWith("\xFF\xFE");
+    case QStringConverter::Utf16BE:
+        return bytes.startsWith("\xFE\xFF");
+    case QStringConverter::Utf32LE:
+        return bytes.startsWith(QByteArray("\xFF\xFE\0\0", 4));
+    case QStringConverter::Utf32BE:
+        return bytes.startsWith(QByteArray("\0\0\xFE\xFF", 4));
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+QStringConverter::Encoding FileLoader::detectEncoding(const QByteArray &firstChunk)
+{
+    QStringConverter::Encoding detected = QStringConverter::encodingForData(firstChunk).value_or(QStringConverter::Utf8);
+    if (detected == QStringConverter::Utf8)
+    {
+        QStringDecoder probe(QStringConverter::Utf8);
+        const QString probeText = probe(firstChunk);
+        Q_UNUSED(probeText);
+        if (probe.hasError())
+            detected = QStringConverter::Latin1;
+    }
+    return detected;
+}
+
+bool FileLoader::readText(const QString &fileName, QString *text, TextFormat *format, QString *error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = file.errorString();
+        return false;
+    }
+    const QByteArray bytes = file.readAll();
+    if (file.error() != QFileDevice::NoError)
+    {
+        *error = file.errorString();
+        return false;
+    }
+    *format = TextFormat();
+    format->encoding = detectEncoding(bytes.left(ChunkSize));
+    format->bom = startsWithBom(bytes, format->encoding);
+    QStringDecoder decoder(format->encoding);
+    bool pendingCarriageReturn = false;
+    QString lineEnding;
+    *text = normalizeLineEndings(decoder(bytes), &pendingCarriageReturn, true, &lineEnding);
+    if (!lineEnding.isEmpty())
+        format->lineEnding = lineEnding;
+    return true;
+}
+
+FileLoader::FileLoader(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FileLoader::~FileLoader()
+{
+    cancel();
+}
+
+void FileLoader::load(const QString &fileName)
+{
+    cancel();
+
+    const quint64 id = ++generation;
+    std::shared_ptr<LoadState> state = std::make_shared<LoadState>();
+    current = state;
+    worker = QThread::create([this, state, fileName, id] { run(state, fileName, id); });
+    worker->start();
+}
+
+void FileLoader::cancel()
+{
+    if (!worker)
+        return;
+    current->cancelled = true;
+    current->window.release(MaxPendingChunks);
+    finishWorker();
+    ++generation; // порции, уже стоящие в очереди, будут отброшены
+}
+
+void FileLoader::finishWorker()
+{
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+    current.reset();
+}
+
+// Выполняется в рабочем потоке.
+void FileLoader::run(const std::shared_ptr<LoadState> &state, const QString &fileName, quint64 id)
+{
+    TextFormat formatUsed;
+    auto finish = [this, id, fileName, &formatUsed](bool ok, const QString &encodingUsed)
+    {
+        QMetaObject::invokeMethod(this, [this, id, fileName, ok, encodingUsed, formatUsed]
+                                  {
+                                      if (id != generation)
+                                          return;
+                                      encoding = encodingUsed;
+                                      format = formatUsed;
+                                      finishWorker();
+                                      emit finished(fileName, ok); }, Qt::QueuedConnection);
+    };
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        finish(false, QString());
+        return;
+    }
+
+    const qint64 total = file.size();
+    qint64 done = 0;
+    QStringDecoder decoder;
+    QString encodingUsed;
+    QString lineEnding;
+    bool pendingCarriageReturn = false;
+
+    while (!state->cancelled)
+    {
+        const QByteArray bytes = file.read(ChunkSize);
+        if (bytes.isEmpty())
+        {
+            if (file.error() != QFileDevice::NoError)
+            {
+                finish(false, encodingUsed);
+                return;
+            }
+            break;
+        }
+        done += bytes.size();
+
+        if (!decoder.isValid())
+        {
+            const QStringConverter::Encoding detected = detectEncoding(bytes);
+            decoder = QStringDecoder(detected);
+            encodingUsed = QString::fromLatin1(QStringConverter::nameForEncoding(detected));
+            formatUsed.encoding = detected;
+            formatUsed.bom = startsWithBom(bytes, detected);
+        }
+
+        const bool lastChunk = done >= total;
+        const QString text = normalizeLineEndings(decoder(bytes), &pendingCarriageReturn, lastChunk, &lineEnding);
+
+        state->window.acquire();
+        if (state->cancelled)
+            return;
+        QMetaObject::invokeMethod(this, [this, state, id, text, done, total]
+                                  {
+                                      if (id == generation)
+                                      {
+                                          emit chunkReady(text);
+                                          emit progress(done, total);
+                                      }
+                                      state->window.release(); }, Qt::QueuedConnection);
+    }
+
+    if (state->cancelled)
+        return;
+    if (pendingCarriageReturn)
+    {
+        if (lineEnding.isEmpty())
+            lineEnding = QStringLiteral("\r");
+        const QString newline(QLatin1Char('\n'));
+        QMetaObject::invokeMethod(this, [this, id, newline]
+                                  {
+                                      if (id == generation)
+                                          emit chunkReady(newline); }, Qt::QueuedConnection);
+    }
+    if (!lineEnding.isEmpty())
+        formatUsed.lineEnding = lineEnding;
+    finish(true, encodingUsed);
+}
@@ -0,0 +1,78 @@
+#ifndef FILELOADER_H
+#define FILELOADER_H
+
+#include <QObject>
+#include <QSemaphore>
+#include <QString>
+#include <QStringConverter>
+#include <atomic>
+#include <memory>
+
+class QThread;
+
+// Как текст записан в файле: сохранение повторяет кодировку, BOM и
+// перевод строки. У файла без переводов строк и у нового файла перевод
+// строки принятый в системе.
+struct TextFormat {
+    QStringConverter::Encoding encoding = QStringConverter::Utf8;
+    bool bom = false;
+#ifdef Q_OS_WIN
+    QString lineEnding = QStringLiteral("\r\n");
+#else
+    QString lineEnding = QStringLiteral("\n");
+#endif
+};
+
+// Чтение и декодирование файла в рабочем потоке порциями фиксированного
+// размера. Кодировка определяется по BOM (иначе UTF-8 с откатом на
+// Latin-1), концы строк приводятся к '\n'; первый из них и BOM
+// запоминаются в TextFormat. Порции приходят в поток GUI
+// сигналом chunkReady; одновременно в очереди не больше MaxPendingChunks,
+// поэтому чтение не убегает вперёд от вставки в документ.
+class FileLoader : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 ChunkSize = 512 * 1024;
+    static constexpr int MaxPendingChunks = 4;
+
+    explicit FileLoader(QObject *parent = nullptr);
+    ~FileLoader() override;
+
+    // Кодировка по первой порции файла: BOM, иначе UTF-8 или Latin-1,
+    // если порция не читается как UTF-8.
+    static QStringConverter::Encoding detectEncoding(const QByteArray &firstChunk);
+    // Файл целиком с той же кодировкой и концами строк, что при чтении
+    // порциями. Для рабочих потоков.
+    static bool readText(const QString &fileName, QString *text, TextFormat *format, QString *error);
+
+    void load(const QString &fileName);
+    bool isRunning() const { return worker != nullptr; }
+    QString encodingName() const { return encoding; }
+    TextFormat textFormat() const { return format; }
+
+public slots:
+    void cancel();
+
+signals:
+    void chunkReady(const QString &text);
+    void progress(qint64 bytesRead, qint64 totalBytes);
+    void finished(const QString &fileName, bool ok);
+
+private:
+    struct LoadState {
+        std::atomic<bool> cancelled{false};
+        QSemaphore window{MaxPendingChunks};
+    };
+
+    void run(const std::shared_ptr<LoadState> &state, const QString &fileName, quint64 id);
+    void finishWorker();
+
+    QThread *worker = nullptr;
+    std::shared_ptr<LoadState> current;
+    quint64 generation = 0;
+    QString encoding;
+    TextFormat format;
+};
+
+#endif // FILELOADER_H
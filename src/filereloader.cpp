@@ -0,0 +1,116 @@
+#include "filereloader.h"
+#include "fileloader.h"
+#include "linediff.h"
+#include <QFileInfo>
+#include <QThread>
+
+namespace {
+
+// Начала строк в символах; последний элемент — длина текста.
+QVector<qsizetype> lineOffsets(const QVector<QStringView> &lines)
+{
+    QVector<qsizetype> offsets;
+    offsets.reserve(lines.size() + 1);
+    qsizetype offset = 0;
+    offsets.append(offset);
+    for (QStringView line : lines)
+    {
+        offset += line.size();
+        offsets.append(offset);
+    }
+    return offsets;
+}
+
+} // namespace
+
+FileReloader::FileReloader(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FileReloader::~FileReloader()
+{
+    if (worker)
+    {
+        worker->wait();
+        delete worker;
+    }
+}
+
+void FileReloader::reload(const QString &filePath, const QString &rawText, quint64 revision)
+{
+    const Job job{filePath, rawText, revision};
+    if (!worker)
+    {
+        start(job);
+        return;
+    }
+    for (Job &waiting : pending)
+    {
+        if (waiting.filePath == filePath)
+        {
+            waiting = job;
+            return;
+        }
+    }
+    pending.append(job);
+}
+
+void FileReloader::start(const Job &job)
+{
+    worker = QThread::create([this, job]
+                             {
+        Result result;
+        result.filePath = job.filePath;
+        result.revision = job.revision;
+        QString error;
+        const bool ok = compute(job.filePath, job.rawText, &result, &error);
+        QMetaObject::invokeMethod(this, [this, result, ok, error]
+                                  {
+                                      worker->wait();
+                                      delete worker;
+                                      worker = nullptr;
+                                      if (ok)
+                                          emit reloaded(result);
+                                      else
+                                          emit failed(result.filePath, error);
+                                      if (!worker && !pending.isEmpty())
+                                          start(pending.takeFirst()); }, Qt::QueuedConnection); });
+    worker->start();
+}
+
+// Выполняется в рабочем потоке. Строки сравниваются вместе с
+// разделителем, поэтому замена строк — это замена отрезка текста.
+bool FileReloader::compute(const QString &filePath, const QString &rawText, Result *result, QString *error)
+{
+    // Размер и время берутся до чтения: если файл допишут во время
+    // чтения, следующее уведомление перечитает его снова.
+    const QFileInfo info(filePath);
+    result->size = info.size();
+    result->modified = info.lastModified();
+
+    QString text;
+    if (!FileLoader::readText(filePath, &text, &result->format, error))
+        return false;
+    text.replace(QLatin1Char('\n'), QChar::ParagraphSeparator);
+
+    const QVector<QStringView> oldLines = LineDiff::split(rawText, QChar::ParagraphSeparator);
+    const QVector<QStringView> newLines = LineDiff::split(text, QChar::ParagraphSeparator);
+    const QVector<LineDiff::Hunk> hunks = LineDiff::compute(oldLines, newLines);
+    const QVector<qsizetype> oldOffsets = lineOffsets(oldLines);
+    const QVector<qsizetype> newOffsets = lineOffsets(newLines);
+
+    result->edits.clear();
+    result->edits.reserve(hunks.size());
+    for (auto hunk = hunks.crbegin(); hunk != hunks.crend(); ++hunk)
+    {
+        const qsizetype from = oldOffsets[hunk->oldStart];
+        const qsizetype insertFrom = newOffsets[hunk->newStart];
+        Edit edit;
+        edit.position = int(from);
+        edit.removed = int(oldOffsets[hunk->oldStart + hunk->oldCount] - from);
+        edit.inserted = text.mid(insertFrom, newOffsets[hunk->newStart + hunk->newCount] - insertFrom);
+        result->edits.append(edit);
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef FILERELOADER_H
+#define FILERELOADER_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include "fileloader.h"
+
+class QThread;
+
+// Перечитывание файла, изменённого вне редактора (сборка, генератор кода,
+// git checkout). В рабочем потоке файл читается так же, как при загрузке,
+// и сравнивается по строкам со снимком документа (LineDiff). В поток GUI
+// приходят только правки — замены отрезков текста — от конца документа
+// к началу, поэтому позиции ещё не применённых правок не сдвигаются.
+// Запросы выполняются по одному; ожидающий запрос для того же файла
+// заменяется более свежим.
+class FileReloader : public QObject {
+    Q_OBJECT
+
+public:
+    struct Edit {
+        int position; // в символах toRawText() снимка
+        int removed;
+        QString inserted;
+    };
+
+    struct Result {
+        QString filePath;
+        quint64 revision = 0; // из запроса: снимок устарел, если документ с тех пор правили
+        QVector<Edit> edits;
+        TextFormat format;
+        qint64 size = -1;     // файл на момент чтения
+        QDateTime modified;
+    };
+
+    explicit FileReloader(QObject *parent = nullptr);
+    ~FileReloader() override;
+
+    // rawText — QTextDocument::toRawText() документа.
+    void reload(const QString &filePath, const QString &rawText, quint64 revision);
+    bool isRunning() const { return worker != nullptr; }
+
+    static bool compute(const QString &filePath, const QString &rawText, Result *result, QString *error);
+
+signals:
+    void reloaded(const FileReloader::Result &result);
+    void failed(const QString &filePath, const QString &error);
+
+private:
+    struct Job {
+        QString filePath;
+        QString rawText;
+        quint64 revision = 0;
+    };
+
+    void start(const Job &job);
+
+    QThread *worker = nullptr;
+    QVector<Job> pending;
+};
+
+#endif // FILERELOADER_H
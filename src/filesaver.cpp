@@ -0,0 +1,246 @@
+#include "filesaver.h"
+#include <QSaveFile>
+#include <QStringEncoder>
+#include <QThread>
+#include <utility>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr qsizetype SliceChars = 1024 * 1024;
+
+// То же, что делает QTextDocument::toPlainText(), но для куска текста.
+void toPlainText(QString &text)
+{
+    QChar *c = text.data();
+    QChar *end = c + text.size();
+    for (; c != end; ++c)
+    {
+        switch (c->unicode())
+        {
+        case 0xfdd0: // начало фрейма
+        case 0xfdd1: // конец фрейма
+        case QChar::ParagraphSeparator:
+        case QChar::LineSeparator:
+            *c = QLatin1Char('\n');
+            break;
+        case QChar::Nbsp:
+            *c = QLatin1Char(' ');
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool syncToDisk(QFileDevice &file)
+{
+    if (!file.flush())
+        return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+} // namespace
+
+FileSaver::FileSaver(QObject *parent)
+    : QObject(parent)
+{
+}
+
+// Окно вызывает waitForFinished() до закрытия, так что здесь работы
+// обычно нет. Если есть, она фиксируется без сигналов: отображённый
+// большой файл на Windows тогда не заменится, но и не испортится.
+FileSaver::~FileSaver()
+{
+    if (worker)
+    {
+        worker->wait();
+        delete worker;
+    }
+    if (written)
+        written->commit();
+    if (hasPending)
+    {
+        QSaveFile file(pending.fileName);
+        qint64 bytes = 0;
+        QString error;
+        if (write(pending, &file, &bytes, &error))
+            file.commit();
+    }
+}
+
+void FileSaver::waitForFinished()
+{
+    while (worker)
+    {
+        worker->wait();
+        finishWorker();
+    }
+}
+
+void FileSaver::save(const QString &fileName, const QString &rawText, const TextFormat &format)
+{
+    Job job;
+    job.fileName = fileName;
+    job.rawText = rawText;
+    job.format = format;
+    job.timer.start();
+    enqueue(job);
+}
+
+void FileSaver::save(const QString &fileName, const PieceTable &pieces)
+{
+    Job job;
+    job.fileName = fileName;
+    job.pieces = pieces;
+    job.usePieces = true;
+    job.timer.start();
+    enqueue(job);
+}
+
+void FileSaver::enqueue(Job job)
+{
+    if (worker)
+    {
+        pending = job;
+        hasPending = true;
+        return;
+    }
+    start(job);
+}
+
+void FileSaver::start(const Job &job)
+{
+    const quint64 id = ++runId;
+    worker = QThread::create([this, job, id]
+                             {
+        qint64 bytes = 0;
+        QString error;
+        std::unique_ptr<QSaveFile> file = std::make_unique<QSaveFile>(job.fileName);
+        bool ok = write(job, file.get(), &bytes, &error);
+        if (ok && job.usePieces)
+        {
+            // Поток GUI прочитает written после wait() этого потока.
+            file->moveToThread(thread());
+            written = std::move(file);
+        }
+        else if (ok && !file->commit())
+        {
+            error = file->errorString();
+            ok = false;
+        }
+        result = {job.fileName, ok, bytes, error, job.timer.elapsed()};
+        QMetaObject::invokeMethod(this, [this, id]
+                                  {
+                                      // waitForFinished() мог уже забрать этот результат.
+                                      if (id == runId && worker)
+                                          finishWorker(); }, Qt::QueuedConnection); });
+    worker->start();
+}
+
+void FileSaver::finishWorker()
+{
+    // Копия таблицы в задании отпускается вместе с потоком.
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+    finish(std::exchange(result, Result()));
+}
+
+void FileSaver::finish(const Result &done)
+{
+    bool ok = done.ok;
+    QString reason = done.error;
+    bool superseded = false;
+    if (written)
+    {
+        std::unique_ptr<QSaveFile> file = std::move(written);
+        superseded = hasPending && pending.usePieces && pending.fileName == done.fileName;
+        if (superseded)
+        {
+            file->cancelWriting();
+        }
+        else
+        {
+            emit replacing(done.fileName);
+            if (!file->commit())
+            {
+                reason = file->errorString();
+                ok = false;
+            }
+        }
+    }
+    if (ok && !superseded)
+        emit saved(done.fileName, done.bytes, done.elapsedMs);
+    else if (!ok)
+        emit failed(done.fileName, reason);
+    if (hasPending)
+    {
+        hasPending = false;
+        start(pending);
+        pending = Job();
+    }
+}
+
+// Выполняется в рабочем потоке. Текст фиксируется здесь же, и его
+// сбрасывает на диск commit(). Таблицу фрагментов фиксирует поток GUI,
+// поэтому её данные сбрасываются заранее, в фоне: fsync в commit() тогда
+// почти ничего не стоит.
+bool FileSaver::write(const Job &job, QSaveFile *file, qint64 *bytes, QString *error)
+{
+    if (!file->open(QIODevice::WriteOnly))
+    {
+        *error = file->errorString();
+        return false;
+    }
+
+    if (job.usePieces)
+    {
+        if (!job.pieces.writeTo(file))
+        {
+            *error = file->errorString();
+            file->cancelWriting();
+            return false;
+        }
+        *bytes = job.pieces.size();
+    }
+    else
+    {
+        QStringEncoder encoder(job.format.encoding,
+                               job.format.bom ? QStringConverter::Flag::WriteBom : QStringConverter::Flag::Default);
+        const bool newlineOnly = job.format.lineEnding == QLatin1String("\n");
+        const qsizetype total = job.rawText.size();
+        for (qsizetype pos = 0; pos < total; pos += SliceChars)
+        {
+            QString slice = job.rawText.mid(pos, SliceChars);
+            toPlainText(slice);
+            if (!newlineOnly)
+                slice.replace(QLatin1Char('\n'), job.format.lineEnding);
+            const QByteArray encoded = encoder(slice);
+            if (file->write(encoded) != encoded.size())
+            {
+                *error = file->errorString();
+                file->cancelWriting();
+                return false;
+            }
+            *bytes += encoded.size();
+        }
+    }
+
+    if (job.usePieces && !syncToDisk(*file))
+    {
+        *error = file->errorString();
+        file->cancelWriting();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef FILESAVER_H
+#define FILESAVER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <memory>
+#include "fileloader.h"
+#include "piecetable.h"
+
+class QSaveFile;
+class QThread;
+
+// Сохранение в рабочем потоке. GUI передаёт дешёвый снимок документа
+// (сырой текст QTextDocument или копию PieceTable, которая делит буферы
+// с оригиналом), а кодирование, запись и fsync выполняются в фоне через
+// QSaveFile: временный файл + атомарное переименование, поэтому падение
+// во время записи не портит исходный файл. fsync делает сам
+// QSaveFile::commit() перед переименованием. Пока идёт сохранение,
+// следующий запрос ждёт в очереди (хранится только последний).
+//
+// Большой файл отображён в память, и Windows не переименует файл поверх
+// отображённого. Поэтому таблица фрагментов записывается и сбрасывается
+// на диск в фоне, а фиксация идёт в потоке GUI: replacing() даёт
+// отпустить отображение, затем файл переименовывается и приходит
+// saved() или failed(). Запись того же файла, которую догнал следующий
+// запрос, не фиксируется.
+//
+// Перед закрытием окна вызывается waitForFinished(): деструктор уже не
+// шлёт сигналы, и большой файл, отображённый получателем, на Windows
+// из него не заменить.
+class FileSaver : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FileSaver(QObject *parent = nullptr);
+    ~FileSaver() override;
+
+    // rawText — результат QTextDocument::toRawText(), разделители
+    // абзацев приводятся к переводу строки format уже в рабочем потоке.
+    void save(const QString &fileName, const QString &rawText, const TextFormat &format = TextFormat());
+    void save(const QString &fileName, const PieceTable &pieces);
+
+    // Дожидается записи и очереди в потоке GUI, с теми же сигналами.
+    void waitForFinished();
+
+    bool isRunning() const { return worker != nullptr; }
+    bool hasQueued() const { return hasPending; }
+
+signals:
+    void replacing(const QString &fileName);
+    void saved(const QString &fileName, qint64 bytes, qint64 elapsedMs);
+    void failed(const QString &fileName, const QString &error);
+
+private:
+    struct Job {
+        QString fileName;
+        QString rawText;
+        PieceTable pieces;
+        bool usePieces = false;
+        TextFormat format;
+        QElapsedTimer timer;
+    };
+
+    struct Result {
+        QString fileName;
+        bool ok = false;
+        qint64 bytes = 0;
+        QString error;
+        qint64 elapsedMs = 0;
+    };
+
+    void enqueue(Job job);
+    void start(const Job &job);
+    void finishWorker();
+    void finish(const Result &result);
+    static bool write(const Job &job, QSaveFile *file, qint64 *bytes, QString *error);
+
+    QThread *worker = nullptr;
+    quint64 runId = 0;
+    Result result; // пишется рабочим потоком, читается после wait()
+    Job pending;
+    bool hasPending = false;
+    std::unique_ptr<QSaveFile> written; // записан в фоне, ждёт фиксации в потоке GUI
+};
+
+#endif // FILESAVER_H
@@ -0,0 +1,270 @@
+#include "filesearcher.h"
+#include "literalmatcher.h"
+#include "projectwalker.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace {
+
+constexpr int MaxLineText = 300;
+constexpr qint64 BinaryProbeSize = 8192;
+
+struct WorkQueue {
+    QMutex mutex;
+    std::deque<int> files;
+};
+
+bool isBinary(const char *data, qsizetype size)
+{
+    return std::memchr(data, 0, size_t(qMin<qint64>(size, BinaryProbeSize))) != nullptr;
+}
+
+QString lineTextAt(const char *data, qsizetype lineStart, qsizetype lineEnd)
+{
+    QString text = QString::fromUtf8(data + lineStart, qMin<qsizetype>(lineEnd - lineStart, MaxLineText * 4));
+    if (text.size() > MaxLineText)
+        text.truncate(MaxLineText);
+    return text;
+}
+
+// Совпадения в байтах файла, не больше одного на строку.
+void searchLiteral(const LiteralMatcher &matcher, const char *data, qsizetype size, const QString &filePath,
+                   const std::atomic<bool> &cancelled, QVector<SearchMatch> &matches)
+{
+    int line = 1;
+    qsizetype counted = 0;
+    qsizetype lineStart = 0;
+    qsizetype pos = 0;
+    while (!cancelled && (pos = matcher.find(data, size, pos)) >= 0)
+    {
+        while (counted < pos)
+        {
+            const void *newline = std::memchr(data + counted, '\n', size_t(pos - counted));
+            if (!newline)
+                break;
+            counted = static_cast<const char *>(newline) - data + 1;
+            lineStart = counted;
+            ++line;
+        }
+        counted = pos;
+
+        const void *newline = std::memchr(data + pos, '\n', size_t(size - pos));
+        const qsizetype lineEnd = newline ? static_cast<const char *>(newline) - data : size;
+        matches.append({filePath, line, int(QString::fromUtf8(data + lineStart, pos - lineStart).size()),
+                        lineTextAt(data, lineStart, lineEnd)});
+        pos = lineEnd;
+    }
+}
+
+void searchRegex(const QRegularExpression &expression, const QString &text, const QString &filePath,
+                 const std::atomic<bool> &cancelled, QVector<SearchMatch> &matches)
+{
+    int line = 1;
+    qsizetype counted = 0;
+    qsizetype lineStart = 0;
+    qsizetype offset = 0;
+    while (!cancelled && offset <= text.size())
+    {
+        const QRegularExpressionMatch match = expression.match(text, offset);
+        if (!match.hasMatch())
+            break;
+        const qsizetype start = match.capturedStart();
+        for (; counted < start; ++counted)
+        {
+            if (text[counted] == QLatin1Char('\n'))
+            {
+                ++line;
+                lineStart = counted + 1;
+            }
+        }
+        qsizetype lineEnd = text.indexOf(QLatin1Char('\n'), start);
+        if (lineEnd < 0)
+            lineEnd = text.size();
+        matches.append({filePath, line, int(start - lineStart), text.mid(lineStart, qMin<qsizetype>(lineEnd - lineStart, MaxLineText))});
+        offset = lineEnd + 1;
+    }
+}
+
+} // namespace
+
+FileSearcher::FileSearcher(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FileSearcher::~FileSearcher()
+{
+    cancel();
+}
+
+void FileSearcher::start(const QString &root, const QString &pattern, bool regex, bool caseSensitive)
+{
+    cancel();
+
+    const quint64 id = ++generation;
+    std::shared_ptr<SearchState> state = std::make_shared<SearchState>();
+    current = state;
+    worker = QThread::create([this, state, root, pattern, regex, caseSensitive, id]
+                             { run(state, root, pattern, regex, caseSensitive, id); });
+    worker->start();
+}
+
+void FileSearcher::cancel()
+{
+    if (!worker)
+        return;
+    current->cancelled = true;
+    finishWorker();
+    ++generation;
+}
+
+void FileSearcher::finishWorker()
+{
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+    current.reset();
+}
+
+// Выполняется в рабочем потоке.
+void FileSearcher::run(const std::shared_ptr<SearchState> &state, const QString &root, const QString &pattern,
+                       bool regex, bool caseSensitive, quint64 id)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto flush = [this, state, id]
+    {
+        QVector<SearchMatch> batch;
+        {
+            QMutexLocker locker(&state->mutex);
+            batch.swap(state->pending);
+        }
+        if (batch.isEmpty())
+            return;
+        QMetaObject::invokeMethod(this, [this, id, batch]
+                                  {
+                                      if (id == generation)
+                                          emit matchesFound(batch); }, Qt::QueuedConnection);
+    };
+
+    QStringList files;
+    ProjectWalker(root).walk(state->cancelled, [&files](const QString &relativePath, const QFileInfo &info)
+                        {
+                            if (info.size() > 0 && info.size() <= MaxFileSize)
+                                files.append(relativePath); });
+    if (state->cancelled)
+        return;
+
+    // Каждому потоку — свой непрерывный участок списка; владелец берёт
+    // файлы с конца своей очереди, остальные крадут с начала.
+    const int threadCount = qMax(1, QThread::idealThreadCount());
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        queues.push_back(std::make_unique<WorkQueue>());
+        const qsizetype begin = files.size() * t / threadCount;
+        const qsizetype end = files.size() * (t + 1) / threadCount;
+        for (qsizetype i = begin; i < end; ++i)
+            queues[t]->files.push_back(int(i));
+    }
+
+    auto nextFile = [&queues, threadCount](int self, int *file) -> bool
+    {
+        {
+            WorkQueue &own = *queues[self];
+            QMutexLocker locker(&own.mutex);
+            if (!own.files.empty())
+            {
+                *file = own.files.back();
+                own.files.pop_back();
+                return true;
+            }
+        }
+        for (int k = 1; k < threadCount; ++k)
+        {
+            WorkQueue &victim = *queues[(self + k) % threadCount];
+            QMutexLocker locker(&victim.mutex);
+            if (!victim.files.empty())
+            {
+                *file = victim.files.front();
+                victim.files.pop_front();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const LiteralMatcher literal(pattern.toUtf8(), caseSensitive);
+    const QRegularExpression expression(pattern, caseSensitive ? QRegularExpression::MultilineOption
+                                                               : QRegularExpression::MultilineOption | QRegularExpression::CaseInsensitiveOption);
+    const QDir rootDir(root);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (int t = 0; t < threadCount; ++t)
+    {
+        pool.start([&, t]
+                   {
+                       const QRegularExpression localExpression = expression;
+                       QVector<SearchMatch> matches;
+                       int file = 0;
+                       while (!state->cancelled && state->matchCount < MaxMatches && nextFile(t, &file))
+                       {
+                           const QString filePath = rootDir.filePath(files[file]);
+                           QFile input(filePath);
+                           if (!input.open(QIODevice::ReadOnly))
+                               continue;
+                           qint64 size = input.size();
+                           QByteArray buffer;
+                           const char *data = reinterpret_cast<const char *>(input.map(0, size));
+                           if (!data)
+                           {
+                               buffer = input.readAll();
+                               data = buffer.constData();
+                               size = buffer.size();
+                           }
+                           if (size <= 0 || isBinary(data, size))
+                               continue;
+
+                           if (regex)
+                               searchRegex(localExpression, QString::fromUtf8(data, size), filePath, state->cancelled, matches);
+                           else
+                               searchLiteral(literal, data, size, filePath, state->cancelled, matches);
+
+                           ++state->filesSearched;
+                           state->bytesSearched += size;
+                           if (!matches.isEmpty())
+                           {
+                               state->matchCount += matches.size();
+                               QMutexLocker locker(&state->mutex);
+                               state->pending.append(matches);
+                               matches.clear();
+                           }
+                       } });
+    }
+    while (!pool.waitForDone(50))
+        flush();
+    if (state->cancelled)
+        return;
+    flush();
+
+    const int filesSearched = state->filesSearched;
+    const int matchCount = qMin<int>(state->matchCount, MaxMatches);
+    const qint64 bytes = state->bytesSearched;
+    const qint64 elapsedMs = timer.elapsed();
+    QMetaObject::invokeMethod(this, [this, id, filesSearched, matchCount, bytes, elapsedMs]
+                              {
+                                  if (id != generation)
+                                      return;
+                                  finishWorker();
+                                  emit finished(filesSearched, matchCount, bytes, elapsedMs); }, Qt::QueuedConnection);
+}
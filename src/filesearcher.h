@@ -0,0 +1,65 @@
+#ifndef FILESEARCHER_H
+#define FILESEARCHER_H
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+class QThread;
+
+struct SearchMatch {
+    QString filePath; // абсолютный
+    int line;         // с единицы
+    int column;       // в символах строки
+    QString lineText;
+};
+
+// Поиск по всем файлам папки проекта. Список файлов делится между
+// потоками пула, опустевший поток забирает работу из чужих очередей.
+// Строка ищется прямо в байтах файла, отображённого в память (кандидаты
+// отбираются SSE2 по первому и последнему байту), регулярное выражение —
+// по декодированному тексту. Двоичные файлы пропускаются. Совпадения
+// копятся в общем буфере и уходят в поток GUI пачками раз в 50 мс.
+class FileSearcher : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int MaxMatches = 100000;
+    static constexpr qint64 MaxFileSize = 256 * 1024 * 1024;
+
+    explicit FileSearcher(QObject *parent = nullptr);
+    ~FileSearcher() override;
+
+    void start(const QString &root, const QString &pattern, bool regex, bool caseSensitive);
+    bool isRunning() const { return worker != nullptr; }
+
+public slots:
+    void cancel();
+
+signals:
+    void matchesFound(const QVector<SearchMatch> &matches);
+    void finished(int files, int matches, qint64 bytes, qint64 elapsedMs);
+
+private:
+    struct SearchState {
+        std::atomic<bool> cancelled{false};
+        std::atomic<int> matchCount{0};
+        std::atomic<int> filesSearched{0};
+        std::atomic<qint64> bytesSearched{0};
+        QMutex mutex;
+        QVector<SearchMatch> pending;
+    };
+
+    void run(const std::shared_ptr<SearchState> &state, const QString &root, const QString &pattern,
+             bool regex, bool caseSensitive, quint64 id);
+    void finishWorker();
+
+    QThread *worker = nullptr;
+    std::shared_ptr<SearchState> current;
+    quint64 generation = 0;
+};
+
+#endif // FILESEARCHER_H
@@ -0,0 +1,236 @@
+#include "filetreemodel.h"
+#include "projectfiles.h"
+#include <QFileIconProvider>
+#include <QSet>
+#include <QStringList>
+#include <algorithm>
+#include <utility>
+
+FileTreeModel::FileTreeModel(ProjectFiles *files, QObject *parent)
+    : QAbstractItemModel(parent), files(files), rootPath(files->root())
+{
+    nodes.append({QString(), -1, 0, true, false, {}});
+    connect(files, &ProjectFiles::rootChanged, this, &FileTreeModel::resetRoot);
+    connect(files, &ProjectFiles::directoryChanged, this, &FileTreeModel::refreshDirectory);
+}
+
+int FileTreeModel::nodeOf(const QModelIndex &index) const
+{
+    return index.isValid() ? int(index.internalId()) : 0;
+}
+
+QModelIndex FileTreeModel::indexOf(int node) const
+{
+    if (node <= 0)
+        return QModelIndex();
+    return createIndex(nodes[node].row, 0, quintptr(node));
+}
+
+QString FileTreeModel::relativePath(int node) const
+{
+    QStringList parts;
+    for (; node > 0; node = nodes[node].parent)
+        parts.prepend(nodes[node].name);
+    return parts.join(QLatin1Char('/'));
+}
+
+QString FileTreeModel::filePath(const QModelIndex &index) const
+{
+    const QString relative = relativePath(nodeOf(index));
+    return relative.isEmpty() ? rootPath : rootPath + '/' + relative;
+}
+
+bool FileTreeModel::isDir(const QModelIndex &index) const
+{
+    return nodes[nodeOf(index)].isDir;
+}
+
+QModelIndex FileTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    const Node &node = nodes[nodeOf(parent)];
+    if (row < 0 || row >= node.children.size() || column != 0)
+        return QModelIndex();
+    return createIndex(row, column, quintptr(node.children[row]));
+}
+
+QModelIndex FileTreeModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid())
+        return QModelIndex();
+    return indexOf(nodes[nodeOf(child)].parent);
+}
+
+int FileTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+    return nodes[nodeOf(parent)].children.size();
+}
+
+int FileTreeModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+bool FileTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    const int node = nodeOf(parent);
+    if (node == 0)
+        return !rootPath.isEmpty();
+    return nodes[node].isDir && (!nodes[node].fetched || !nodes[node].children.isEmpty());
+}
+
+bool FileTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    const int node = nodeOf(parent);
+    return !rootPath.isEmpty() && nodes[node].isDir && !nodes[node].fetched;
+}
+
+void FileTreeModel::fetchMore(const QModelIndex &parent)
+{
+    const int node = nodeOf(parent);
+    const QVector<Listing> listing = listDirectory(node);
+    nodes[node].fetched = true;
+    if (listing.isEmpty())
+        return;
+
+    beginInsertRows(parent, 0, listing.size() - 1);
+    for (const Listing &entry : listing)
+    {
+        const int child = createNode(entry, node);
+        nodes[node].children.append(child);
+    }
+    endInsertRows();
+}
+
+QVariant FileTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+    const Node &node = nodes[nodeOf(index)];
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return node.name;
+    case Qt::DecorationRole:
+    {
+        static const QFileIconProvider icons;
+        return icons.icon(node.isDir ? QAbstractFileIconProvider::Folder : QAbstractFileIconProvider::File);
+    }
+    case Qt::ToolTipRole:
+        return relativePath(nodeOf(index));
+    default:
+        return QVariant();
+    }
+}
+
+int FileTreeModel::createNode(const Listing &listing, int parent)
+{
+    const Node node{listing.name, parent, int(nodes[parent].children.size()), listing.isDir, false, {}};
+    if (!freeNodes.isEmpty())
+    {
+        const int id = freeNodes.takeLast();
+        nodes[id] = node;
+        return id;
+    }
+    nodes.append(node);
+    return nodes.size() - 1;
+}
+
+// Вызывается после endRemoveRows(): индексы на узел и его потомков
+// модель уже сбросила.
+void FileTreeModel::releaseNode(int node)
+{
+    const QVector<int> children = std::exchange(nodes[node].children, QVector<int>());
+    for (int child : children)
+        releaseNode(child);
+    nodes[node] = {QString(), -1, 0, false, false, {}};
+    freeNodes.append(node);
+}
+
+QVector<FileTreeModel::Listing> FileTreeModel::listDirectory(int node) const
+{
+    QVector<Listing> listing;
+    for (const QFileInfo &entry : files->list(relativePath(node)))
+        listing.append({entry.fileName(), entry.isDir()});
+    // Каталоги сверху, дальше по имени без учёта регистра.
+    std::sort(listing.begin(), listing.end(), [](const Listing &a, const Listing &b)
+              {
+                  if (a.isDir != b.isDir)
+                      return a.isDir;
+                  return QString::compare(a.name, b.name, Qt::CaseInsensitive) < 0; });
+    return listing;
+}
+
+int FileTreeModel::findNode(const QString &relativePath) const
+{
+    int node = 0;
+    for (const QString &part : relativePath.split(QLatin1Char('/'), Qt::SkipEmptyParts))
+    {
+        if (!nodes[node].fetched)
+            return -1;
+        const QVector<int> &children = nodes[node].children;
+        const auto it = std::find_if(children.cbegin(), children.cend(), [this, &part](int child)
+                                     { return nodes[child].name == part; });
+        if (it == children.cend())
+            return -1;
+        node = *it;
+    }
+    return node;
+}
+
+void FileTreeModel::resetRoot(const QString &root)
+{
+    beginResetModel();
+    rootPath = root;
+    nodes.clear();
+    freeNodes.clear();
+    nodes.append({QString(), -1, 0, true, false, {}});
+    endResetModel();
+}
+
+void FileTreeModel::refreshDirectory(const QString &relativeDir)
+{
+    const int node = findNode(relativeDir);
+    if (node < 0 || !nodes[node].fetched)
+        return;
+
+    const QVector<Listing> listing = listDirectory(node);
+    const QModelIndex parentIndex = indexOf(node);
+    auto renumber = [this, node](int from)
+    {
+        const QVector<int> &children = nodes[node].children;
+        for (int row = from; row < children.size(); ++row)
+            nodes[children[row]].row = row;
+    };
+
+    QSet<QString> listed;
+    for (const Listing &entry : listing)
+        listed.insert((entry.isDir ? QLatin1Char('d') : QLatin1Char('f')) + entry.name);
+
+    // Сначала удаляются исчезнувшие записи, затем вставляются новые:
+    // оба списка упорядочены одинаково, поэтому хватает одного прохода.
+    for (int row = nodes[node].children.size() - 1; row >= 0; --row)
+    {
+        const Node &child = nodes[nodes[node].children[row]];
+        if (listed.contains((child.isDir ? QLatin1Char('d') : QLatin1Char('f')) + child.name))
+            continue;
+        beginRemoveRows(parentIndex, row, row);
+        const int removed = nodes[node].children.takeAt(row);
+        renumber(row);
+        endRemoveRows();
+        releaseNode(removed);
+    }
+
+    for (int row = 0; row < listing.size(); ++row)
+    {
+        const QVector<int> &children = nodes[node].children;
+        if (row < children.size() && nodes[children[row]].name == listing[row].name)
+            continue;
+        beginInsertRows(parentIndex, row, row);
+        const int child = createNode(listing[row], node);
+        nodes[node].children.insert(row, child);
+        renumber(row);
+        endInsertRows();
+    }
+}
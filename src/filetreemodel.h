@@ -0,0 +1,67 @@
+#ifndef FILETREEMODEL_H
+#define FILETREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QString>
+#include <QVector>
+
+class ProjectFiles;
+
+// Ленивая модель дерева папки проекта: содержимое каталога читается,
+// только когда его раскрывают, исключённые пути (.gitignore, настройки)
+// не показываются. Узлы хранятся в плоском массиве, индекс модели
+// ссылается на номер узла. Изменения приходят от ProjectFiles
+// и применяются только к уже прочитанным каталогам. Узлы исчезнувших
+// записей освобождаются вместе с поддеревом и занимаются новыми.
+class FileTreeModel : public QAbstractItemModel {
+    Q_OBJECT
+
+public:
+    explicit FileTreeModel(ProjectFiles *files, QObject *parent = nullptr);
+
+    QString filePath(const QModelIndex &index) const;
+    bool isDir(const QModelIndex &index) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private slots:
+    void resetRoot(const QString &root);
+    void refreshDirectory(const QString &relativeDir);
+
+private:
+    struct Node {
+        QString name;
+        int parent; // -1 у корня и у удалённых узлов
+        int row;
+        bool isDir;
+        bool fetched;
+        QVector<int> children;
+    };
+
+    struct Listing {
+        QString name;
+        bool isDir;
+    };
+
+    int nodeOf(const QModelIndex &index) const;
+    QModelIndex indexOf(int node) const;
+    QString relativePath(int node) const;
+    int findNode(const QString &relativePath) const;
+    QVector<Listing> listDirectory(int node) const;
+    int createNode(const Listing &listing, int parent);
+    void releaseNode(int node);
+
+    ProjectFiles *files;
+    QString rootPath;
+    QVector<Node> nodes; // nodes[0] — корень
+    QVector<int> freeNodes;
+};
+
+#endif // FILETREEMODEL_H
@@ -0,0 +1,197 @@
+#include "filewatcher.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTimer>
+#include <utility>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(QObject *parent)
+    : QObject(parent)
+{
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(100);
+    connect(flushTimer, &QTimer::timeout, this, &FileWatcher::flushChanges);
+
+#ifdef Q_OS_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0)
+    {
+        notifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &FileWatcher::readEvents);
+    }
+#else
+    watcher = new QFileSystemWatcher(this);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &FileWatcher::markChanged);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &file)
+            { markChanged(QFileInfo(file).absolutePath()); });
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef Q_OS_LINUX
+    if (inotifyFd >= 0)
+        ::close(inotifyFd);
+#endif
+}
+
+bool FileWatcher::addDirectory(const QString &path)
+{
+#ifdef Q_OS_LINUX
+    if (inotifyFd < 0)
+        return false;
+    if (watchesByPath.contains(path))
+        return true;
+    uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    if (watchContents)
+        mask |= IN_CLOSE_WRITE; // файл дописан и закрыт, а не каждая запись
+    const int watch = inotify_add_watch(inotifyFd, QFile::encodeName(path).constData(), mask);
+    if (watch < 0)
+        return false;
+    pathsByWatch.insert(watch, path);
+    watchesByPath.insert(path, watch);
+    return true;
+#else
+    if (!watcher->addPath(path))
+        return false;
+    if (watchContents)
+    {
+        contentDirs.insert(path);
+        watchFiles(path);
+    }
+    return true;
+#endif
+}
+
+#ifndef Q_OS_LINUX
+// Новые файлы каталога ставятся на наблюдение, исчезнувшие QFileSystemWatcher
+// снимает сам.
+void FileWatcher::watchFiles(const QString &path)
+{
+    const QStringList watched = watcher->files();
+    const QSet<QString> known(watched.cbegin(), watched.cend());
+    QStringList added;
+    for (const QString &name : QDir(path).entryList(QDir::Files | QDir::Hidden))
+    {
+        const QString file = path + '/' + name;
+        if (!known.contains(file))
+            added.append(file);
+    }
+    if (!added.isEmpty())
+        watcher->addPaths(added);
+}
+#endif
+
+void FileWatcher::removeDirectory(const QString &path)
+{
+#ifdef Q_OS_LINUX
+    const int watch = watchesByPath.take(path);
+    if (watch > 0)
+    {
+        inotify_rm_watch(inotifyFd, watch);
+        pathsByWatch.remove(watch);
+    }
+#else
+    watcher->removePath(path);
+    if (contentDirs.remove(path))
+    {
+        QStringList files;
+        for (const QString &file : watcher->files())
+        {
+            if (QFileInfo(file).absolutePath() == path)
+                files.append(file);
+        }
+        if (!files.isEmpty())
+            watcher->removePaths(files);
+    }
+#endif
+}
+
+void FileWatcher::clear()
+{
+#ifdef Q_OS_LINUX
+    for (auto it = pathsByWatch.constBegin(); it != pathsByWatch.constEnd(); ++it)
+        inotify_rm_watch(inotifyFd, it.key());
+    pathsByWatch.clear();
+    watchesByPath.clear();
+#else
+    const QStringList paths = watcher->directories() + watcher->files();
+    if (!paths.isEmpty())
+        watcher->removePaths(paths);
+    contentDirs.clear();
+#endif
+    changedDirs.clear();
+    flushTimer->stop();
+}
+
+int FileWatcher::count() const
+{
+#ifdef Q_OS_LINUX
+    return pathsByWatch.size();
+#else
+    return watcher->directories().size();
+#endif
+}
+
+void FileWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(inotify_event) char buffer[16 * 1024];
+    for (;;)
+    {
+        const ssize_t length = ::read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            const QString path = pathsByWatch.value(event->wd);
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // Очередь переполнена: считаем изменившимися все каталоги.
+                for (const QString &watched : std::as_const(pathsByWatch))
+                    markChanged(watched);
+                continue;
+            }
+            if (path.isEmpty())
+                continue;
+            if (event->mask & IN_IGNORED)
+            {
+                pathsByWatch.remove(event->wd);
+                watchesByPath.remove(path);
+                continue;
+            }
+            markChanged(path);
+        }
+    }
+#endif
+}
+
+void FileWatcher::markChanged(const QString &path)
+{
+#ifndef Q_OS_LINUX
+    if (contentDirs.contains(path) && !changedDirs.contains(path))
+        watchFiles(path);
+#endif
+    changedDirs.insert(path);
+    if (!flushTimer->isActive())
+        flushTimer->start();
+}
+
+void FileWatcher::flushChanges()
+{
+    const QSet<QString> dirs = std::exchange(changedDirs, QSet<QString>());
+    for (const QString &dir : dirs)
+        emit directoryChanged(dir);
+}
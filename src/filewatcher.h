@@ -0,0 +1,66 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+class QSocketNotifier;
+class QFileSystemWatcher;
+class QTimer;
+
+// Один наблюдатель за каталогами проекта. В Linux — единственный
+// дескриптор inotify на все каталоги, в остальных системах —
+// QFileSystemWatcher. События за 100 мс сливаются: каждый изменившийся
+// каталог сообщается один раз.
+class FileWatcher : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FileWatcher(QObject *parent = nullptr);
+    ~FileWatcher() override;
+
+    // Сообщать и о записи в файлы каталога, а не только о созданных,
+    // удалённых и переименованных. Действует на каталоги, добавленные
+    // после вызова. В Linux это флаг IN_CLOSE_WRITE того же дескриптора.
+    // QFileSystemWatcher о записи в файлы каталога не сообщает, поэтому в
+    // остальных системах на наблюдение ставится ещё и каждый файл каталога
+    // (список обновляется при изменении каталога) — это годится для
+    // каталогов открытых документов, но не для всего дерева проекта.
+    void setWatchContents(bool enabled) { watchContents = enabled; }
+
+    // false, если каталог не удалось поставить на наблюдение (например, исчерпан лимит inotify).
+    bool addDirectory(const QString &path);
+    void removeDirectory(const QString &path);
+    void clear();
+    int count() const;
+
+signals:
+    void directoryChanged(const QString &path);
+
+private slots:
+    void readEvents();
+    void flushChanges();
+
+private:
+    void markChanged(const QString &path);
+#ifndef Q_OS_LINUX
+    void watchFiles(const QString &path);
+#endif
+
+#ifdef Q_OS_LINUX
+    int inotifyFd = -1;
+    QSocketNotifier *notifier = nullptr;
+    QHash<int, QString> pathsByWatch;
+    QHash<QString, int> watchesByPath;
+#else
+    QFileSystemWatcher *watcher = nullptr;
+    QSet<QString> contentDirs; // каталоги, за файлами которых тоже следим
+#endif
+    QSet<QString> changedDirs;
+    QTimer *flushTimer;
+    bool watchContents = false;
+};
+
+#endif // FILEWATCHER_H
@@ -0,0 +1,527 @@
+#include "findbar.h"
+#include "largefileview.h"
+#include "undohistory.h"
+#include <QApplication>
+#include <QCheckBox>
+#include <QElapsedTimer>
+#include <QHBoxLayout>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextEdit>
+#include <QTimer>
+#include <QVBoxLayout>
+
+namespace {
+
+constexpr int MaxHighlights = 2000;
+constexpr int ResearchDelayMs = 300;
+
+} // namespace
+
+FindBar::FindBar(QWidget *parent)
+    : QWidget(parent)
+{
+    searcher = new DocumentSearcher(this);
+    connect(searcher, &DocumentSearcher::matchesFound, this, &FindBar::onMatchesFound);
+    connect(searcher, &DocumentSearcher::finished, this, &FindBar::onMatchesFound);
+    connect(searcher, &DocumentSearcher::replaced, this, &FindBar::onReplaced);
+
+    findEdit = new QLineEdit(this);
+    findEdit->setPlaceholderText("Найти");
+    countLabel = new QLabel(this);
+    countLabel->setMinimumWidth(fontMetrics().horizontalAdvance("000000 из 000000"));
+    QPushButton *previousButton = new QPushButton("Назад", this);
+    QPushButton *nextButton = new QPushButton("Далее", this);
+    caseCheck = new QCheckBox("Учитывать регистр", this);
+    regexCheck = new QCheckBox("Регулярное выражение", this);
+    QPushButton *closeButton = new QPushButton("Закрыть", this);
+
+    replaceRow = new QWidget(this);
+    replaceEdit = new QLineEdit(replaceRow);
+    replaceEdit->setPlaceholderText("Заменить на (\\1 — группа выражения)");
+    QPushButton *replaceButton = new QPushButton("Заменить", replaceRow);
+    QPushButton *replaceAllButton = new QPushButton("Заменить все", replaceRow);
+
+    QHBoxLayout *findLayout = new QHBoxLayout;
+    findLayout->addWidget(findEdit);
+    findLayout->addWidget(countLabel);
+    findLayout->addWidget(previousButton);
+    findLayout->addWidget(nextButton);
+    findLayout->addWidget(caseCheck);
+    findLayout->addWidget(regexCheck);
+    findLayout->addWidget(closeButton);
+
+    QHBoxLayout *replaceLayout = new QHBoxLayout(replaceRow);
+    replaceLayout->setContentsMargins(0, 0, 0, 0);
+    replaceLayout->addWidget(replaceEdit);
+    replaceLayout->addWidget(replaceButton);
+    replaceLayout->addWidget(replaceAllButton);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(4, 2, 4, 2);
+    layout->setSpacing(2);
+    layout->addLayout(findLayout);
+    layout->addWidget(replaceRow);
+
+    searchTimer = new QTimer(this);
+    searchTimer->setSingleShot(true);
+    searchTimer->setInterval(ResearchDelayMs);
+    connect(searchTimer, &QTimer::timeout, this, &FindBar::startSearch);
+    highlightTimer = new QTimer(this);
+    highlightTimer->setSingleShot(true);
+    highlightTimer->setInterval(20);
+    connect(highlightTimer, &QTimer::timeout, this, &FindBar::updateHighlights);
+
+    connect(findEdit, &QLineEdit::textChanged, this, &FindBar::onQueryChanged);
+    connect(caseCheck, &QCheckBox::toggled, this, &FindBar::onQueryChanged);
+    connect(regexCheck, &QCheckBox::toggled, this, &FindBar::onQueryChanged);
+    connect(findEdit, &QLineEdit::returnPressed, this, [this]
+            {
+                if (QApplication::keyboardModifiers() & Qt::ShiftModifier)
+                    findPrevious();
+                else
+                    findNext(); });
+    connect(replaceEdit, &QLineEdit::returnPressed, this, &FindBar::replaceCurrent);
+    connect(previousButton, &QPushButton::clicked, this, &FindBar::findPrevious);
+    connect(nextButton, &QPushButton::clicked, this, &FindBar::findNext);
+    connect(replaceButton, &QPushButton::clicked, this, &FindBar::replaceCurrent);
+    connect(replaceAllButton, &QPushButton::clicked, this, &FindBar::replaceAll);
+    connect(closeButton, &QPushButton::clicked, this, &FindBar::dismiss);
+}
+
+void FindBar::setTarget(QTextEdit *textEditor, UndoHistory *undoHistory)
+{
+    clearTarget();
+    if (!textEditor || !undoHistory)
+        return;
+    editor = textEditor;
+    history = undoHistory;
+    const auto scheduleHighlights = [this]
+    { highlightTimer->start(); };
+    targetConnections = {
+        connect(undoHistory, &UndoHistory::textChanged, this, &FindBar::onDocumentChanged),
+        connect(undoHistory, &UndoHistory::diverged, this, &FindBar::onDocumentChanged),
+        connect(textEditor->verticalScrollBar(), &QScrollBar::valueChanged, this, scheduleHighlights),
+        connect(textEditor->verticalScrollBar(), &QScrollBar::rangeChanged, this, scheduleHighlights),
+        connect(textEditor->horizontalScrollBar(), &QScrollBar::valueChanged, this, scheduleHighlights),
+    };
+    if (isVisible())
+        startSearch();
+}
+
+void FindBar::setTarget(LargeFileView *view)
+{
+    clearTarget();
+    if (!view)
+        return;
+    largeView = view;
+    targetConnections = {
+        connect(view, &LargeFileView::textChanged, this, &FindBar::onDocumentChanged),
+        // Поиск держит копию таблицы, а с ней и отображённый файл.
+        connect(view, &LargeFileView::releasingFile, this, [this]
+                {
+                    if (replacing)
+                        emit message("Замена прервана сохранением файла.");
+                    replacing = false;
+                    searcher->cancel();
+                    onDocumentChanged(); }),
+    };
+    if (isVisible())
+        startSearch();
+}
+
+void FindBar::clearTarget()
+{
+    for (const QMetaObject::Connection &connection : std::as_const(targetConnections))
+        disconnect(connection);
+    targetConnections.clear();
+    searcher->cancel();
+    searchTimer->stop();
+    highlightTimer->stop();
+    if (editor)
+        editor->setExtraSelections({});
+    if (largeView)
+        largeView->setSearchMatches({}, -1);
+    editor = nullptr;
+    history = nullptr;
+    largeView = nullptr;
+    current = -1;
+    jumpToMatch = false;
+    replacing = false;
+    updateCount();
+}
+
+void FindBar::open(bool replace)
+{
+    replaceRow->setVisible(replace);
+    const bool wasVisible = isVisible();
+    const QString before = findEdit->text();
+    show();
+    // Выделение в одной строке становится запросом.
+    if (editor && largeView.isNull() && editor->textCursor().hasSelection())
+    {
+        const QString selected = editor->textCursor().selectedText();
+        if (!selected.contains(QChar::ParagraphSeparator))
+            findEdit->setText(selected);
+    }
+    if (!wasVisible && findEdit->text() == before)
+    {
+        searchOrigin = cursorPosition();
+        jumpToMatch = false;
+        startSearch();
+    }
+    findEdit->setFocus();
+    findEdit->selectAll();
+}
+
+void FindBar::dismiss()
+{
+    hide();
+    searcher->cancel();
+    searchTimer->stop();
+    current = -1;
+    replacing = false;
+    updateHighlights();
+    if (largeView)
+        largeView->setFocus();
+    else if (editor)
+        editor->setFocus();
+}
+
+void FindBar::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() == Qt::Key_Escape)
+    {
+        dismiss();
+        return;
+    }
+    QWidget::keyPressEvent(event);
+}
+
+DocumentSearcher::Query FindBar::query() const
+{
+    DocumentSearcher::Query result;
+    result.pattern = findEdit->text();
+    result.regex = regexCheck->isChecked();
+    result.caseSensitive = caseCheck->isChecked();
+    return result;
+}
+
+bool FindBar::hasTarget() const
+{
+    return largeView || (editor && history);
+}
+
+quint64 FindBar::revision() const
+{
+    if (largeView)
+        return largeView->revision();
+    return history ? history->revision() : 0;
+}
+
+// Начало выделения: при наборе запроса найденное совпадение остаётся
+// выбранным, пока оно продолжает подходить.
+qint64 FindBar::cursorPosition() const
+{
+    if (largeView)
+        return largeView->caretOffset();
+    return editor ? editor->textCursor().selectionStart() : 0;
+}
+
+bool FindBar::isSelected(int index) const
+{
+    const QVector<DocumentSearcher::Match> &matches = searcher->matches();
+    if (index < 0 || index >= matches.size() || revision() != searchedRevision)
+        return false;
+    const DocumentSearcher::Match &match = matches[index];
+    if (largeView)
+        return largeView->caretOffset() == match.position;
+    const QTextCursor cursor = editor->textCursor();
+    return cursor.selectionStart() == match.position && cursor.selectionEnd() == match.position + match.length;
+}
+
+void FindBar::onQueryChanged()
+{
+    if (!isVisible())
+        return;
+    searchOrigin = cursorPosition();
+    jumpToMatch = true;
+    startSearch();
+}
+
+void FindBar::onDocumentChanged()
+{
+    if (!isVisible())
+        return;
+    // Позиции найденного уже сдвинулись: подсветка снимается до нового поиска.
+    current = -1;
+    if (editor && largeView.isNull())
+        editor->setExtraSelections({});
+    searchTimer->start();
+}
+
+void FindBar::startSearch()
+{
+    searchTimer->stop();
+    current = -1;
+    replacing = false;
+    const DocumentSearcher::Query request = query();
+    QString error;
+    countLabel->setToolTip(QString());
+    if (!hasTarget() || request.pattern.isEmpty() || !DocumentSearcher::isValid(request, &error))
+    {
+        searcher->cancel();
+        jumpToMatch = false;
+        updateCount();
+        updateHighlights();
+        if (!error.isEmpty())
+        {
+            countLabel->setText("Ошибка в выражении");
+            countLabel->setToolTip(error);
+        }
+        return;
+    }
+
+    searchedRevision = revision();
+    if (largeView)
+        searcher->search(largeView->snapshot(), request);
+    else
+        searcher->search(editor->document()->toRawText(), request);
+    updateCount();
+    updateHighlights();
+}
+
+void FindBar::onMatchesFound()
+{
+    if (jumpToMatch)
+    {
+        const int index = searcher->indexAfter(searchOrigin);
+        if (index < searcher->matches().size())
+        {
+            jumpToMatch = false;
+            select(index);
+        }
+        else if (searcher->isComplete())
+        {
+            // После начальной точки совпадений нет — с начала документа.
+            jumpToMatch = false;
+            if (!searcher->matches().isEmpty())
+                select(0);
+        }
+    }
+    updateCount();
+    highlightTimer->start();
+}
+
+void FindBar::select(int index)
+{
+    const DocumentSearcher::Match &match = searcher->matches()[index];
+    current = index;
+    if (largeView)
+    {
+        largeView->setCaretOffset(match.position);
+    }
+    else
+    {
+        QTextCursor cursor(editor->document());
+        cursor.setPosition(int(match.position));
+        cursor.setPosition(int(match.position + match.length), QTextCursor::KeepAnchor);
+        editor->setTextCursor(cursor);
+    }
+    updateCount();
+    updateHighlights();
+}
+
+void FindBar::findNext()
+{
+    const QVector<DocumentSearcher::Match> &matches = searcher->matches();
+    if (!hasTarget() || revision() != searchedRevision || (matches.isEmpty() && searcher->isComplete()))
+        return;
+    int index = isSelected(current) ? current + 1 : searcher->indexAfter(cursorPosition());
+    if (index >= matches.size())
+    {
+        if (!searcher->isComplete())
+        {
+            // Следующее совпадение ещё не найдено: выберем, когда придёт.
+            searchOrigin = index > 0 ? matches[index - 1].position + matches[index - 1].length : cursorPosition();
+            jumpToMatch = true;
+            return;
+        }
+        index = 0;
+    }
+    select(index);
+}
+
+void FindBar::findPrevious()
+{
+    const QVector<DocumentSearcher::Match> &matches = searcher->matches();
+    if (!hasTarget() || revision() != searchedRevision || matches.isEmpty())
+        return;
+    int index = isSelected(current) ? current - 1 : searcher->indexAfter(cursorPosition()) - 1;
+    if (index < 0)
+    {
+        if (!searcher->isComplete())
+            return;
+        index = int(matches.size()) - 1;
+    }
+    select(index);
+}
+
+void FindBar::replaceCurrent()
+{
+    if (!isSelected(current))
+    {
+        findNext();
+        return;
+    }
+    const DocumentSearcher::Match match = searcher->matches()[current];
+    const DocumentSearcher::Query request = query();
+    if (largeView)
+    {
+        const QByteArray bytes = DocumentSearcher::substitute(largeView->snapshot(), request, match, replaceEdit->text());
+        largeView->replace(match.position, match.length, bytes);
+        searchOrigin = match.position + bytes.size();
+    }
+    else
+    {
+        // Выражению хватает строк совпадения и строки перед ними для
+        // просмотра назад: весь текст документа не копируется.
+        QTextDocument *document = editor->document();
+        QTextBlock first = document->findBlock(int(match.position));
+        if (first.previous().isValid())
+            first = first.previous();
+        const QTextBlock last = document->findBlock(int(match.position + match.length));
+        QString lines;
+        for (QTextBlock block = first; block.isValid(); block = block.next())
+        {
+            lines += block.text();
+            if (!block.next().isValid())
+                break;
+            lines += QLatin1Char('\n');
+            if (block == last)
+                break;
+        }
+        const DocumentSearcher::Match local{match.position - first.position(), match.length};
+        QTextCursor cursor = editor->textCursor();
+        cursor.insertText(DocumentSearcher::substitute(lines, request, local, replaceEdit->text()));
+        searchOrigin = cursor.position();
+    }
+    jumpToMatch = true;
+    startSearch();
+}
+
+void FindBar::replaceAll()
+{
+    const DocumentSearcher::Query request = query();
+    if (!hasTarget() || request.pattern.isEmpty() || !DocumentSearcher::isValid(request, nullptr))
+        return;
+    searchTimer->stop();
+    current = -1;
+    jumpToMatch = false;
+    replacing = true;
+    searchedRevision = revision();
+    if (largeView)
+        searcher->replaceAll(largeView->snapshot(), request, replaceEdit->text());
+    else
+        searcher->replaceAll(editor->document()->toRawText(), request, replaceEdit->text());
+    updateCount();
+    updateHighlights();
+}
+
+// Замена применяется, только если документ не меняли, пока она считалась.
+// Одна правка — один шаг отмены и в UndoHistory, и в LargeFileView.
+void FindBar::onReplaced(const DocumentSearcher::Replacement &replacement, qint64 elapsedMs)
+{
+    replacing = false;
+    if (!hasTarget() || revision() != searchedRevision)
+    {
+        emit message("Документ изменился во время замены, замена не выполнена.");
+        startSearch();
+        return;
+    }
+    if (replacement.count > 0)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if (largeView)
+        {
+            largeView->replace(replacement.position, replacement.removed, replacement.bytes);
+        }
+        else
+        {
+            QTextCursor cursor(editor->document());
+            cursor.setPosition(int(replacement.position));
+            cursor.setPosition(int(replacement.position + replacement.removed), QTextCursor::KeepAnchor);
+            cursor.beginEditBlock();
+            cursor.insertText(replacement.text);
+            cursor.endEditBlock();
+        }
+        emit message(QString("Заменено совпадений: %1 за %2 мс (правка %3 мс)")
+                         .arg(replacement.count)
+                         .arg(elapsedMs + timer.elapsed())
+                         .arg(timer.elapsed()));
+    }
+    else
+    {
+        emit message("Совпадений нет.");
+    }
+    startSearch();
+}
+
+void FindBar::updateCount()
+{
+    const int total = int(searcher->matches().size());
+    if (replacing)
+        countLabel->setText("Замена...");
+    else if (findEdit->text().isEmpty() || !hasTarget())
+        countLabel->clear();
+    else if (!searcher->isComplete())
+        countLabel->setText(total > 0 ? QString("%1+").arg(total) : QString("Поиск..."));
+    else if (total == 0)
+        countLabel->setText("Нет совпадений");
+    else if (current >= 0)
+        countLabel->setText(QString("%1 из %2").arg(current + 1).arg(total));
+    else
+        countLabel->setText(QString("Совпадений: %1").arg(total));
+}
+
+void FindBar::updateHighlights()
+{
+    const bool fresh = isVisible() && revision() == searchedRevision;
+    const QVector<DocumentSearcher::Match> &matches = searcher->matches();
+    if (largeView)
+    {
+        largeView->setSearchMatches(fresh ? matches : QVector<DocumentSearcher::Match>(), current);
+        return;
+    }
+    if (!editor)
+        return;
+
+    // Только видимое: от первого символа экрана до конца последнего блока.
+    QList<QTextEdit::ExtraSelection> selections;
+    if (fresh && !matches.isEmpty())
+    {
+        const QRect area = editor->viewport()->rect();
+        const int first = editor->cursorForPosition(area.topLeft()).block().position();
+        QTextCursor lastCursor = editor->cursorForPosition(area.bottomRight());
+        lastCursor.movePosition(QTextCursor::EndOfBlock);
+        const int last = lastCursor.position();
+        QColor color = editor->palette().highlight().color();
+        for (int i = searcher->indexAfter(first); i < matches.size() && matches[i].position <= last
+                                                  && selections.size() < MaxHighlights; ++i)
+        {
+            QTextEdit::ExtraSelection selection;
+            selection.cursor = QTextCursor(editor->document());
+            selection.cursor.setPosition(int(matches[i].position));
+            selection.cursor.setPosition(int(matches[i].position + matches[i].length), QTextCursor::KeepAnchor);
+            color.setAlpha(i == current ? 160 : 70);
+            selection.format.setBackground(color);
+            selections.append(selection);
+        }
+    }
+    editor->setExtraSelections(selections);
+}
@@ -0,0 +1,84 @@
+#ifndef FINDBAR_H
+#define FINDBAR_H
+
+#include <QPointer>
+#include <QVector>
+#include <QWidget>
+#include "documentsearcher.h"
+
+class LargeFileView;
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QTextEdit;
+class QTimer;
+class UndoHistory;
+
+// Полоса поиска и замены над редактором (Ctrl+F, Ctrl+H). Поиск идёт по
+// мере набора в DocumentSearcher, счётчик растёт вместе с пачками
+// совпадений. Подсвечиваются только совпадения на экране: в QTextEdit —
+// через extraSelections при прокрутке, большой файл рисует их сам. После
+// правки документа поиск повторяется с задержкой.
+class FindBar : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit FindBar(QWidget *parent = nullptr);
+
+    // Документ в общем редакторе (history — его история отмены) или большой файл.
+    void setTarget(QTextEdit *editor, UndoHistory *history);
+    void setTarget(LargeFileView *view);
+    void clearTarget();
+    void open(bool replace);
+
+signals:
+    void message(const QString &text);
+
+public slots:
+    void findNext();
+    void findPrevious();
+    void replaceCurrent();
+    void replaceAll();
+    void dismiss();
+
+protected:
+    void keyPressEvent(QKeyEvent *event) override;
+
+private slots:
+    void onQueryChanged();
+    void onDocumentChanged();
+    void onMatchesFound();
+    void onReplaced(const DocumentSearcher::Replacement &replacement, qint64 elapsedMs);
+
+private:
+    DocumentSearcher::Query query() const;
+    bool hasTarget() const;
+    quint64 revision() const;
+    qint64 cursorPosition() const;
+    bool isSelected(int index) const;
+    void startSearch();
+    void select(int index);
+    void updateCount();
+    void updateHighlights();
+
+    DocumentSearcher *searcher;
+    QLineEdit *findEdit;
+    QLineEdit *replaceEdit;
+    QCheckBox *caseCheck;
+    QCheckBox *regexCheck;
+    QLabel *countLabel;
+    QWidget *replaceRow;
+    QTimer *searchTimer;    // правка документа — повторный поиск
+    QTimer *highlightTimer; // прокрутка, новые пачки — подсветка экрана
+    QPointer<QTextEdit> editor;
+    QPointer<UndoHistory> history;
+    QPointer<LargeFileView> largeView;
+    QVector<QMetaObject::Connection> targetConnections;
+    quint64 searchedRevision = 0;
+    qint64 searchOrigin = 0;
+    int current = -1;
+    bool jumpToMatch = false; // выбрать первое совпадение после searchOrigin, когда оно придёт
+    bool replacing = false;
+};
+
+#endif // FINDBAR_H
@@ -0,0 +1,150 @@
+#include "findinfilespanel.h"
+#include <QCheckBox>
+#include <QDir>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QRegularExpression>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+constexpr int LineRole = Qt::UserRole;
+constexpr int PathRole = Qt::UserRole + 1;
+
+} // namespace
+
+FindInFilesPanel::FindInFilesPanel(QWidget *parent)
+    : QWidget(parent)
+{
+    searcher = new FileSearcher(this);
+    connect(searcher, &FileSearcher::matchesFound, this, &FindInFilesPanel::appendMatches);
+    connect(searcher, &FileSearcher::finished, this, &FindInFilesPanel::onFinished);
+
+    queryEdit = new QLineEdit(this);
+    queryEdit->setPlaceholderText("Искать в файлах проекта...");
+    regexCheck = new QCheckBox("Регулярное выражение", this);
+    caseCheck = new QCheckBox("Учитывать регистр", this);
+    caseCheck->setChecked(true);
+    searchButton = new QPushButton("Найти", this);
+    resultTree = new QTreeWidget(this);
+    resultTree->setHeaderHidden(true);
+    resultTree->setUniformRowHeights(true);
+    statusLabel = new QLabel(this);
+
+    QHBoxLayout *queryLayout = new QHBoxLayout;
+    queryLayout->addWidget(queryEdit);
+    queryLayout->addWidget(regexCheck);
+    queryLayout->addWidget(caseCheck);
+    queryLayout->addWidget(searchButton);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(queryLayout);
+    layout->addWidget(resultTree);
+    layout->addWidget(statusLabel);
+
+    connect(queryEdit, &QLineEdit::returnPressed, this, &FindInFilesPanel::startOrCancel);
+    connect(searchButton, &QPushButton::clicked, this, &FindInFilesPanel::startOrCancel);
+    connect(resultTree, &QTreeWidget::itemActivated, this, &FindInFilesPanel::onItemActivated);
+}
+
+void FindInFilesPanel::setRoot(const QString &root)
+{
+    searcher->cancel();
+    setRunning(false);
+    rootPath = root;
+}
+
+void FindInFilesPanel::focusQuery()
+{
+    queryEdit->setFocus();
+    queryEdit->selectAll();
+}
+
+void FindInFilesPanel::startOrCancel()
+{
+    if (searcher->isRunning())
+    {
+        searcher->cancel();
+        setRunning(false);
+        statusLabel->setText(QString("Поиск отменён, найдено: %1").arg(shownMatches));
+        return;
+    }
+
+    const QString pattern = queryEdit->text();
+    if (pattern.isEmpty())
+        return;
+    if (rootPath.isEmpty())
+    {
+        statusLabel->setText("Сначала откройте папку проекта.");
+        return;
+    }
+    if (regexCheck->isChecked())
+    {
+        const QRegularExpression expression(pattern);
+        if (!expression.isValid())
+        {
+            statusLabel->setText("Ошибка в выражении: " + expression.errorString());
+            return;
+        }
+    }
+
+    resultTree->clear();
+    fileItems.clear();
+    shownMatches = 0;
+    statusLabel->setText("Поиск...");
+    setRunning(true);
+    searcher->start(rootPath, pattern, regexCheck->isChecked(), caseCheck->isChecked());
+}
+
+void FindInFilesPanel::appendMatches(const QVector<SearchMatch> &matches)
+{
+    resultTree->setUpdatesEnabled(false);
+    for (const SearchMatch &match : matches)
+    {
+        if (shownMatches >= FileSearcher::MaxMatches)
+            break;
+        QTreeWidgetItem *&fileItem = fileItems[match.filePath];
+        if (!fileItem)
+        {
+            fileItem = new QTreeWidgetItem(resultTree, {QDir(rootPath).relativeFilePath(match.filePath)});
+            fileItem->setData(0, PathRole, match.filePath);
+            fileItem->setExpanded(true);
+        }
+        QTreeWidgetItem *item = new QTreeWidgetItem(fileItem, {QString("%1: %2").arg(match.line).arg(match.lineText.trimmed())});
+        item->setData(0, PathRole, match.filePath);
+        item->setData(0, LineRole, match.line);
+        ++shownMatches;
+    }
+    resultTree->setUpdatesEnabled(true);
+    statusLabel->setText(QString("Поиск... найдено: %1").arg(shownMatches));
+}
+
+void FindInFilesPanel::onFinished(int files, int matches, qint64 bytes, qint64 elapsedMs)
+{
+    setRunning(false);
+    const double megabytesPerSecond = elapsedMs > 0 ? bytes / 1048576.0 / (elapsedMs / 1000.0) : 0.0;
+    statusLabel->setText(QString("Найдено: %1 в %2 файлах, просмотрено %3 файлов (%4 МБ) за %5 мс, %6 МБ/с%7")
+                             .arg(matches)
+                             .arg(fileItems.size())
+                             .arg(files)
+                             .arg(bytes / 1048576)
+                             .arg(elapsedMs)
+                             .arg(megabytesPerSecond, 0, 'f', 0)
+                             .arg(matches >= FileSearcher::MaxMatches ? " (достигнут предел)" : ""));
+}
+
+void FindInFilesPanel::onItemActivated(QTreeWidgetItem *item)
+{
+    const QString filePath = item->data(0, PathRole).toString();
+    if (!filePath.isEmpty())
+        emit locationActivated(filePath, qMax(1, item->data(0, LineRole).toInt()));
+}
+
+void FindInFilesPanel::setRunning(bool running)
+{
+    searchButton->setText(running ? "Отмена" : "Найти");
+}
@@ -0,0 +1,50 @@
+#ifndef FINDINFILESPANEL_H
+#define FINDINFILESPANEL_H
+
+#include <QHash>
+#include <QWidget>
+#include "filesearcher.h"
+
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Панель "Поиск в файлах": строка запроса, флажки, дерево результатов
+// по файлам, которое заполняется по мере того, как приходят совпадения.
+class FindInFilesPanel : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit FindInFilesPanel(QWidget *parent = nullptr);
+
+    void setRoot(const QString &root);
+    void focusQuery();
+
+signals:
+    void locationActivated(const QString &filePath, int line);
+
+private slots:
+    void startOrCancel();
+    void appendMatches(const QVector<SearchMatch> &matches);
+    void onFinished(int files, int matches, qint64 bytes, qint64 elapsedMs);
+    void onItemActivated(QTreeWidgetItem *item);
+
+private:
+    void setRunning(bool running);
+
+    FileSearcher *searcher;
+    QLineEdit *queryEdit;
+    QCheckBox *regexCheck;
+    QCheckBox *caseCheck;
+    QPushButton *searchButton;
+    QTreeWidget *resultTree;
+    QLabel *statusLabel;
+    QHash<QString, QTreeWidgetItem *> fileItems;
+    QString rootPath;
+    int shownMatches = 0;
+};
+
+#endif // FINDINFILESPANEL_H
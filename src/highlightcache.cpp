@@ -0,0 +1,113 @@
+#include "highlightcache.h"
+#include <QThread>
+
+HighlightCache::HighlightCache(const Lexer &lexer, QObject *parent)
+    : QObject(parent), lexer(lexer)
+{
+}
+
+HighlightCache::~HighlightCache()
+{
+    cancel();
+}
+
+void HighlightCache::rebuild(const QString &snapshot, int blockCount, quint64 version)
+{
+    cancel();
+
+    const quint64 id = ++runId;
+    std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+    cancelled = flag;
+    worker = QThread::create([this, flag, snapshot, blockCount, version, id]
+                             { run(flag, snapshot, blockCount, version, id); });
+    worker->start();
+}
+
+void HighlightCache::cancel()
+{
+    if (!worker)
+        return;
+    *cancelled = true;
+    finishWorker();
+    ++runId; // результат, уже стоящий в очереди, будет отброшен
+}
+
+void HighlightCache::finishWorker()
+{
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+    cancelled.reset();
+}
+
+const HighlightCache::Span *HighlightCache::spans(int line, int *count) const
+{
+    *count = lineStarts[line + 1] - lineStarts[line];
+    return lineSpans.constData() + lineStarts[line];
+}
+
+LexerState HighlightCache::outgoingState(int line) const
+{
+    LexerState state;
+    state.kind = LexerState::Kind(states[line]);
+    if (state.kind != LexerState::Normal)
+        state.closing = closings.value(line);
+    return state;
+}
+
+// Выполняется в рабочем потоке.
+void HighlightCache::run(const std::shared_ptr<std::atomic<bool>> &flag, const QString &snapshot, int blockCount,
+                         quint64 version, quint64 id)
+{
+    std::shared_ptr<Result> result = std::make_shared<Result>();
+    result->lineStarts.reserve(blockCount + 1);
+    result->states.reserve(blockCount);
+    result->lineStarts.append(0);
+
+    QVector<Token> tokens;
+    LexerState state;
+    const QChar *data = snapshot.constData();
+    const qsizetype size = snapshot.size();
+    qsizetype start = 0;
+    for (int line = 0; line < blockCount; ++line)
+    {
+        if (line % CancelCheckLines == 0 && *flag)
+            return;
+
+        qsizetype end = snapshot.indexOf(QChar::ParagraphSeparator, start);
+        if (end < 0)
+            end = size;
+        // Строка не копируется: лексер только читает её.
+        const QString text = QString::fromRawData(data + start, end - start);
+        state = lexer.tokenize(text, tokens, state);
+        for (const Token &token : std::as_const(tokens))
+        {
+            if (token.kind == TokenKind::Identifier || token.kind == TokenKind::Text)
+                continue;
+            Span span;
+            span.start = quint32(token.start);
+            span.length = quint32(qMin(token.length, 0xffffff));
+            span.kind = quint32(token.kind);
+            result->spans.append(span);
+        }
+        result->lineStarts.append(result->spans.size());
+        result->states.append(quint8(state.kind));
+        if (state.kind != LexerState::Normal)
+            result->closings.insert(line, state.closing);
+        start = qMin(end + 1, size);
+    }
+
+    QMetaObject::invokeMethod(this, [this, result, version, id]
+                              {
+                                  if (id != runId)
+                                      return;
+                                  finishWorker();
+                                  lineSpans = std::move(result->spans);
+                                  lineStarts = std::move(result->lineStarts);
+                                  states = std::move(result->states);
+                                  closings = std::move(result->closings);
+                                  builtVersion = version;
+                                  built = true;
+                                  ++builds;
+                                  emit ready(); }, Qt::QueuedConnection);
+}
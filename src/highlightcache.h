@@ -0,0 +1,77 @@
+#ifndef HIGHLIGHTCACHE_H
+#define HIGHLIGHTCACHE_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include "lexer.h"
+
+class QThread;
+
+// Токены всего документа, разобранные в рабочем потоке. Снимок текста
+// проходит лексером строка за строкой с переносом состояния, отрезки
+// всех строк лежат в одном плоском массиве. Кэш годится, пока версия
+// правки документа совпадает с версией снимка: любая правка делает его
+// устаревшим целиком до следующей сборки.
+class HighlightCache : public QObject {
+    Q_OBJECT
+
+public:
+    // Отрезок подсветки: 8 байт на токен. Идентификаторы и простой
+    // текст не хранятся — у них нет формата.
+    struct Span {
+        quint32 start;
+        quint32 length : 24;
+        quint32 kind : 8;
+    };
+
+    static constexpr int CancelCheckLines = 1024;
+
+    explicit HighlightCache(const Lexer &lexer, QObject *parent = nullptr);
+    ~HighlightCache() override;
+
+    // snapshot — QTextDocument::toRawText(): блоки разделены
+    // QChar::ParagraphSeparator. Прежняя сборка, если идёт, отменяется.
+    void rebuild(const QString &snapshot, int blockCount, quint64 version);
+    void cancel();
+    bool isRunning() const { return worker != nullptr; }
+
+    bool isValid(quint64 version) const { return built && builtVersion == version; }
+    int generation() const { return builds; } // число принятых сборок
+    int lineCount() const { return states.size(); }
+    const Span *spans(int line, int *count) const;
+    LexerState outgoingState(int line) const;
+
+signals:
+    void ready();
+
+private:
+    struct Result {
+        QVector<Span> spans;
+        QVector<int> lineStarts; // начало отрезков строки в spans, плюс конец
+        QVector<quint8> states;  // LexerState::Kind на выходе строки
+        QHash<int, QString> closings;
+    };
+
+    void run(const std::shared_ptr<std::atomic<bool>> &cancelled, const QString &snapshot, int blockCount,
+             quint64 version, quint64 id);
+    void finishWorker();
+
+    const Lexer &lexer;
+    QThread *worker = nullptr;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    quint64 runId = 0;
+
+    QVector<Span> lineSpans;
+    QVector<int> lineStarts;
+    QVector<quint8> states;
+    QHash<int, QString> closings;
+    quint64 builtVersion = 0;
+    bool built = false;
+    int builds = 0;
+};
+
+#endif // HIGHLIGHTCACHE_H
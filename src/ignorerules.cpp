@@ -0,0 +1,151 @@
+#include "ignorerules.h"
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+
+namespace {
+
+QString globToRegularExpression(const QString &glob)
+{
+    QString pattern = "^";
+    for (qsizetype i = 0; i < glob.size(); ++i)
+    {
+        const QChar c = glob[i];
+        if (c == QLatin1Char('*'))
+        {
+            if (i + 1 < glob.size() && glob[i + 1] == QLatin1Char('*'))
+            {
+                // "**/" — любое число каталогов, в том числе ноль; иначе всё подряд.
+                if (i + 2 < glob.size() && glob[i + 2] == QLatin1Char('/'))
+                {
+                    pattern += "(?:.*/)?";
+                    i += 2;
+                }
+                else
+                {
+                    pattern += ".*";
+                    ++i;
+                }
+            }
+            else
+            {
+                pattern += "[^/]*";
+            }
+        }
+        else if (c == QLatin1Char('?'))
+        {
+            pattern += "[^/]";
+        }
+        else if (c == QLatin1Char('['))
+        {
+            const qsizetype close = glob.indexOf(QLatin1Char(']'), i + 2);
+            if (close < 0)
+            {
+                pattern += "\\[";
+                continue;
+            }
+            QString set = glob.mid(i + 1, close - i - 1);
+            if (set.startsWith(QLatin1Char('!')))
+                set[0] = QLatin1Char('^');
+            set.replace(QLatin1String("\\"), QLatin1String("\\\\"));
+            pattern += '[' + set + ']';
+            i = close;
+        }
+        else if (c == QLatin1Char('\\') && i + 1 < glob.size())
+        {
+            pattern += QRegularExpression::escape(QString(glob[++i]));
+        }
+        else
+        {
+            pattern += QRegularExpression::escape(QString(c));
+        }
+    }
+    return pattern + "$";
+}
+
+} // namespace
+
+IgnoreRules::IgnoreRules(const QString &root)
+    : rootPath(root)
+{
+    for (const QString &pattern : configuredExcludes())
+        addPattern(pattern);
+    loadDirectory(QString());
+}
+
+QStringList IgnoreRules::configuredExcludes()
+{
+    QSettings settings("PablaIDE", "CodeEditor");
+    return settings.value("excludePatterns", QStringList{"build/", "node_modules/", "cmake-build-*/"}).toStringList();
+}
+
+void IgnoreRules::addPattern(const QString &pattern, const QString &baseDir)
+{
+    QString glob = pattern;
+    // Пробелы в конце значимы только экранированные.
+    while (glob.endsWith(QLatin1Char(' ')) && !glob.endsWith(QLatin1String("\\ ")))
+        glob.chop(1);
+    if (glob.isEmpty() || glob.startsWith(QLatin1Char('#')))
+        return;
+
+    Rule rule;
+    rule.baseDir = baseDir;
+    rule.negated = glob.startsWith(QLatin1Char('!'));
+    if (rule.negated)
+        glob.remove(0, 1);
+    else if (glob.startsWith(QLatin1String("\\#")) || glob.startsWith(QLatin1String("\\!")))
+        glob.remove(0, 1);
+    rule.dirOnly = glob.endsWith(QLatin1Char('/'));
+    if (rule.dirOnly)
+        glob.chop(1);
+    rule.anchored = glob.contains(QLatin1Char('/'));
+    if (glob.startsWith(QLatin1Char('/')))
+        glob.remove(0, 1);
+    if (glob.isEmpty())
+        return;
+
+    rule.expression = QRegularExpression(globToRegularExpression(glob));
+    if (rule.expression.isValid())
+        rules.append(rule);
+}
+
+void IgnoreRules::loadDirectory(const QString &relativeDir)
+{
+    if (rootPath.isEmpty() || loadedDirs.contains(relativeDir))
+        return;
+    loadedDirs.insert(relativeDir);
+
+    QFile file(QDir(rootPath).filePath(relativeDir.isEmpty() ? QString(".gitignore") : relativeDir + "/.gitignore"));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return;
+    while (!file.atEnd())
+        addPattern(QString::fromUtf8(file.readLine()).remove(QLatin1Char('\n')).remove(QLatin1Char('\r')), relativeDir);
+}
+
+bool IgnoreRules::isIgnored(const QString &relativePath, bool isDir) const
+{
+    const qsizetype slash = relativePath.lastIndexOf(QLatin1Char('/'));
+    const QStringView name = QStringView(relativePath).mid(slash + 1);
+
+    bool ignored = false;
+    for (const Rule &rule : rules)
+    {
+        if (rule.dirOnly && !isDir)
+            continue;
+        if (rule.negated != ignored)
+            continue; // правило не изменит результат
+        QStringView subject = relativePath;
+        if (!rule.baseDir.isEmpty())
+        {
+            if (!relativePath.startsWith(rule.baseDir) || relativePath.size() <= rule.baseDir.size()
+                || relativePath[rule.baseDir.size()] != QLatin1Char('/'))
+                continue;
+            subject = subject.mid(rule.baseDir.size() + 1);
+        }
+        if (!rule.anchored)
+            subject = name;
+        if (rule.expression.matchView(subject).hasMatch())
+            ignored = !rule.negated;
+    }
+    return ignored;
+}
@@ -0,0 +1,43 @@
+#ifndef IGNORERULES_H
+#define IGNORERULES_H
+
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Правила исключения путей проекта в формате .gitignore: шаблоны
+// * ? [..] **, отрицание !, только каталоги (/ в конце), привязка к
+// каталогу файла правил (/ внутри шаблона). Правила вложенных .gitignore
+// действуют только в своём поддереве; побеждает последнее совпавшее.
+// Пути — относительно корня проекта, через '/'.
+class IgnoreRules {
+public:
+    IgnoreRules() = default;
+    explicit IgnoreRules(const QString &root);
+
+    // Шаблоны из настройки excludePatterns (по умолчанию build, node_modules, cmake-build-*).
+    static QStringList configuredExcludes();
+
+    void addPattern(const QString &pattern, const QString &baseDir = QString());
+    // Читает .gitignore каталога; повторный вызов для того же каталога ничего не делает.
+    void loadDirectory(const QString &relativeDir);
+
+    bool isIgnored(const QString &relativePath, bool isDir) const;
+
+private:
+    struct Rule {
+        QRegularExpression expression;
+        QString baseDir;
+        bool negated;
+        bool dirOnly;
+        bool anchored;
+    };
+
+    QString rootPath;
+    QVector<Rule> rules;
+    QSet<QString> loadedDirs;
+};
+
+#endif // IGNORERULES_H
@@ -1,6 +1,6 @@
 #include "keypresshandler.h"
 
-KeyPressHandler::KeyPressHandler(QTextEdit *editor, QObject *parent)
+KeyPressHandler::KeyPressHandler(QWidget *editor, QObject *parent)
     : QObject(parent), editor(editor)
 {
     editor->installEventFilter(this);
@@ -23,6 +23,21 @@ bool KeyPressHandler::eventFilter(QObject *obj, QEvent *event)
                 emit undoRequested();
                 return true;
             }
+            else if (keyEvent->key() == Qt::Key_Y)
+            {
+                emit redoRequested();
+                return true;
+            }
+            else if (keyEvent->key() == Qt::Key_Space)
+            {
+                emit completionRequested();
+                return true;
+            }
+        }
+        else if (keyEvent->modifiers() == (Qt::ControlModifier | Qt::ShiftModifier) && keyEvent->key() == Qt::Key_Z)
+        {
+            emit redoRequested();
+            return true;
         }
     }
     return QObject::eventFilter(obj, event);
@@ -3,13 +3,13 @@
 
 #include <QObject>
 #include <QKeyEvent>
-#include <QTextEdit>
+#include <QWidget>
 
 class KeyPressHandler : public QObject {
     Q_OBJECT
 
 public:
-    explicit KeyPressHandler(QTextEdit *editor, QObject *parent = nullptr);
+    explicit KeyPressHandler(QWidget *editor, QObject *parent = nullptr);
 
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override;
@@ -17,9 +17,11 @@ protected:
 signals:
     void saveRequested();
     void undoRequested();
+    void redoRequested();
+    void completionRequested();
 
 private:
-    QTextEdit *editor;
+    QWidget *editor;
 };
 
 #endif // KEYPRESSHANDLER_H
\ No newline at end of file
@@ -0,0 +1,1096 @@
+#include "largefileview.h"
+#include "lexer.h"
+#include "theme.h"
+#include <QFile>
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QThread>
+#include <QWheelEvent>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+constexpr int TabWidth = 4;
+
+// column — колонка первого символа text.
+QString expandTabs(const QString &text, int column)
+{
+    if (!text.contains('\t'))
+        return text;
+    QString result;
+    result.reserve(text.size() + 16);
+    for (QChar c : text)
+    {
+        if (c == '\t')
+        {
+            const int spaces = TabWidth - column % TabWidth;
+            result.append(QString(spaces, ' '));
+            column += spaces;
+        }
+        else
+        {
+            result.append(c);
+            ++column;
+        }
+    }
+    return result;
+}
+
+// Колонка после байтов UTF-8: табуляция — до следующей кратной TabWidth,
+// байты продолжения места не занимают.
+int advanceColumns(const char *data, qint64 size, int column)
+{
+    for (qint64 i = 0; i < size; ++i)
+    {
+        const uchar c = uchar(data[i]);
+        if (c == '\t')
+            column = (column / TabWidth + 1) * TabWidth;
+        else if ((c & 0xC0) != 0x80)
+            ++column;
+    }
+    return column;
+}
+
+// Цвет токена из текущей темы; начертание не меняется, чтобы символы
+// оставались в сетке моноширинного шрифта.
+QColor tokenColor(TokenKind kind, const QColor &text)
+{
+    const QTextCharFormat &format = Theme::current().format(kind);
+    return format.hasProperty(QTextFormat::ForegroundBrush) ? format.foreground().color() : text;
+}
+
+} // namespace
+
+bool LargeFileView::hasLongLine(const QString &fileName, qint64 threshold)
+{
+    QFile file(fileName);
+    if (threshold <= 0 || !file.open(QIODevice::ReadOnly) || file.size() <= threshold)
+        return false;
+    const qint64 size = file.size();
+    const uchar *mapped = file.map(0, size);
+    if (!mapped)
+        return false;
+
+    // Ищем перевод строки не дальше threshold байт от начала каждой строки.
+    const char *data = reinterpret_cast<const char *>(mapped);
+    const char *end = data + size;
+    bool found = false;
+    while (data < end)
+    {
+        const qint64 remaining = end - data;
+        const void *newline = std::memchr(data, '\n', size_t(qMin(remaining, threshold + 1)));
+        if (!newline)
+        {
+            found = remaining > threshold;
+            break;
+        }
+        data = static_cast<const char *>(newline) + 1;
+    }
+    file.unmap(const_cast<uchar *>(mapped));
+    return found;
+}
+
+LargeFileView::LargeFileView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+    verticalScrollBar()->setRange(0, ScrollRange);
+}
+
+LargeFileView::~LargeFileView()
+{
+    stopIndexing();
+}
+
+bool LargeFileView::openFile(const QString &fileName)
+{
+    if (!table.open(fileName))
+        return false;
+    savingFile.clear();
+    savingTable.clear();
+    reindexAfterSave = false;
+    startIndexing(fileName);
+    segmentCache.clear();
+    clearHistory();
+    currentFile = fileName;
+    topOffset = 0;
+    topColumn = 0;
+    caret = 0;
+    preferredColumn = -1;
+    widestLine = 0;
+    setModified(false);
+    updateScrollBars();
+    viewport()->update();
+    return true;
+}
+
+PieceTable LargeFileView::beginSave(const QString &fileName)
+{
+    savingFile = fileName;
+    savingTable = table;
+    savingStep = int(undoSteps.size());
+    savingRevision = textRevision;
+    if (!undoSteps.isEmpty())
+        undoSteps.last().typed = false; // набор после снимка — новый шаг
+    return savingTable;
+}
+
+// Вызывается синхронно перед переименованием, за ним сразу finishSave():
+// между ними не бывает отрисовки и правок.
+void LargeFileView::releaseFile(const QString &fileName)
+{
+    if (fileName != savingFile || table.isDetached())
+        return;
+    emit releasingFile();
+    // Индекс строк читает файл своим отображением; он будет построен
+    // заново по файлу, который окажется на месте.
+    if (indexer)
+    {
+        stopIndexing();
+        reindexAfterSave = true;
+    }
+    table.detach(savingTable, fileName);
+    savingTable.clear();
+}
+
+bool LargeFileView::finishSave(const QString &fileName, bool ok)
+{
+    if (fileName != savingFile)
+        return true; // итог сохранения, которое догнало следующее
+    savingFile.clear();
+    savingTable.clear();
+    const bool attached = table.attach(ok);
+    if (ok)
+    {
+        currentFile = fileName;
+        cleanStep = savingStep;
+    }
+    if (!attached)
+    {
+        openFile(currentFile);
+        return false;
+    }
+    if (reindexAfterSave)
+    {
+        reindexAfterSave = false;
+        // В новом файле уже есть правки до снимка, в прежнем — ни одной.
+        QVector<PendingEdit> edits;
+        for (const PendingEdit &edit : std::as_const(pendingEdits))
+        {
+            if (!ok || edit.revision >= savingRevision)
+                edits.append(edit);
+        }
+        const qint64 line = pendingLine;
+        startIndexing(ok ? fileName : currentFile);
+        pendingEdits = edits;
+        pendingLine = line;
+    }
+    setModified(int(undoSteps.size()) != cleanStep);
+    return true;
+}
+
+void LargeFileView::clear()
+{
+    stopIndexing();
+    lines.clear();
+    pendingEdits.clear();
+    pendingLine = 0;
+    table.clear();
+    savingFile.clear();
+    savingTable.clear();
+    reindexAfterSave = false;
+    segmentCache.clear();
+    clearHistory();
+    currentFile.clear();
+    topOffset = 0;
+    topColumn = 0;
+    caret = 0;
+    setModified(false);
+    updateScrollBars();
+    viewport()->update();
+}
+
+// Индекс строится по файлу на диске, отображённому ещё раз: таблица
+// фрагментов в рабочий поток не передаётся.
+void LargeFileView::startIndexing(const QString &fileName)
+{
+    stopIndexing();
+    lines.clear();
+    pendingEdits.clear();
+    pendingLine = 0;
+
+    const quint64 id = ++indexGeneration;
+    std::shared_ptr<std::atomic<bool>> cancelled = std::make_shared<std::atomic<bool>>(false);
+    indexCancelled = cancelled;
+    indexer = QThread::create([this, cancelled, fileName, id]
+                              {
+                                  std::shared_ptr<LineIndex> index = std::make_shared<LineIndex>();
+                                  QFile file(fileName);
+                                  if (file.open(QIODevice::ReadOnly))
+                                  {
+                                      const qint64 size = file.size();
+                                      const uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+                                      if (size == 0 || mapped)
+                                          index->build(reinterpret_cast<const char *>(mapped), size, cancelled.get());
+                                      if (mapped)
+                                          file.unmap(const_cast<uchar *>(mapped));
+                                  }
+                                  if (*cancelled)
+                                      return;
+                                  QMetaObject::invokeMethod(this, [this, index, id]
+                                                            {
+                                                                if (id == indexGeneration)
+                                                                    finishIndexing(std::move(*index)); }, Qt::QueuedConnection); });
+    indexer->start();
+}
+
+void LargeFileView::stopIndexing()
+{
+    if (!indexer)
+        return;
+    *indexCancelled = true;
+    indexer->wait();
+    delete indexer;
+    indexer = nullptr;
+    indexCancelled.reset();
+    ++indexGeneration; // готовый индекс, уже стоящий в очереди, будет отброшен
+}
+
+void LargeFileView::finishIndexing(LineIndex index)
+{
+    indexer->wait();
+    delete indexer;
+    indexer = nullptr;
+    indexCancelled.reset();
+
+    lines = std::move(index);
+    for (const PendingEdit &edit : std::as_const(pendingEdits))
+        indexEdit(edit.pos, edit.removed, edit.inserted);
+    pendingEdits.clear();
+    if (!lines.isValid())
+        return; // строка длиннее 4 ГБ: номеров строк не будет
+    emit lineIndexReady(lines.isUtf8());
+    if (pendingLine > 0)
+        goToLine(pendingLine);
+    emit caretMoved();
+}
+
+void LargeFileView::indexEdit(qint64 pos, qint64 removed, const QByteArray &inserted)
+{
+    if (indexer)
+    {
+        pendingEdits.append({pos, removed, inserted, textRevision});
+        return;
+    }
+    if (removed > 0)
+        lines.remove(pos, removed);
+    if (!inserted.isEmpty())
+        lines.insert(pos, inserted.constData(), inserted.size());
+}
+
+void LargeFileView::goToLine(qint64 line)
+{
+    if (!lines.isValid())
+    {
+        if (indexer)
+            pendingLine = line;
+        return;
+    }
+    pendingLine = 0;
+    const qint64 target = qBound<qint64>(0, line - 1, lines.lineCount() - 1);
+    // Строка встаёт на треть высоты окна от верха, а не к самому краю.
+    topOffset = lines.lineStart(qMax<qint64>(0, target - visibleLineCount() / 3));
+    topColumn = 0;
+    preferredColumn = -1;
+    moveCaret(lines.lineStart(target));
+}
+
+qint64 LargeFileView::caretLine() const
+{
+    return lines.isValid() ? lines.lineOf(caret) + 1 : 0;
+}
+
+int LargeFileView::caretColumn() const
+{
+    return columnOf(table.lineStart(caret), caret) + 1;
+}
+
+void LargeFileView::setCaretOffset(qint64 pos)
+{
+    preferredColumn = -1;
+    moveCaret(pos);
+}
+
+void LargeFileView::setSearchMatches(const QVector<DocumentSearcher::Match> &matches, int current)
+{
+    searchMatches = matches;
+    currentMatch = current;
+    viewport()->update();
+}
+
+void LargeFileView::setModified(bool value)
+{
+    if (modified == value)
+        return;
+    modified = value;
+    emit modificationChanged(modified);
+}
+
+void LargeFileView::setWordWrap(bool enabled)
+{
+    if (wrap == enabled)
+        return;
+    wrap = enabled;
+    setHorizontalScrollBarPolicy(wrap ? Qt::ScrollBarAlwaysOff : Qt::ScrollBarAsNeeded);
+    horizontalScrollBar()->setValue(0);
+    topColumn = 0;
+    preferredColumn = -1;
+    ensureCaretVisible();
+    viewport()->update();
+}
+
+qint64 LargeFileView::contentEnd(qint64 lineStart) const
+{
+    const qint64 newline = table.findForward(lineStart, '\n');
+    qint64 end = newline < 0 ? table.size() : newline;
+    if (end > lineStart && table.at(end - 1) == '\r')
+        --end;
+    return end;
+}
+
+LargeFileView::Segments &LargeFileView::segments(qint64 lineStart) const
+{
+    auto it = segmentCache.find(lineStart);
+    if (it == segmentCache.end())
+    {
+        if (segmentCache.size() >= MaxCachedLines)
+            segmentCache.clear();
+        Segments line;
+        line.offsets.append(lineStart);
+        line.columns.append(0);
+        line.end = contentEnd(lineStart);
+        it = segmentCache.insert(lineStart, line);
+    }
+    return it.value();
+}
+
+// Продвигает опорные точки, пока последняя не окажется дальше untilColumn
+// или untilPos, либо пока строка не кончится.
+void LargeFileView::extendSegments(Segments &line, int untilColumn, qint64 untilPos) const
+{
+    while (line.totalColumns < 0 && line.columns.last() <= untilColumn && line.offsets.last() <= untilPos)
+    {
+        const qint64 from = line.offsets.last();
+        const qint64 to = segmentEnd(from, line.end);
+        const QByteArray bytes = table.read(from, to - from);
+        const int column = advanceColumns(bytes.constData(), bytes.size(), line.columns.last());
+        if (to >= line.end)
+        {
+            line.totalColumns = column;
+            break;
+        }
+        line.offsets.append(to);
+        line.columns.append(column);
+    }
+}
+
+// Конец куска строки от from: SegmentBytes байт, дополненные до целого символа.
+qint64 LargeFileView::segmentEnd(qint64 from, qint64 end) const
+{
+    qint64 to = qMin(from + SegmentBytes, end);
+    while (to < end && (uchar(table.at(to)) & 0xC0) == 0x80)
+        ++to;
+    return to;
+}
+
+// Досчитывает состояния лексера до точки index; состояние в начале
+// строки уже известно.
+void LargeFileView::extendStates(Segments &line, int index) const
+{
+    QVector<Token> tokens;
+    while (line.states.size() <= index)
+    {
+        const int i = line.states.size();
+        const QString text = QString::fromUtf8(table.read(line.offsets[i - 1], line.offsets[i] - line.offsets[i - 1]));
+        line.states.append(Lexer::defaultLexer().tokenize(text, tokens, line.states.last()));
+    }
+}
+
+// Состояние в конце строки, которая начинается в состоянии state. Строка
+// из кэша проходится по его точкам, остальные — теми же кусками.
+LexerState LargeFileView::lineEndState(qint64 lineStart, const LexerState &state) const
+{
+    QVector<Token> tokens;
+    qint64 from = lineStart;
+    LexerState current = state;
+    const auto it = segmentCache.find(lineStart);
+    if (it != segmentCache.end() && !it->states.isEmpty())
+    {
+        Segments &line = it.value();
+        extendSegments(line, INT_MAX, LLONG_MAX);
+        extendStates(line, line.offsets.size() - 1);
+        from = line.offsets.last();
+        current = line.states.last();
+    }
+    const qint64 end = contentEnd(lineStart);
+    while (from < end)
+    {
+        const qint64 to = segmentEnd(from, end);
+        current = Lexer::defaultLexer().tokenize(QString::fromUtf8(table.read(from, to - from)), tokens, current);
+        from = to;
+    }
+    return current;
+}
+
+// Строки просматриваются назад до строки с известным состоянием, начала
+// файла или StateLookbackBytes; там состояние считается обычным. Найденные
+// состояния запоминаются, поэтому при прокрутке вниз хватает одной строки.
+LexerState LargeFileView::lineStartState(qint64 lineStart) const
+{
+    QVector<qint64> chain{lineStart};
+    LexerState state;
+    for (;;)
+    {
+        const auto known = segmentCache.constFind(chain.last());
+        if (known != segmentCache.cend() && !known->states.isEmpty())
+        {
+            state = known->states.first();
+            break;
+        }
+        if (chain.last() <= 0)
+            break;
+        const qint64 previous = table.lineStart(chain.last() - 1);
+        const auto cached = segmentCache.constFind(previous);
+        const bool hasState = cached != segmentCache.cend() && !cached->states.isEmpty();
+        if (!hasState && lineStart - previous > StateLookbackBytes)
+            break;
+        chain.append(previous);
+    }
+    for (int i = chain.size() - 1; i > 0; --i)
+        state = lineEndState(chain[i], state);
+    return state;
+}
+
+// Состояние лексера в опорной точке строки не правее column.
+LexerState LargeFileView::stateAtColumn(qint64 lineStart, int column) const
+{
+    if (segments(lineStart).states.isEmpty())
+    {
+        const LexerState start = lineStartState(lineStart);
+        Segments &line = segments(lineStart); // lineStartState мог очистить кэш
+        if (line.states.isEmpty())
+            line.states.append(start);
+    }
+    Segments &line = segments(lineStart);
+    extendSegments(line, column, LLONG_MAX);
+    const int index = int(std::upper_bound(line.columns.cbegin(), line.columns.cend(), column) - line.columns.cbegin()) - 1;
+    extendStates(line, index);
+    return line.states[index];
+}
+
+// Правка в pos: точки строк до неё остаются, строки после — забываются.
+void LargeFileView::invalidateSegments(qint64 pos)
+{
+    for (auto it = segmentCache.begin(); it != segmentCache.end();)
+    {
+        if (it.key() > pos)
+        {
+            it = segmentCache.erase(it);
+            continue;
+        }
+        Segments &line = it.value();
+        if (line.end + 2 >= pos) // правка в строке или в её переводе строки
+        {
+            int keep = 1;
+            while (keep < line.offsets.size() && line.offsets[keep] < pos)
+                ++keep;
+            line.offsets.resize(keep);
+            line.columns.resize(keep);
+            line.states.resize(qMin(keep, int(line.states.size())));
+            line.end = contentEnd(it.key());
+            line.totalColumns = -1;
+        }
+        ++it;
+    }
+}
+
+// Текст строки, покрывающий колонки [fromColumn, fromColumn + columnCount),
+// с развёрнутыми табуляциями. Начинается с опорной точки не правее
+// fromColumn, её колонка возвращается в sliceColumn; reachesEnd — строка
+// кончается в этом окне.
+QString LargeFileView::lineSlice(qint64 lineStart, int fromColumn, int columnCount, int *sliceColumn,
+                                 bool *reachesEnd) const
+{
+    Segments &line = segments(lineStart);
+    const int target = fromColumn + columnCount;
+    extendSegments(line, target, LLONG_MAX);
+    const int first = int(std::upper_bound(line.columns.cbegin(), line.columns.cend(), fromColumn) - line.columns.cbegin()) - 1;
+    const int last = int(std::upper_bound(line.columns.cbegin(), line.columns.cend(), target) - line.columns.cbegin());
+    const qint64 from = line.offsets[first];
+    const qint64 to = last < line.offsets.size() ? line.offsets[last] : line.end;
+    *sliceColumn = line.columns[first];
+    *reachesEnd = line.totalColumns >= 0 && line.totalColumns <= target;
+    return expandTabs(QString::fromUtf8(table.read(from, to - from)), line.columns[first]);
+}
+
+int LargeFileView::lineColumns(qint64 lineStart) const
+{
+    Segments &line = segments(lineStart);
+    extendSegments(line, INT_MAX, LLONG_MAX);
+    return line.totalColumns;
+}
+
+// Есть ли в строке символы правее колонки column.
+bool LargeFileView::hasColumn(qint64 lineStart, int column) const
+{
+    Segments &line = segments(lineStart);
+    extendSegments(line, column, LLONG_MAX);
+    return line.totalColumns < 0 || line.totalColumns > column;
+}
+
+int LargeFileView::columnOf(qint64 lineStart, qint64 pos) const
+{
+    Segments &line = segments(lineStart);
+    pos = qBound(lineStart, pos, line.end);
+    extendSegments(line, INT_MAX, pos);
+    const int i = int(std::upper_bound(line.offsets.cbegin(), line.offsets.cend(), pos) - line.offsets.cbegin()) - 1;
+    const QByteArray bytes = table.read(line.offsets[i], pos - line.offsets[i]);
+    return advanceColumns(bytes.constData(), bytes.size(), line.columns[i]);
+}
+
+qint64 LargeFileView::positionAtColumn(qint64 lineStart, int column) const
+{
+    Segments &line = segments(lineStart);
+    extendSegments(line, column, LLONG_MAX);
+    const int i = int(std::upper_bound(line.columns.cbegin(), line.columns.cend(), column) - line.columns.cbegin()) - 1;
+    const qint64 start = line.offsets[i];
+    const qint64 end = i + 1 < line.offsets.size() ? line.offsets[i + 1] : line.end;
+    const QByteArray bytes = table.read(start, end - start);
+
+    int current = line.columns[i];
+    int index = 0;
+    while (index < bytes.size() && current < column)
+    {
+        const uchar c = uchar(bytes[index++]);
+        current = c == '\t' ? (current / TabWidth + 1) * TabWidth : current + 1;
+        while (index < bytes.size() && (uchar(bytes[index]) & 0xC0) == 0x80)
+            ++index;
+    }
+    return start + index;
+}
+
+qint64 LargeFileView::previousChar(qint64 pos) const
+{
+    if (pos <= 0)
+        return 0;
+    --pos;
+    while (pos > 0 && (uchar(table.at(pos)) & 0xC0) == 0x80)
+        --pos;
+    if (pos > 0 && table.at(pos) == '\n' && table.at(pos - 1) == '\r')
+        --pos;
+    return pos;
+}
+
+qint64 LargeFileView::nextChar(qint64 pos) const
+{
+    if (pos >= table.size())
+        return table.size();
+    if (table.at(pos) == '\r' && table.at(pos + 1) == '\n')
+        return pos + 2;
+    ++pos;
+    while (pos < table.size() && (uchar(table.at(pos)) & 0xC0) == 0x80)
+        ++pos;
+    return pos;
+}
+
+int LargeFileView::visibleLineCount() const
+{
+    return qMax(1, viewport()->height() / fontMetrics().height());
+}
+
+int LargeFileView::charWidth() const
+{
+    return qMax(1, fontMetrics().horizontalAdvance(QLatin1Char('M')));
+}
+
+int LargeFileView::wrapColumns() const
+{
+    return wrap ? qMax(8, (viewport()->width() - 8) / charWidth()) : 0;
+}
+
+LargeFileView::VisualRow LargeFileView::visualRowOf(qint64 pos) const
+{
+    VisualRow row;
+    row.line = table.lineStart(pos);
+    const int width = wrapColumns();
+    if (width <= 0)
+        return row;
+    const int column = columnOf(row.line, pos);
+    row.column = column / width * width;
+    // Каретка в конце строки ровно на границе переноса — в конце
+    // предыдущей строки экрана, а не на пустой следующей.
+    if (row.column > 0 && row.column == column && !hasColumn(row.line, column))
+        row.column -= width;
+    return row;
+}
+
+LargeFileView::VisualRow LargeFileView::stepRows(VisualRow row, int count) const
+{
+    const int width = wrapColumns();
+    for (; count > 0; --count)
+    {
+        if (width > 0 && hasColumn(row.line, row.column + width))
+        {
+            row.column += width;
+            continue;
+        }
+        const qint64 next = table.nextLineStart(row.line);
+        if (next < 0 || next >= table.size())
+            break;
+        row.line = next;
+        row.column = 0;
+    }
+    for (; count < 0; ++count)
+    {
+        if (width > 0 && row.column > 0)
+        {
+            row.column = qMax(0, row.column - width);
+            continue;
+        }
+        if (row.line <= 0)
+            break;
+        row.line = table.lineStart(row.line - 1);
+        row.column = width > 0 ? qMax(0, lineColumns(row.line) - 1) / width * width : 0;
+    }
+    return row;
+}
+
+void LargeFileView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(viewport());
+    painter.fillRect(viewport()->rect(), palette().base());
+    painter.setFont(font());
+
+    const QFontMetrics metrics = fontMetrics();
+    const int lineHeight = metrics.height();
+    const int width = charWidth();
+    const int wrapWidth = wrapColumns();
+    // Без переноса рисуется только видимое окно колонок.
+    const int windowColumns = wrapWidth > 0 ? wrapWidth : viewport()->width() / width + 2;
+    const int scrolledColumns = wrapWidth > 0 ? 0 : horizontalScrollBar()->value();
+    const QColor textColor = palette().text().color();
+    const Lexer &lexer = Lexer::defaultLexer();
+    QVector<Token> tokens;
+
+    const qint64 caretLine = table.lineStart(caret);
+    int caretColumn = -1;
+    visibleRows.clear();
+    VisualRow row{topOffset, topColumn};
+    for (int y = 0; y < viewport()->height(); y += lineHeight)
+    {
+        const int from = wrapWidth > 0 ? row.column : scrolledColumns;
+        int sliceColumn = 0;
+        bool reachesEnd = false;
+        const QString text = lineSlice(row.line, from, windowColumns, &sliceColumn, &reachesEnd);
+        const int skip = from - sliceColumn;
+        visibleRows.append(row);
+        if (wrapWidth <= 0)
+        {
+            const Segments &line = segments(row.line);
+            const qint64 known = line.totalColumns >= 0 ? line.totalColumns
+                                                        : line.columns.last() + (line.end - line.offsets.last());
+            widestLine = qMax(widestLine, int(qMin<qint64>(known, INT_MAX / 2)));
+        }
+
+        if (!searchMatches.isEmpty())
+            paintMatches(painter, row.line, from, windowColumns, y);
+
+        // Лексер видит весь кусок от опорной точки, начиная с её
+        // состояния; рисуется только окно, каждый символ — один раз:
+        // цветные токены своим цветом, промежутки между ними — цветом текста.
+        const int baseline = y + metrics.ascent();
+        const int windowEnd = qMin(int(text.size()), skip + windowColumns);
+        lexer.tokenize(text, tokens, stateAtColumn(row.line, sliceColumn));
+        int drawn = skip;
+        for (const Token &token : std::as_const(tokens))
+        {
+            if (token.kind == TokenKind::Identifier || token.kind == TokenKind::Text)
+                continue;
+            const int start = qMax(token.start, drawn);
+            const int end = qMin(token.start + token.length, windowEnd);
+            if (start >= end)
+                continue;
+            if (start > drawn)
+            {
+                painter.setPen(textColor);
+                painter.drawText(4 + (drawn - skip) * width, baseline, text.mid(drawn, start - drawn));
+            }
+            painter.setPen(tokenColor(token.kind, textColor));
+            painter.drawText(4 + (start - skip) * width, baseline, text.mid(start, end - start));
+            drawn = end;
+        }
+        if (drawn < windowEnd)
+        {
+            painter.setPen(textColor);
+            painter.drawText(4 + (drawn - skip) * width, baseline, text.mid(drawn, windowEnd - drawn));
+        }
+
+        if (hasFocus() && row.line == caretLine)
+        {
+            if (caretColumn < 0)
+                caretColumn = columnOf(caretLine, caret);
+            const bool inRow = wrapWidth <= 0
+                || (caretColumn >= from
+                    && (caretColumn < from + wrapWidth || (reachesEnd && caretColumn == from + wrapWidth)));
+            if (inRow)
+                painter.fillRect(4 + (caretColumn - from) * width, y, 2, lineHeight, textColor);
+        }
+
+        if (wrapWidth > 0 && !reachesEnd)
+        {
+            row.column += wrapWidth;
+            continue;
+        }
+        const qint64 next = table.nextLineStart(row.line);
+        if (next < 0)
+            break;
+        row.line = next;
+        row.column = 0;
+    }
+    if (wrapWidth <= 0)
+        horizontalScrollBar()->setRange(0, qMax(0, widestLine - viewport()->width() / width + 1));
+}
+
+// Фон совпадений поиска в окне колонок [fromColumn, fromColumn + columnCount)
+// строки; совпадения вне окна не просматриваются.
+void LargeFileView::paintMatches(QPainter &painter, qint64 lineStart, int fromColumn, int columnCount, int y) const
+{
+    const qint64 from = positionAtColumn(lineStart, fromColumn);
+    const qint64 to = positionAtColumn(lineStart, fromColumn + columnCount);
+    const int width = charWidth();
+    const int height = fontMetrics().height();
+    QColor color = palette().highlight().color();
+    auto match = std::partition_point(searchMatches.cbegin(), searchMatches.cend(), [from](const DocumentSearcher::Match &m)
+                                      { return m.position + m.length <= from; });
+    for (; match != searchMatches.cend() && match->position <= to; ++match)
+    {
+        const int start = qMax(fromColumn, columnOf(lineStart, match->position));
+        const int end = qMin(fromColumn + columnCount, qMax(start + 1, columnOf(lineStart, match->position + match->length)));
+        if (end <= start)
+            continue;
+        color.setAlpha(match - searchMatches.cbegin() == currentMatch ? 160 : 70);
+        painter.fillRect(4 + (start - fromColumn) * width, y, (end - start) * width, height, color);
+    }
+}
+
+void LargeFileView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    if (const int width = wrapColumns())
+        topColumn = topColumn / width * width;
+    updateScrollBars();
+}
+
+void LargeFileView::updateScrollBars()
+{
+    // Точного числа строк нет, размер ползунка оценивается по байтам экрана.
+    const qint64 size = table.size();
+    const qint64 screenBytes = qint64(visibleLineCount()) * 80;
+    const qint64 top = topColumn > 0 ? positionAtColumn(topOffset, topColumn) : topOffset;
+    syncingScrollBar = true;
+    verticalScrollBar()->setPageStep(int(qBound<qint64>(1, size > 0 ? screenBytes * ScrollRange / size : ScrollRange, ScrollRange)));
+    verticalScrollBar()->setValue(size > 0 ? int(top * ScrollRange / size) : 0);
+    syncingScrollBar = false;
+}
+
+void LargeFileView::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    if (dy != 0 && !syncingScrollBar)
+    {
+        const qint64 target = qMin(qint64(verticalScrollBar()->value()) * table.size() / ScrollRange, table.size());
+        topOffset = table.lineStart(target);
+        const int width = wrapColumns();
+        topColumn = width > 0 ? columnOf(topOffset, target) / width * width : 0;
+    }
+    viewport()->update();
+}
+
+void LargeFileView::scrollLines(int count)
+{
+    const VisualRow top = stepRows({topOffset, topColumn}, count);
+    topOffset = top.line;
+    topColumn = top.column;
+    updateScrollBars();
+    viewport()->update();
+}
+
+void LargeFileView::wheelEvent(QWheelEvent *event)
+{
+    const int steps = event->angleDelta().y() / 40;
+    if (steps != 0)
+        scrollLines(-steps);
+    const int horizontal = event->angleDelta().x() / 40;
+    if (horizontal != 0 && !wrap)
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() - horizontal * 4);
+    event->accept();
+}
+
+void LargeFileView::moveCaret(qint64 pos)
+{
+    caret = qBound<qint64>(0, pos, table.size());
+    ensureCaretVisible();
+    viewport()->update();
+}
+
+// preferredColumn — колонка внутри строки экрана.
+void LargeFileView::moveCaretVertically(int lines)
+{
+    const VisualRow row = visualRowOf(caret);
+    if (preferredColumn < 0)
+        preferredColumn = columnOf(row.line, caret) - row.column;
+    const VisualRow target = stepRows(row, lines);
+    caret = positionAtColumn(target.line, target.column + preferredColumn);
+    ensureCaretVisible();
+    viewport()->update();
+}
+
+void LargeFileView::ensureCaretVisible()
+{
+    const auto before = [](const VisualRow &a, const VisualRow &b)
+    { return a.line < b.line || (a.line == b.line && a.column < b.column); };
+
+    const VisualRow caretRow = visualRowOf(caret);
+    const VisualRow top{topOffset, topColumn};
+    VisualRow newTop = top;
+    if (before(caretRow, top))
+        newTop = caretRow;
+    else if (before(stepRows(top, visibleLineCount() - 1), caretRow))
+        newTop = stepRows(caretRow, -(visibleLineCount() - 1)); // строка с кареткой становится последней видимой
+    topOffset = newTop.line;
+    topColumn = newTop.column;
+
+    if (!wrap)
+    {
+        const int column = columnOf(caretRow.line, caret);
+        const int visible = qMax(1, (viewport()->width() - 8) / charWidth());
+        QScrollBar *bar = horizontalScrollBar();
+        if (column < bar->value())
+        {
+            bar->setValue(qMax(0, column - visible / 4));
+        }
+        else if (column >= bar->value() + visible)
+        {
+            bar->setMaximum(qMax(bar->maximum(), column));
+            bar->setValue(column - visible + visible / 4);
+        }
+    }
+    updateScrollBars();
+    emit caretMoved();
+}
+
+void LargeFileView::insertBytes(const QByteArray &bytes)
+{
+    edit(caret, 0, bytes, true);
+}
+
+void LargeFileView::removeBytes(qint64 pos, qint64 length)
+{
+    if (length > 0)
+        edit(pos, length, QByteArray(), false);
+}
+
+void LargeFileView::replace(qint64 pos, qint64 length, const QByteArray &bytes)
+{
+    pos = qBound<qint64>(0, pos, table.size());
+    length = qBound<qint64>(0, length, table.size() - pos);
+    if (length > 0 || !bytes.isEmpty())
+        edit(pos, length, bytes, false);
+}
+
+void LargeFileView::edit(qint64 pos, qint64 length, const QByteArray &bytes, bool typed)
+{
+    if (cleanStep > undoSteps.size())
+        cleanStep = -1; // сохранённое состояние было среди отменённых шагов
+    if (savingStep > undoSteps.size())
+        savingStep = -1;
+    redoSteps.clear();
+    if (typed && !undoSteps.isEmpty() && undoSteps.last().typed && !bytes.contains('\n')
+        && undoSteps.last().pos + undoSteps.last().inserted.size() == pos)
+    {
+        undoSteps.last().inserted.append(bytes);
+    }
+    else
+    {
+        undoSteps.append({pos, table.read(pos, length), bytes, typed && !bytes.contains('\n')});
+        if (undoSteps.size() > MaxUndoSteps)
+        {
+            undoSteps.removeFirst();
+            cleanStep = cleanStep > 0 ? cleanStep - 1 : -1;
+            savingStep = savingStep > 0 ? savingStep - 1 : -1;
+        }
+    }
+    applyEdit(pos, length, bytes);
+    setModified(true);
+}
+
+void LargeFileView::undo()
+{
+    if (undoSteps.isEmpty())
+        return;
+    const UndoStep step = undoSteps.takeLast();
+    applyEdit(step.pos, step.inserted.size(), step.removed);
+    redoSteps.append(step);
+    setModified(int(undoSteps.size()) != cleanStep);
+}
+
+void LargeFileView::redo()
+{
+    if (redoSteps.isEmpty())
+        return;
+    UndoStep step = redoSteps.takeLast();
+    step.typed = false;
+    applyEdit(step.pos, step.removed.size(), step.inserted);
+    undoSteps.append(step);
+    setModified(int(undoSteps.size()) != cleanStep);
+}
+
+void LargeFileView::clearHistory()
+{
+    undoSteps.clear();
+    redoSteps.clear();
+    cleanStep = 0;
+    searchMatches.clear();
+    currentMatch = -1;
+}
+
+// Замена [pos, pos + length) на bytes без записи в историю.
+void LargeFileView::applyEdit(qint64 pos, qint64 length, const QByteArray &bytes)
+{
+    table.remove(pos, length);
+    table.insert(pos, bytes);
+    indexEdit(pos, length, bytes);
+    invalidateSegments(pos);
+    caret = pos + bytes.size();
+    if (topOffset > pos)
+    {
+        // Верх экрана мог попасть в середину заменённого отрезка.
+        topOffset = table.lineStart(qMin(topOffset, table.size()));
+        topColumn = 0;
+    }
+    preferredColumn = -1;
+    ++textRevision;
+    searchMatches.clear();
+    currentMatch = -1;
+    ensureCaretVisible();
+    viewport()->update();
+    emit textChanged();
+}
+
+void LargeFileView::keyPressEvent(QKeyEvent *event)
+{
+    const bool control = event->modifiers() & Qt::ControlModifier;
+    switch (event->key())
+    {
+    case Qt::Key_Left:
+        preferredColumn = -1;
+        moveCaret(previousChar(caret));
+        return;
+    case Qt::Key_Right:
+        preferredColumn = -1;
+        moveCaret(nextChar(caret));
+        return;
+    case Qt::Key_Up:
+        moveCaretVertically(-1);
+        return;
+    case Qt::Key_Down:
+        moveCaretVertically(1);
+        return;
+    case Qt::Key_PageUp:
+        scrollLines(-visibleLineCount());
+        moveCaretVertically(-visibleLineCount());
+        return;
+    case Qt::Key_PageDown:
+        scrollLines(visibleLineCount());
+        moveCaretVertically(visibleLineCount());
+        return;
+    case Qt::Key_Home:
+        preferredColumn = -1;
+        moveCaret(control ? 0 : table.lineStart(caret));
+        return;
+    case Qt::Key_End:
+    {
+        preferredColumn = -1;
+        const qint64 next = table.nextLineStart(caret);
+        qint64 end = next < 0 ? table.size() : next - 1;
+        if (end > 0 && next >= 0 && table.at(end - 1) == '\r')
+            --end;
+        moveCaret(control ? table.size() : end);
+        return;
+    }
+    case Qt::Key_Backspace:
+        removeBytes(previousChar(caret), caret - previousChar(caret));
+        return;
+    case Qt::Key_Delete:
+        removeBytes(caret, nextChar(caret) - caret);
+        return;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        insertBytes("\n");
+        return;
+    default:
+        break;
+    }
+
+    if (control && event->key() == Qt::Key_Z)
+    {
+        if (event->modifiers() & Qt::ShiftModifier)
+            redo();
+        else
+            undo();
+        return;
+    }
+    if (control && event->key() == Qt::Key_Y)
+    {
+        redo();
+        return;
+    }
+    if (!control && !event->text().isEmpty() && event->text().at(0).isPrint())
+    {
+        insertBytes(event->text().toUtf8());
+        return;
+    }
+    if (event->key() == Qt::Key_Tab)
+    {
+        insertBytes("\t");
+        return;
+    }
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void LargeFileView::mousePressEvent(QMouseEvent *event)
+{
+    setFocus();
+    const int row = int(event->position().y()) / fontMetrics().height();
+    if (row < 0 || row >= visibleRows.size())
+        return;
+    const int width = charWidth();
+    const VisualRow &visual = visibleRows[row];
+    int column = qMax(0, (int(event->position().x()) - 4 + width / 2) / width);
+    if (const int wrapWidth = wrapColumns())
+        column = visual.column + qMin(column, wrapWidth);
+    else
+        column += horizontalScrollBar()->value();
+    preferredColumn = -1;
+    caret = positionAtColumn(visual.line, column);
+    viewport()->update();
+    emit caretMoved();
+}
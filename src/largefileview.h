@@ -0,0 +1,216 @@
+#ifndef LARGEFILEVIEW_H
+#define LARGEFILEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QHash>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include "documentsearcher.h"
+#include "lexer.h"
+#include "lineindex.h"
+#include "piecetable.h"
+
+class QPainter;
+class QThread;
+
+// Виртуализированный просмотр и правка больших файлов. Текст лежит в
+// PieceTable поверх отображённого файла, раскладываются только видимые
+// строки. Вертикальная прокрутка идёт по байтовым смещениям, поэтому
+// открытие не требует подсчёта строк и занимает постоянное время.
+//
+// Длинные строки (минифицированный JS, JSON в одну строку) читаются и
+// подсвечиваются кусками: для строки по мере надобности строится список
+// опорных точек через SegmentBytes байт с колонкой каждой из них, и на
+// экран попадает только видимое окно колонок. Перенос строк использует
+// те же точки и тоже не просматривает строку дальше, чем нужно. В точках
+// по запросу запоминается и состояние лексера, так что кусок строки
+// подсвечивается с верным состоянием: внутри строкового литерала или
+// /* */. Состояние в начале строки берётся из предыдущих строк, но не
+// дальше StateLookbackBytes назад.
+//
+// Номера строк даёт LineIndex. Он строится в рабочем потоке после
+// открытия; правки, сделанные до его готовности, копятся и применяются
+// к нему по приходе.
+//
+// Каждая правка запоминает вытесненные байты, так что отмена и повтор
+// (Ctrl+Z, Ctrl+Y) — это обратная правка. Набор подряд — один шаг.
+class LargeFileView : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    // Обычный файл со строкой длиннее порога (в байтах) тоже открывается
+    // здесь: QTextEdit раскладывает и подсвечивает строку целиком.
+    static constexpr qint64 DefaultLongLineThreshold = 32 * 1024;
+    static bool hasLongLine(const QString &fileName, qint64 threshold);
+
+    explicit LargeFileView(QWidget *parent = nullptr);
+    ~LargeFileView() override;
+
+    bool openFile(const QString &fileName);
+    void clear();
+
+    // Копия таблицы делит буферы с оригиналом и стоит O(число фрагментов).
+    PieceTable snapshot() const { return table; }
+
+    // Сохранение: beginSave() даёт снимок для FileSaver, releaseFile()
+    // отпускает отображённый файл перед его заменой, finishSave() —
+    // по итогу записи. После успеха таблица ссылается на новый файл.
+    // finishSave() возвращает false, если файл не удалось отобразить
+    // снова: тогда он открыт заново, а правки во время сохранения потеряны.
+    PieceTable beginSave(const QString &fileName);
+    void releaseFile(const QString &fileName);
+    bool finishSave(const QString &fileName, bool ok);
+
+    QString fileName() const { return currentFile; }
+    bool isModified() const { return modified; }
+    void setModified(bool value);
+
+    bool wordWrap() const { return wrap; }
+    void setWordWrap(bool enabled);
+
+    // Строки и колонки считаются с единицы. Пока индекс строится,
+    // caretLine() возвращает 0, а goToLine() переходит по готовности.
+    bool hasLineIndex() const { return lines.isValid(); }
+    qint64 lineCount() const { return lines.lineCount(); }
+    void goToLine(qint64 line);
+    qint64 caretLine() const;
+    int caretColumn() const;
+    qint64 caretOffset() const { return caret; }
+    void setCaretOffset(qint64 pos);
+
+    // Замена [pos, pos + length) одной правкой (и одним шагом отмены).
+    void replace(qint64 pos, qint64 length, const QByteArray &bytes);
+    void undo();
+    void redo();
+    quint64 revision() const { return textRevision; } // растёт с каждой правкой
+
+    // Подсвечиваются только совпадения на экране; current — выбранное.
+    // Копия вектора разделяет данные, правка документа сбрасывает подсветку.
+    void setSearchMatches(const QVector<DocumentSearcher::Match> &matches, int current);
+
+signals:
+    void modificationChanged(bool modified);
+    void textChanged();
+    void releasingFile(); // копии snapshot() нужно отпустить
+    void caretMoved();
+    void lineIndexReady(bool utf8);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    static constexpr int ScrollRange = 1 << 20;
+    static constexpr qint64 SegmentBytes = 1024;
+    static constexpr qint64 StateLookbackBytes = 64 * 1024;
+    static constexpr int MaxCachedLines = 512;
+    static constexpr int MaxUndoSteps = 1000;
+
+    // Опорные точки строки: offsets[i] — начало символа, columns[i] — его
+    // колонка. Последняя точка продвигается только по запросу.
+    struct Segments {
+        QVector<qint64> offsets;
+        QVector<int> columns;
+        QVector<LexerState> states; // для первых точек; пусто — начало строки не известно
+        qint64 end = 0;        // конец текста строки (без \r\n)
+        int totalColumns = -1; // известно, когда строка просмотрена до конца
+    };
+
+    // Строка экрана: логическая строка и первая колонка (с переносом
+    // длинная строка занимает несколько строк экрана).
+    struct VisualRow {
+        qint64 line = 0;
+        int column = 0;
+    };
+
+    struct PendingEdit {
+        qint64 pos;
+        qint64 removed;
+        QByteArray inserted;
+        quint64 revision; // textRevision до правки
+    };
+
+    struct UndoStep {
+        qint64 pos;
+        QByteArray removed;
+        QByteArray inserted;
+        bool typed; // к шагу можно дописать следующий набранный символ
+    };
+
+    Segments &segments(qint64 lineStart) const;
+    void extendSegments(Segments &line, int untilColumn, qint64 untilPos) const;
+    qint64 segmentEnd(qint64 from, qint64 end) const;
+    void extendStates(Segments &line, int index) const;
+    LexerState lineStartState(qint64 lineStart) const;
+    LexerState lineEndState(qint64 lineStart, const LexerState &state) const;
+    LexerState stateAtColumn(qint64 lineStart, int column) const;
+    void invalidateSegments(qint64 pos);
+    qint64 contentEnd(qint64 lineStart) const;
+    QString lineSlice(qint64 lineStart, int fromColumn, int columnCount, int *sliceColumn, bool *reachesEnd) const;
+    int lineColumns(qint64 lineStart) const;
+    bool hasColumn(qint64 lineStart, int column) const;
+    int columnOf(qint64 lineStart, qint64 pos) const;
+    qint64 positionAtColumn(qint64 lineStart, int column) const;
+    qint64 previousChar(qint64 pos) const;
+    qint64 nextChar(qint64 pos) const;
+
+    int wrapColumns() const;
+    VisualRow visualRowOf(qint64 pos) const;
+    VisualRow stepRows(VisualRow row, int count) const;
+    void scrollLines(int count);
+    void moveCaret(qint64 pos);
+    void moveCaretVertically(int lines);
+    void ensureCaretVisible();
+    void updateScrollBars();
+    void insertBytes(const QByteArray &bytes);
+    void removeBytes(qint64 pos, qint64 length);
+    void edit(qint64 pos, qint64 length, const QByteArray &bytes, bool typed);
+    void applyEdit(qint64 pos, qint64 length, const QByteArray &bytes);
+    void clearHistory();
+    void paintMatches(QPainter &painter, qint64 lineStart, int fromColumn, int columnCount, int y) const;
+    int visibleLineCount() const;
+    int charWidth() const;
+
+    void startIndexing(const QString &fileName);
+    void stopIndexing();
+    void finishIndexing(LineIndex index);
+    void indexEdit(qint64 pos, qint64 removed, const QByteArray &inserted);
+
+    PieceTable table;
+    QString currentFile;
+    qint64 topOffset = 0;
+    int topColumn = 0; // с переносом — первая колонка верхней строки экрана
+    qint64 caret = 0;
+    int preferredColumn = -1;
+    int widestLine = 0;
+    bool modified = false;
+    bool wrap = false;
+    bool syncingScrollBar = false;
+    QVector<VisualRow> visibleRows;
+    QVector<UndoStep> undoSteps;
+    QVector<UndoStep> redoSteps;
+    int cleanStep = 0; // undoSteps.size() в сохранённом состоянии, -1 — недостижимо
+    quint64 textRevision = 0;
+    QString savingFile;   // сохранение, которое ещё не закончилось
+    PieceTable savingTable;
+    int savingStep = 0;   // как cleanStep, для savingTable
+    quint64 savingRevision = 0;
+    bool reindexAfterSave = false;
+    QVector<DocumentSearcher::Match> searchMatches;
+    int currentMatch = -1;
+    mutable QHash<qint64, Segments> segmentCache; // по началу строки
+
+    LineIndex lines;
+    QThread *indexer = nullptr;
+    std::shared_ptr<std::atomic<bool>> indexCancelled;
+    quint64 indexGeneration = 0;
+    QVector<PendingEdit> pendingEdits; // пока индекс строится
+    qint64 pendingLine = 0;
+};
+
+#endif // LARGEFILEVIEW_H
@@ -0,0 +1,281 @@
+#include "latencytracer.h"
+#include <QAbstractScrollArea>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QKeySequence>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextDocument>
+#include <QVector>
+#include <QWidget>
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+constexpr int Capacity = 1 << 15; // событий в кольцевом буфере
+constexpr qint64 KeyTimeoutNs = 1000000000; // нажатие без отрисовки дольше — не считается
+
+// Гистограмма в стиле HDR: 32 линейные корзины на каждую степень двойки,
+// значения в микросекундах до 2^36 (почти 20 часов).
+constexpr int SubBucketBits = 5;
+constexpr int SubBuckets = 1 << SubBucketBits;
+constexpr int MaxShift = 36 - SubBucketBits;
+constexpr int BucketCount = (MaxShift + 2) * SubBuckets;
+
+const char *const KindNames[LatencyTracer::KindCount] = {"key", "highlightBlock", "layout", "paint", "key → paint"};
+
+struct Event {
+    qint64 start;
+    qint64 end;
+    int arg;
+    LatencyTracer::Kind kind;
+};
+
+struct TracerState {
+    QElapsedTimer timer;
+    QVector<Event> events;
+    int next = 0;
+    bool wrapped = false;
+    QSet<const QObject *> watched;
+    qint64 pendingKey = -1;
+    qint64 layoutStart = -1;
+    quint64 counts[BucketCount] = {};
+    quint64 total = 0;
+    qint64 maxUs = 0;
+
+    TracerState()
+    {
+        timer.start();
+        events.resize(Capacity);
+    }
+};
+
+TracerState &state()
+{
+    static TracerState tracer;
+    return tracer;
+}
+
+int bucketOf(qint64 us)
+{
+    if (us < SubBuckets)
+        return int(qMax(qint64(0), us));
+    const int shift = qMin(int(std::bit_width(quint64(us))) - SubBucketBits - 1, MaxShift);
+    return qMin((shift + 1) * SubBuckets + int((us >> shift) - SubBuckets), BucketCount - 1);
+}
+
+// Наибольшее значение, попадающее в корзину.
+qint64 valueOf(int bucket)
+{
+    if (bucket < SubBuckets)
+        return bucket;
+    const int shift = bucket / SubBuckets - 1;
+    return ((qint64(bucket % SubBuckets + SubBuckets) + 1) << shift) - 1;
+}
+
+qint64 percentile(const TracerState &tracer, double fraction)
+{
+    const quint64 target = qMax(quint64(1), quint64(fraction * tracer.total + 0.5));
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount; ++bucket)
+    {
+        seen += tracer.counts[bucket];
+        if (seen >= target)
+            return qMin(valueOf(bucket), tracer.maxUs);
+    }
+    return tracer.maxUs;
+}
+
+bool isModifier(int key)
+{
+    switch (key)
+    {
+    case Qt::Key_Shift:
+    case Qt::Key_Control:
+    case Qt::Key_Alt:
+    case Qt::Key_AltGr:
+    case Qt::Key_Meta:
+    case Qt::Key_CapsLock:
+    case Qt::Key_NumLock:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+qint64 LatencyTracer::now()
+{
+    return state().timer.nsecsElapsed();
+}
+
+void LatencyTracer::record(Kind kind, qint64 start, qint64 end, int arg)
+{
+    TracerState &tracer = state();
+    tracer.events[tracer.next] = Event{start, end, arg, kind};
+    if (++tracer.next == Capacity)
+    {
+        tracer.next = 0;
+        tracer.wrapped = true;
+    }
+    // Раскладка начинается после подсветки изменённых блоков.
+    if (kind == Highlight && tracer.layoutStart >= 0)
+        tracer.layoutStart = end;
+}
+
+void LatencyTracer::watch(QWidget *widget)
+{
+    state().watched.insert(widget);
+    QObject::connect(widget, &QObject::destroyed, [](QObject *object)
+                     { state().watched.remove(object); });
+    if (QAbstractScrollArea *area = qobject_cast<QAbstractScrollArea *>(widget))
+        watch(area->viewport());
+}
+
+bool LatencyTracer::isWatched(const QObject *object)
+{
+    return state().watched.contains(object);
+}
+
+void LatencyTracer::watch(QTextDocument *document)
+{
+    QObject::connect(document, &QTextDocument::contentsChange, document, []
+                     { state().layoutStart = now(); });
+    QObject::connect(document, &QTextDocument::contentsChanged, document, []
+                     {
+                         TracerState &tracer = state();
+                         if (tracer.layoutStart < 0)
+                             return;
+                         record(Layout, tracer.layoutStart, now());
+                         tracer.layoutStart = -1; });
+}
+
+void LatencyTracer::keyPressed(int key, qint64 time)
+{
+    TracerState &tracer = state();
+    if (!isModifier(key) && tracer.pendingKey < 0)
+        tracer.pendingKey = time;
+}
+
+void LatencyTracer::painted(qint64 start, qint64 end)
+{
+    record(Paint, start, end);
+    TracerState &tracer = state();
+    if (tracer.pendingKey < 0)
+        return;
+    const qint64 latency = end - tracer.pendingKey;
+    if (latency <= KeyTimeoutNs)
+    {
+        const qint64 us = latency / 1000;
+        ++tracer.counts[bucketOf(us)];
+        ++tracer.total;
+        tracer.maxUs = qMax(tracer.maxUs, us);
+        record(KeyToPaint, tracer.pendingKey, end);
+    }
+    tracer.pendingKey = -1;
+}
+
+LatencyTracer::Summary LatencyTracer::summary()
+{
+    const TracerState &tracer = state();
+    Summary result;
+    result.count = tracer.total;
+    if (tracer.total == 0)
+        return result;
+    result.p50Us = percentile(tracer, 0.50);
+    result.p99Us = percentile(tracer, 0.99);
+    result.maxUs = tracer.maxUs;
+    return result;
+}
+
+void LatencyTracer::resetHistogram()
+{
+    TracerState &tracer = state();
+    std::fill(std::begin(tracer.counts), std::end(tracer.counts), 0);
+    tracer.total = 0;
+    tracer.maxUs = 0;
+}
+
+// Формат Trace Event: события "X" с началом и длительностью в мкс.
+// Задержка «клавиша → экран» перекрывает остальные события, поэтому
+// лежит на отдельной дорожке.
+bool LatencyTracer::writeChromeTrace(const QString &fileName, int seconds, QString *error)
+{
+    const TracerState &tracer = state();
+    const qint64 from = now() - qint64(seconds) * 1000000000;
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray events;
+    const auto threadName = [&events, pid](int tid, const char *name)
+    {
+        events.append(QJsonObject{{"name", "thread_name"}, {"ph", "M"}, {"pid", pid}, {"tid", tid},
+                                  {"args", QJsonObject{{"name", name}}}});
+    };
+    threadName(1, "GUI");
+    threadName(2, "key → paint");
+
+    const int count = tracer.wrapped ? Capacity : tracer.next;
+    const int first = tracer.wrapped ? tracer.next : 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const Event &event = tracer.events[(first + i) % Capacity];
+        if (event.start < from)
+            continue;
+        QJsonObject object{{"name", KindNames[event.kind]},
+                           {"cat", "editor"},
+                           {"ph", "X"},
+                           {"ts", event.start / 1000.0},
+                           {"dur", (event.end - event.start) / 1000.0},
+                           {"pid", pid},
+                           {"tid", event.kind == KeyToPaint ? 2 : 1}};
+        if (event.kind == Key)
+            object.insert("args", QJsonObject{{"key", QKeySequence(event.arg).toString()}});
+        else if (event.kind == Highlight)
+            object.insert("args", QJsonObject{{"block", event.arg}});
+        events.append(object);
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    const QJsonObject root{{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit())
+    {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TracingApplication::notify(QObject *receiver, QEvent *event)
+{
+    const QEvent::Type type = event->type();
+    if ((type != QEvent::KeyPress && type != QEvent::Paint) || !LatencyTracer::isWatched(receiver))
+        return QApplication::notify(receiver, event);
+
+    const qint64 start = LatencyTracer::now();
+    if (type == QEvent::Paint)
+    {
+        const bool result = QApplication::notify(receiver, event);
+        LatencyTracer::painted(start, LatencyTracer::now());
+        return result;
+    }
+    // Отрисовка может случиться и внутри обработки нажатия (repaint()),
+    // поэтому нажатие отмечается до доставки.
+    const int key = static_cast<QKeyEvent *>(event)->key();
+    LatencyTracer::keyPressed(key, start);
+    const bool result = QApplication::notify(receiver, event);
+    LatencyTracer::record(LatencyTracer::Key, start, LatencyTracer::now(), key);
+    return result;
+}
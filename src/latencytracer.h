@@ -0,0 +1,72 @@
+#ifndef LATENCYTRACER_H
+#define LATENCYTRACER_H
+
+#include <QApplication>
+#include <QString>
+
+class QTextDocument;
+class QWidget;
+
+// Замер задержки от нажатия клавиши до отрисовки. Нажатия и отрисовка
+// отслеживаемых виджетов, подсветка блоков и раскладка документа пишутся
+// в кольцевой буфер событий, задержка «клавиша → экран» — в гистограмму
+// с логарифмическими корзинами (погрешность ~3%). Последние секунды
+// буфера выгружаются в формате Chrome trace (chrome://tracing, Perfetto).
+class LatencyTracer {
+public:
+    enum Kind : quint8 {
+        Key,
+        Highlight,
+        Layout,
+        Paint,
+        KeyToPaint,
+        KindCount
+    };
+
+    struct Summary {
+        quint64 count = 0;
+        qint64 p50Us = 0;
+        qint64 p99Us = 0;
+        qint64 maxUs = 0;
+    };
+
+    // Отрезок от создания до разрушения объекта.
+    class Scope {
+    public:
+        explicit Scope(Kind kind, int arg = 0) : kind(kind), arg(arg), start(now()) {}
+        ~Scope() { LatencyTracer::record(kind, start, now(), arg); }
+
+    private:
+        Kind kind;
+        int arg;
+        qint64 start;
+    };
+
+    static qint64 now(); // нс от запуска
+    static void record(Kind kind, qint64 start, qint64 end, int arg = 0);
+
+    // Нажатия, пришедшие виджету, и его отрисовка (для QAbstractScrollArea —
+    // сам виджет и его viewport).
+    static void watch(QWidget *widget);
+    static bool isWatched(const QObject *object);
+    // Раскладка — от изменения текста (и подсветки) до contentsChanged.
+    static void watch(QTextDocument *document);
+
+    static void keyPressed(int key, qint64 time);
+    static void painted(qint64 start, qint64 end);
+
+    static Summary summary();
+    static void resetHistogram();
+    static bool writeChromeTrace(const QString &fileName, int seconds, QString *error = nullptr);
+};
+
+// QApplication, который замеряет доставку нажатий и отрисовки
+// отслеживаемым виджетам (обработчик целиком, с фильтрами событий).
+class TracingApplication : public QApplication {
+public:
+    using QApplication::QApplication;
+
+    bool notify(QObject *receiver, QEvent *event) override;
+};
+
+#endif // LATENCYTRACER_H
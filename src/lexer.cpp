@@ -0,0 +1,252 @@
+#include "lexer.h"
+
+namespace {
+
+inline bool isWordChar(QChar c)
+{
+    const char16_t u = c.unicode();
+    if (u < 0x80)
+        return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_';
+    return c.isLetterOrNumber();
+}
+
+inline bool isDigit(QChar c)
+{
+    return c.unicode() >= '0' && c.unicode() <= '9';
+}
+
+bool isRawStringPrefix(QStringView word)
+{
+    return word == QLatin1String("R") || word == QLatin1String("u8R") || word == QLatin1String("LR")
+        || word == QLatin1String("uR") || word == QLatin1String("UR");
+}
+
+// Ищет closing, начиная с позиции from. Возвращает позицию сразу за ним
+// или -1, если строка закончилась раньше. escapedNewline сообщает, что
+// последним символом строки был экранирующий '\'.
+int scanUntil(const QChar *data, int n, int from, const QString &closing, bool escapes, bool *escapedNewline)
+{
+    const QChar first = closing.at(0);
+    const int closingLength = closing.size();
+    int i = from;
+    while (i < n)
+    {
+        const QChar c = data[i];
+        if (escapes && c == '\\')
+        {
+            if (i + 1 == n && escapedNewline)
+                *escapedNewline = true;
+            i += 2;
+            continue;
+        }
+        if (c == first && n - i >= closingLength && QStringView(data + i, closingLength) == closing)
+            return i + closingLength;
+        ++i;
+    }
+    return -1;
+}
+
+} // namespace
+
+Lexer::Lexer(const QStringList &keywords)
+{
+    nodes.append({0, false, -1, -1}); // корень
+    for (const QString &keyword : keywords)
+        addKeyword(keyword);
+}
+
+const Lexer &Lexer::defaultLexer()
+{
+    static const Lexer lexer(defaultKeywords());
+    return lexer;
+}
+
+QStringList Lexer::defaultKeywords()
+{
+    return {
+        "int", "float", "if", "else", "while", "return", "class",
+        "import", "start", "Class", "print", "give", "function",
+        "Method", "connect", "from", "Path", "OSS", "protocol", "ip",
+        "port", "http", "https", "DNS", "ip-v4", "ip-v6", "break",
+        "open", "close", "mkadir", "rmdir", "delete", "rename",
+        "void", "stdout", "stderr", "list", "lib", "create",
+        "std", "vg", "trs", "exit", "return", "else if"};
+}
+
+void Lexer::addKeyword(const QString &keyword)
+{
+    int node = 0;
+    for (QChar c : keyword)
+    {
+        int child = findChild(node, c.unicode());
+        if (child < 0)
+        {
+            child = nodes.size();
+            nodes.append({c.unicode(), false, -1, nodes[node].firstChild});
+            nodes[node].firstChild = child;
+        }
+        node = child;
+    }
+    nodes[node].terminal = true;
+}
+
+int Lexer::findChild(int node, char16_t ch) const
+{
+    for (int child = nodes[node].firstChild; child >= 0; child = nodes[child].nextSibling)
+    {
+        if (nodes[child].ch == ch)
+            return child;
+    }
+    return -1;
+}
+
+// Возвращает длину самого длинного ключевого слова, которое начинается
+// в text и заканчивается на границе слова, либо 0.
+int Lexer::matchKeyword(const QChar *text, int length) const
+{
+    int node = 0;
+    int matched = 0;
+    for (int i = 0; i < length; ++i)
+    {
+        node = findChild(node, text[i].unicode());
+        if (node < 0)
+            break;
+        if (nodes[node].terminal && (i + 1 == length || !isWordChar(text[i + 1])))
+            matched = i + 1;
+    }
+    return matched;
+}
+
+bool Lexer::isKeyword(const QString &word) const
+{
+    return !word.isEmpty() && matchKeyword(word.constData(), word.size()) == word.size();
+}
+
+LexerState Lexer::tokenize(const QString &text, QVector<Token> &tokens, const LexerState &state) const
+{
+    tokens.clear();
+    const QChar *data = text.constData();
+    const int n = text.size();
+    int i = 0;
+
+    // Продолжение конструкции, начатой в предыдущих строках.
+    if (state.kind != LexerState::Normal)
+    {
+        const TokenKind kind = state.kind == LexerState::InComment ? TokenKind::Comment : TokenKind::String;
+        bool escapedNewline = false;
+        const int end = scanUntil(data, n, 0, state.closing, state.kind == LexerState::InString, &escapedNewline);
+        if (end < 0)
+        {
+            if (n > 0)
+                tokens.append({0, n, kind});
+            if (state.kind == LexerState::InString && state.closing.size() == 1 && !escapedNewline)
+                return LexerState();
+            return state;
+        }
+        if (end > 0)
+            tokens.append({0, end, kind});
+        i = end;
+    }
+
+    while (i < n)
+    {
+        const QChar c = data[i];
+        const int start = i;
+
+        if (c == '/' && i + 1 < n && data[i + 1] == '/')
+        {
+            tokens.append({start, n - start, TokenKind::Comment});
+            break;
+        }
+
+        if (c == '/' && i + 1 < n && data[i + 1] == '*')
+        {
+            const QString closing = QStringLiteral("*/");
+            const int end = scanUntil(data, n, i + 2, closing, false, nullptr);
+            if (end < 0)
+            {
+                tokens.append({start, n - start, TokenKind::Comment});
+                return {LexerState::InComment, closing};
+            }
+            tokens.append({start, end - start, TokenKind::Comment});
+            i = end;
+            continue;
+        }
+
+        if (c == '"' || c == '\'')
+        {
+            const bool triple = i + 2 < n && data[i + 1] == c && data[i + 2] == c;
+            const QString closing = triple ? QString(3, c) : QString(c);
+            bool escapedNewline = false;
+            const int end = scanUntil(data, n, i + closing.size(), closing, true, &escapedNewline);
+            if (end < 0)
+            {
+                tokens.append({start, n - start, TokenKind::String});
+                if (triple || escapedNewline)
+                    return {LexerState::InString, closing};
+                return LexerState();
+            }
+            tokens.append({start, end - start, TokenKind::String});
+            i = end;
+            continue;
+        }
+
+        if (isDigit(c) || (c == '.' && i + 1 < n && isDigit(data[i + 1])))
+        {
+            ++i;
+            while (i < n)
+            {
+                const QChar d = data[i];
+                if (isWordChar(d) || d == '.' || d == '\'')
+                    ++i;
+                else if ((d == '+' || d == '-') && (data[i - 1] == 'e' || data[i - 1] == 'E'
+                                                    || data[i - 1] == 'p' || data[i - 1] == 'P'))
+                    ++i;
+                else
+                    break;
+            }
+            tokens.append({start, i - start, TokenKind::Number});
+            continue;
+        }
+
+        if (isWordChar(c))
+        {
+            const int keywordLength = matchKeyword(data + i, n - i);
+            if (keywordLength > 0)
+            {
+                i += keywordLength;
+                tokens.append({start, keywordLength, TokenKind::Keyword});
+                continue;
+            }
+            while (i < n && isWordChar(data[i]))
+                ++i;
+
+            if (i < n && data[i] == '"' && isRawStringPrefix(QStringView(data + start, i - start)))
+            {
+                // R"delim( ... )delim" — внутри нет экранирования.
+                int open = i + 1;
+                while (open < n && open - i <= 17 && data[open] != '(' && data[open] != ' '
+                       && data[open] != '\\' && data[open] != ')')
+                    ++open;
+                if (open < n && data[open] == '(')
+                {
+                    const QString closing = QLatin1Char(')') + QString(data + i + 1, open - i - 1) + QLatin1Char('"');
+                    const int end = scanUntil(data, n, open + 1, closing, false, nullptr);
+                    if (end < 0)
+                    {
+                        tokens.append({start, n - start, TokenKind::String});
+                        return {LexerState::InRawString, closing};
+                    }
+                    tokens.append({start, end - start, TokenKind::String});
+                    i = end;
+                    continue;
+                }
+            }
+            tokens.append({start, i - start, TokenKind::Identifier});
+            continue;
+        }
+
+        ++i;
+    }
+    return LexerState();
+}
@@ -0,0 +1,67 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+enum class TokenKind : quint8 {
+    Text,
+    Keyword,
+    Identifier,
+    Number,
+    String,
+    Comment,
+    Count
+};
+
+struct Token {
+    int start;
+    int length;
+    TokenKind kind;
+};
+
+// Состояние лексера на границе строк: внутри /* */, внутри многострочной
+// строки (тройные кавычки или продолжение через \) или raw-строки R"d(...)d".
+struct LexerState {
+    enum Kind : quint8 { Normal, InComment, InString, InRawString };
+
+    Kind kind = Normal;
+    QString closing; // последовательность, которая закрывает комментарий или строку
+
+    bool operator==(const LexerState &other) const
+    {
+        return kind == other.kind && closing == other.closing;
+    }
+    bool operator!=(const LexerState &other) const { return !(*this == other); }
+};
+
+// Однопроходный лексер: строится один раз на язык, ключевые слова
+// хранятся в плоском префиксном дереве, строка разбирается за один проход.
+class Lexer {
+public:
+    explicit Lexer(const QStringList &keywords);
+
+    static const Lexer &defaultLexer();
+    static QStringList defaultKeywords();
+
+    LexerState tokenize(const QString &text, QVector<Token> &tokens,
+                        const LexerState &state = LexerState()) const;
+    bool isKeyword(const QString &word) const;
+
+private:
+    struct TrieNode {
+        char16_t ch;
+        bool terminal;
+        int firstChild;
+        int nextSibling;
+    };
+
+    void addKeyword(const QString &keyword);
+    int matchKeyword(const QChar *text, int length) const;
+    int findChild(int node, char16_t ch) const;
+
+    QVector<TrieNode> nodes;
+};
+
+#endif // LEXER_H
@@ -0,0 +1,179 @@
+#include "linediff.h"
+#include <QHash>
+#include <vector>
+
+namespace {
+
+// Разница последовательностей номеров строк. Участки сравниваются в
+// координатах [lo, hi) обеих последовательностей, найденные фрагменты
+// добавляются по порядку и сливаются, если идут вплотную.
+class Differ {
+public:
+    Differ(const QVector<int> &a, const QVector<int> &b, QVector<LineDiff::Hunk> *hunks)
+        : a(a.constData()), b(b.constData()), hunks(hunks)
+    {
+    }
+
+    void run(int aLo, int aHi, int bLo, int bHi)
+    {
+        while (aLo < aHi && bLo < bHi && a[aLo] == b[bLo])
+        {
+            ++aLo;
+            ++bLo;
+        }
+        while (aLo < aHi && bLo < bHi && a[aHi - 1] == b[bHi - 1])
+        {
+            --aHi;
+            --bHi;
+        }
+        if (aLo == aHi || bLo == bHi)
+        {
+            if (aLo < aHi || bLo < bHi)
+                add(aLo, aHi - aLo, bLo, bHi - bLo);
+            return;
+        }
+
+        int x = 0;
+        int y = 0;
+        int u = 0;
+        int v = 0;
+        if (!middleSnake(aLo, aHi, bLo, bHi, &x, &y, &u, &v))
+        {
+            add(aLo, aHi - aLo, bLo, bHi - bLo);
+            return;
+        }
+        // Каждая половина стоит не больше половины правок участка.
+        run(aLo, x, bLo, y);
+        run(u, aHi, v, bHi);
+    }
+
+private:
+    // Проход навстречу: вперёд от начала участка и назад от конца, по d
+    // правок за шаг. Змейка, на которой пути встретились, лежит на
+    // кратчайшем пути; (x, y)–(u, v) — её начало и конец.
+    bool middleSnake(int aLo, int aHi, int bLo, int bHi, int *x1, int *y1, int *x2, int *y2)
+    {
+        const int n = aHi - aLo;
+        const int m = bHi - bLo;
+        const int delta = n - m;
+        const bool odd = delta & 1;
+        const int maxD = qMin((n + m + 1) / 2, LineDiff::MaxCost);
+        const int offset = maxD + 1;
+        forward.assign(size_t(2 * maxD + 3), 0);
+        backward.assign(size_t(2 * maxD + 3), 0);
+
+        for (int d = 0; d <= maxD; ++d)
+        {
+            for (int k = -d; k <= d; k += 2)
+            {
+                int x = (k == -d || (k != d && forward[offset + k - 1] < forward[offset + k + 1]))
+                            ? forward[offset + k + 1]
+                            : forward[offset + k - 1] + 1;
+                int y = x - k;
+                const int x0 = x;
+                const int y0 = y;
+                while (x < n && y < m && a[aLo + x] == b[bLo + y])
+                {
+                    ++x;
+                    ++y;
+                }
+                forward[offset + k] = x;
+                const int c = delta - k;
+                if (odd && x <= n && y <= m && c >= -(d - 1) && c <= d - 1 && x + backward[offset + c] >= n)
+                {
+                    *x1 = aLo + x0;
+                    *y1 = bLo + y0;
+                    *x2 = aLo + x;
+                    *y2 = bLo + y;
+                    return true;
+                }
+            }
+            for (int c = -d; c <= d; c += 2)
+            {
+                int x = (c == -d || (c != d && backward[offset + c - 1] < backward[offset + c + 1]))
+                            ? backward[offset + c + 1]
+                            : backward[offset + c - 1] + 1;
+                int y = x - c;
+                const int x0 = x;
+                const int y0 = y;
+                while (x < n && y < m && a[aHi - 1 - x] == b[bHi - 1 - y])
+                {
+                    ++x;
+                    ++y;
+                }
+                backward[offset + c] = x;
+                const int k = delta - c;
+                if (!odd && x <= n && y <= m && k >= -d && k <= d && x + forward[offset + k] >= n)
+                {
+                    *x1 = aHi - x;
+                    *y1 = bHi - y;
+                    *x2 = aHi - x0;
+                    *y2 = bHi - y0;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void add(int oldStart, int oldCount, int newStart, int newCount)
+    {
+        if (!hunks->isEmpty())
+        {
+            LineDiff::Hunk &last = hunks->last();
+            if (last.oldStart + last.oldCount == oldStart && last.newStart + last.newCount == newStart)
+            {
+                last.oldCount += oldCount;
+                last.newCount += newCount;
+                return;
+            }
+        }
+        hunks->append({oldStart, oldCount, newStart, newCount});
+    }
+
+    const int *a;
+    const int *b;
+    QVector<LineDiff::Hunk> *hunks;
+    std::vector<int> forward;  // по диагонали k: самый дальний x
+    std::vector<int> backward; // то же с конца участка
+};
+
+} // namespace
+
+QVector<QStringView> LineDiff::split(QStringView text, QChar separator)
+{
+    QVector<QStringView> lines;
+    qsizetype start = 0;
+    while (start < text.size())
+    {
+        const qsizetype found = text.indexOf(separator, start);
+        const qsizetype end = found < 0 ? text.size() : found + 1;
+        lines.append(text.mid(start, end - start));
+        start = end;
+    }
+    return lines;
+}
+
+QVector<LineDiff::Hunk> LineDiff::compute(const QVector<QStringView> &oldLines, const QVector<QStringView> &newLines)
+{
+    QHash<QStringView, int> ids;
+    const auto number = [&ids](const QVector<QStringView> &lines)
+    {
+        QVector<int> result;
+        result.reserve(lines.size());
+        for (QStringView line : lines)
+        {
+            auto it = ids.constFind(line);
+            if (it == ids.constEnd())
+                it = ids.insert(line, int(ids.size()));
+            result.append(*it);
+        }
+        return result;
+    };
+    const QVector<int> a = number(oldLines);
+    const QVector<int> b = number(newLines);
+
+    QVector<Hunk> hunks;
+    Differ(a, b, &hunks).run(0, int(a.size()), 0, int(b.size()));
+    return hunks;
+}
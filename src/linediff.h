@@ -0,0 +1,32 @@
+#ifndef LINEDIFF_H
+#define LINEDIFF_H
+
+#include <QChar>
+#include <QStringView>
+#include <QVector>
+
+// Построчная разница двух текстов алгоритмом Майерса в линейной памяти:
+// строки заменяются номерами (одинаковые строки — один номер), общие
+// начало и конец отрезаются, середина делится пополам по «средней
+// змейке». Если на участке различий больше MaxCost, поиск кратчайшего
+// пути на нём прекращается и участок целиком становится одним фрагментом:
+// результат остаётся верным, хоть и не минимальным, а время — O(n·MaxCost).
+class LineDiff {
+public:
+    static constexpr int MaxCost = 1024;
+
+    // Строки [oldStart, oldStart + oldCount) заменяются строками
+    // [newStart, newStart + newCount) нового текста.
+    struct Hunk {
+        int oldStart;
+        int oldCount;
+        int newStart;
+        int newCount;
+    };
+
+    // Строки вместе с разделителем: склеенные, они дают исходный текст.
+    static QVector<QStringView> split(QStringView text, QChar separator);
+    static QVector<Hunk> compute(const QVector<QStringView> &oldLines, const QVector<QStringView> &newLines);
+};
+
+#endif // LINEDIFF_H
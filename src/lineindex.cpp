@@ -0,0 +1,442 @@
+#include "lineindex.h"
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PABLA_HAVE_SSE2 1
+#else
+#define PABLA_HAVE_SSE2 0
+#endif
+
+namespace {
+
+constexpr qint64 CancelCheckBytes = 16 * 1024 * 1024;
+
+// Проверка UTF-8 побайтно с состоянием между вызовами: сколько байт
+// продолжения ещё нужно и в каком диапазоне должен быть следующий.
+// Отсекает лишние длины кодирования, суррогаты и значения выше U+10FFFF.
+class Utf8Validator {
+public:
+    void feed(uchar c)
+    {
+        if (pending > 0)
+        {
+            if (c < low || c > high)
+                ok = false;
+            low = 0x80;
+            high = 0xbf;
+            --pending;
+            return;
+        }
+        if (c < 0x80)
+            return;
+        if (c >= 0xc2 && c <= 0xdf)
+        {
+            pending = 1;
+        }
+        else if (c >= 0xe0 && c <= 0xef)
+        {
+            pending = 2;
+            low = c == 0xe0 ? 0xa0 : 0x80;
+            high = c == 0xed ? 0x9f : 0xbf;
+        }
+        else if (c >= 0xf0 && c <= 0xf4)
+        {
+            pending = 3;
+            low = c == 0xf0 ? 0x90 : 0x80;
+            high = c == 0xf4 ? 0x8f : 0xbf;
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+
+    bool idle() const { return pending == 0; }
+    bool failed() const { return !ok; }
+    bool isValid() const { return ok && pending == 0; }
+
+private:
+    int pending = 0;
+    uchar low = 0x80;
+    uchar high = 0xbf;
+    bool ok = true;
+};
+
+} // namespace
+
+bool LineIndex::build(const char *data, qint64 size, const std::atomic<bool> *cancelled)
+{
+    clear();
+
+    Block block;
+    block.lengths.reserve(BlockLines);
+    qint64 lineBegin = 0;
+    bool tooLong = false;
+    Utf8Validator validator;
+
+    const auto addLine = [&](qint64 end)
+    {
+        const qint64 length = end - lineBegin;
+        if (length > MaxLineLength)
+        {
+            tooLong = true;
+            return;
+        }
+        block.lengths.append(quint32(length));
+        block.bytes += length;
+        ++totalLines;
+        lineBegin = end;
+        if (block.lengths.size() == BlockLines)
+        {
+            blocks.append(std::move(block));
+            block = Block();
+            block.lengths.reserve(BlockLines);
+        }
+    };
+
+    qint64 i = 0;
+    while (i < size && !tooLong)
+    {
+        if (cancelled && *cancelled)
+        {
+            clear();
+            return false;
+        }
+        const qint64 stop = qMin(size, i + CancelCheckBytes);
+#if PABLA_HAVE_SSE2
+        // Порция из одних байтов ASCII проверяется одним movemask; байты
+        // с установленным старшим битом уходят в побайтную проверку.
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (; i + 16 <= stop; i += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            if (utf8 && (_mm_movemask_epi8(chunk) != 0 || !validator.idle()))
+            {
+                for (int k = 0; k < 16; ++k)
+                    validator.feed(uchar(data[i + k]));
+                utf8 = !validator.failed();
+            }
+            uint mask = uint(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+            while (mask)
+            {
+                addLine(i + qCountTrailingZeroBits(mask) + 1);
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; i < stop; ++i)
+        {
+            const uchar c = uchar(data[i]);
+            if (utf8 && (c >= 0x80 || !validator.idle()))
+            {
+                validator.feed(c);
+                utf8 = !validator.failed();
+            }
+            if (c == '\n')
+                addLine(i + 1);
+        }
+    }
+    addLine(size); // последняя строка, возможно пустая
+    if (tooLong)
+    {
+        clear();
+        return false;
+    }
+    if (!blocks.isEmpty() && block.lengths.size() < MinBlockLines)
+    {
+        blocks.last().lengths.append(block.lengths);
+        blocks.last().bytes += block.bytes;
+    }
+    else if (!block.lengths.isEmpty())
+    {
+        blocks.append(std::move(block));
+    }
+
+    utf8 = utf8 && validator.isValid();
+    totalBytes = size;
+    rebuildTrees();
+    valid = true;
+    return true;
+}
+
+void LineIndex::clear()
+{
+    blocks.clear();
+    lineTree.clear();
+    byteTree.clear();
+    treeStep = 0;
+    totalLines = 0;
+    totalBytes = 0;
+    valid = false;
+    utf8 = true;
+}
+
+// Дерево Фенвика строится за O(число блоков): каждый узел добавляет
+// свою сумму в ближайшего родителя.
+void LineIndex::rebuildTrees()
+{
+    const int count = blocks.size();
+    lineTree.fill(0, count + 1);
+    byteTree.fill(0, count + 1);
+    for (int i = 1; i <= count; ++i)
+    {
+        lineTree[i] += blocks[i - 1].lengths.size();
+        byteTree[i] += blocks[i - 1].bytes;
+        const int parent = i + (i & -i);
+        if (parent <= count)
+        {
+            lineTree[parent] += lineTree[i];
+            byteTree[parent] += byteTree[i];
+        }
+    }
+    treeStep = count > 0 ? 1 : 0;
+    while (treeStep * 2 <= count)
+        treeStep *= 2;
+}
+
+void LineIndex::addToTrees(int block, qint64 lines, qint64 bytes)
+{
+    for (int i = block + 1; i < lineTree.size(); i += i & -i)
+    {
+        lineTree[i] += lines;
+        byteTree[i] += bytes;
+    }
+}
+
+// Спуск по дереву: набираются блоки, в которых вместе не больше line
+// строк. Следующий за ними блок и содержит строку.
+int LineIndex::findBlockByLine(qint64 line, qint64 *firstLine, qint64 *firstByte) const
+{
+    int index = 0;
+    qint64 lines = 0;
+    qint64 bytes = 0;
+    for (int step = treeStep; step > 0; step >>= 1)
+    {
+        const int next = index + step;
+        if (next <= blocks.size() && lines + lineTree[next] <= line)
+        {
+            index = next;
+            lines += lineTree[next];
+            bytes += byteTree[next];
+        }
+    }
+    *firstLine = lines;
+    *firstByte = bytes;
+    return index;
+}
+
+int LineIndex::findBlockByPos(qint64 pos, qint64 *firstLine, qint64 *firstByte) const
+{
+    int index = 0;
+    qint64 lines = 0;
+    qint64 bytes = 0;
+    for (int step = treeStep; step > 0; step >>= 1)
+    {
+        const int next = index + step;
+        if (next <= blocks.size() && bytes + byteTree[next] <= pos)
+        {
+            index = next;
+            lines += lineTree[next];
+            bytes += byteTree[next];
+        }
+    }
+    if (index == blocks.size())
+    {
+        // Конец документа: последняя строка без '\n'.
+        index = blocks.size() - 1;
+        lines = totalLines - blocks[index].lengths.size();
+        bytes = totalBytes - blocks[index].bytes;
+    }
+    *firstLine = lines;
+    *firstByte = bytes;
+    return index;
+}
+
+// start — на входе начало блока, на выходе начало найденной строки.
+int LineIndex::lineInBlock(const Block &block, qint64 pos, qint64 *start) const
+{
+    const int last = block.lengths.size() - 1;
+    int line = 0;
+    while (line < last && pos >= *start + block.lengths[line])
+        *start += block.lengths[line++];
+    return line;
+}
+
+qint64 LineIndex::lineStart(qint64 line) const
+{
+    if (!valid || line <= 0)
+        return 0;
+    if (line >= totalLines)
+        return totalBytes;
+    qint64 firstLine = 0;
+    qint64 start = 0;
+    const Block &block = blocks[findBlockByLine(line, &firstLine, &start)];
+    for (int i = 0; i < int(line - firstLine); ++i)
+        start += block.lengths[i];
+    return start;
+}
+
+qint64 LineIndex::lineOf(qint64 pos) const
+{
+    if (!valid || pos <= 0)
+        return 0;
+    pos = qMin(pos, totalBytes);
+    qint64 firstLine = 0;
+    qint64 start = 0;
+    const int block = findBlockByPos(pos, &firstLine, &start);
+    return firstLine + lineInBlock(blocks[block], pos, &start);
+}
+
+// Строка, в которую попала вставка, делится по переводам строк во
+// вставленном тексте; новые строки встают в тот же блок.
+void LineIndex::insert(qint64 pos, const char *bytes, qint64 length)
+{
+    if (!valid || length <= 0 || pos < 0 || pos > totalBytes)
+        return;
+    qint64 firstLine = 0;
+    qint64 start = 0;
+    const int index = findBlockByPos(pos, &firstLine, &start);
+    Block &block = blocks[index];
+    const int line = lineInBlock(block, pos, &start);
+    const qint64 head = pos - start;
+    const qint64 tail = block.lengths[line] - head;
+
+    QVector<quint32> added;
+    qint64 from = 0;
+    qint64 prefix = head;
+    while (const void *hit = std::memchr(bytes + from, '\n', size_t(length - from)))
+    {
+        const qint64 end = static_cast<const char *>(hit) - bytes + 1;
+        if (prefix + end - from > MaxLineLength)
+        {
+            clear();
+            return;
+        }
+        added.append(quint32(prefix + end - from));
+        prefix = 0;
+        from = end;
+    }
+    const qint64 lastLength = prefix + (length - from) + tail;
+    if (lastLength > MaxLineLength)
+    {
+        clear();
+        return;
+    }
+
+    const int newLines = added.size();
+    if (newLines == 0)
+    {
+        block.lengths[line] = quint32(lastLength);
+    }
+    else
+    {
+        block.lengths[line] = added[0];
+        block.lengths.insert(line + 1, newLines, 0);
+        for (int i = 1; i < newLines; ++i)
+            block.lengths[line + i] = added[i];
+        block.lengths[line + newLines] = quint32(lastLength);
+    }
+    block.bytes += length;
+    totalBytes += length;
+    totalLines += newLines;
+
+    if (block.lengths.size() > 2 * BlockLines)
+    {
+        splitLarge(index);
+        rebuildTrees();
+    }
+    else
+    {
+        addToTrees(index, newLines, length);
+    }
+}
+
+// Первая и последняя затронутые строки сливаются в одну. Если удаление
+// задело несколько блоков, их остатки объединяются в первый.
+void LineIndex::remove(qint64 pos, qint64 length)
+{
+    if (!valid || length <= 0 || pos < 0 || pos >= totalBytes)
+        return;
+    length = qMin(length, totalBytes - pos);
+
+    qint64 firstLine = 0;
+    qint64 firstStart = 0;
+    const int first = findBlockByPos(pos, &firstLine, &firstStart);
+    const int line = lineInBlock(blocks[first], pos, &firstStart);
+    qint64 lastLine = 0;
+    qint64 lastStart = 0;
+    const int last = findBlockByPos(pos + length, &lastLine, &lastStart);
+    const int endLine = lineInBlock(blocks[last], pos + length, &lastStart);
+
+    const qint64 merged = (pos - firstStart) + (lastStart + blocks[last].lengths[endLine] - pos - length);
+    if (merged > MaxLineLength)
+    {
+        clear();
+        return;
+    }
+    const qint64 removedLines = (lastLine + endLine) - (firstLine + line);
+    totalBytes -= length;
+    totalLines -= removedLines;
+
+    if (first == last)
+    {
+        Block &block = blocks[first];
+        block.lengths.remove(line + 1, endLine - line);
+        block.lengths[line] = quint32(merged);
+        block.bytes -= length;
+        if (mergeSmall(first))
+            rebuildTrees();
+        else
+            addToTrees(first, -removedLines, -length);
+        return;
+    }
+
+    Block &block = blocks[first];
+    block.lengths.resize(line + 1);
+    block.lengths[line] = quint32(merged);
+    block.lengths.append(blocks[last].lengths.mid(endLine + 1));
+    block.bytes = 0;
+    for (quint32 lineLength : std::as_const(block.lengths))
+        block.bytes += lineLength;
+    blocks.remove(first + 1, last - first);
+    if (blocks[first].lengths.size() > 2 * BlockLines)
+        splitLarge(first);
+    else
+        mergeSmall(first);
+    rebuildTrees();
+}
+
+// Части равные, так что каждая не меньше MinBlockLines.
+void LineIndex::splitLarge(int index)
+{
+    const QVector<quint32> lengths = std::move(blocks[index].lengths);
+    const int parts = (lengths.size() + BlockLines - 1) / BlockLines;
+    blocks.insert(index + 1, parts - 1, Block());
+    for (int part = 0; part < parts; ++part)
+    {
+        Block &block = blocks[index + part];
+        const qsizetype begin = lengths.size() * part / parts;
+        block.lengths = lengths.mid(begin, lengths.size() * (part + 1) / parts - begin);
+        block.bytes = 0;
+        for (quint32 lineLength : std::as_const(block.lengths))
+            block.bytes += lineLength;
+    }
+}
+
+// Блок, в котором после удаления осталось меньше MinBlockLines строк,
+// сливается с соседом; слишком большой результат делится заново.
+// Деревья после этого перестраивает вызывающий.
+bool LineIndex::mergeSmall(int index)
+{
+    if (blocks.size() < 2 || blocks[index].lengths.size() >= MinBlockLines)
+        return false;
+    const int target = index > 0 ? index - 1 : index;
+    blocks[target].lengths.append(blocks[target + 1].lengths);
+    blocks[target].bytes += blocks[target + 1].bytes;
+    blocks.remove(target + 1);
+    if (blocks[target].lengths.size() > 2 * BlockLines)
+        splitLarge(target);
+    return true;
+}
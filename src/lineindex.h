@@ -0,0 +1,64 @@
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <QVector>
+#include <atomic>
+
+// Индекс начал строк документа (позиции в байтах). Длины строк лежат
+// блоками по MinBlockLines..2×BlockLines (меньше — только если блок
+// один), над блоками — два дерева Фенвика: число строк и число байт.
+// Блок ищется спуском по деревьям за O(log n), внутри блока строка
+// находится по длинам. Правка меняет длины одного блока и точечно
+// обновляет деревья; целиком они перестраиваются, только когда блок
+// разросся и делится или опустел после удаления и сливается с соседом.
+class LineIndex {
+public:
+    static constexpr int BlockLines = 1024;
+    static constexpr int MinBlockLines = BlockLines / 2;
+
+    // Один проход по тексту: переводы строк ищутся SSE2 по 16 байт, в том
+    // же проходе проверяется UTF-8. false — проход отменён или в тексте
+    // строка длиннее 4 ГБ.
+    bool build(const char *data, qint64 size, const std::atomic<bool> *cancelled = nullptr);
+    void clear();
+
+    bool isValid() const { return valid; }
+    bool isUtf8() const { return utf8; }
+    qint64 size() const { return totalBytes; }
+    qint64 lineCount() const { return totalLines; }
+
+    // Строки считаются с нуля; lineStart(lineCount()) == size().
+    qint64 lineStart(qint64 line) const;
+    qint64 lineOf(qint64 pos) const;
+
+    // Правки документа. После них индекс проверку UTF-8 не обновляет.
+    void insert(qint64 pos, const char *bytes, qint64 length);
+    void remove(qint64 pos, qint64 length);
+
+private:
+    static constexpr qint64 MaxLineLength = 0xffffffffLL;
+
+    struct Block {
+        QVector<quint32> lengths; // вместе с '\n'; у последней строки документа его нет
+        qint64 bytes = 0;
+    };
+
+    int findBlockByLine(qint64 line, qint64 *firstLine, qint64 *firstByte) const;
+    int findBlockByPos(qint64 pos, qint64 *firstLine, qint64 *firstByte) const;
+    int lineInBlock(const Block &block, qint64 pos, qint64 *start) const;
+    void addToTrees(int block, qint64 lines, qint64 bytes);
+    void splitLarge(int block);
+    bool mergeSmall(int block);
+    void rebuildTrees();
+
+    QVector<Block> blocks;
+    QVector<qint64> lineTree; // деревья Фенвика, индексы с единицы
+    QVector<qint64> byteTree;
+    int treeStep = 0;         // старшая степень двойки не больше blocks.size()
+    qint64 totalLines = 0;
+    qint64 totalBytes = 0;
+    bool valid = false;
+    bool utf8 = true;
+};
+
+#endif // LINEINDEX_H
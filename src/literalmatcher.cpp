@@ -0,0 +1,174 @@
+#include "literalmatcher.h"
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PABLA_HAVE_SSE2 1
+#else
+#define PABLA_HAVE_SSE2 0
+#endif
+
+namespace {
+
+inline uchar foldAscii(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? uchar(c + ('a' - 'A')) : c;
+}
+
+inline uchar upperAscii(uchar c)
+{
+    return (c >= 'a' && c <= 'z') ? uchar(c - ('a' - 'A')) : c;
+}
+
+// Все символы, сворачивающиеся так же, как c, — это c и его заглавная.
+inline bool foldsWithinAscii(char16_t c)
+{
+    return c < 0x80 && c != u'k' && c != u'K' && c != u's' && c != u'S';
+}
+
+} // namespace
+
+LiteralMatcher::LiteralMatcher(const QByteArray &pattern, bool caseSensitive)
+    : needle(pattern), caseSensitive(caseSensitive)
+{
+    if (!caseSensitive)
+    {
+        for (char &c : needle)
+            c = char(foldAscii(uchar(c)));
+    }
+}
+
+qsizetype LiteralMatcher::find(const char *data, qsizetype size, qsizetype from) const
+{
+    const qsizetype n = needle.size();
+    if (n == 0 || size - from < n)
+        return -1;
+    const qsizetype last = n - 1;
+    qsizetype i = from;
+
+#if PABLA_HAVE_SSE2
+    const uchar first = uchar(needle[0]);
+    const uchar lastByte = uchar(needle[last]);
+    const __m128i firstA = _mm_set1_epi8(char(first));
+    const __m128i firstB = _mm_set1_epi8(char(caseSensitive ? first : upperAscii(first)));
+    const __m128i lastA = _mm_set1_epi8(char(lastByte));
+    const __m128i lastB = _mm_set1_epi8(char(caseSensitive ? lastByte : upperAscii(lastByte)));
+    for (; i + last + 16 <= size; i += 16)
+    {
+        const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + last));
+        const __m128i eqFirst = _mm_or_si128(_mm_cmpeq_epi8(blockFirst, firstA), _mm_cmpeq_epi8(blockFirst, firstB));
+        const __m128i eqLast = _mm_or_si128(_mm_cmpeq_epi8(blockLast, lastA), _mm_cmpeq_epi8(blockLast, lastB));
+        uint mask = uint(_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast)));
+        while (mask)
+        {
+            const qsizetype candidate = i + qCountTrailingZeroBits(mask);
+            if (equalsAt(data + candidate))
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+#else
+    if (caseSensitive)
+    {
+        while (i + n <= size)
+        {
+            const void *hit = std::memchr(data + i, needle[0], size_t(size - i - last));
+            if (!hit)
+                return -1;
+            i = static_cast<const char *>(hit) - data;
+            if (equalsAt(data + i))
+                return i;
+            ++i;
+        }
+        return -1;
+    }
+#endif
+    for (; i + n <= size; ++i)
+    {
+        if (equalsAt(data + i))
+            return i;
+    }
+    return -1;
+}
+
+bool LiteralMatcher::equalsAt(const char *p) const
+{
+    if (caseSensitive)
+        return std::memcmp(p, needle.constData(), size_t(needle.size())) == 0;
+    for (qsizetype k = 0; k < needle.size(); ++k)
+    {
+        if (foldAscii(uchar(p[k])) != uchar(needle[k]))
+            return false;
+    }
+    return true;
+}
+
+Utf16Matcher::Utf16Matcher(const QString &pattern, bool caseSensitive)
+    : needle(pattern), caseSensitive(caseSensitive), filtered(caseSensitive)
+{
+    if (caseSensitive || needle.isEmpty())
+        return;
+    for (QChar &c : needle)
+        c = c.toCaseFolded();
+    filtered = foldsWithinAscii(needle.front().unicode()) && foldsWithinAscii(needle.back().unicode());
+}
+
+qsizetype Utf16Matcher::find(const char16_t *data, qsizetype size, qsizetype from) const
+{
+    const qsizetype n = needle.size();
+    if (n == 0 || size - from < n)
+        return -1;
+    const qsizetype last = n - 1;
+    qsizetype i = from;
+
+#if PABLA_HAVE_SSE2
+    if (filtered)
+    {
+        // movemask даёт по два бита на символ, берётся младший.
+        const char16_t first = needle.front().unicode();
+        const char16_t lastChar = needle.back().unicode();
+        const __m128i firstA = _mm_set1_epi16(short(first));
+        const __m128i firstB = _mm_set1_epi16(short(caseSensitive ? first : upperAscii(uchar(first))));
+        const __m128i lastA = _mm_set1_epi16(short(lastChar));
+        const __m128i lastB = _mm_set1_epi16(short(caseSensitive ? lastChar : upperAscii(uchar(lastChar))));
+        for (; i + last + 8 <= size; i += 8)
+        {
+            const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + last));
+            const __m128i eqFirst = _mm_or_si128(_mm_cmpeq_epi16(blockFirst, firstA), _mm_cmpeq_epi16(blockFirst, firstB));
+            const __m128i eqLast = _mm_or_si128(_mm_cmpeq_epi16(blockLast, lastA), _mm_cmpeq_epi16(blockLast, lastB));
+            uint mask = uint(_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast))) & 0x5555u;
+            while (mask)
+            {
+                const qsizetype candidate = i + qCountTrailingZeroBits(mask) / 2;
+                if (equalsAt(data + candidate))
+                    return candidate;
+                mask &= mask - 1;
+            }
+        }
+    }
+#else
+    if (caseSensitive)
+        return QStringView(data, size).indexOf(QStringView(needle), i);
+#endif
+    for (; i + n <= size; ++i)
+    {
+        if (equalsAt(data + i))
+            return i;
+    }
+    return -1;
+}
+
+bool Utf16Matcher::equalsAt(const char16_t *p) const
+{
+    if (caseSensitive)
+        return std::memcmp(p, needle.utf16(), size_t(needle.size()) * sizeof(char16_t)) == 0;
+    for (qsizetype k = 0; k < needle.size(); ++k)
+    {
+        if (QChar(p[k]).toCaseFolded() != needle[k])
+            return false;
+    }
+    return true;
+}
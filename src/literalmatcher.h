@@ -0,0 +1,44 @@
+#ifndef LITERALMATCHER_H
+#define LITERALMATCHER_H
+
+#include <QByteArray>
+#include <QString>
+
+// Поиск подстроки без регулярных выражений. Кандидаты отбираются SSE2
+// по первому и последнему элементу образца, затем проверяются целиком.
+
+// В байтах UTF-8. Без учёта регистра сворачиваются только буквы ASCII.
+class LiteralMatcher {
+public:
+    LiteralMatcher(const QByteArray &pattern, bool caseSensitive);
+
+    qsizetype size() const { return needle.size(); }
+    qsizetype find(const char *data, qsizetype size, qsizetype from) const;
+
+private:
+    bool equalsAt(const char *p) const;
+
+    QByteArray needle;
+    bool caseSensitive;
+};
+
+// В UTF-16. Без учёта регистра символы сравниваются после
+// QChar::toCaseFolded(); отбор SSE2 работает, когда крайние символы
+// образца — ASCII, у которых нет родни по регистру вне ASCII (как у
+// k и K — знак кельвина, у s — длинное s). Иначе проверяется каждая позиция.
+class Utf16Matcher {
+public:
+    Utf16Matcher(const QString &pattern, bool caseSensitive);
+
+    qsizetype size() const { return needle.size(); }
+    qsizetype find(const char16_t *data, qsizetype size, qsizetype from) const;
+
+private:
+    bool equalsAt(const char16_t *p) const;
+
+    QString needle; // без учёта регистра — свёрнутый
+    bool caseSensitive;
+    bool filtered; // можно отбирать кандидатов по крайним символам
+};
+
+#endif // LITERALMATCHER_H
@@ -1,7 +1,6 @@
 #include <QApplication>
 #include <QMainWindow>
 #include <QTextEdit>
-#include <QPlainTextEdit>
 #include <QMenuBar>
 #include <QFileDialog>
 #include <QMessageBox>
@@ -9,14 +8,59 @@
 #include <QTextStream>
 #include <QDockWidget>
 #include <QTreeView>
-#include <QFileSystemModel>
 #include <QSettings>
 #include <QToolBar>
 #include <QKeyEvent>
+#include <QCloseEvent>
 #include <QProcess>
+#include <QStackedWidget>
+#include <QTabBar>
+#include <QVBoxLayout>
+#include <QFileInfo>
+#include <QStatusBar>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QTextBlock>
+#include <QSpinBox>
+#include <QLabel>
+#include <QThread>
+#include <QDateTime>
+#include <QDir>
+#include <QActionGroup>
+#include <QScrollBar>
+#include <QInputDialog>
+#include <QSet>
 #include <iostream>
-#include "syntaxhighlighter.h"
+#include <algorithm>
+#include <climits>
+#include "largefileview.h"
+#include "fileloader.h"
+#include "filesaver.h"
+#include "filereloader.h"
+#include "filewatcher.h"
+#include "outputconsole.h"
+#include "projectindexer.h"
+#include "symbolsearchdialog.h"
+#include "findinfilespanel.h"
+#include "findbar.h"
+#include "projectfiles.h"
+#include "filetreemodel.h"
+#include "filefinderdialog.h"
+#include "taskrunner.h"
+#include "buildrunner.h"
+#include "runconfigdialog.h"
+#include "buildpanel.h"
 #include "keypresshandler.h"
+#include "undohistory.h"
+#include "syntaxhighlighter.h"
+#include "theme.h"
+#include "documentmanager.h"
+#include "editjournal.h"
+#include "startuptrace.h"
+#include "latencytracer.h"
+#include "terminalwidget.h"
 #include "aftocomplet.h"
 
 class CodeEditor : public QMainWindow
@@ -27,15 +71,111 @@ public:
     CodeEditor(QWidget *parent = nullptr) : QMainWindow(parent)
     {
         editor = new QTextEdit(this);
-        setCentralWidget(editor);
+        editorStack = new QStackedWidget(this);
+        editorStack->addWidget(editor);
+
+        // Вкладки открытых документов над общим редактором
+        tabBar = new QTabBar(this);
+        tabBar->setDocumentMode(true);
+        tabBar->setTabsClosable(true);
+        tabBar->setMovable(true);
+        tabBar->setExpanding(false);
+        tabBar->setElideMode(Qt::ElideMiddle);
+        QWidget *central = new QWidget(this);
+        QVBoxLayout *centralLayout = new QVBoxLayout(central);
+        centralLayout->setContentsMargins(0, 0, 0, 0);
+        centralLayout->setSpacing(0);
+        // Поиск и замена в текущем документе, скрыта до Ctrl+F
+        findBar = new FindBar(this);
+        findBar->hide();
+        connect(findBar, &FindBar::message, this, [this](const QString &text)
+                { statusBar()->showMessage(text, 10000); });
+        centralLayout->addWidget(tabBar);
+        centralLayout->addWidget(findBar);
+        centralLayout->addWidget(editorStack);
+        setCentralWidget(central);
 
-        highlighter = new SyntaxHighlighter(editor->document());
+        // Документы вкладок; история правок у каждого своя, с ограничением памяти
+        QSettings documentSettings("PablaIDE", "CodeEditor");
+        documents = new DocumentManager(editor, this);
+        documents->setWarmCount(documentSettings.value("warmTabs", DocumentManager::DefaultWarmCount).toInt());
+        documents->setMemoryBudget(documentSettings.value("documentMemoryBudgetMB", 256).toLongLong() * 1024 * 1024);
+        documents->setUndoBudgets(documentSettings.value("undoMemoryBudgetMB", 32).toLongLong() * 1024 * 1024,
+                                  documentSettings.value("undoDiskBudgetMB", 256).toLongLong() * 1024 * 1024);
+        connect(documents, &DocumentManager::modificationChanged, this, &CodeEditor::updateTab);
+        connect(tabBar, &QTabBar::currentChanged, this, &CodeEditor::showDocument);
+        connect(tabBar, &QTabBar::tabCloseRequested, this, &CodeEditor::closeTab);
+        connect(tabBar, &QTabBar::tabMoved, documents, &DocumentManager::move);
 
         keyPressHandler = new KeyPressHandler(editor, this);
         connect(keyPressHandler, &KeyPressHandler::saveRequested, this, &CodeEditor::saveFile);
-        connect(keyPressHandler, &KeyPressHandler::undoRequested, editor, &QTextEdit::undo);
+        connect(keyPressHandler, &KeyPressHandler::undoRequested, this, [this]
+                {
+                    if (UndoHistory *history = documents->currentUndo())
+                        history->undo(); });
+        connect(keyPressHandler, &KeyPressHandler::redoRequested, this, [this]
+                {
+                    if (UndoHistory *history = documents->currentUndo())
+                        history->redo(); });
+        undoUsage = new QLabel(this);
+        statusBar()->addPermanentWidget(undoUsage);
+        cursorPosition = new QLabel(this);
+        statusBar()->addPermanentWidget(cursorPosition);
+        connect(editor, &QTextEdit::cursorPositionChanged, this, &CodeEditor::showCursorPosition);
+        connect(editorStack, &QStackedWidget::currentChanged, this, &CodeEditor::showCursorPosition);
+
+        // Задержка от нажатия до отрисовки, обновляется раз в секунду
+        LatencyTracer::watch(editor);
+        keyLatency = new QLabel(this);
+        keyLatency->setToolTip("Задержка от нажатия клавиши до отрисовки: медиана, 99-й процентиль, максимум");
+        statusBar()->addPermanentWidget(keyLatency);
+        QTimer *keyLatencyTimer = new QTimer(this);
+        connect(keyLatencyTimer, &QTimer::timeout, this, &CodeEditor::showKeyLatency);
+        keyLatencyTimer->start(1000);
+        showKeyLatency();
+        connect(documents, &DocumentManager::undoUsageChanged, this, &CodeEditor::showUndoUsage);
+        showUndoUsage(0, 0);
+        connect(documents, &DocumentManager::journalFailed, this, [this](const QString &error)
+                { statusBar()->showMessage(QString("Журнал восстановления: %1").arg(error), 10000); });
 
         autoComplete = new aftocomplet(editor, this);
+        connect(keyPressHandler, &KeyPressHandler::completionRequested, autoComplete, &aftocomplet::complete);
+
+        // Асинхронная загрузка файлов с индикатором и отменой
+        fileLoader = new FileLoader(this);
+        connect(fileLoader, &FileLoader::chunkReady, this, &CodeEditor::appendLoadedChunk);
+        connect(fileLoader, &FileLoader::progress, this, [this](qint64 done, qint64 total)
+                { loadProgress->setValue(total > 0 ? int(done * 100 / total) : 100); });
+        connect(fileLoader, &FileLoader::finished, this, &CodeEditor::finishLoading);
+
+        loadProgress = new QProgressBar(this);
+        loadProgress->setRange(0, 100);
+        loadProgress->setMaximumWidth(200);
+        loadProgress->hide();
+        cancelLoadButton = new QPushButton("Отмена", this);
+        cancelLoadButton->hide();
+        statusBar()->addPermanentWidget(loadProgress);
+        statusBar()->addPermanentWidget(cancelLoadButton);
+        connect(cancelLoadButton, &QPushButton::clicked, this, &CodeEditor::cancelLoading);
+
+        // Фоновое атомарное сохранение
+        fileSaver = new FileSaver(this);
+        connect(fileSaver, &FileSaver::replacing, this, [this](const QString &fileName)
+                {
+                    const int index = documents->indexOf(fileName);
+                    if (index >= 0 && documents->document(index).largeView)
+                        documents->document(index).largeView->releaseFile(fileName); });
+        connect(fileSaver, &FileSaver::saved, this, &CodeEditor::onFileSaved);
+        connect(fileSaver, &FileSaver::failed, this, &CodeEditor::onSaveFailed);
+
+        // Файлы открытых документов, изменённые вне редактора
+        documentWatcher = new FileWatcher(this);
+        documentWatcher->setWatchContents(true);
+        connect(documentWatcher, &FileWatcher::directoryChanged, this, &CodeEditor::checkDiskChanges);
+        fileReloader = new FileReloader(this);
+        connect(fileReloader, &FileReloader::reloaded, this, &CodeEditor::onReloaded);
+        connect(fileReloader, &FileReloader::failed, this, [this](const QString &fileName, const QString &error)
+                { statusBar()->showMessage(QString("Не удалось перечитать %1: %2").arg(fileName, error), 10000); });
 
         // Создание меню
         QMenu *fileMenu = menuBar()->addMenu("Файл");
@@ -43,97 +183,251 @@ public:
         QAction *openFile = fileMenu->addAction("Открыть файл");
         QAction *openFolder = fileMenu->addAction("Открыть папку");
         QAction *saveFile = fileMenu->addAction("Сохранить файл");
+        QAction *closeFile = fileMenu->addAction("Закрыть вкладку");
+        closeFile->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_W));
+        connect(closeFile, &QAction::triggered, this, [this]
+                { closeTab(tabBar->currentIndex()); });
 
         connect(newFile, &QAction::triggered, this, &CodeEditor::createNewFile);
         connect(openFile, &QAction::triggered, this, &CodeEditor::openFile);
         connect(openFolder, &QAction::triggered, this, &CodeEditor::openFolder);
         connect(saveFile, &QAction::triggered, this, &CodeEditor::saveFile);
 
-        // Боковая панель с деревом файлов
+        // Индекс символов проекта
+        projectIndexer = new ProjectIndexer(this);
+        connect(projectIndexer, &ProjectIndexer::progress, this, [this](int done, int total)
+                { statusBar()->showMessage(QString("Индексация: %1 из %2 файлов").arg(done).arg(total)); });
+        connect(projectIndexer, &ProjectIndexer::indexReady, this, &CodeEditor::onIndexReady);
+        connect(projectIndexer, &ProjectIndexer::failed, this, [this](const QString &error)
+                { statusBar()->showMessage(error, 10000); });
+        reindexTimer = new QTimer(this);
+        reindexTimer->setSingleShot(true);
+        reindexTimer->setInterval(1000);
+        connect(reindexTimer, &QTimer::timeout, projectIndexer, &ProjectIndexer::reindex);
+
+        QMenu *goMenu = menuBar()->addMenu("Переход");
+        QAction *goToDefinition = goMenu->addAction("Перейти к определению");
+        goToDefinition->setShortcut(Qt::Key_F12);
+        QAction *searchSymbol = goMenu->addAction("Символ в проекте...");
+        searchSymbol->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_T));
+
+        connect(goToDefinition, &QAction::triggered, this, &CodeEditor::goToDefinition);
+        connect(searchSymbol, &QAction::triggered, this, [this]
+                { showSymbolSearch(QString()); });
+        QAction *goToFile = goMenu->addAction("Перейти к файлу...");
+        goToFile->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_P));
+        connect(goToFile, &QAction::triggered, this, &CodeEditor::showFileFinder);
+        QAction *goToLineAction = goMenu->addAction("Перейти к строке...");
+        goToLineAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_G));
+        connect(goToLineAction, &QAction::triggered, this, &CodeEditor::askLine);
+
+        // Панели: сразу создаются только пустые доки, содержимое — при
+        // первом показе или первом обращении.
+        projectFiles = new ProjectFiles(this);
+        connect(projectFiles, &ProjectFiles::scanFinished, this, [this](int files, int directories, qint64 elapsedMs)
+                { statusBar()->showMessage(QString("Проект: %1 файлов в %2 папках, обход %3 мс").arg(files).arg(directories).arg(elapsedMs), 10000); });
+        connect(projectFiles, &ProjectFiles::watchLimitReached, this, [this](int watched)
+                { statusBar()->showMessage(QString("Достигнут лимит наблюдения за папками (%1), изменения в остальных не отслеживаются.").arg(watched), 10000); });
+        // Файлы, изменённые вне редактора (checkout, сборка), переиндексируются
+        // так же, как после сохранения: неизменённые берутся из прошлого индекса.
+        connect(projectFiles, &ProjectFiles::directoryChanged, reindexTimer, qOverload<>(&QTimer::start));
         fileTreeDock = new QDockWidget("Файлы", this);
-        fileTree = new QTreeView(fileTreeDock);
-        fileModel = new QFileSystemModel(this);
-        fileTree->setModel(fileModel);
-        fileTreeDock->setWidget(fileTree);
         addDockWidget(Qt::LeftDockWidgetArea, fileTreeDock);
+        connect(fileTreeDock, &QDockWidget::visibilityChanged, this, [this](bool visible)
+                { if (visible) createFileTree(); });
 
-        connect(fileTree, &QTreeView::doubleClicked, this, &CodeEditor::openFileFromTree);
-
-        // Терминал
-        terminal = new QPlainTextEdit(this);
-        terminal->setReadOnly(false); // Разрешаем ввод текста
-        terminal->setPlaceholderText("Введите команду и нажмите Enter...");
-        QDockWidget *terminalDock = new QDockWidget("Терминал", this);
-        terminalDock->setWidget(terminal);
+        // Терминал виден с самого начала, но оболочка запускается только
+        // после первой отрисовки окна (finishStartup) — fork не задерживает её.
+        terminalDock = new QDockWidget("Терминал", this);
         addDockWidget(Qt::BottomDockWidgetArea, terminalDock);
+        connect(terminalDock, &QDockWidget::visibilityChanged, this, [this](bool visible)
+                { if (visible && startupFinished) createTerminal(); });
+
+        // Вывод сборки и запуска
+        outputDock = new QDockWidget("Вывод", this);
+        addDockWidget(Qt::BottomDockWidgetArea, outputDock);
+        tabifyDockWidget(terminalDock, outputDock);
+        connect(outputDock, &QDockWidget::visibilityChanged, this, [this](bool visible)
+                { if (visible) outputConsole(); });
+
+        // Поиск в файлах проекта
+        findDock = new QDockWidget("Поиск", this);
+        addDockWidget(Qt::BottomDockWidgetArea, findDock);
+        tabifyDockWidget(outputDock, findDock);
+        connect(findDock, &QDockWidget::visibilityChanged, this, [this](bool visible)
+                { if (visible) findInFilesPanel(); });
 
-        connect(terminal, &QPlainTextEdit::textChanged, this, &CodeEditor::onTerminalTextChanged);
+        QMenu *searchMenu = menuBar()->addMenu("Поиск");
+        QAction *findAction = searchMenu->addAction("Найти");
+        findAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_F));
+        connect(findAction, &QAction::triggered, this, [this]
+                { findBar->open(false); });
+        QAction *replaceAction = searchMenu->addAction("Заменить");
+        replaceAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_H));
+        connect(replaceAction, &QAction::triggered, this, [this]
+                { findBar->open(true); });
+        QAction *findNextAction = searchMenu->addAction("Найти далее");
+        findNextAction->setShortcut(Qt::Key_F3);
+        connect(findNextAction, &QAction::triggered, findBar, &FindBar::findNext);
+        QAction *findPreviousAction = searchMenu->addAction("Найти ранее");
+        findPreviousAction->setShortcut(QKeySequence(Qt::SHIFT | Qt::Key_F3));
+        connect(findPreviousAction, &QAction::triggered, findBar, &FindBar::findPrevious);
+        searchMenu->addSeparator();
+        QAction *findInFiles = searchMenu->addAction("Найти в файлах");
+        findInFiles->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_F));
+        connect(findInFiles, &QAction::triggered, this, [this]
+                {
+                    findDock->show();
+                    findDock->raise();
+                    findInFilesPanel()->focusQuery(); });
+
+        // Перенос строк в режиме больших файлов
+        QMenu *viewMenu = menuBar()->addMenu("Вид");
+        wordWrapAction = viewMenu->addAction("Перенос длинных строк");
+        wordWrapAction->setCheckable(true);
+        wordWrapAction->setShortcut(QKeySequence(Qt::ALT | Qt::Key_Z));
+        wordWrapAction->setChecked(QSettings("PablaIDE", "CodeEditor").value("wordWrap", false).toBool());
+        connect(wordWrapAction, &QAction::toggled, this, [this](bool enabled)
+                {
+                    QSettings("PablaIDE", "CodeEditor").setValue("wordWrap", enabled);
+                    for (int i = 0; i < documents->count(); ++i)
+                    {
+                        if (LargeFileView *view = documents->document(i).largeView)
+                            view->setWordWrap(enabled);
+                    } });
+
+        // Темы из файлов JSON; при прокрутке перекрашиваются строки,
+        // которые после смены темы ещё не были видны
+        defaultPalette = qApp->palette();
+        themes = Theme::loadAll();
+        QMenu *themeMenu = menuBar()->addMenu("Тема");
+        themeActions = new QActionGroup(this);
+        for (const Theme &theme : std::as_const(themes))
+        {
+            QAction *action = themeMenu->addAction(theme.name);
+            action->setCheckable(true);
+            action->setData(theme.id);
+            themeActions->addAction(action);
+            const QString id = theme.id;
+            connect(action, &QAction::triggered, this, [this, id]
+                    { applyTheme(id); });
+        }
+        connect(editor->verticalScrollBar(), &QScrollBar::valueChanged, this, &CodeEditor::restyleVisible);
+        applyTheme(QSettings("PablaIDE", "CodeEditor").value("theme", "light").toString());
+
+        // Сборка: сообщения компилятора и профиль времени
+        taskRunner = new TaskRunner(this);
+        connect(taskRunner, &TaskRunner::taskOutput, this, [this](int, const QByteArray &bytes)
+                { outputConsole()->write(bytes); });
+        connect(taskRunner, &TaskRunner::taskStarted, this, [this](int, const TaskSpec &spec)
+                { outputConsole()->appendMessage(QString("%1: %2 %3").arg(spec.name, spec.program, spec.arguments.join(' '))); });
+        connect(taskRunner, &TaskRunner::taskFinished, this, &CodeEditor::onTaskFinished);
+        buildRunner = new BuildRunner(taskRunner, this);
+        buildDock = new QDockWidget("Сборка", this);
+        addDockWidget(Qt::BottomDockWidgetArea, buildDock);
+        tabifyDockWidget(findDock, buildDock);
+        terminalDock->raise();
+        connect(buildDock, &QDockWidget::visibilityChanged, this, [this](bool visible)
+                { if (visible) buildResults(); });
+        connect(buildRunner, &BuildRunner::diagnosticsFound, this, [this](const QVector<Diagnostic> &diagnostics)
+                { buildResults()->addDiagnostics(diagnostics); });
+        connect(buildRunner, &BuildRunner::finished, this, &CodeEditor::onBuildFinished);
 
         // Панель инструментов
         QToolBar *toolBar = addToolBar("Инструменты");
-        QAction *buildAction = toolBar->addAction("Собрать");
+        buildAction = toolBar->addAction("Собрать");
+        toolBar->addWidget(new QLabel(" Потоков: ", toolBar));
+        buildJobs = new QSpinBox(toolBar);
+        buildJobs->setRange(1, 256);
+        buildJobs->setValue(QSettings("PablaIDE", "CodeEditor").value("buildJobs", QThread::idealThreadCount()).toInt());
+        buildJobs->setToolTip("Число параллельных заданий сборки (--parallel)");
+        connect(buildJobs, &QSpinBox::valueChanged, this, [](int jobs)
+                { QSettings("PablaIDE", "CodeEditor").setValue("buildJobs", jobs); });
+        toolBar->addWidget(buildJobs);
         QAction *runAction = toolBar->addAction("Запустить");
+        QAction *configureRunAction = toolBar->addAction("Настроить запуск...");
+        connect(configureRunAction, &QAction::triggered, this, &CodeEditor::configureRun);
 
         connect(buildAction, &QAction::triggered, this, &CodeEditor::buildProject);
         connect(runAction, &QAction::triggered, this, &CodeEditor::runProject);
 
-        // Загрузка последней папки
-        loadLastFolder();
+        createNewFile();
+
+        // Последняя папка открывается после первой отрисовки окна: обход
+        // проекта и индексация не задерживают появление окна. Таймер — на
+        // случай, если окно свёрнуто и не рисуется.
+        editor->viewport()->installEventFilter(this);
+        QTimer::singleShot(2000, this, &CodeEditor::finishStartup);
+        StartupTrace::mark("window");
     }
 
-private slots:
-    void onTerminalTextChanged()
+protected:
+    // Фоновое сохранение доводится до конца, пока окно и отображения
+    // больших файлов ещё живы: замена файла требует replacing().
+    void closeEvent(QCloseEvent *event) override
     {
-        QString text = terminal->toPlainText();
-        if (text.endsWith("\n"))
-        {                                     // Проверяем, нажата ли клавиша Enter
-            QString command = text.trimmed(); // Убираем лишние пробелы и символы новой строки
-            terminal->clear();                // Очищаем терминал после ввода команды
-            processCommand(command);          // Обрабатываем команду
-        }
+        fileSaver->waitForFinished();
+        QMainWindow::closeEvent(event);
     }
 
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (watched == editor->viewport() && event->type() == QEvent::Paint && !startupFinished)
+            QTimer::singleShot(0, this, &CodeEditor::finishStartup);
+        else if (watched == editor->viewport() && event->type() == QEvent::Resize)
+            QTimer::singleShot(0, this, &CodeEditor::restyleVisible);
+        return QMainWindow::eventFilter(watched, event);
+    }
+
+private slots:
+    // Встроенные команды терминала; всё остальное выполняет оболочка.
     void processCommand(const QString &command)
     {
-        if (command == "help")
+        if (command == "trace save" || command.startsWith("trace save "))
         {
-            terminal->appendPlainText("Доступные команды:\n"
-                                      "  help - показать список команд\n"
-                                      "  start theme dark - включить тёмную тему\n"
-                                      "  start theme light - включить светлую тему\n"
-                                      "  start theme dark blue - включить синюю тёмную тему\n"
-                                      "  start theme dracula - включить тему Dracula\n");
+            bool ok = true;
+            const QString argument = command.mid(10).trimmed();
+            const int seconds = argument.isEmpty() ? 10 : argument.toInt(&ok);
+            if (!ok || seconds <= 0)
+            {
+                terminal->showMessage("Укажите число секунд, например: trace save 30");
+                return;
+            }
+            const QString fileName = QDir::temp().filePath(
+                QString("pabla-trace-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+            QString error;
+            if (LatencyTracer::writeChromeTrace(fileName, seconds, &error))
+                terminal->showMessage(QString("Трасса за %1 с сохранена: %2").arg(seconds).arg(fileName));
+            else
+                terminal->showMessage(QString("Не удалось сохранить трассу: %1").arg(error));
         }
-        else if (command == "start theme dark")
+        else if (command == "trace reset")
         {
-            applyDarkTheme();
-            terminal->appendPlainText("Тёмная тема активирована.");
+            LatencyTracer::resetHistogram();
+            showKeyLatency();
+            terminal->showMessage("Статистика задержки ввода сброшена.");
         }
-        else if (command == "start theme light")
+        else if (command.startsWith("start theme"))
         {
-            applyLightTheme();
-            terminal->appendPlainText("Светлая тема активирована.");
-        }
-        else if (command == "start theme dark blue")
-        {
-            applyDarkBlueTheme();
-            terminal->appendPlainText("Синяя тёмная тема активирована.");
-        }
-        else if (command == "start theme dracula")
-        {
-            applyDraculaTheme();
-            terminal->appendPlainText("Тема Dracula активирована.");
-        }
-        else
-        {
-            terminal->appendPlainText("Неизвестная команда. Введите 'help' для списка команд.");
+            const QString name = command.mid(11).trimmed();
+            auto theme = std::find_if(themes.cbegin(), themes.cend(), [&name](const Theme &other)
+                                      { return other.matches(name); });
+            if (theme == themes.cend())
+            {
+                QStringList ids;
+                for (const Theme &other : std::as_const(themes))
+                    ids << other.id;
+                terminal->showMessage(QString("Тема \"%1\" не найдена. Доступны: %2").arg(name, ids.join(", ")));
+                return;
+            }
+            applyTheme(theme->id);
+            terminal->showMessage(QString("Тема %1 активирована.").arg(theme->name));
         }
     }
 
     void createNewFile()
     {
-        editor->clear();
-        currentFile.clear();
+        openTab(documents->add(QString()));
     }
 
     void openFile()
@@ -145,25 +439,213 @@ private slots:
         loadFile(fileName);
     }
 
-    void saveFile()
+    // false — сохранение не начато (текст недочитан или имя не выбрано).
+    bool saveFile()
     {
-        QString fileName = currentFile.isEmpty()
+        const int index = documents->current();
+        // Недочитанный текст не сохраняется: он затёр бы конец файла.
+        if (index < 0 || !documents->document(index).loaded)
+            return false;
+        const DocumentManager::Document &document = documents->document(index);
+        QString fileName = document.filePath.isEmpty()
                                ? QFileDialog::getSaveFileName(this, "Сохранить файл", "", "Все файлы (*.*)")
-                               : currentFile;
+                               : document.filePath;
         if (fileName.isEmpty())
+            return false;
+
+        // В потоке GUI берётся только снимок, запись идёт в фоне. Для
+        // обычного документа это toRawText(): одна копия текста без
+        // разбора и кодирования. Такие документы меньше порога больших
+        // файлов, и копия стоит миллисекунды (file.save_snapshot_ms в
+        // pabla_bench); большие файлы сохраняются из PieceTable без копии.
+        if (document.largeView)
+        {
+            fileSaver->save(fileName, document.largeView->beginSave(fileName));
+        }
+        else
+        {
+            documents->markSaving(index);
+            fileSaver->save(fileName, document.text->toRawText(), document.format);
+            document.text->setModified(false);
+        }
+        documents->setFilePath(index, fileName);
+        updateTab(index);
+        updateWatchedDirectories();
+        statusBar()->showMessage("Сохранение...");
+        return true;
+    }
+
+    void onFileSaved(const QString &fileName, qint64 bytes, qint64 elapsedMs)
+    {
+        const double megabytesPerSecond = elapsedMs > 0 ? bytes / 1048576.0 / (elapsedMs / 1000.0) : 0.0;
+        statusBar()->showMessage(QString("Сохранено %1: %2 КБ за %3 мс (%4 МБ/с)")
+                                     .arg(QFileInfo(fileName).fileName())
+                                     .arg(bytes / 1024)
+                                     .arg(elapsedMs)
+                                     .arg(megabytesPerSecond, 0, 'f', 1),
+                                 10000);
+
+        const int index = documents->indexOf(fileName);
+        LargeFileView *largeView = index >= 0 ? documents->document(index).largeView : nullptr;
+        if (largeView && !largeView->finishSave(fileName, true))
+            QMessageBox::warning(this, "Ошибка", "Файл сохранён, но не открылся заново: правки, сделанные во время сохранения, потеряны.");
+        if (index >= 0)
+            documents->markSaved(index, !fileSaver->hasQueued());
+        // Пока шло сохранение, изменения на диске не проверялись.
+        if (!fileSaver->hasQueued())
+            checkDiskChanges(QString());
+        scheduleReindex(fileName);
+
+        // Вкладка, закрытая с сохранением, закрывается только теперь: до
+        // записи файла её журнал — единственная копия правок. Если текст
+        // успели изменить после сохранения, вкладка остаётся.
+        if (index >= 0 && closeAfterSave.contains(fileName) && !fileSaver->hasQueued())
+        {
+            closeAfterSave.remove(fileName);
+            if (!documents->isModified(index))
+                removeTab(index);
+        }
+    }
+
+    void scheduleReindex(const QString &fileName)
+    {
+        if (!currentFolder.isEmpty() && fileName.startsWith(currentFolder + '/'))
+            reindexTimer->start();
+    }
+
+    void onIndexReady(int files, int symbols, int reusedFiles, qint64 elapsedMs)
+    {
+        statusBar()->showMessage(QString("Индекс: %1 файлов (%2 без изменений), %3 символов за %4 мс")
+                                     .arg(files)
+                                     .arg(reusedFiles)
+                                     .arg(symbols)
+                                     .arg(elapsedMs),
+                                 10000);
+    }
+
+    void goToDefinition()
+    {
+        if (editorStack->currentWidget() != editor)
+            return;
+        QTextCursor cursor = editor->textCursor();
+        cursor.select(QTextCursor::WordUnderCursor);
+        const QString word = cursor.selectedText();
+        if (word.isEmpty())
+            return;
+
+        const QVector<SymbolLocation> locations = projectIndexer->index().find(word);
+        if (locations.size() == 1)
+            openLocation(locations.first().filePath, locations.first().line);
+        else if (locations.isEmpty())
+            statusBar()->showMessage(QString("Определение %1 не найдено.").arg(word), 5000);
+        else
+            showSymbolSearch(word);
+    }
+
+    void showSymbolSearch(const QString &query)
+    {
+        SymbolSearchDialog dialog(projectIndexer->index(), this);
+        dialog.setQuery(query);
+        if (dialog.exec() == QDialog::Accepted)
+        {
+            const SymbolLocation location = dialog.selectedLocation();
+            if (!location.filePath.isEmpty())
+                openLocation(location.filePath, location.line);
+        }
+    }
+
+    void openLocation(const QString &filePath, int line)
+    {
+        // Строка применяется, когда документ покажется: сразу или после загрузки.
+        pendingLine = line;
+        loadFile(filePath);
+    }
+
+    void showFileFinder()
+    {
+        if (currentFolder.isEmpty())
+        {
+            QMessageBox::warning(this, "Ошибка", "Сначала откройте папку проекта.");
             return;
+        }
+        FileFinderDialog dialog(projectFiles, this);
+        if (dialog.exec() == QDialog::Accepted)
+        {
+            const QString fileName = dialog.selectedFile();
+            if (!fileName.isEmpty())
+                loadFile(fileName);
+        }
+    }
 
-        QFile file(fileName);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    void askLine()
+    {
+        LargeFileView *largeView = qobject_cast<LargeFileView *>(editorStack->currentWidget());
+        qint64 current = editor->textCursor().blockNumber() + 1;
+        qint64 count = editor->document()->blockCount();
+        if (largeView)
         {
-            QMessageBox::warning(this, "Ошибка", "Не удалось сохранить файл.");
+            // Пока индекс строк строится, число строк неизвестно.
+            current = qMax<qint64>(1, largeView->caretLine());
+            count = largeView->hasLineIndex() ? largeView->lineCount() : INT_MAX;
+        }
+        const QString label = count < INT_MAX ? QString("Строка (1–%1):").arg(count) : QString("Строка:");
+        bool ok = false;
+        const int line = QInputDialog::getInt(this, "Перейти к строке", label,
+                                              int(qMin<qint64>(current, INT_MAX)), 1, int(qMin<qint64>(count, INT_MAX)),
+                                              1, &ok);
+        if (!ok)
             return;
+        if (largeView)
+        {
+            largeView->goToLine(line);
+            largeView->setFocus();
         }
+        else
+        {
+            goToLine(line);
+        }
+    }
 
-        QTextStream out(&file);
-        out << editor->toPlainText();
-        file.close();
-        currentFile = fileName;
+    void showCursorPosition()
+    {
+        if (LargeFileView *largeView = qobject_cast<LargeFileView *>(editorStack->currentWidget()))
+        {
+            const qint64 line = largeView->caretLine();
+            cursorPosition->setText(QString("Стр. %1, стлб. %2")
+                                        .arg(line > 0 ? QString::number(line) : QString("…"))
+                                        .arg(largeView->caretColumn()));
+            return;
+        }
+        const QTextCursor cursor = editor->textCursor();
+        cursorPosition->setText(QString("Стр. %1, стлб. %2").arg(cursor.blockNumber() + 1).arg(cursor.positionInBlock() + 1));
+    }
+
+    void goToLine(int line)
+    {
+        const QTextBlock block = editor->document()->findBlockByNumber(line - 1);
+        if (!block.isValid())
+            return;
+        QTextCursor cursor(block);
+        editor->setTextCursor(cursor);
+        editor->ensureCursorVisible();
+        editor->setFocus();
+    }
+
+    void onSaveFailed(const QString &fileName, const QString &error)
+    {
+        const int index = documents->indexOf(fileName);
+        if (index >= 0)
+        {
+            const DocumentManager::Document &document = documents->document(index);
+            if (document.largeView)
+                document.largeView->finishSave(fileName, false);
+            else if (document.text)
+                document.text->setModified(true);
+        }
+        statusBar()->clearMessage();
+        const bool closing = closeAfterSave.remove(fileName);
+        QMessageBox::warning(this, "Ошибка",
+                             QString("Не удалось сохранить файл.%1\n").arg(closing ? " Вкладка не закрыта." : "") + error);
     }
 
     void openFolder()
@@ -175,8 +657,134 @@ private slots:
         QSettings settings("PablaIDE", "CodeEditor");
         settings.setValue("lastFolderPath", dir);
 
-        fileModel->setRootPath(dir);
-        fileTree->setRootIndex(fileModel->index(dir));
+        projectFiles->setRoot(dir);
+        currentFolder = dir;
+        projectIndexer->setRoot(dir);
+        if (findPanel)
+            findPanel->setRoot(dir);
+    }
+
+    void finishStartup()
+    {
+        if (startupFinished)
+            return;
+        startupFinished = true;
+        StartupTrace::mark("first paint");
+        loadLastFolder();
+        if (terminalDock->isVisible())
+            createTerminal();
+        offerRecovery();
+        QTimer::singleShot(0, this, []
+                           { StartupTrace::mark("interactive"); });
+    }
+
+    // Журналы без владельца остались от сбоя или от выхода без сохранения.
+    void offerRecovery()
+    {
+        const QStringList journals = EditJournal::orphans(EditJournal::defaultDirectory());
+        if (journals.isEmpty())
+            return;
+        // Журнал удаляется только после восстановления или по явному
+        // «Удалить»; «Пропустить» оставляет его до следующего запуска.
+        const QMessageBox::StandardButton answer = QMessageBox::question(
+            this, "Восстановление",
+            QString("Найдены несохранённые правки из прошлого сеанса (документов: %1). Восстановить их?").arg(journals.size()),
+            QMessageBox::Yes | QMessageBox::Discard | QMessageBox::Ignore, QMessageBox::Yes);
+        if (answer == QMessageBox::Discard)
+        {
+            for (const QString &journal : journals)
+                EditJournal::remove(journal);
+            return;
+        }
+        if (answer != QMessageBox::Yes)
+            return;
+
+        QStringList errors;
+        for (const QString &journal : journals)
+        {
+            const int blank = documents->current() >= 0 && documents->isBlank(documents->current()) ? documents->current() : -1;
+            EditJournal::Recovery recovery;
+            QString error;
+            if (!EditJournal::recover(journal, &recovery, &error))
+            {
+                errors.append(QString("%1\nЖурнал оставлен: %2").arg(error, QDir::toNativeSeparators(journal)));
+                continue;
+            }
+            bool journaled = false;
+            openTab(documents->addRecovered(recovery.filePath, recovery.text, recovery.format, &journaled));
+            if (blank >= 0)
+                removeTab(blank);
+            if (!recovery.complete)
+                errors.append(QString("%1: последние правки повреждены").arg(documentTitle(documents->current())));
+            if (journaled)
+                EditJournal::remove(journal);
+            else
+                errors.append(QString("%1: новый журнал не записан\nЖурнал оставлен: %2")
+                                  .arg(documentTitle(documents->current()), QDir::toNativeSeparators(journal)));
+        }
+        if (!errors.isEmpty())
+            QMessageBox::warning(this, "Восстановление", errors.join('\n'));
+    }
+
+    void createFileTree()
+    {
+        if (fileTree)
+            return;
+        fileTree = new QTreeView(fileTreeDock);
+        fileModel = new FileTreeModel(projectFiles, this);
+        fileTree->setModel(fileModel);
+        fileTree->setHeaderHidden(true);
+        fileTree->setUniformRowHeights(true);
+        fileTreeDock->setWidget(fileTree);
+        connect(fileTree, &QTreeView::doubleClicked, this, &CodeEditor::openFileFromTree);
+    }
+
+    void createTerminal()
+    {
+        if (terminal)
+            return;
+        terminal = new TerminalWidget(this);
+        terminal->setBuiltinCommands({"start theme", "trace save", "trace reset"});
+        terminalDock->setWidget(terminal);
+        connect(terminal, &TerminalWidget::commandEntered, this, &CodeEditor::processCommand);
+        QString error;
+        if (!terminal->start(currentFolder.isEmpty() ? QDir::homePath() : currentFolder, &error))
+            terminal->showMessage(QString("Не удалось запустить оболочку: %1").arg(error));
+    }
+
+    OutputConsole *outputConsole()
+    {
+        if (!output)
+        {
+            output = new OutputConsole(this);
+            QSettings settings("PablaIDE", "CodeEditor");
+            output->setScrollback(settings.value("outputScrollback", OutputConsole::DefaultScrollback).toInt());
+            outputDock->setWidget(output);
+        }
+        return output;
+    }
+
+    FindInFilesPanel *findInFilesPanel()
+    {
+        if (!findPanel)
+        {
+            findPanel = new FindInFilesPanel(this);
+            findPanel->setRoot(currentFolder);
+            findDock->setWidget(findPanel);
+            connect(findPanel, &FindInFilesPanel::locationActivated, this, &CodeEditor::openLocation);
+        }
+        return findPanel;
+    }
+
+    BuildPanel *buildResults()
+    {
+        if (!buildPanel)
+        {
+            buildPanel = new BuildPanel(this);
+            buildDock->setWidget(buildPanel);
+            connect(buildPanel, &BuildPanel::locationActivated, this, &CodeEditor::openLocation);
+        }
+        return buildPanel;
     }
 
     void loadLastFolder()
@@ -185,33 +793,357 @@ private slots:
         QString lastPath = settings.value("lastFolderPath", "").toString();
         if (!lastPath.isEmpty() && QDir(lastPath).exists())
         {
-            fileModel->setRootPath(lastPath);
-            fileTree->setRootIndex(fileModel->index(lastPath));
+            projectFiles->setRoot(lastPath);
+            currentFolder = lastPath;
+            projectIndexer->setRoot(lastPath);
+            if (findPanel)
+                findPanel->setRoot(lastPath);
         }
     }
 
     void openFileFromTree(const QModelIndex &index)
     {
-        QFileInfo fileInfo = fileModel->fileInfo(index);
-        if (fileInfo.isFile())
+        if (!fileModel->isDir(index))
         {
-            loadFile(fileInfo.filePath());
+            loadFile(fileModel->filePath(index));
         }
     }
 
     void loadFile(const QString &fileName)
     {
-        QFile file(fileName);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        // Уже открытый файл только показывается.
+        const int existing = documents->indexOf(fileName);
+        if (existing >= 0)
+        {
+            selectTab(existing);
+            return;
+        }
+        // Пустая безымянная вкладка заменяется открытым файлом.
+        const int blank = documents->current() >= 0 && documents->isBlank(documents->current()) ? documents->current() : -1;
+
+        // Большие файлы открываются без чтения целиком: через отображение в
+        // память. Туда же идут файлы с очень длинными строками (минифицированный
+        // код): их QTextEdit раскладывает и подсвечивает целиком.
+        QSettings settings("PablaIDE", "CodeEditor");
+        const qint64 threshold = settings.value("largeFileThreshold", qint64(32) * 1024 * 1024).toLongLong();
+        const qint64 longLineThreshold =
+            settings.value("longLineThreshold", LargeFileView::DefaultLongLineThreshold).toLongLong();
+        LargeFileView *largeView = nullptr;
+        const bool large = QFileInfo(fileName).size() >= threshold;
+        if (large || LargeFileView::hasLongLine(fileName, longLineThreshold))
         {
+            largeView = new LargeFileView(this);
+            largeView->setWordWrap(wordWrapAction->isChecked());
+            LatencyTracer::watch(largeView);
+            if (!largeView->openFile(fileName))
+            {
+                delete largeView;
+                pendingLine = 0;
+                QMessageBox::warning(this, "Ошибка", "Не удалось открыть файл.");
+                return;
+            }
+            editorStack->addWidget(largeView);
+            KeyPressHandler *largeViewKeys = new KeyPressHandler(largeView, largeView);
+            connect(largeViewKeys, &KeyPressHandler::saveRequested, this, &CodeEditor::saveFile);
+            connect(largeView, &LargeFileView::modificationChanged, this, [this, largeView]
+                    { updateTab(documents->indexOf(largeView)); });
+            connect(largeView, &LargeFileView::caretMoved, this, &CodeEditor::showCursorPosition);
+            connect(largeView, &LargeFileView::lineIndexReady, this, [this](bool utf8)
+                    {
+                        if (!utf8)
+                            statusBar()->showMessage("Файл не в UTF-8: текст может отображаться неверно", 5000); });
+            if (!large)
+                statusBar()->showMessage("В файле есть очень длинные строки: он открыт в режиме больших файлов", 5000);
+        }
+
+        openTab(documents->add(fileName, largeView));
+        if (blank >= 0)
+            removeTab(blank);
+    }
+
+    void openTab(int index)
+    {
+        tabBar->addTab(QString());
+        updateTab(index);
+        selectTab(index);
+        updateWatchedDirectories();
+    }
+
+    void selectTab(int index)
+    {
+        if (tabBar->currentIndex() == index)
+            showDocument(index);
+        else
+            tabBar->setCurrentIndex(index);
+    }
+
+    void showDocument(int index)
+    {
+        if (index < 0 || index >= documents->count())
+            return;
+        // Загружается всегда текущий документ, его строку применит finishLoading().
+        if (index == documents->current() && fileLoader->isRunning())
+            return;
+        if (fileLoader->isRunning())
+        {
+            fileLoader->cancel();
+            endLoading();
+        }
+
+        const bool ready = documents->activate(index);
+        const DocumentManager::Document &document = documents->document(index);
+        if (document.largeView)
+        {
+            if (pendingLine > 0)
+                document.largeView->goToLine(pendingLine);
+            pendingLine = 0;
+            findBar->setTarget(document.largeView);
+            editorStack->setCurrentWidget(document.largeView);
+            document.largeView->setFocus();
+            showCursorPosition();
+            return;
+        }
+        editorStack->setCurrentWidget(editor);
+        if (!ready)
+        {
+            findBar->clearTarget();
+            startLoading(document.filePath);
+            return;
+        }
+        findBar->setTarget(editor, document.undo);
+        if (pendingLine > 0)
+        {
+            goToLine(pendingLine);
+            pendingLine = 0;
+        }
+        restyleVisible();
+        showCursorPosition();
+    }
+
+    void closeTab(int index)
+    {
+        if (index < 0 || index >= documents->count())
+            return;
+        if (documents->isModified(index))
+        {
+            selectTab(index);
+            const QMessageBox::StandardButton answer =
+                QMessageBox::question(this, "Закрыть вкладку", QString("Сохранить изменения в %1?").arg(documentTitle(index)),
+                                      QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
+            if (answer == QMessageBox::Cancel)
+                return;
+            if (answer == QMessageBox::Save)
+            {
+                // Закроется из onFileSaved(), когда файл будет записан.
+                if (saveFile())
+                    closeAfterSave.insert(documents->document(index).filePath);
+                return;
+            }
+        }
+        removeTab(index);
+    }
+
+    void removeTab(int index)
+    {
+        closeAfterSave.remove(documents->document(index).filePath);
+        if (index == documents->current() && fileLoader->isRunning())
+        {
+            fileLoader->cancel();
+            endLoading();
+        }
+        documents->remove(index);
+        tabBar->removeTab(index);
+        if (tabBar->count() == 0)
+            createNewFile();
+        updateWatchedDirectories();
+    }
+
+    // Наблюдаются каталоги файлов, а не сами файлы: запись через временный
+    // файл и переименование (git, многие генераторы) заменяет файл новым.
+    void updateWatchedDirectories()
+    {
+        QSet<QString> directories;
+        for (int i = 0; i < documents->count(); ++i)
+        {
+            const DocumentManager::Document &document = documents->document(i);
+            if (!document.filePath.isEmpty() && !document.largeView)
+                directories.insert(QFileInfo(document.filePath).absolutePath());
+        }
+        for (const QString &directory : std::as_const(watchedDirectories))
+        {
+            if (!directories.contains(directory))
+                documentWatcher->removeDirectory(directory);
+        }
+        for (const QString &directory : std::as_const(directories))
+        {
+            if (!watchedDirectories.contains(directory))
+                documentWatcher->addDirectory(directory);
+        }
+        watchedDirectories = directories;
+    }
+
+    // directory пусто — проверяются все документы. Документ без правок
+    // перечитывается сразу, с правками — после вопроса.
+    void checkDiskChanges(const QString &directory)
+    {
+        // Своё сохранение ещё пишется; проверка повторится по его окончании.
+        if (fileSaver->isRunning() || fileSaver->hasQueued())
+            return;
+        for (int i = 0; i < documents->count(); ++i)
+        {
+            const QString filePath = documents->document(i).filePath;
+            if ((!directory.isEmpty() && QFileInfo(filePath).absolutePath() != directory) || diskPrompts.contains(filePath)
+                || !documents->changedOnDisk(i))
+                continue;
+            if (documents->isModified(i))
+            {
+                diskPrompts.insert(filePath);
+                const QMessageBox::StandardButton answer = QMessageBox::question(
+                    this, "Файл изменён",
+                    QString("Файл %1 изменён на диске. Загрузить новую версию? Несохранённые правки можно будет вернуть отменой.")
+                        .arg(QFileInfo(filePath).fileName()));
+                diskPrompts.remove(filePath);
+                // Пока висел вопрос, вкладки могли закрыть.
+                i = documents->indexOf(filePath);
+                if (i < 0)
+                    break;
+                if (answer != QMessageBox::Yes)
+                {
+                    documents->ignoreDiskChange(i);
+                    continue;
+                }
+            }
+            const DocumentManager::Document &document = documents->document(i);
+            fileReloader->reload(filePath, document.text->toRawText(), document.undo->revision());
+        }
+    }
+
+    void onReloaded(const FileReloader::Result &result)
+    {
+        const int index = documents->indexOf(result.filePath);
+        if (index < 0)
+            return;
+        const DocumentManager::Document &document = documents->document(index);
+        if (!document.text || !document.loaded || document.undo->revision() != result.revision)
+        {
+            // Документ правили или выгрузили, пока файл сравнивался.
+            checkDiskChanges(QFileInfo(result.filePath).absolutePath());
+            return;
+        }
+        documents->applyReload(index, result);
+        updateTab(index);
+        scheduleReindex(result.filePath);
+        if (!result.edits.isEmpty())
+            statusBar()->showMessage(QString("%1 обновлён с диска (изменённых мест: %2)")
+                                         .arg(documentTitle(index))
+                                         .arg(result.edits.size()),
+                                     5000);
+    }
+
+    QString documentTitle(int index) const
+    {
+        const QString &filePath = documents->document(index).filePath;
+        return filePath.isEmpty() ? QString("Без имени") : QFileInfo(filePath).fileName();
+    }
+
+    void updateTab(int index)
+    {
+        if (index < 0 || index >= tabBar->count())
+            return;
+        tabBar->setTabText(index, documentTitle(index) + (documents->isModified(index) ? " *" : ""));
+        tabBar->setTabToolTip(index, documents->document(index).filePath);
+    }
+
+    void startLoading(const QString &fileName)
+    {
+        editor->setReadOnly(true);
+        firstScreenShown = false;
+        loadTimer.start();
+        loadProgress->setValue(0);
+        loadProgress->show();
+        cancelLoadButton->show();
+        fileLoader->load(fileName);
+    }
+
+    void appendLoadedChunk(const QString &text)
+    {
+        QTextCursor cursor(editor->document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(text);
+
+        if (!firstScreenShown)
+        {
+            // repaint() синхронный, поэтому замер включает первую отрисовку.
+            firstScreenShown = true;
+            editor->viewport()->repaint();
+            firstScreenMs = loadTimer.elapsed();
+            statusBar()->showMessage(QString("Первый экран: %1 мс").arg(firstScreenMs));
+        }
+    }
+
+    void finishLoading(const QString &fileName, bool ok)
+    {
+        endLoading();
+        if (!ok)
+        {
+            pendingLine = 0;
+            removeTab(documents->current());
             QMessageBox::warning(this, "Ошибка", "Не удалось открыть файл.");
             return;
         }
+        // Файл сохраняется так же, как прочитан: в той же кодировке, с тем
+        // же BOM и переводом строки.
+        documents->finishLoading(documents->current(), fileLoader->textFormat());
+        findBar->setTarget(editor, documents->currentUndo());
+        statusBar()->showMessage(QString("%1 (%2): первый экран %3 мс, загрузка %4 мс")
+                                     .arg(QFileInfo(fileName).fileName(), fileLoader->encodingName())
+                                     .arg(firstScreenShown ? firstScreenMs : loadTimer.elapsed())
+                                     .arg(loadTimer.elapsed()),
+                                 10000);
+
+        if (pendingLine > 0)
+        {
+            goToLine(pendingLine);
+            pendingLine = 0;
+        }
+    }
+
+    void cancelLoading()
+    {
+        fileLoader->cancel();
+        endLoading();
+        pendingLine = 0;
+        removeTab(documents->current());
+        statusBar()->showMessage("Загрузка отменена.", 5000);
+    }
 
-        QTextStream in(&file);
-        editor->setText(in.readAll());
-        file.close();
-        currentFile = fileName;
+    void endLoading()
+    {
+        loadProgress->hide();
+        cancelLoadButton->hide();
+        editor->setReadOnly(false);
+    }
+
+    void showUndoUsage(qint64 memoryBytes, qint64 diskBytes)
+    {
+        const double mb = 1024.0 * 1024.0;
+        QString text = QString("Отмена: %1 МБ").arg(memoryBytes / mb, 0, 'f', 1);
+        if (diskBytes > 0)
+            text += QString(" (+%1 МБ на диске)").arg(diskBytes / mb, 0, 'f', 1);
+        undoUsage->setText(text);
+    }
+
+    void showKeyLatency()
+    {
+        const LatencyTracer::Summary latency = LatencyTracer::summary();
+        if (latency.count == 0)
+        {
+            keyLatency->setText("Ввод: —");
+            return;
+        }
+        const auto ms = [](qint64 us)
+        { return QString::number(us / 1000.0, 'f', 1); };
+        keyLatency->setText(QString("Ввод: %1 / %2 / %3 мс").arg(ms(latency.p50Us), ms(latency.p99Us), ms(latency.maxUs)));
     }
 
     void buildProject()
@@ -222,15 +1154,89 @@ private slots:
             return;
         }
 
-        QProcess *process = new QProcess(this);
-        connect(process, &QProcess::readyReadStandardOutput, this, [this, process]()
-                { terminal->appendPlainText(process->readAllStandardOutput()); });
-        connect(process, &QProcess::readyReadStandardError, this, [this, process]()
-                { terminal->appendPlainText(process->readAllStandardError()); });
+        if (buildRunner->isRunning())
+        {
+            outputConsole()->appendMessage("Остановка сборки...");
+            buildRunner->cancel();
+            return;
+        }
+        startBuild();
+    }
+
+    // Каталог сборки: настройка buildDirectory (относительно папки проекта),
+    // иначе build/, если он сконфигурирован, иначе сама папка проекта.
+    QString projectBuildDirectory() const
+    {
+        QSettings settings("PablaIDE", "CodeEditor");
+        QString buildDirectory = settings.value("buildDirectory").toString();
+        if (buildDirectory.isEmpty())
+            buildDirectory = QFileInfo::exists(currentFolder + "/build/CMakeCache.txt") ? "build" : ".";
+        return QDir::cleanPath(QDir(currentFolder).absoluteFilePath(buildDirectory));
+    }
+
+    int startBuild()
+    {
+        const int id = buildRunner->start(projectBuildDirectory(), buildJobs->value());
+        if (id == 0)
+        {
+            outputConsole()->appendMessage("Очередь задач переполнена, сборка не запущена.");
+            return 0;
+        }
+        buildResults()->clear();
+        outputDock->raise();
+        buildAction->setText("Остановить");
+        return id;
+    }
+
+    void onBuildFinished(const TaskResult &result)
+    {
+        buildAction->setText("Собрать");
+        if (!result.cancelled)
+            outputConsole()->appendMessage(QString("Ошибок: %1, предупреждений: %2")
+                                      .arg(buildResults()->errorCount())
+                                      .arg(buildResults()->warningCount()));
+
+        // Профиль только если журнал Ninja обновила именно эта сборка.
+        const QString ninjaLog = buildRunner->buildDirectory() + "/.ninja_log";
+        BuildProfile profile;
+        if (!result.cancelled && QFileInfo(ninjaLog).lastModified().toSecsSinceEpoch() >= buildRunner->startedAt().toSecsSinceEpoch()
+            && BuildProfile::load(ninjaLog, profile))
+        {
+            buildResults()->setProfile(profile);
+            if (profile.wallMs > 0)
+                outputConsole()->appendMessage(QString("Профиль сборки: %1 шагов, самый долгий — %2 (%3 мс)")
+                                          .arg(profile.steps.size())
+                                          .arg(profile.steps.first().output)
+                                          .arg(profile.steps.first().durationMs()));
+        }
+
+        if (buildResults()->errorCount() + buildResults()->warningCount() > 0)
+        {
+            buildDock->show();
+            buildDock->raise();
+        }
+        else if (!profile.isEmpty())
+        {
+            buildResults()->showProfile();
+        }
+    }
 
-        terminal->appendPlainText("Сборка проекта...");
-        process->setWorkingDirectory(currentFolder);
-        process->start("cmake --build .");
+    void onTaskFinished(int, const TaskSpec &spec, const TaskResult &result)
+    {
+        if (result.cancelled)
+        {
+            outputConsole()->appendMessage(spec.name + ": отменено");
+            return;
+        }
+        QString stats = QString("%1: %2 (код %3) за %4 мс")
+                            .arg(spec.name, result.success ? "готово" : "ошибка")
+                            .arg(result.exitCode)
+                            .arg(result.wallMs);
+        if (result.cpuMs >= 0)
+            stats += QString(", процессор %1 мс").arg(result.cpuMs);
+        if (result.peakRssKb > 0)
+            stats += QString(", пик памяти %1 МБ").arg(result.peakRssKb / 1024);
+        outputConsole()->appendMessage(stats);
     }
 
     void runProject()
@@ -241,61 +1247,144 @@ private slots:
             return;
         }
 
-        QProcess *process = new QProcess(this);
-        connect(process, &QProcess::readyReadStandardOutput, this, [this, process]()
-                { terminal->appendPlainText(process->readAllStandardOutput()); });
-        connect(process, &QProcess::readyReadStandardError, this, [this, process]()
-                { terminal->appendPlainText(process->readAllStandardError()); });
+        RunConfig config = RunConfig::load(currentFolder);
+        if (config.isEmpty())
+        {
+            if (!configureRun())
+                return;
+            config = RunConfig::load(currentFolder);
+        }
 
-        terminal->appendPlainText("Запуск проекта...");
-        process->setWorkingDirectory(currentFolder);
-        process->start("./untitled20");
-    }
+        // Повторный запуск отменяет прежние сборку и запуск, а не соревнуется с ними.
+        const int buildId = config.buildFirst ? startBuild() : 0;
+        if (config.buildFirst && buildId == 0)
+            return;
 
-    void applyDarkTheme()
-    {
-        qApp->setStyleSheet("QTextEdit { background-color: #2b2b2b; color: #ffffff; }"
-                            "QTreeView { background-color: #2b2b2b; color: #ffffff; }"
-                            "QPlainTextEdit { background-color: #2b2b2b; color: #ffffff; }");
+        const QDir root(currentFolder);
+        TaskSpec spec;
+        spec.name = "Запуск";
+        spec.program = root.absoluteFilePath(config.program);
+        spec.arguments = QProcess::splitCommand(config.arguments);
+        spec.workingDirectory = root.absoluteFilePath(config.workingDirectory.isEmpty() ? "." : config.workingDirectory);
+        spec.group = "run";
+        if (taskRunner->submit(spec, buildId) == 0)
+            outputConsole()->appendMessage("Очередь задач переполнена, запуск не выполнен.");
+        outputDock->raise();
     }
 
-    void applyLightTheme()
+    bool configureRun()
     {
-        qApp->setStyleSheet("QTextEdit { background-color: #ffffff; color: #000000; }"
-                            "QTreeView { background-color: #ffffff; color: #000000; }"
-                            "QPlainTextEdit { background-color: #ffffff; color: #000000; }");
+        if (currentFolder.isEmpty())
+        {
+            QMessageBox::warning(this, "Ошибка", "Сначала откройте папку проекта.");
+            return false;
+        }
+        RunConfig config = RunConfig::load(currentFolder);
+        if (config.isEmpty())
+        {
+            const QString guess = RunConfig::guessProgram(projectBuildDirectory());
+            if (!guess.isEmpty())
+                config.program = QDir(currentFolder).relativeFilePath(guess);
+        }
+        RunConfigDialog dialog(config, currentFolder, this);
+        if (dialog.exec() != QDialog::Accepted || dialog.config().isEmpty())
+            return false;
+        dialog.config().save(currentFolder);
+        return true;
     }
 
-    void applyDarkBlueTheme()
+    // Тема меняет палитру приложения, а не таблицу стилей, поэтому виджеты
+    // не полируются заново. В документе перекрашиваются только видимые
+    // строки, без повторного разбора текста.
+    void applyTheme(const QString &id)
     {
-        qApp->setStyleSheet("QTextEdit { background-color: #1e1e2f; color: #dcdcdc; }"
-                            "QTreeView { background-color: #1e1e2f; color: #dcdcdc; }"
-                            "QPlainTextEdit { background-color: #1e1e2f; color: #dcdcdc; }");
+        auto theme = std::find_if(themes.cbegin(), themes.cend(), [&id](const Theme &other)
+                                  { return other.id == id; });
+        if (theme == themes.cend())
+            return;
+
+        QElapsedTimer timer;
+        timer.start();
+        Theme::setCurrent(*theme);
+        qApp->setPalette(theme->hasPalette ? theme->palette : defaultPalette);
+        restyleVisible();
+        const double elapsedMs = timer.nsecsElapsed() / 1e6;
+
+        for (QAction *action : themeActions->actions())
+            action->setChecked(action->data().toString() == id);
+        QSettings("PablaIDE", "CodeEditor").setValue("theme", id);
+        statusBar()->showMessage(QString("Тема %1: %2 мс").arg(theme->name).arg(elapsedMs, 0, 'f', 1), 3000);
     }
 
-    void applyDraculaTheme()
+    void restyleVisible()
     {
-        qApp->setStyleSheet("QTextEdit { background-color:rgb(14, 0, 86); color:rgb(255, 255, 255); }"
-                            "QTreeView { background-color:rgb(14, 0, 86); color:rgb(255, 255, 255); }"
-                            "QPlainTextEdit { background-color:rgb(14, 0, 86); color:rgb(255, 255, 255); }");
+        const int index = documents->current();
+        if (index < 0 || editorStack->currentWidget() != editor)
+            return;
+        const DocumentManager::Document &document = documents->document(index);
+        if (!document.highlighter || editor->document() != document.text)
+            return;
+        const QTextBlock first = editor->cursorForPosition(QPoint(0, 0)).block();
+        const QTextBlock last = editor->cursorForPosition(QPoint(0, editor->viewport()->height())).block();
+        document.highlighter->setViewport(first, last);
+        document.highlighter->restyle(first, last);
     }
 
 private:
     QTextEdit *editor;
-    SyntaxHighlighter *highlighter;
+    QTabBar *tabBar;
+    DocumentManager *documents;
+    FileLoader *fileLoader;
+    QProgressBar *loadProgress;
+    QPushButton *cancelLoadButton;
+    QElapsedTimer loadTimer;
+    qint64 firstScreenMs = 0;
+    bool firstScreenShown = false;
+    FileSaver *fileSaver;
+    FileWatcher *documentWatcher;
+    FileReloader *fileReloader;
+    QSet<QString> watchedDirectories;
+    QSet<QString> diskPrompts; // файлы, о которых сейчас спрашивают
+    QSet<QString> closeAfterSave; // вкладки, которые закроются после записи файла
+    QStackedWidget *editorStack;
     KeyPressHandler *keyPressHandler;
+    QLabel *undoUsage;
+    QLabel *cursorPosition;
+    QLabel *keyLatency;
+    QVector<Theme> themes;
+    QPalette defaultPalette; // палитра платформы для тем без своей палитры
+    QActionGroup *themeActions;
     aftocomplet *autoComplete;
     QDockWidget *fileTreeDock;
-    QTreeView *fileTree;
-    QFileSystemModel *fileModel;
-    QPlainTextEdit *terminal;
-    QString currentFile;
+    QTreeView *fileTree = nullptr;
+    FileTreeModel *fileModel = nullptr;
+    ProjectFiles *projectFiles;
+    QDockWidget *terminalDock;
+    TerminalWidget *terminal = nullptr;
+    QAction *wordWrapAction;
+    OutputConsole *output = nullptr;
+    QDockWidget *outputDock;
     QString currentFolder;
+    ProjectIndexer *projectIndexer;
+    QTimer *reindexTimer;
+    FindInFilesPanel *findPanel = nullptr;
+    FindBar *findBar;
+    QDockWidget *findDock;
+    TaskRunner *taskRunner;
+    BuildRunner *buildRunner;
+    BuildPanel *buildPanel = nullptr;
+    QDockWidget *buildDock;
+    QAction *buildAction;
+    QSpinBox *buildJobs;
+    int pendingLine = 0;
+    bool startupFinished = false;
 };
 
 int main(int argc, char *argv[])
 {
-    QApplication app(argc, argv);
+    StartupTrace::start(argc, argv);
+    TracingApplication app(argc, argv);
+    StartupTrace::mark("application");
     CodeEditor editor;
     editor.setWindowTitle("Pabla IDE");
     editor.resize(1000, 600);
@@ -0,0 +1,163 @@
+#include "outputconsole.h"
+#include <QFontDatabase>
+#include <QMutexLocker>
+#include <QScrollBar>
+#include <QStringDecoder>
+#include <QThread>
+#include <algorithm>
+
+namespace {
+
+constexpr qsizetype RingCapacity = 4 * 1024 * 1024;
+constexpr qsizetype ReadChunk = 64 * 1024;
+constexpr qsizetype MaxOverflow = 16 * 1024 * 1024;
+constexpr int FrameMs = 16;
+
+} // namespace
+
+OutputConsole::OutputConsole(QWidget *parent)
+    : QPlainTextEdit(parent), ring(RingCapacity)
+{
+    setReadOnly(true);
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setMaximumBlockCount(scrollback);
+    setUndoRedoEnabled(false);
+
+    flushTimer.setInterval(FrameMs);
+    flushTimer.setSingleShot(true);
+    connect(&flushTimer, &QTimer::timeout, this, &OutputConsole::flush);
+
+    worker = QThread::create([this] { runWorker(); });
+    worker->start();
+}
+
+OutputConsole::~OutputConsole()
+{
+    stopping = true;
+    dataReady.release();
+    worker->wait();
+    delete worker;
+}
+
+void OutputConsole::setScrollback(int lines)
+{
+    scrollback = qMax(1, lines);
+    setMaximumBlockCount(scrollback);
+}
+
+// Что не влезло в кольцо, ждёт в overflow до следующего кадра. Начало
+// очереди сдвигается смещением, буфер уплотняется, когда прочитано больше
+// половины. Сверх MaxOverflow старые строки отбрасываются: их всё равно
+// вытеснило бы ограничение прокрутки.
+void OutputConsole::write(const QByteArray &bytes)
+{
+    if (!bytes.isEmpty())
+        atLineStart = bytes.endsWith('\n');
+    overflow.append(bytes);
+    if (overflow.size() - overflowStart > MaxOverflow)
+    {
+        qsizetype cut = overflow.indexOf('\n', overflow.size() - MaxOverflow);
+        cut = cut < 0 ? overflow.size() : cut + 1;
+        droppedLines += std::count(overflow.constData() + overflowStart, overflow.constData() + cut, '\n');
+        overflowStart = cut;
+    }
+
+    const qsizetype written = ring.write(overflow.constData() + overflowStart, overflow.size() - overflowStart);
+    overflowStart += written;
+    if (overflowStart == overflow.size())
+    {
+        overflow.clear();
+        overflowStart = 0;
+    }
+    else if (overflowStart > overflow.size() / 2)
+    {
+        overflow.remove(0, overflowStart);
+        overflowStart = 0;
+    }
+    if (written > 0)
+        dataReady.release();
+    if (!overflow.isEmpty())
+        scheduleFlush(); // остаток пойдёт в кольцо в следующем кадре
+}
+
+void OutputConsole::appendMessage(const QString &text)
+{
+    // Незавершённую строку процесса сообщение не продолжает.
+    write((atLineStart ? QByteArray() : QByteArray("\n")) + text.toUtf8() + '\n');
+}
+
+// Рабочий поток: забирает байты из кольца, декодирует и режет на строки.
+void OutputConsole::runWorker()
+{
+    QStringDecoder decoder(QStringConverter::Utf8);
+    QString partial;
+    QByteArray bytes(ReadChunk, Qt::Uninitialized);
+
+    while (!stopping)
+    {
+        dataReady.acquire();
+        dataReady.tryAcquire(dataReady.available());
+
+        QStringList lines;
+        for (;;)
+        {
+            const qsizetype count = ring.read(bytes.data(), bytes.size());
+            if (count == 0)
+                break;
+            partial += decoder(QByteArrayView(bytes.constData(), count));
+
+            qsizetype start = 0;
+            for (qsizetype newline = partial.indexOf('\n'); newline >= 0; newline = partial.indexOf('\n', start))
+            {
+                qsizetype end = newline;
+                if (end > start && partial.at(end - 1) == '\r')
+                    --end;
+                lines.append(partial.mid(start, end - start));
+                start = newline + 1;
+            }
+            partial.remove(0, start);
+        }
+        if (lines.isEmpty())
+            continue;
+
+        QMutexLocker locker(&pendingMutex);
+        // Кадр запускается, когда очередь перестаёт быть пустой; flush()
+        // забирает её целиком.
+        if (pendingLines.isEmpty())
+            QMetaObject::invokeMethod(this, &OutputConsole::scheduleFlush, Qt::QueuedConnection);
+        pendingLines.append(lines);
+        // Строки, которые всё равно вытеснит ограничение прокрутки, не копим.
+        while (pendingLines.size() > scrollback)
+        {
+            pendingLines.removeFirst();
+            ++droppedLines;
+        }
+    }
+}
+
+void OutputConsole::scheduleFlush()
+{
+    if (!flushTimer.isActive())
+        flushTimer.start();
+}
+
+void OutputConsole::flush()
+{
+    if (!overflow.isEmpty())
+        write(QByteArray());
+
+    QStringList lines;
+    {
+        QMutexLocker locker(&pendingMutex);
+        lines.swap(pendingLines);
+    }
+    if (lines.isEmpty())
+        return;
+
+    QScrollBar *bar = verticalScrollBar();
+    const bool atBottom = bar->value() == bar->maximum();
+    appendPlainText(lines.join('\n'));
+    appendedLines += lines.size();
+    if (atBottom)
+        bar->setValue(bar->maximum());
+}
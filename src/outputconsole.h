@@ -0,0 +1,57 @@
+#ifndef OUTPUTCONSOLE_H
+#define OUTPUTCONSOLE_H
+
+#include <QMutex>
+#include <QPlainTextEdit>
+#include <QSemaphore>
+#include <QStringList>
+#include <QTimer>
+#include <atomic>
+#include "bytering.h"
+
+class QThread;
+
+// Консоль вывода сборки и запуска. Вывод задач кладётся в кольцевой
+// буфер без блокировок, на строки его режет рабочий поток, а в виджет
+// они попадают не чаще раза за кадр одной пакетной вставкой. Таймер
+// кадра запускается, только когда есть что вставить.
+// Прокрутка ограничена maximumBlockCount: старые строки отрезаются сверху.
+class OutputConsole : public QPlainTextEdit {
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultScrollback = 10000;
+
+    explicit OutputConsole(QWidget *parent = nullptr);
+    ~OutputConsole() override;
+
+    void write(const QByteArray &bytes);
+    void appendMessage(const QString &text);
+    void setScrollback(int lines);
+
+    qint64 linesAppended() const { return appendedLines; }
+    qint64 linesDropped() const { return droppedLines; }
+
+private:
+    void scheduleFlush();
+    void flush();
+    void runWorker();
+
+    ByteRing ring;
+    QSemaphore dataReady;
+    std::atomic<bool> stopping{false};
+    QThread *worker;
+
+    QMutex pendingMutex;
+    QStringList pendingLines; // под pendingMutex
+
+    QTimer flushTimer; // однократный, до следующего кадра
+    QByteArray overflow; // то, что не влезло в кольцо при write(), с overflowStart
+    qsizetype overflowStart = 0;
+    bool atLineStart = true;
+    std::atomic<int> scrollback{DefaultScrollback};
+    qint64 appendedLines = 0;
+    std::atomic<qint64> droppedLines{0};
+};
+
+#endif // OUTPUTCONSOLE_H
@@ -0,0 +1,352 @@
+#include "pathtable.h"
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr int ParallelChunk = 32768;
+constexpr int NameBonus = 1000;
+
+struct Scored {
+    int score;
+    int length;
+    int id;
+};
+
+// Лучше ли a, чем b: выше оценка, короче путь, раньше добавлен.
+inline bool better(const Scored &a, const Scored &b)
+{
+    if (a.score != b.score)
+        return a.score > b.score;
+    if (a.length != b.length)
+        return a.length < b.length;
+    return a.id < b.id;
+}
+
+inline char fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+}
+
+inline bool isSeparator(char c)
+{
+    return c == '/' || c == '_' || c == '-' || c == '.' || c == ' ';
+}
+
+inline int bitOf(char c)
+{
+    const uchar u = uchar(fold(c));
+    if (u >= 'a' && u <= 'z')
+        return u - 'a';
+    if (u >= '0' && u <= '9')
+        return 26 + (u - '0');
+    if (u == '_')
+        return 36;
+    if (u == '-')
+        return 37;
+    if (u == '.')
+        return 38;
+    if (u == '/')
+        return -1;
+    return 39 + u % 25;
+}
+
+// Жадно укладывает запрос в текст как подпоследовательность. -1, если не удалось.
+int subsequenceScore(const char *p, int length, const char *query, int queryLength)
+{
+    int score = 0;
+    int previous = -2;
+    int q = 0;
+    for (int i = 0; i < length && q < queryLength; ++i)
+    {
+        if (fold(p[i]) != query[q])
+            continue;
+        int bonus = 10;
+        if (i == previous + 1)
+            bonus += 15;
+        else if (previous >= 0)
+            bonus -= qMin(i - previous - 1, 10);
+        if (i == 0 || isSeparator(p[i - 1]))
+            bonus += 20;
+        else if (p[i] >= 'A' && p[i] <= 'Z' && p[i - 1] >= 'a' && p[i - 1] <= 'z')
+            bonus += 10;
+        score += bonus;
+        previous = i;
+        ++q;
+    }
+    return q == queryLength ? score : -1;
+}
+
+} // namespace
+
+void PathTable::clear()
+{
+    text.clear();
+    entries.clear();
+    removedCount = 0;
+    idsByHash.clear();
+    idsByDir.clear();
+    lastQuery.clear();
+    lastCandidates.clear();
+}
+
+void PathTable::reserve(int paths, qsizetype characters)
+{
+    entries.reserve(paths);
+    text.reserve(characters);
+    idsByHash.reserve(paths);
+}
+
+quint64 PathTable::maskOf(const char *data, qsizetype length)
+{
+    quint64 mask = 0;
+    for (qsizetype i = 0; i < length; ++i)
+    {
+        const int bit = bitOf(data[i]);
+        if (bit >= 0)
+            mask |= quint64(1) << bit;
+    }
+    return mask;
+}
+
+int PathTable::add(const QString &path)
+{
+    const QByteArray utf8 = path.toUtf8();
+    if (utf8.isEmpty() || utf8.size() > 0xffff)
+        return -1;
+    Entry entry;
+    entry.offset = quint32(text.size());
+    entry.length = quint16(utf8.size());
+    entry.nameStart = quint16(utf8.lastIndexOf('/') + 1);
+    entry.mask = maskOf(utf8.constData(), utf8.size());
+    entry.nameMask = maskOf(utf8.constData() + entry.nameStart, utf8.size() - entry.nameStart);
+    text.append(utf8);
+    entries.append(entry);
+    link(entries.size() - 1);
+    lastQuery.clear();
+    return entries.size() - 1;
+}
+
+QByteArrayView PathTable::bytes(int id) const
+{
+    const Entry &entry = entries[id];
+    return QByteArrayView(text.constData() + entry.offset, entry.length);
+}
+
+void PathTable::link(int id)
+{
+    const QByteArrayView path = bytes(id);
+    idsByHash.insert(qHash(path), id);
+    idsByDir[path.first(entries[id].nameStart).toByteArray()].append(id);
+}
+
+int PathTable::find(const QString &path) const
+{
+    const QByteArray utf8 = path.toUtf8();
+    const auto range = idsByHash.equal_range(qHash(QByteArrayView(utf8)));
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const Entry &entry = entries[*it];
+        if (entry.length == utf8.size() && std::memcmp(text.constData() + entry.offset, utf8.constData(), entry.length) == 0)
+            return *it;
+    }
+    return -1;
+}
+
+bool PathTable::contains(const QString &path) const
+{
+    return find(path) >= 0;
+}
+
+QString PathTable::path(int id) const
+{
+    const Entry &entry = entries[id];
+    return QString::fromUtf8(text.constData() + entry.offset, entry.length);
+}
+
+QStringList PathTable::filesIn(const QString &dir) const
+{
+    const QByteArray prefix = dir.isEmpty() ? QByteArray() : dir.toUtf8() + '/';
+    QStringList result;
+    for (int id : idsByDir.value(prefix))
+        result.append(path(id));
+    return result;
+}
+
+void PathTable::remove(const QString &path)
+{
+    const int id = find(path);
+    if (id >= 0)
+        markRemoved(id);
+    compact();
+}
+
+// Просматриваются каталоги, а не записи: их на порядок меньше.
+void PathTable::removeUnder(const QString &dir)
+{
+    const QByteArray prefix = dir.toUtf8() + '/';
+    QVector<int> removed;
+    for (auto it = idsByDir.constBegin(); it != idsByDir.constEnd(); ++it)
+    {
+        if (it.key().startsWith(prefix))
+            removed += it.value();
+    }
+    for (int id : std::as_const(removed))
+        markRemoved(id);
+    compact();
+}
+
+void PathTable::markRemoved(int id)
+{
+    Entry &entry = entries[id];
+    if (entry.length == 0)
+        return;
+
+    const QByteArrayView path = bytes(id);
+    idsByHash.remove(qHash(path), id);
+    const auto dir = idsByDir.find(path.first(entry.nameStart).toByteArray());
+    if (dir != idsByDir.end())
+    {
+        dir->removeOne(id);
+        if (dir->isEmpty())
+            idsByDir.erase(dir);
+    }
+
+    entry.length = 0;
+    ++removedCount;
+    lastQuery.clear();
+}
+
+void PathTable::compact()
+{
+    if (removedCount < 1024 || removedCount < entries.size() / 4)
+        return;
+    QByteArray packedText;
+    QVector<Entry> packedEntries;
+    packedText.reserve(text.size());
+    packedEntries.reserve(entries.size() - removedCount);
+    for (const Entry &entry : std::as_const(entries))
+    {
+        if (entry.length == 0)
+            continue;
+        Entry moved = entry;
+        moved.offset = quint32(packedText.size());
+        packedText.append(text.constData() + entry.offset, entry.length);
+        packedEntries.append(moved);
+    }
+    text = packedText;
+    entries = packedEntries;
+    removedCount = 0;
+    lastQuery.clear();
+
+    idsByHash.clear();
+    idsByDir.clear();
+    for (int id = 0; id < entries.size(); ++id)
+        link(id);
+}
+
+QVector<int> PathTable::match(const QString &query, int limit) const
+{
+    QByteArray folded;
+    for (char c : query.toUtf8())
+    {
+        if (c != ' ')
+            folded.append(fold(c));
+    }
+    if (folded.isEmpty() || limit <= 0)
+        return {};
+
+    const quint64 queryMask = maskOf(folded.constData(), folded.size());
+    const bool narrowing = !lastQuery.isEmpty() && folded.startsWith(lastQuery);
+    const QVector<int> previous = narrowing ? lastCandidates : QVector<int>();
+    const int total = narrowing ? previous.size() : entries.size();
+
+    const int chunkCount = qBound(1, total / ParallelChunk, qMax(1, QThread::idealThreadCount()));
+    std::vector<QVector<int>> candidates(chunkCount);
+    std::vector<QVector<Scored>> tops(chunkCount);
+
+    auto process = [&](int chunk)
+    {
+        const int begin = int(qint64(total) * chunk / chunkCount);
+        const int end = int(qint64(total) * (chunk + 1) / chunkCount);
+        QVector<int> &found = candidates[chunk];
+        QVector<Scored> &top = tops[chunk]; // куча, худший элемент впереди
+        for (int i = begin; i < end; ++i)
+        {
+            const int id = narrowing ? previous[i] : i;
+            const Entry &entry = entries[id];
+            if (entry.length == 0 || (entry.mask & queryMask) != queryMask)
+                continue;
+
+            const char *p = text.constData() + entry.offset;
+            int score = (entry.nameMask & queryMask) == queryMask
+                ? subsequenceScore(p + entry.nameStart, entry.length - entry.nameStart, folded.constData(), folded.size())
+                : -1;
+            if (score >= 0)
+            {
+                score += NameBonus - (entry.length - entry.nameStart);
+            }
+            else
+            {
+                score = subsequenceScore(p, entry.length, folded.constData(), folded.size());
+                if (score < 0)
+                    continue;
+                score -= entry.length / 4;
+            }
+            found.append(id);
+
+            const Scored scored{score, entry.length, id};
+            if (top.size() < limit)
+            {
+                top.append(scored);
+                std::push_heap(top.begin(), top.end(), better);
+            }
+            else if (better(scored, top.front()))
+            {
+                std::pop_heap(top.begin(), top.end(), better);
+                top.back() = scored;
+                std::push_heap(top.begin(), top.end(), better);
+            }
+        }
+    };
+
+    if (chunkCount == 1)
+    {
+        process(0);
+    }
+    else
+    {
+        QSemaphore done;
+        for (int chunk = 1; chunk < chunkCount; ++chunk)
+        {
+            QThreadPool::globalInstance()->start([&process, &done, chunk]
+                                                 {
+                                                     process(chunk);
+                                                     done.release(); });
+        }
+        process(0);
+        done.acquire(chunkCount - 1);
+    }
+
+    lastQuery = folded;
+    lastCandidates.clear();
+    QVector<Scored> merged;
+    for (int chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        lastCandidates += candidates[chunk];
+        merged += tops[chunk];
+    }
+    std::sort(merged.begin(), merged.end(), better);
+    if (merged.size() > limit)
+        merged.resize(limit);
+
+    QVector<int> result;
+    result.reserve(merged.size());
+    for (const Scored &scored : std::as_const(merged))
+        result.append(scored.id);
+    return result;
+}
@@ -0,0 +1,65 @@
+#ifndef PATHTABLE_H
+#define PATHTABLE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Плоская таблица путей проекта для быстрого поиска файла по нечёткому
+// запросу. Все пути лежат подряд в одном буфере UTF-8 (регистр при
+// сравнении сворачивается только у ASCII), у каждой записи —
+// смещение, длина, начало имени файла и 64-битная маска встречающихся
+// символов. Запрос сначала отсеивает записи по маске, затем оставшиеся
+// оцениваются как подпоследовательность (бонусы за начало слова, подряд
+// идущие символы и совпадение в имени файла). Большие таблицы делятся
+// между потоками. Если запрос продолжает предыдущий, просматриваются
+// только прошлые кандидаты.
+//
+// Для обновлений по событиям наблюдателя записи дополнительно разложены
+// по хешу пути и по каталогу: find(), filesIn() и remove() не проходят
+// всю таблицу.
+class PathTable {
+public:
+    void clear();
+    void reserve(int paths, qsizetype characters);
+
+    int add(const QString &path);
+    void remove(const QString &path);
+    void removeUnder(const QString &dir);
+    bool contains(const QString &path) const;
+    QStringList filesIn(const QString &dir) const;
+
+    int size() const { return entries.size() - removedCount; }
+    QString path(int id) const;
+
+    QVector<int> match(const QString &query, int limit = 50) const;
+
+private:
+    struct Entry {
+        quint32 offset;
+        quint16 length;
+        quint16 nameStart;
+        quint64 mask;
+        quint64 nameMask; // только по имени файла
+    };
+
+    static quint64 maskOf(const char *text, qsizetype length);
+    QByteArrayView bytes(int id) const;
+    int find(const QString &path) const;
+    void link(int id);
+    void markRemoved(int id);
+    void compact();
+
+    QByteArray text;
+    QVector<Entry> entries; // удалённые записи имеют нулевую длину
+    int removedCount = 0;
+    QMultiHash<size_t, int> idsByHash;         // qHash пути UTF-8 → запись
+    QHash<QByteArray, QVector<int>> idsByDir; // каталог с '/' на конце (пусто — корень) → записи
+
+    mutable QByteArray lastQuery;
+    mutable QVector<int> lastCandidates;
+};
+
+#endif // PATHTABLE_H
@@ -0,0 +1,350 @@
+#include "piecetable.h"
+#include <algorithm>
+#include <cstring>
+
+bool PieceTable::open(const QString &fileName)
+{
+    clear();
+
+    QSharedPointer<QFile> mapped = QSharedPointer<QFile>::create(fileName);
+    if (!mapped->open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 fileSize = mapped->size();
+    if (fileSize > 0)
+    {
+        original = reinterpret_cast<const char *>(mapped->map(0, fileSize));
+        if (!original)
+            return false;
+        pieces.append({-1, 0, fileSize});
+        starts.append(0);
+    }
+    file = mapped;
+    totalSize = fileSize;
+    return true;
+}
+
+void PieceTable::clear()
+{
+    pieces.clear();
+    starts.clear();
+    buffers.clear();
+    original = nullptr;
+    file.reset();
+    totalSize = 0;
+    detached = false;
+    savedPieces.clear();
+}
+
+const char *PieceTable::pieceData(const Piece &piece) const
+{
+    if (piece.buffer < 0)
+        return original + piece.start;
+    return buffers[piece.buffer].constData() + piece.start;
+}
+
+int PieceTable::findPiece(qint64 pos, qint64 *pieceStart) const
+{
+    if (pos >= totalSize)
+    {
+        *pieceStart = totalSize;
+        return pieces.size();
+    }
+    const int i = qMax(0, int(std::upper_bound(starts.cbegin(), starts.cend(), pos) - starts.cbegin()) - 1);
+    *pieceStart = starts[i];
+    return i;
+}
+
+// Пересчитывает начала фрагментов с from до конца.
+void PieceTable::updateStarts(int from)
+{
+    starts.resize(pieces.size());
+    qint64 start = from > 0 ? starts[from - 1] + pieces[from - 1].length : 0;
+    for (int i = from; i < pieces.size(); ++i)
+    {
+        starts[i] = start;
+        start += pieces[i].length;
+    }
+}
+
+QByteArray PieceTable::read(qint64 pos, qint64 length) const
+{
+    QByteArray result;
+    if (pos < 0 || pos >= totalSize || length <= 0)
+        return result;
+    length = qMin(length, totalSize - pos);
+    result.reserve(length);
+
+    qint64 pieceStart = 0;
+    for (int i = findPiece(pos, &pieceStart); i < pieces.size() && result.size() < length; ++i)
+    {
+        const Piece &piece = pieces[i];
+        const qint64 offset = qMax<qint64>(0, pos - pieceStart);
+        const qint64 count = qMin(piece.length - offset, length - result.size());
+        result.append(pieceData(piece) + offset, count);
+        pieceStart += piece.length;
+    }
+    return result;
+}
+
+char PieceTable::at(qint64 pos) const
+{
+    qint64 pieceStart = 0;
+    const int i = findPiece(pos, &pieceStart);
+    if (pos < 0 || i >= pieces.size())
+        return '\0';
+    return pieceData(pieces[i])[pos - pieceStart];
+}
+
+// Дописывает байты в последний буфер добавления.
+PieceTable::Piece PieceTable::append(const char *data, qint64 length)
+{
+    if (buffers.isEmpty() || buffers.last().size() + length > BufferChunkSize)
+    {
+        QByteArray chunk;
+        chunk.reserve(qMax<qint64>(BufferChunkSize, length));
+        buffers.append(chunk);
+    }
+    const int buffer = buffers.size() - 1;
+    const qint64 bufferStart = buffers[buffer].size();
+    buffers[buffer].append(data, length);
+    return {buffer, bufferStart, length};
+}
+
+void PieceTable::insert(qint64 pos, const QByteArray &bytes)
+{
+    if (bytes.isEmpty() || pos < 0 || pos > totalSize)
+        return;
+
+    // Фрагменты ищутся по старому размеру, до увеличения totalSize.
+    const Piece inserted = append(bytes.constData(), bytes.size());
+    qint64 pieceStart = 0;
+    const int i = findPiece(pos, &pieceStart);
+    totalSize += bytes.size();
+
+    // Набор подряд продлевает последний фрагмент вместо создания нового.
+    if (i > 0 && pos == pieceStart)
+    {
+        Piece &piece = pieces[i - 1];
+        if (piece.buffer == inserted.buffer && piece.start + piece.length == inserted.start)
+        {
+            piece.length += bytes.size();
+            updateStarts(i);
+            return;
+        }
+    }
+
+    if (i == pieces.size() || pos == pieceStart)
+    {
+        pieces.insert(i, inserted);
+        updateStarts(i);
+        return;
+    }
+
+    const Piece piece = pieces[i];
+    const qint64 offset = pos - pieceStart;
+    pieces[i].length = offset;
+    pieces.insert(i + 1, inserted);
+    pieces.insert(i + 2, {piece.buffer, piece.start + offset, piece.length - offset});
+    updateStarts(i + 1);
+}
+
+// Затронутые фрагменты заменяются остатками первого и последнего из них.
+void PieceTable::remove(qint64 pos, qint64 length)
+{
+    if (pos < 0 || pos >= totalSize || length <= 0)
+        return;
+    length = qMin(length, totalSize - pos);
+    const qint64 end = pos + length;
+
+    qint64 firstStart = 0;
+    const int first = findPiece(pos, &firstStart);
+    qint64 lastStart = 0;
+    const int last = findPiece(end - 1, &lastStart);
+    const Piece head = pieces[first];
+    const Piece tail = pieces[last];
+
+    pieces.remove(first, last - first + 1);
+    int at = first;
+    if (firstStart < pos)
+        pieces.insert(at++, {head.buffer, head.start, pos - firstStart});
+    if (lastStart + tail.length > end)
+        pieces.insert(at, {tail.buffer, tail.start + (end - lastStart), lastStart + tail.length - end});
+    totalSize -= length;
+    updateStarts(first);
+}
+
+qint64 PieceTable::findForward(qint64 pos, char ch) const
+{
+    if (pos < 0)
+        pos = 0;
+    qint64 pieceStart = 0;
+    for (int i = findPiece(pos, &pieceStart); i < pieces.size(); ++i)
+    {
+        const Piece &piece = pieces[i];
+        const qint64 offset = qMax<qint64>(0, pos - pieceStart);
+        const char *data = pieceData(piece);
+        const void *hit = std::memchr(data + offset, ch, piece.length - offset);
+        if (hit)
+            return pieceStart + (static_cast<const char *>(hit) - data);
+        pieceStart += piece.length;
+    }
+    return -1;
+}
+
+qint64 PieceTable::findBackward(qint64 pos, char ch) const
+{
+    if (pos <= 0)
+        return -1;
+    pos = qMin(pos, totalSize);
+
+    qint64 pieceStart = 0;
+    int i = findPiece(pos - 1, &pieceStart);
+    qint64 limit = pos - pieceStart; // байт в текущем фрагменте до pos
+    while (i >= 0)
+    {
+        const char *data = pieceData(pieces[i]);
+        for (qint64 k = limit - 1; k >= 0; --k)
+        {
+            if (data[k] == ch)
+                return pieceStart + k;
+        }
+        if (--i >= 0)
+        {
+            pieceStart -= pieces[i].length;
+            limit = pieces[i].length;
+        }
+    }
+    return -1;
+}
+
+qint64 PieceTable::lineStart(qint64 pos) const
+{
+    return findBackward(pos, '\n') + 1;
+}
+
+qint64 PieceTable::nextLineStart(qint64 pos) const
+{
+    const qint64 newline = findForward(pos, '\n');
+    return newline < 0 ? -1 : newline + 1;
+}
+
+bool PieceTable::writeTo(QIODevice *device) const
+{
+    constexpr qint64 SliceSize = 4 * 1024 * 1024;
+    for (const Piece &piece : pieces)
+    {
+        const char *data = pieceData(piece);
+        for (qint64 written = 0; written < piece.length;)
+        {
+            const qint64 count = qMin(SliceSize, piece.length - written);
+            if (device->write(data + written, count) != count)
+                return false;
+            written += count;
+        }
+    }
+    return true;
+}
+
+// Фрагменты исходника не переставляются правками и идут по возрастанию
+// start, поэтому их места в сохранённом файле находятся одним проходом.
+void PieceTable::detach(const PieceTable &saved, const QString &savedFileName)
+{
+    struct Span {
+        qint64 start;
+        qint64 length;
+        qint64 offset; // в сохранённом файле
+    };
+    QVector<Span> spans;
+    qint64 offset = 0;
+    for (const Piece &piece : saved.pieces)
+    {
+        if (piece.buffer < 0 && saved.file == file)
+            spans.append({piece.start, piece.length, offset});
+        offset += piece.length;
+    }
+
+    savedPieces.clear();
+    savedPieces.reserve(pieces.size());
+    const auto add = [this](const Piece &piece)
+    {
+        if (!savedPieces.isEmpty())
+        {
+            Piece &last = savedPieces.last();
+            if (last.buffer == piece.buffer && last.start + last.length == piece.start)
+            {
+                last.length += piece.length;
+                return;
+            }
+        }
+        savedPieces.append(piece);
+    };
+    for (const Piece &piece : std::as_const(pieces))
+    {
+        if (piece.buffer >= 0)
+        {
+            add(piece);
+            continue;
+        }
+        const qint64 end = piece.start + piece.length;
+        auto span = std::upper_bound(spans.cbegin(), spans.cend(), piece.start, [](qint64 pos, const Span &s)
+                                     { return pos < s.start + s.length; });
+        for (qint64 pos = piece.start; pos < end;)
+        {
+            if (span != spans.cend() && span->start <= pos)
+            {
+                const qint64 spanEnd = qMin(end, span->start + span->length);
+                add({-1, span->offset + (pos - span->start), spanEnd - pos});
+                pos = spanEnd;
+                if (pos == span->start + span->length)
+                    ++span;
+            }
+            else
+            {
+                const qint64 gapEnd = span != spans.cend() ? qMin(end, span->start) : end;
+                add(append(original + pos, gapEnd - pos));
+                pos = gapEnd;
+            }
+        }
+    }
+
+    sourceName = file ? file->fileName() : QString();
+    sourceSize = file ? file->size() : 0;
+    savedName = savedFileName;
+    savedSize = saved.size();
+    file.reset();
+    original = nullptr;
+    detached = true;
+}
+
+bool PieceTable::attach(bool replaced)
+{
+    if (!detached)
+        return true;
+    detached = false;
+    const bool ok = replaced ? map(savedName, savedSize) : map(sourceName, sourceSize);
+    if (replaced)
+    {
+        pieces = savedPieces;
+        updateStarts(0);
+    }
+    savedPieces.clear();
+    if (!ok)
+        clear(); // фрагментам исходника не на что ссылаться
+    return ok;
+}
+
+bool PieceTable::map(const QString &fileName, qint64 expectedSize)
+{
+    QSharedPointer<QFile> mapped = QSharedPointer<QFile>::create(fileName);
+    if (!mapped->open(QIODevice::ReadOnly) || mapped->size() != expectedSize)
+        return false;
+    if (expectedSize > 0)
+    {
+        original = reinterpret_cast<const char *>(mapped->map(0, expectedSize));
+        if (!original)
+            return false;
+    }
+    file = mapped;
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+// Таблица фрагментов поверх отображённого в память файла. Исходный файл
+// не копируется: правки попадают в буферы добавления, а документ
+// описывается списком фрагментов (исходник или буфер, смещение, длина).
+// Начала фрагментов в документе хранятся рядом, так что фрагмент по
+// позиции находится двоичным поиском. Все позиции — в байтах UTF-8.
+class PieceTable {
+public:
+    PieceTable() = default;
+
+    bool open(const QString &fileName);
+    void clear();
+
+    qint64 size() const { return totalSize; }
+    int pieceCount() const { return pieces.size(); }
+
+    QByteArray read(qint64 pos, qint64 length) const;
+    char at(qint64 pos) const;
+
+    void insert(qint64 pos, const QByteArray &bytes);
+    void remove(qint64 pos, qint64 length);
+
+    // Поиск байта вперёд от pos (включительно) и назад от pos (не включая).
+    qint64 findForward(qint64 pos, char ch) const;
+    qint64 findBackward(qint64 pos, char ch) const;
+
+    qint64 lineStart(qint64 pos) const;
+    qint64 nextLineStart(qint64 pos) const;
+
+    // Потоково выводит все фрагменты, не собирая документ целиком.
+    bool writeTo(QIODevice *device) const;
+
+    // Замена исходного файла сохранённым: Windows не переименует файл
+    // поверх отображённого. detach() отпускает отображение, заранее
+    // переведя фрагменты исходника на их места в savedName, куда
+    // записана таблица saved (фрагменты, которых в ней нет, копируются в
+    // буфер). attach(true) отображает savedName, attach(false) — снова
+    // прежний исходник с прежними фрагментами. Между ними таблицу не
+    // читают, а её копии должны быть отпущены до замены файла.
+    void detach(const PieceTable &saved, const QString &savedName);
+    bool attach(bool replaced);
+    bool isDetached() const { return detached; }
+
+private:
+    struct Piece {
+        int buffer; // -1 — исходный файл, иначе индекс в buffers
+        qint64 start;
+        qint64 length;
+    };
+
+    static constexpr qint64 BufferChunkSize = 64 * 1024;
+
+    const char *pieceData(const Piece &piece) const;
+    int findPiece(qint64 pos, qint64 *pieceStart) const;
+    void updateStarts(int from);
+    Piece append(const char *data, qint64 length);
+    bool map(const QString &fileName, qint64 expectedSize);
+
+    QSharedPointer<QFile> file;
+    const char *original = nullptr;
+    QVector<Piece> pieces;
+    QVector<qint64> starts; // позиция начала каждого фрагмента
+    QVector<QByteArray> buffers; // растут только добавлением
+    qint64 totalSize = 0;
+
+    // Между detach() и attach().
+    bool detached = false;
+    QString sourceName;
+    qint64 sourceSize = 0;
+    QString savedName;
+    qint64 savedSize = 0;
+    QVector<Piece> savedPieces; // pieces, переведённые на savedName
+};
+
+#endif // PIECETABLE_H
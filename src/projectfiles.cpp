@@ -0,0 +1,276 @@
+#include "projectfiles.h"
+#include "filewatcher.h"
+#include "projectwalker.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QThread>
+#include <utility>
+
+ProjectFiles::ProjectFiles(QObject *parent)
+    : QObject(parent)
+{
+    watcher = new FileWatcher(this);
+#ifdef Q_OS_LINUX
+    // Запись в файл — тоже повод переиндексировать символы. В других
+    // системах это наблюдение за каждым файлом проекта, там хватает
+    // изменений списка: checkout и генераторы обычно пересоздают файлы.
+    watcher->setWatchContents(true);
+#endif
+    connect(watcher, &FileWatcher::directoryChanged, this, &ProjectFiles::onDirectoryChanged);
+}
+
+ProjectFiles::~ProjectFiles()
+{
+    cancel();
+}
+
+void ProjectFiles::setRoot(const QString &root)
+{
+    cancel();
+    rootPath = QDir::cleanPath(root);
+    walker = std::make_unique<ProjectWalker>(rootPath);
+    table.clear();
+    knownDirs.clear();
+    dirsChangedDuringScan.clear();
+    newSubtrees.clear();
+    watcher->clear();
+    watchLimitHit = false;
+    emit rootChanged(rootPath);
+    emit pathsChanged();
+
+    const quint64 id = ++generation;
+    std::shared_ptr<ScanState> state = std::make_shared<ScanState>();
+    current = state;
+    worker = QThread::create([this, state, id, root = rootPath] { run(state, root, id); });
+    worker->start(QThread::LowPriority);
+}
+
+QFileInfoList ProjectFiles::list(const QString &relativeDir)
+{
+    return walker ? walker->list(relativeDir) : QFileInfoList();
+}
+
+QString ProjectFiles::absolutePath(const QString &relativePath) const
+{
+    return relativePath.isEmpty() ? rootPath : rootPath + '/' + relativePath;
+}
+
+void ProjectFiles::cancel()
+{
+    if (!worker)
+        return;
+    current->cancelled = true;
+    finishWorker();
+    ++generation;
+}
+
+void ProjectFiles::finishWorker()
+{
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+    current.reset();
+}
+
+// Выполняется в рабочем потоке.
+void ProjectFiles::run(const std::shared_ptr<ScanState> &state, const QString &root, quint64 id)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    std::shared_ptr<ScanResult> result = std::make_shared<ScanResult>();
+    ProjectWalker(root).walk(
+        state->cancelled,
+        [&result](const QString &relativePath, const QFileInfo &)
+        { result->table.add(relativePath); },
+        [&result](const QString &relativePath, const QFileInfo &)
+        { result->directories.append(relativePath); });
+    if (state->cancelled)
+        return;
+
+    const qint64 elapsedMs = timer.elapsed();
+    QMetaObject::invokeMethod(this, [this, id, result, elapsedMs]
+                              {
+                                  if (id != generation)
+                                      return;
+                                  finishWorker();
+                                  table = std::move(result->table);
+                                  watch(QString());
+                                  for (const QString &dir : std::as_const(result->directories))
+                                  {
+                                      knownDirs.insert(dir);
+                                      watch(dir);
+                                  }
+                                  emit scanFinished(table.size(), knownDirs.size(), elapsedMs);
+                                  emit pathsChanged();
+                                  rescanChangedDuringScan(); }, Qt::QueuedConnection);
+}
+
+// Новые подкаталоги могут быть большими (распакованный архив, node_modules),
+// поэтому их обход идёт в рабочем потоке, как и первичный. Пока он идёт,
+// события наблюдателя копятся в dirsChangedDuringScan.
+void ProjectFiles::scanSubtrees()
+{
+    if (worker || newSubtrees.isEmpty())
+        return;
+
+    const QStringList subtrees = std::exchange(newSubtrees, QStringList());
+    const quint64 id = ++generation;
+    std::shared_ptr<ScanState> state = std::make_shared<ScanState>();
+    current = state;
+    worker = QThread::create([this, state, id, subtrees, root = rootPath]
+                             {
+        std::shared_ptr<ScanResult> result = std::make_shared<ScanResult>();
+        ProjectWalker walker(root);
+        for (const QString &dir : subtrees)
+        {
+            walker.walk(
+                state->cancelled,
+                [&result](const QString &relativePath, const QFileInfo &)
+                { result->table.add(relativePath); },
+                [&result](const QString &relativePath, const QFileInfo &)
+                { result->directories.append(relativePath); },
+                dir);
+        }
+        if (state->cancelled)
+            return;
+
+        QMetaObject::invokeMethod(this, [this, id, subtrees, result]
+                                  {
+                                      if (id != generation)
+                                          return;
+                                      finishWorker();
+                                      mergeSubtrees(subtrees, *result); }, Qt::QueuedConnection); });
+    worker->start(QThread::LowPriority);
+}
+
+void ProjectFiles::mergeSubtrees(const QStringList &subtrees, const ScanResult &result)
+{
+    // Таблица обхода свежая, номера в ней идут подряд.
+    for (int id = 0; id < result.table.size(); ++id)
+        table.add(result.table.path(id));
+    for (const QString &dir : result.directories)
+    {
+        knownDirs.insert(dir);
+        watch(dir);
+    }
+    for (const QString &dir : subtrees)
+        emit directoryChanged(dir);
+    emit pathsChanged();
+    rescanChangedDuringScan();
+}
+
+// События, пришедшие во время обхода, применяются к готовой таблице.
+void ProjectFiles::rescanChangedDuringScan()
+{
+    const QSet<QString> pending = std::exchange(dirsChangedDuringScan, QSet<QString>());
+    for (const QString &dir : pending)
+        rescanDirectory(dir);
+    if (!pending.isEmpty())
+        emit pathsChanged();
+    scanSubtrees();
+}
+
+void ProjectFiles::watch(const QString &relativeDir)
+{
+    if (watchLimitHit)
+        return;
+    if (!watcher->addDirectory(absolutePath(relativeDir)))
+    {
+        watchLimitHit = true;
+        emit watchLimitReached(watcher->count());
+    }
+}
+
+void ProjectFiles::onDirectoryChanged(const QString &path)
+{
+    if (rootPath.isEmpty())
+        return;
+    QString relativeDir = QDir(rootPath).relativeFilePath(path);
+    if (relativeDir == ".")
+        relativeDir.clear();
+    if (relativeDir.startsWith(".."))
+        return;
+
+    if (isScanning())
+    {
+        dirsChangedDuringScan.insert(relativeDir);
+    }
+    else
+    {
+        rescanDirectory(relativeDir);
+        emit pathsChanged();
+        scanSubtrees();
+    }
+    emit directoryChanged(relativeDir);
+}
+
+void ProjectFiles::forgetDirectory(const QString &relativeDir)
+{
+    table.removeUnder(relativeDir);
+    const QString prefix = relativeDir + '/';
+    newSubtrees.removeIf([&](const QString &dir)
+                         { return dir == relativeDir || dir.startsWith(prefix); });
+    for (auto it = knownDirs.begin(); it != knownDirs.end();)
+    {
+        if (*it == relativeDir || it->startsWith(prefix))
+        {
+            watcher->removeDirectory(absolutePath(*it));
+            it = knownDirs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void ProjectFiles::rescanDirectory(const QString &relativeDir)
+{
+    if (!relativeDir.isEmpty() && !QFileInfo(absolutePath(relativeDir)).isDir())
+    {
+        forgetDirectory(relativeDir);
+        return;
+    }
+
+    QSet<QString> presentFiles;
+    QSet<QString> presentDirs;
+    for (const QFileInfo &entry : list(relativeDir))
+    {
+        const QString relativePath = relativeDir.isEmpty() ? entry.fileName() : relativeDir + '/' + entry.fileName();
+        if (entry.isDir())
+            presentDirs.insert(relativePath);
+        else
+            presentFiles.insert(relativePath);
+    }
+
+    const QStringList knownFiles = table.filesIn(relativeDir);
+    for (const QString &file : knownFiles)
+    {
+        if (!presentFiles.remove(file))
+            table.remove(file);
+    }
+    for (const QString &file : std::as_const(presentFiles))
+        table.add(file);
+
+    // Исчезнувшие подкаталоги убираются целиком, новые ставятся в очередь
+    // на обход в рабочем потоке.
+    const QString prefix = relativeDir.isEmpty() ? QString() : relativeDir + '/';
+    QStringList vanished;
+    for (const QString &dir : std::as_const(knownDirs))
+    {
+        if (dir.startsWith(prefix) && dir.indexOf(QLatin1Char('/'), prefix.size()) < 0 && !presentDirs.contains(dir))
+            vanished.append(dir);
+    }
+    for (const QString &dir : vanished)
+        forgetDirectory(dir);
+
+    for (const QString &dir : std::as_const(presentDirs))
+    {
+        if (knownDirs.contains(dir))
+            continue;
+        knownDirs.insert(dir);
+        watch(dir);
+        newSubtrees.append(dir);
+    }
+}
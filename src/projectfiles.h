@@ -0,0 +1,80 @@
+#ifndef PROJECTFILES_H
+#define PROJECTFILES_H
+
+#include <QFileInfo>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include "pathtable.h"
+
+class QThread;
+class FileWatcher;
+class ProjectWalker;
+
+// Список файлов открытой папки: первичный обход в рабочем потоке
+// заполняет таблицу путей, дальше она поддерживается по событиям
+// наблюдателя — пересматривается только изменившийся каталог, а
+// появившиеся в нём подкаталоги обходятся тем же рабочим потоком.
+// В Linux directoryChanged сообщает и о записи в файлы каталога.
+// Номера в paths() меняются вместе с таблицей, об этом — pathsChanged().
+class ProjectFiles : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ProjectFiles(QObject *parent = nullptr);
+    ~ProjectFiles() override;
+
+    void setRoot(const QString &root);
+    QString root() const { return rootPath; }
+    bool isScanning() const { return worker != nullptr; }
+    const PathTable &paths() const { return table; }
+
+    // Содержимое каталога без исключённых записей.
+    QFileInfoList list(const QString &relativeDir);
+
+signals:
+    void rootChanged(const QString &root);
+    void scanFinished(int files, int directories, qint64 elapsedMs);
+    void directoryChanged(const QString &relativeDir);
+    void pathsChanged();
+    void watchLimitReached(int watchedDirectories);
+
+private slots:
+    void onDirectoryChanged(const QString &path);
+
+private:
+    struct ScanState {
+        std::atomic<bool> cancelled{false};
+    };
+    struct ScanResult {
+        PathTable table;
+        QStringList directories;
+    };
+
+    void run(const std::shared_ptr<ScanState> &state, const QString &root, quint64 id);
+    void scanSubtrees();
+    void mergeSubtrees(const QStringList &subtrees, const ScanResult &result);
+    void rescanChangedDuringScan();
+    void cancel();
+    void finishWorker();
+    void watch(const QString &relativeDir);
+    void rescanDirectory(const QString &relativeDir);
+    void forgetDirectory(const QString &relativeDir);
+    QString absolutePath(const QString &relativePath) const;
+
+    QThread *worker = nullptr;
+    std::shared_ptr<ScanState> current;
+    quint64 generation = 0;
+    QString rootPath;
+    std::unique_ptr<ProjectWalker> walker;
+    PathTable table;
+    QSet<QString> knownDirs;
+    QSet<QString> dirsChangedDuringScan;
+    QStringList newSubtrees; // новые каталоги, ждущие обхода в рабочем потоке
+    FileWatcher *watcher;
+    bool watchLimitHit = false;
+};
+
+#endif // PROJECTFILES_H
@@ -0,0 +1,390 @@
+#include "projectindexer.h"
+#include "lexer.h"
+#include "projectwalker.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+
+namespace {
+
+struct Candidate {
+    QString path; // относительно корня
+    qint64 mtime;
+    qint64 size;
+};
+
+// Значимый элемент исходника: слово или одиночный знак препинания.
+struct Item {
+    QString word; // пусто для знака препинания
+    QChar punct;
+    quint32 line;
+};
+
+const QSet<QString> &sourceSuffixes()
+{
+    static const QSet<QString> suffixes = {
+        "c", "cc", "cpp", "cxx", "c++", "h", "hh", "hpp", "hxx", "inl", "ipp",
+        "py", "js", "ts", "java", "cs", "go", "rs", "kt", "swift"};
+    return suffixes;
+}
+
+const QSet<QString> &typeWords()
+{
+    static const QSet<QString> words = {"class", "struct", "union", "enum", "namespace", "interface", "trait"};
+    return words;
+}
+
+const QSet<QString> &functionWords()
+{
+    static const QSet<QString> words = {"def", "fn", "func", "function", "fun"};
+    return words;
+}
+
+// Слова, после которых или вместо которых "имя(" — не определение функции.
+const QSet<QString> &nonDefinitionWords()
+{
+    static const QSet<QString> words = {
+        "if", "else", "for", "while", "do", "switch", "case", "return", "sizeof", "alignof",
+        "decltype", "catch", "throw", "new", "delete", "elif", "assert", "static_assert",
+        "defined", "typeof", "and", "or", "not", "in", "await", "yield", "co_return", "co_await"};
+    return words;
+}
+
+const QSet<QString> &trailingQualifiers()
+{
+    static const QSet<QString> words = {"const", "override", "final", "noexcept", "volatile", "mutable", "throw"};
+    return words;
+}
+
+QVector<Item> significantItems(const QString &text)
+{
+    const Lexer &lexer = Lexer::defaultLexer();
+    QVector<Item> items;
+    QVector<Token> tokens;
+    LexerState state;
+    quint32 line = 0;
+    qsizetype lineStart = 0;
+    while (lineStart <= text.size())
+    {
+        qsizetype lineEnd = text.indexOf(QLatin1Char('\n'), lineStart);
+        if (lineEnd < 0)
+            lineEnd = text.size();
+        ++line;
+
+        const QString lineText = text.mid(lineStart, lineEnd - lineStart);
+        tokens.clear();
+        state = lexer.tokenize(lineText, tokens, state);
+        for (const Token &token : tokens)
+        {
+            if (token.kind == TokenKind::Keyword || token.kind == TokenKind::Identifier)
+            {
+                items.append({lineText.mid(token.start, token.length), QChar(), line});
+            }
+            else if (token.kind == TokenKind::Text)
+            {
+                for (int i = token.start; i < token.start + token.length; ++i)
+                {
+                    if (!lineText[i].isSpace())
+                        items.append({QString(), lineText[i], line});
+                }
+            }
+        }
+        lineStart = lineEnd + 1;
+    }
+    return items;
+}
+
+bool isPunct(const QVector<Item> &items, qsizetype i, char ch)
+{
+    return i >= 0 && i < items.size() && items[i].word.isEmpty() && items[i].punct == QLatin1Char(ch);
+}
+
+bool isWord(const QVector<Item> &items, qsizetype i)
+{
+    return i >= 0 && i < items.size() && !items[i].word.isEmpty();
+}
+
+// Похоже ли "имя(...)" в позиции i на определение функции, а не на вызов.
+bool isFunctionDefinition(const QVector<Item> &items, qsizetype i)
+{
+    if (isPunct(items, i - 1, '.') || (isPunct(items, i - 1, '>') && isPunct(items, i - 2, '-')))
+        return false;
+    if (i > 0)
+    {
+        const Item &previous = items[i - 1];
+        if (!previous.word.isEmpty())
+        {
+            if (nonDefinitionWords().contains(previous.word))
+                return false;
+        }
+        else if (!QStringLiteral(":*&~>;{}").contains(previous.punct))
+        {
+            return false;
+        }
+    }
+
+    qsizetype j = i + 1;
+    int depth = 0;
+    for (; j < items.size(); ++j)
+    {
+        if (isPunct(items, j, '('))
+            ++depth;
+        else if (isPunct(items, j, ')') && --depth == 0)
+            break;
+        else if (isPunct(items, j, ';') || isPunct(items, j, '{'))
+            return false;
+    }
+
+    qsizetype k = j + 1;
+    while (k < items.size() && ((isWord(items, k) && trailingQualifiers().contains(items[k].word)) || isPunct(items, k, '&')))
+        ++k;
+    if (isPunct(items, k, '{'))
+        return true;
+    // Список инициализации конструктора: ") : base(...)", но не "::".
+    return isPunct(items, k, ':') && !isPunct(items, k + 1, ':') && isWord(items, k + 1);
+}
+
+} // namespace
+
+ProjectIndexer::ProjectIndexer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ProjectIndexer::~ProjectIndexer()
+{
+    cancel();
+}
+
+QString ProjectIndexer::indexFileName(const QString &root)
+{
+    const QByteArray key = QCryptographicHash::hash(QDir::cleanPath(root).toUtf8(), QCryptographicHash::Md5).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/index/" + QString::fromLatin1(key) + ".idx";
+}
+
+QVector<IndexedSymbol> ProjectIndexer::extractSymbols(const QString &text)
+{
+    const QVector<Item> items = significantItems(text);
+    QVector<IndexedSymbol> symbols;
+    for (qsizetype i = 0; i < items.size(); ++i)
+    {
+        const Item &item = items[i];
+        if (item.word.isEmpty())
+            continue;
+
+        if (item.word == "define" && isPunct(items, i - 1, '#') && isWord(items, i + 1) && items[i + 1].line == item.line)
+        {
+            symbols.append({items[i + 1].word.toUtf8(), items[i + 1].line, SymbolKind::Macro});
+            ++i;
+        }
+        else if (typeWords().contains(item.word))
+        {
+            qsizetype j = i + 1;
+            if (isWord(items, j) && (items[j].word == "class" || items[j].word == "struct"))
+                ++j; // enum class
+            // Макросы экспорта перед именем: class EXPORT Name
+            while (isWord(items, j) && isWord(items, j + 1) && items[j + 1].word != "final")
+                ++j;
+            if (!isWord(items, j))
+                continue;
+            const bool definition = isPunct(items, j + 1, '{') || isPunct(items, j + 1, ':') || isPunct(items, j + 1, '(')
+                                    || (isWord(items, j + 1) && items[j + 1].word == "final");
+            if (definition && !typeWords().contains(items[j].word))
+                symbols.append({items[j].word.toUtf8(), items[j].line, SymbolKind::Class});
+            i = j;
+        }
+        else if (functionWords().contains(item.word))
+        {
+            if (isWord(items, i + 1))
+            {
+                symbols.append({items[i + 1].word.toUtf8(), items[i + 1].line, SymbolKind::Function});
+                ++i;
+            }
+        }
+        else if (isPunct(items, i + 1, '(') && !nonDefinitionWords().contains(item.word) && isFunctionDefinition(items, i))
+        {
+            symbols.append({item.word.toUtf8(), item.line, SymbolKind::Function});
+        }
+    }
+    return symbols;
+}
+
+void ProjectIndexer::setRoot(const QString &root)
+{
+    cancel();
+    reindexPending = false;
+    rootPath = QDir::cleanPath(root);
+    symbolIndex.close();
+    if (!symbolIndex.open(indexFileName(rootPath)) || symbolIndex.root() != rootPath)
+        symbolIndex.close();
+    reindex();
+}
+
+void ProjectIndexer::reindex()
+{
+    if (rootPath.isEmpty())
+        return;
+    if (worker)
+    {
+        // Текущий проход не прерываем: после него будет ещё один, инкрементальный.
+        reindexPending = true;
+        return;
+    }
+
+    const quint64 id = ++generation;
+    std::shared_ptr<IndexState> state = std::make_shared<IndexState>();
+    current = state;
+    const QString root = rootPath;
+    worker = QThread::create([this, state, root, id] { run(state, root, id); });
+    worker->start(QThread::LowPriority);
+}
+
+void ProjectIndexer::cancel()
+{
+    if (!worker)
+        return;
+    current->cancelled = true;
+    finishWorker();
+    ++generation;
+}
+
+void ProjectIndexer::finishWorker()
+{
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+    current.reset();
+}
+
+// Выполняется в рабочем потоке.
+void ProjectIndexer::run(const std::shared_ptr<IndexState> &state, const QString &root, quint64 id)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto finish = [this, id, root](bool ok, const QString &error, int files, int symbols, int reused, qint64 elapsedMs)
+    {
+        QMetaObject::invokeMethod(this, [this, id, root, ok, error, files, symbols, reused, elapsedMs]
+                                  {
+                                      if (id != generation)
+                                          return;
+                                      finishWorker();
+                                      if (ok)
+                                      {
+                                          const QString fileName = indexFileName(root);
+                                          symbolIndex.close();
+                                          QFile::remove(fileName);
+                                          if (QFile::rename(fileName + ".new", fileName) && symbolIndex.open(fileName))
+                                              emit indexReady(files, symbols, reused, elapsedMs);
+                                          else
+                                              emit failed("Не удалось заменить файл индекса.");
+                                      }
+                                      else if (!error.isEmpty())
+                                      {
+                                          emit failed(error);
+                                      }
+                                      if (reindexPending)
+                                      {
+                                          reindexPending = false;
+                                          reindex();
+                                      } }, Qt::QueuedConnection);
+    };
+    auto reportProgress = [this, id](int done, int total)
+    {
+        QMetaObject::invokeMethod(this, [this, id, done, total]
+                                  {
+                                      if (id == generation)
+                                          emit progress(done, total); }, Qt::QueuedConnection);
+    };
+
+    QVector<Candidate> candidates;
+    ProjectWalker(root).walk(state->cancelled, [&candidates](const QString &relativePath, const QFileInfo &info)
+                        {
+                            if (sourceSuffixes().contains(info.suffix().toLower()))
+                                candidates.append({relativePath, info.lastModified().toMSecsSinceEpoch(), info.size()}); });
+    const QDir rootDir(root);
+    if (state->cancelled)
+        return;
+
+    // Неизменившиеся файлы переносятся из прошлого индекса.
+    QVector<IndexedFile> files(candidates.size());
+    QVector<int> changed;
+    int reused = 0;
+    {
+        SymbolIndex previous;
+        QHash<QString, int> previousFiles;
+        if (previous.open(indexFileName(root)) && previous.root() == root)
+        {
+            previousFiles.reserve(previous.fileCount());
+            for (int i = 0; i < previous.fileCount(); ++i)
+                previousFiles.insert(previous.filePath(i), i);
+        }
+        for (int i = 0; i < candidates.size(); ++i)
+        {
+            const Candidate &candidate = candidates[i];
+            files[i].path = candidate.path;
+            files[i].mtime = candidate.mtime;
+            files[i].size = candidate.size;
+            const int old = previousFiles.value(candidate.path, -1);
+            if (old >= 0 && previous.fileMtime(old) == candidate.mtime && previous.fileSize(old) == candidate.size)
+            {
+                files[i].symbols = previous.fileSymbols(old);
+                ++reused;
+            }
+            else
+            {
+                changed.append(i);
+            }
+        }
+    }
+
+    // Изменившиеся файлы разбираются пулом: каждый поток берёт следующий
+    // номер из общего счётчика, поэтому медленные файлы не тормозят остальные.
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+    QThreadPool pool;
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+    for (int t = 0; t < pool.maxThreadCount(); ++t)
+    {
+        pool.start([&]
+                   {
+                       for (;;)
+                       {
+                           const int n = next++;
+                           if (n >= changed.size() || state->cancelled)
+                               return;
+                           IndexedFile &indexed = files[changed[n]];
+                           if (indexed.size <= MaxFileSize)
+                           {
+                               QFile file(rootDir.filePath(indexed.path));
+                               if (file.open(QIODevice::ReadOnly))
+                                   indexed.symbols = extractSymbols(QString::fromUtf8(file.readAll()));
+                           }
+                           ++done;
+                       } });
+    }
+    while (!pool.waitForDone(100))
+        reportProgress(reused + done, candidates.size());
+    if (state->cancelled)
+        return;
+
+    int symbols = 0;
+    for (const IndexedFile &indexed : files)
+        symbols += indexed.symbols.size();
+
+    QDir().mkpath(QFileInfo(indexFileName(root)).absolutePath());
+    if (!SymbolIndex::write(indexFileName(root) + ".new", root, files))
+    {
+        finish(false, "Не удалось записать индекс символов.", 0, 0, 0, 0);
+        return;
+    }
+    finish(true, QString(), files.size(), symbols, reused, timer.elapsed());
+}
@@ -0,0 +1,60 @@
+#ifndef PROJECTINDEXER_H
+#define PROJECTINDEXER_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include "symbolindex.h"
+
+class QThread;
+
+// Фоновая индексация символов папки проекта. Обход и разбор идут в
+// рабочем потоке, файлы разбираются параллельно в пуле потоков тем же
+// лексером, что и подсветка. Файлы, у которых не изменились mtime и
+// размер, берутся из прошлого индекса без чтения. Готовый индекс
+// пишется рядом во временный файл и подменяет старый в потоке GUI.
+class ProjectIndexer : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 MaxFileSize = 4 * 1024 * 1024;
+
+    explicit ProjectIndexer(QObject *parent = nullptr);
+    ~ProjectIndexer() override;
+
+    // Сразу открывает сохранённый индекс, если он есть, и запускает переиндексацию.
+    void setRoot(const QString &root);
+    QString root() const { return rootPath; }
+    bool isRunning() const { return worker != nullptr; }
+    const SymbolIndex &index() const { return symbolIndex; }
+
+    static QString indexFileName(const QString &root);
+    static QVector<IndexedSymbol> extractSymbols(const QString &text);
+
+public slots:
+    void reindex();
+    void cancel();
+
+signals:
+    void progress(int filesDone, int filesTotal);
+    void indexReady(int files, int symbols, int reusedFiles, qint64 elapsedMs);
+    void failed(const QString &error);
+
+private:
+    struct IndexState {
+        std::atomic<bool> cancelled{false};
+    };
+
+    void run(const std::shared_ptr<IndexState> &state, const QString &root, quint64 id);
+    void finishWorker();
+
+    QThread *worker = nullptr;
+    std::shared_ptr<IndexState> current;
+    quint64 generation = 0;
+    bool reindexPending = false;
+    QString rootPath;
+    SymbolIndex symbolIndex;
+};
+
+#endif // PROJECTINDEXER_H
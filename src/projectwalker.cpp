@@ -0,0 +1,51 @@
+#include "projectwalker.h"
+#include <QStringList>
+
+ProjectWalker::ProjectWalker(const QString &root)
+    : rootDir(root), ignoreRules(root)
+{
+}
+
+QFileInfoList ProjectWalker::list(const QString &relativeDir)
+{
+    ignoreRules.loadDirectory(relativeDir);
+    QFileInfoList entries = QDir(rootDir.filePath(relativeDir)).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+    entries.removeIf([this, &relativeDir](const QFileInfo &entry)
+                     {
+                         const QString relativePath = relativeDir.isEmpty() ? entry.fileName() : relativeDir + '/' + entry.fileName();
+                         return ignoreRules.isIgnored(relativePath, entry.isDir()); });
+    return entries;
+}
+
+void ProjectWalker::walk(const std::atomic<bool> &cancelled, const Visitor &visit, const Visitor &enterDir,
+                         const QString &startDir)
+{
+    // Правила родительских каталогов действуют и на поддерево.
+    const QStringList parts = startDir.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+    QString ancestor;
+    for (const QString &part : parts)
+    {
+        ignoreRules.loadDirectory(ancestor);
+        ancestor = ancestor.isEmpty() ? part : ancestor + '/' + part;
+    }
+
+    QStringList pendingDirs{startDir};
+    while (!pendingDirs.isEmpty() && !cancelled)
+    {
+        const QString relativeDir = pendingDirs.takeLast();
+        for (const QFileInfo &entry : list(relativeDir))
+        {
+            const QString relativePath = relativeDir.isEmpty() ? entry.fileName() : relativeDir + '/' + entry.fileName();
+            if (entry.isDir())
+            {
+                if (enterDir)
+                    enterDir(relativePath, entry);
+                pendingDirs.append(relativePath);
+            }
+            else
+            {
+                visit(relativePath, entry);
+            }
+        }
+    }
+}
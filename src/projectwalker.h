@@ -0,0 +1,33 @@
+#ifndef PROJECTWALKER_H
+#define PROJECTWALKER_H
+
+#include <QDir>
+#include <QFileInfo>
+#include <QString>
+#include <atomic>
+#include <functional>
+#include "ignorerules.h"
+
+// Обход папки проекта без рекурсии с учётом .gitignore и исключений из
+// настроек. Скрытые записи и символьные ссылки пропускаются. Пути
+// передаются относительно корня, через '/'.
+class ProjectWalker {
+public:
+    using Visitor = std::function<void(const QString &relativePath, const QFileInfo &info)>;
+
+    explicit ProjectWalker(const QString &root);
+
+    // Файлы уходят в visit, каталоги — в enterDir перед обходом их содержимого.
+    void walk(const std::atomic<bool> &cancelled, const Visitor &visit, const Visitor &enterDir = Visitor(),
+              const QString &startDir = QString());
+    // Содержимое одного каталога без исключённых записей.
+    QFileInfoList list(const QString &relativeDir);
+
+    IgnoreRules &rules() { return ignoreRules; }
+
+private:
+    QDir rootDir;
+    IgnoreRules ignoreRules;
+};
+
+#endif // PROJECTWALKER_H
@@ -0,0 +1,598 @@
+#include "pty.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QProcessEnvironment>
+#include <QStandardPaths>
+#include <QThread>
+#include <vector>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void setError(QString *error, const QString &message)
+{
+    if (error)
+        *error = message;
+}
+
+#ifdef Q_OS_WIN
+
+// ConPTY появился в Windows 10 1809: функции берутся из kernel32 во время
+// выполнения, чтобы программа запускалась и на старых системах.
+using CreatePseudoConsoleFn = HRESULT(WINAPI *)(COORD, HANDLE, HANDLE, DWORD, void **);
+using ResizePseudoConsoleFn = HRESULT(WINAPI *)(void *, COORD);
+using ClosePseudoConsoleFn = void(WINAPI *)(void *);
+
+struct ConPty {
+    CreatePseudoConsoleFn create = nullptr;
+    ResizePseudoConsoleFn resize = nullptr;
+    ClosePseudoConsoleFn close = nullptr;
+};
+
+const ConPty &conPty()
+{
+    static const ConPty api = [] {
+        ConPty result;
+        if (HMODULE kernel = GetModuleHandleW(L"kernel32.dll"))
+        {
+            result.create = reinterpret_cast<CreatePseudoConsoleFn>(GetProcAddress(kernel, "CreatePseudoConsole"));
+            result.resize = reinterpret_cast<ResizePseudoConsoleFn>(GetProcAddress(kernel, "ResizePseudoConsole"));
+            result.close = reinterpret_cast<ClosePseudoConsoleFn>(GetProcAddress(kernel, "ClosePseudoConsole"));
+        }
+        return result;
+    }();
+    return api;
+}
+
+constexpr DWORD_PTR PseudoConsoleAttribute = 0x00020016; // PROC_THREAD_ATTRIBUTE_PSEUDOCONSOLE
+
+QString quoteArgument(const QString &argument)
+{
+    if (!argument.isEmpty() && !argument.contains(QLatin1Char(' ')) && !argument.contains(QLatin1Char('\t'))
+        && !argument.contains(QLatin1Char('"')))
+        return argument;
+    QString result = QStringLiteral("\"");
+    int backslashes = 0;
+    for (QChar ch : argument)
+    {
+        if (ch == QLatin1Char('\\'))
+        {
+            ++backslashes;
+            continue;
+        }
+        if (ch == QLatin1Char('"'))
+            result += QString(backslashes * 2 + 1, QLatin1Char('\\'));
+        else
+            result += QString(backslashes, QLatin1Char('\\'));
+        backslashes = 0;
+        result += ch;
+    }
+    result += QString(backslashes * 2, QLatin1Char('\\'));
+    result += QLatin1Char('"');
+    return result;
+}
+
+#else
+
+bool makeCloseOnExec(int fd)
+{
+    return fcntl(fd, F_SETFD, FD_CLOEXEC) == 0;
+}
+
+#endif
+
+} // namespace
+
+QString Pty::defaultShell()
+{
+#ifdef Q_OS_WIN
+    return qEnvironmentVariable("COMSPEC", QStringLiteral("cmd.exe"));
+#else
+    const QString shell = qEnvironmentVariable("SHELL");
+    return shell.isEmpty() ? QStringLiteral("/bin/sh") : shell;
+#endif
+}
+
+#ifdef Q_OS_WIN
+
+Pty::Pty() = default;
+
+Pty::~Pty()
+{
+    terminate();
+    if (exitWait)
+        UnregisterWaitEx(exitWait, INVALID_HANDLE_VALUE); // дождаться обработчика
+    closeHandles();
+}
+
+void CALLBACK Pty::processExited(void *context, BOOLEAN)
+{
+    // Без консоли ReadFile в рабочем потоке получит конец канала, а
+    // WriteFile в потоке записи — ошибку.
+    static_cast<Pty *>(context)->closeConsole();
+}
+
+bool Pty::start(const QString &program, const QStringList &arguments, const QString &workingDirectory,
+                int columns, int rows, QString *error)
+{
+    if (isRunning())
+    {
+        setError(error, QStringLiteral("Процесс уже запущен"));
+        return false;
+    }
+    if (exitWait)
+    {
+        UnregisterWaitEx(exitWait, INVALID_HANDLE_VALUE);
+        exitWait = nullptr;
+    }
+    closeHandles();
+    status = -1;
+
+    const ConPty &api = conPty();
+    if (!api.create)
+    {
+        setError(error, QStringLiteral("Псевдоконсоль требует Windows 10 1809 или новее"));
+        return false;
+    }
+
+    HANDLE inputRead = nullptr;
+    HANDLE inputWrite = nullptr;
+    HANDLE outputRead = nullptr;
+    HANDLE outputWrite = nullptr;
+    if (!CreatePipe(&inputRead, &inputWrite, nullptr, 0))
+    {
+        setError(error, QStringLiteral("Не удалось создать канал"));
+        return false;
+    }
+    if (!CreatePipe(&outputRead, &outputWrite, nullptr, 0))
+    {
+        CloseHandle(inputRead);
+        CloseHandle(inputWrite);
+        setError(error, QStringLiteral("Не удалось создать канал"));
+        return false;
+    }
+
+    void *console = nullptr;
+    const COORD size{SHORT(qBound(1, columns, 32767)), SHORT(qBound(1, rows, 32767))};
+    const HRESULT created = api.create(size, inputRead, outputWrite, 0, &console);
+    // Консоль держит свои копии концов, нужных ей.
+    CloseHandle(inputRead);
+    CloseHandle(outputWrite);
+    if (FAILED(created))
+    {
+        CloseHandle(inputWrite);
+        CloseHandle(outputRead);
+        setError(error, QStringLiteral("Не удалось создать псевдоконсоль"));
+        return false;
+    }
+
+    STARTUPINFOEXW startup{};
+    startup.StartupInfo.cb = sizeof(startup);
+    SIZE_T attributeSize = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeSize);
+    QByteArray attributes(qsizetype(attributeSize), Qt::Uninitialized);
+    startup.lpAttributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributes.data());
+    InitializeProcThreadAttributeList(startup.lpAttributeList, 1, 0, &attributeSize);
+    UpdateProcThreadAttribute(startup.lpAttributeList, 0, PseudoConsoleAttribute, console, sizeof(console),
+                              nullptr, nullptr);
+
+    QString commandLine = quoteArgument(program);
+    for (const QString &argument : arguments)
+        commandLine += QLatin1Char(' ') + quoteArgument(argument);
+    std::wstring command = commandLine.toStdWString();
+    const std::wstring directory = workingDirectory.toStdWString();
+
+    PROCESS_INFORMATION info{};
+    const bool started = CreateProcessW(nullptr, command.data(), nullptr, nullptr, FALSE,
+                                        EXTENDED_STARTUPINFO_PRESENT | CREATE_UNICODE_ENVIRONMENT, nullptr,
+                                        directory.empty() ? nullptr : directory.c_str(), &startup.StartupInfo,
+                                        &info);
+    DeleteProcThreadAttributeList(startup.lpAttributeList);
+    if (!started)
+    {
+        api.close(console);
+        CloseHandle(inputWrite);
+        CloseHandle(outputRead);
+        setError(error, QStringLiteral("Не удалось запустить %1").arg(program));
+        return false;
+    }
+    CloseHandle(info.hThread);
+
+    {
+        QMutexLocker locker(&consoleLock);
+        pseudoConsole = console;
+    }
+    process = info.hProcess;
+    input = inputWrite;
+    output = outputRead;
+    startWriter();
+    RegisterWaitForSingleObject(&exitWait, process, processExited, this, INFINITE, WT_EXECUTEONLYONCE);
+    return true;
+}
+
+bool Pty::isRunning() const
+{
+    return process && status < 0;
+}
+
+qint64 Pty::read(char *data, qint64 maxSize, int timeoutMs)
+{
+    // Анонимные каналы не умеют ждать с таймаутом: ReadFile блокируется,
+    // пока не придут данные или не закроется консоль.
+    Q_UNUSED(timeoutMs);
+    if (!output)
+        return -1;
+    DWORD count = 0;
+    if (ReadFile(output, data, DWORD(qMin<qint64>(maxSize, 1 << 20)), &count, nullptr) && count > 0)
+        return count;
+    DWORD code = DWORD(-1);
+    if (WaitForSingleObject(process, 1000) == WAIT_OBJECT_0)
+        GetExitCodeProcess(process, &code);
+    status = int(code);
+    return -1;
+}
+
+// Поток записи: отдаёт очередь ввода консоли. Если консоль не читает,
+// блокируется он, а не интерфейс; закрытие консоли прерывает WriteFile.
+void Pty::writeInput()
+{
+    QByteArray bytes;
+    for (;;)
+    {
+        {
+            QMutexLocker locker(&inputLock);
+            while (pendingInput.isEmpty() && !stopping)
+                inputReady.wait(&inputLock);
+            if (stopping)
+                return;
+            bytes.swap(pendingInput);
+        }
+        const char *data = bytes.constData();
+        qint64 remaining = bytes.size();
+        while (remaining > 0)
+        {
+            DWORD written = 0;
+            if (!WriteFile(input, data, DWORD(remaining), &written, nullptr))
+            {
+                inputFailed = true;
+                return;
+            }
+            data += written;
+            remaining -= written;
+        }
+        bytes.clear();
+    }
+}
+
+void Pty::resize(int columns, int rows)
+{
+    const ConPty &api = conPty();
+    QMutexLocker locker(&consoleLock);
+    if (pseudoConsole && api.resize)
+        api.resize(pseudoConsole, COORD{SHORT(qBound(1, columns, 32767)), SHORT(qBound(1, rows, 32767))});
+}
+
+void Pty::terminate()
+{
+    if (process && status < 0)
+        TerminateProcess(process, 1);
+    closeConsole();
+}
+
+// ClosePseudoConsole может ждать, пока прочитан вывод, поэтому
+// вызывается без блокировки: resize() после обмена увидит nullptr.
+void Pty::closeConsole()
+{
+    void *console = nullptr;
+    {
+        QMutexLocker locker(&consoleLock);
+        std::swap(console, pseudoConsole);
+    }
+    if (console)
+        conPty().close(console);
+}
+
+void Pty::closeHandles()
+{
+    closeConsole();
+    stopWriter(); // консоль закрыта: WriteFile, если ждал, уже вернулся
+    for (void **handle : {&input, &output, &process})
+    {
+        if (*handle)
+            CloseHandle(*handle);
+        *handle = nullptr;
+    }
+}
+
+#else
+
+Pty::Pty() = default;
+
+Pty::~Pty()
+{
+    if (pid > 0 && status < 0)
+    {
+        ::kill(-pid_t(pid), SIGHUP);
+        ::kill(pid_t(pid), SIGKILL);
+        reap(true);
+    }
+    stopWriter();
+    for (int fd : {master, wakeup[0], wakeup[1]})
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+}
+
+bool Pty::start(const QString &program, const QStringList &arguments, const QString &workingDirectory,
+                int columns, int rows, QString *error)
+{
+    if (isRunning())
+    {
+        setError(error, QStringLiteral("Процесс уже запущен"));
+        return false;
+    }
+    stopWriter();
+    for (int *fd : {&master, &wakeup[0], &wakeup[1]})
+    {
+        if (*fd >= 0)
+            ::close(*fd);
+        *fd = -1;
+    }
+    pid = -1;
+    status = -1;
+
+    const QString path = program.contains(QLatin1Char('/')) ? QFileInfo(program).absoluteFilePath()
+                                                            : QStandardPaths::findExecutable(program);
+    if (path.isEmpty())
+    {
+        setError(error, QStringLiteral("Не найдена программа %1").arg(program));
+        return false;
+    }
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || !makeCloseOnExec(master) || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        setError(error, QStringLiteral("Не удалось открыть псевдотерминал: %1").arg(qt_error_string(errno)));
+        return false;
+    }
+    const char *slaveName = ptsname(master);
+    if (!slaveName || ::pipe(wakeup) != 0 || !makeCloseOnExec(wakeup[0]) || !makeCloseOnExec(wakeup[1]))
+    {
+        setError(error, QStringLiteral("Не удалось открыть псевдотерминал: %1").arg(qt_error_string(errno)));
+        return false;
+    }
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    const QByteArray slavePath(slaveName);
+
+    // Всё, что требует памяти, готовится до fork(): в дочернем процессе
+    // многопоточной программы допустимы только async-signal-safe вызовы.
+    QList<QByteArray> argumentBytes{QFile::encodeName(path)};
+    for (const QString &argument : arguments)
+        argumentBytes.append(argument.toLocal8Bit());
+    std::vector<char *> argv;
+    for (QByteArray &argument : argumentBytes)
+        argv.push_back(argument.data());
+    argv.push_back(nullptr);
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("TERM"), QStringLiteral("xterm-256color"));
+    environment.insert(QStringLiteral("COLORTERM"), QStringLiteral("truecolor"));
+    QList<QByteArray> environmentBytes;
+    for (const QString &entry : environment.toStringList())
+        environmentBytes.append(entry.toLocal8Bit());
+    std::vector<char *> envp;
+    for (QByteArray &entry : environmentBytes)
+        envp.push_back(entry.data());
+    envp.push_back(nullptr);
+
+    const QByteArray directory = QFile::encodeName(workingDirectory);
+    winsize size{};
+    size.ws_col = ushort(qBound(1, columns, 65535));
+    size.ws_row = ushort(qBound(1, rows, 65535));
+
+    const pid_t child = ::fork();
+    if (child < 0)
+    {
+        setError(error, QStringLiteral("Не удалось запустить %1: %2").arg(program, qt_error_string(errno)));
+        return false;
+    }
+    if (child == 0)
+    {
+        ::setsid();
+        const int slave = ::open(slavePath.constData(), O_RDWR);
+        if (slave < 0)
+            ::_exit(127);
+#ifdef TIOCSCTTY
+        ::ioctl(slave, TIOCSCTTY, 0);
+#endif
+        ::ioctl(slave, TIOCSWINSZ, &size);
+        ::dup2(slave, STDIN_FILENO);
+        ::dup2(slave, STDOUT_FILENO);
+        ::dup2(slave, STDERR_FILENO);
+        if (slave > STDERR_FILENO)
+            ::close(slave);
+
+        sigset_t signals;
+        sigemptyset(&signals);
+        ::sigprocmask(SIG_SETMASK, &signals, nullptr);
+        for (int signal : {SIGINT, SIGQUIT, SIGPIPE, SIGCHLD, SIGHUP, SIGTERM})
+            ::signal(signal, SIG_DFL);
+
+        if (!directory.isEmpty() && ::chdir(directory.constData()) != 0)
+        {
+            // остаёмся в текущей папке
+        }
+        ::execve(argv[0], argv.data(), envp.data());
+        ::_exit(127);
+    }
+    pid = child;
+    startWriter();
+    return true;
+}
+
+bool Pty::isRunning() const
+{
+    return pid > 0 && status < 0;
+}
+
+void Pty::reap(bool force)
+{
+    int code = 0;
+    pid_t result;
+    do
+        result = ::waitpid(pid_t(pid), &code, 0);
+    while (result < 0 && errno == EINTR);
+    if (result < 0)
+        status = force ? 128 + SIGKILL : 0;
+    else if (WIFEXITED(code))
+        status = WEXITSTATUS(code);
+    else if (WIFSIGNALED(code))
+        status = 128 + WTERMSIG(code);
+    else
+        status = 0;
+}
+
+qint64 Pty::read(char *data, qint64 maxSize, int timeoutMs)
+{
+    if (master < 0 || pid <= 0 || status >= 0)
+        return -1;
+
+    pollfd fds[2] = {{master, POLLIN, 0}, {wakeup[0], POLLIN, 0}};
+    const int ready = ::poll(fds, 2, timeoutMs);
+    if (ready <= 0)
+        return 0;
+    if (fds[1].revents)
+    {
+        // terminate(): оболочка могла пропустить SIGHUP
+        ::kill(pid_t(pid), SIGKILL);
+        reap(true);
+        return -1;
+    }
+    const ssize_t count = ::read(master, data, size_t(maxSize));
+    if (count > 0)
+        return count;
+    if (count < 0 && (errno == EAGAIN || errno == EINTR))
+        return 0;
+    // EIO: у ведомой стороны не осталось открытых дескрипторов.
+    reap(false);
+    return -1;
+}
+
+// Поток записи: отдаёт очередь ввода терминалу. Пока программа не
+// читает ввод и буфер терминала полон, ждёт он, а не интерфейс; ожидание
+// короткое, чтобы stopWriter() не ждал долго.
+void Pty::writeInput()
+{
+    QByteArray bytes;
+    for (;;)
+    {
+        {
+            QMutexLocker locker(&inputLock);
+            while (pendingInput.isEmpty() && !stopping)
+                inputReady.wait(&inputLock);
+            if (stopping)
+                return;
+            bytes.swap(pendingInput);
+        }
+        const char *data = bytes.constData();
+        qint64 remaining = bytes.size();
+        while (remaining > 0)
+        {
+            const ssize_t written = ::write(master, data, size_t(remaining));
+            if (written > 0)
+            {
+                data += written;
+                remaining -= written;
+                continue;
+            }
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written < 0 && errno == EAGAIN)
+            {
+                pollfd fd{master, POLLOUT, 0};
+                ::poll(&fd, 1, 100);
+                QMutexLocker locker(&inputLock);
+                if (stopping)
+                    return;
+                continue;
+            }
+            inputFailed = true;
+            return;
+        }
+        bytes.clear();
+    }
+}
+
+void Pty::resize(int columns, int rows)
+{
+    if (master < 0)
+        return;
+    winsize size{};
+    size.ws_col = ushort(qBound(1, columns, 65535));
+    size.ws_row = ushort(qBound(1, rows, 65535));
+    ::ioctl(master, TIOCSWINSZ, &size); // ядро пошлёт SIGWINCH группе переднего плана
+}
+
+void Pty::terminate()
+{
+    if (pid <= 0 || status >= 0)
+        return;
+    ::kill(-pid_t(pid), SIGHUP);
+    const char byte = 0;
+    if (::write(wakeup[1], &byte, 1) < 0)
+    {
+        // read() всё равно получит EIO, когда оболочка завершится
+    }
+}
+
+#endif
+
+// Очередь ввода устроена одинаково на обеих системах, различается только
+// writeInput().
+void Pty::startWriter()
+{
+    pendingInput.clear();
+    stopping = false;
+    inputFailed = false;
+    writer = QThread::create([this] { writeInput(); });
+    writer->start();
+}
+
+bool Pty::write(const QByteArray &bytes)
+{
+    if (!writer || inputFailed)
+        return false;
+    QMutexLocker locker(&inputLock);
+    pendingInput.append(bytes);
+    inputReady.wakeOne();
+    return true;
+}
+
+void Pty::stopWriter()
+{
+    if (!writer)
+        return;
+    {
+        QMutexLocker locker(&inputLock);
+        stopping = true;
+        inputReady.wakeOne();
+    }
+    writer->wait();
+    delete writer;
+    writer = nullptr;
+}
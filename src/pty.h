@@ -0,0 +1,77 @@
+#ifndef PTY_H
+#define PTY_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include <QWaitCondition>
+#include <atomic>
+
+class QThread;
+
+// Процесс, подключённый к псевдотерминалу: на Unix — posix_openpt и
+// отдельный сеанс с управляющим терминалом, на Windows — ConPTY
+// (Windows 10 1809+). read() вызывается из рабочего потока и ждёт данных
+// не дольше timeoutMs; resize() — из потока интерфейса. write() только
+// ставит байты в очередь под блокировкой и зовётся из любого потока, а
+// пишет их отдельный поток: запись ждёт, пока программа прочитает ввод
+// (на Windows блокируется WriteFile, на Unix заполнен буфер терминала).
+class Pty {
+public:
+    Pty();
+    ~Pty();
+
+    Pty(const Pty &) = delete;
+    Pty &operator=(const Pty &) = delete;
+
+    bool start(const QString &program, const QStringList &arguments, const QString &workingDirectory,
+               int columns, int rows, QString *error = nullptr);
+    bool isRunning() const;
+
+    // Число прочитанных байт; 0 — истёк таймаут, -1 — процесс завершился
+    // и вывод прочитан до конца.
+    qint64 read(char *data, qint64 maxSize, int timeoutMs);
+    bool write(const QByteArray &bytes);
+    void resize(int columns, int rows);
+    void terminate();
+    int exitCode() const { return status; }
+
+    static QString defaultShell();
+
+private:
+#ifdef Q_OS_WIN
+    static void __stdcall processExited(void *context, unsigned char timedOut);
+    void closeHandles();
+    void closeConsole();
+
+    // pseudoConsole закрывается и из пула потоков (processExited):
+    // resize() держит consoleLock, пока пользуется им.
+    QMutex consoleLock;
+    void *pseudoConsole = nullptr; // HPCON
+    void *process = nullptr;
+    void *exitWait = nullptr;      // закрывает консоль, когда процесс завершился
+    void *input = nullptr;         // запись в консоль, только из writer
+    void *output = nullptr;        // вывод консоли
+#else
+    void reap(bool force);
+
+    int master = -1;
+    qint64 pid = -1;
+    int wakeup[2] = {-1, -1}; // будит read() при terminate()
+#endif
+    void startWriter();
+    void stopWriter();
+    void writeInput();
+
+    QThread *writer = nullptr;
+    QMutex inputLock;
+    QWaitCondition inputReady;
+    QByteArray pendingInput; // под inputLock
+    bool stopping = false;   // под inputLock
+    std::atomic<bool> inputFailed{false};
+    std::atomic<int> status{-1}; // код завершения, пишется рабочим потоком
+};
+
+#endif // PTY_H
@@ -0,0 +1,109 @@
+#include "runconfigdialog.h"
+#include <QCheckBox>
+#include <QCryptographicHash>
+#include <QDialogButtonBox>
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSettings>
+
+namespace {
+
+QString settingsGroup(const QString &projectRoot)
+{
+    const QByteArray key = QCryptographicHash::hash(QDir::cleanPath(projectRoot).toUtf8(), QCryptographicHash::Md5).toHex();
+    return "projects/" + QString::fromLatin1(key);
+}
+
+} // namespace
+
+RunConfig RunConfig::load(const QString &projectRoot)
+{
+    QSettings settings("PablaIDE", "CodeEditor");
+    settings.beginGroup(settingsGroup(projectRoot));
+    RunConfig config;
+    config.program = settings.value("runProgram").toString();
+    config.arguments = settings.value("runArguments").toString();
+    config.workingDirectory = settings.value("runDirectory").toString();
+    config.buildFirst = settings.value("buildBeforeRun", true).toBool();
+    return config;
+}
+
+void RunConfig::save(const QString &projectRoot) const
+{
+    QSettings settings("PablaIDE", "CodeEditor");
+    settings.beginGroup(settingsGroup(projectRoot));
+    settings.setValue("projectPath", QDir::cleanPath(projectRoot));
+    settings.setValue("runProgram", program);
+    settings.setValue("runArguments", arguments);
+    settings.setValue("runDirectory", workingDirectory);
+    settings.setValue("buildBeforeRun", buildFirst);
+}
+
+QString RunConfig::guessProgram(const QString &buildDirectory)
+{
+    const QFileInfoList entries = QDir(buildDirectory).entryInfoList(QDir::Files | QDir::Executable, QDir::Time);
+    for (const QFileInfo &entry : entries)
+    {
+        const QString suffix = entry.suffix().toLower();
+        if (suffix.isEmpty() || suffix == "exe")
+            return entry.absoluteFilePath();
+    }
+    return QString();
+}
+
+RunConfigDialog::RunConfigDialog(const RunConfig &config, const QString &projectRoot, QWidget *parent)
+    : QDialog(parent), root(projectRoot)
+{
+    setWindowTitle("Настройка запуска");
+    resize(560, 0);
+
+    programEdit = new QLineEdit(config.program, this);
+    programEdit->setPlaceholderText("Путь к программе (относительно папки проекта)");
+    QPushButton *browseButton = new QPushButton("Обзор...", this);
+    QHBoxLayout *programLayout = new QHBoxLayout;
+    programLayout->addWidget(programEdit);
+    programLayout->addWidget(browseButton);
+
+    argumentsEdit = new QLineEdit(config.arguments, this);
+    directoryEdit = new QLineEdit(config.workingDirectory, this);
+    directoryEdit->setPlaceholderText("Папка проекта");
+    buildFirstCheck = new QCheckBox("Собирать перед запуском", this);
+    buildFirstCheck->setChecked(config.buildFirst);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+
+    QFormLayout *layout = new QFormLayout(this);
+    layout->addRow("Программа:", programLayout);
+    layout->addRow("Аргументы:", argumentsEdit);
+    layout->addRow("Рабочая папка:", directoryEdit);
+    layout->addRow(buildFirstCheck);
+    layout->addRow(buttons);
+
+    connect(browseButton, &QPushButton::clicked, this, &RunConfigDialog::browseProgram);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+}
+
+RunConfig RunConfigDialog::config() const
+{
+    RunConfig config;
+    config.program = programEdit->text().trimmed();
+    config.arguments = argumentsEdit->text().trimmed();
+    config.workingDirectory = directoryEdit->text().trimmed();
+    config.buildFirst = buildFirstCheck->isChecked();
+    return config;
+}
+
+void RunConfigDialog::browseProgram()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, "Программа", root);
+    if (fileName.isEmpty())
+        return;
+    const QString relative = QDir(root).relativeFilePath(fileName);
+    programEdit->setText(relative.startsWith("..") ? fileName : relative);
+}
@@ -0,0 +1,46 @@
+#ifndef RUNCONFIGDIALOG_H
+#define RUNCONFIGDIALOG_H
+
+#include <QDialog>
+#include <QString>
+
+class QCheckBox;
+class QLineEdit;
+
+// Настройка запуска, своя у каждой папки проекта (хранится в QSettings
+// под ключом от пути папки).
+struct RunConfig {
+    QString program;          // абсолютный или относительно папки проекта
+    QString arguments;        // одной строкой, кавычки как в оболочке
+    QString workingDirectory; // пусто — папка проекта
+    bool buildFirst = true;
+
+    bool isEmpty() const { return program.isEmpty(); }
+
+    static RunConfig load(const QString &projectRoot);
+    void save(const QString &projectRoot) const;
+
+    // Самый свежий исполняемый файл в каталоге сборки — начальное предложение.
+    static QString guessProgram(const QString &buildDirectory);
+};
+
+class RunConfigDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    RunConfigDialog(const RunConfig &config, const QString &projectRoot, QWidget *parent = nullptr);
+
+    RunConfig config() const;
+
+private slots:
+    void browseProgram();
+
+private:
+    QString root;
+    QLineEdit *programEdit;
+    QLineEdit *argumentsEdit;
+    QLineEdit *directoryEdit;
+    QCheckBox *buildFirstCheck;
+};
+
+#endif // RUNCONFIGDIALOG_H
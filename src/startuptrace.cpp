@@ -0,0 +1,80 @@
+#include "startuptrace.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <cstdio>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <time.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+namespace {
+
+bool enabled = false;
+QElapsedTimer timer;
+qint64 offsetMs = 0; // от старта процесса до start()
+qint64 lastMs = 0;
+
+// Сколько процесс уже живёт, -1 — неизвестно.
+qint64 processAgeMs()
+{
+#ifdef Q_OS_LINUX
+    QFile stat("/proc/self/stat");
+    if (!stat.open(QIODevice::ReadOnly))
+        return -1;
+    // Имя процесса в скобках может содержать пробелы: поля считаются после ')'.
+    const QByteArray line = stat.readAll();
+    const QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    bool ok = false;
+    const qint64 startTicks = fields.value(19).toLongLong(&ok); // поле 22, starttime
+    timespec now;
+    if (!ok || clock_gettime(CLOCK_BOOTTIME, &now) != 0)
+        return -1;
+    return qint64(now.tv_sec) * 1000 + now.tv_nsec / 1000000 - startTicks * 1000 / sysconf(_SC_CLK_TCK);
+#elif defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user, now;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return -1;
+    GetSystemTimeAsFileTime(&now);
+    const auto ticks = [](const FILETIME &time)
+    { return (qint64(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+    return (ticks(now) - ticks(creation)) / 10000;
+#else
+    return -1;
+#endif
+}
+
+} // namespace
+
+void StartupTrace::start(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--trace-startup") == 0)
+            enabled = true;
+    }
+    if (!enabled)
+        return;
+    timer.start();
+    offsetMs = qMax(qint64(0), processAgeMs());
+    lastMs = 0;
+    mark("main");
+}
+
+bool StartupTrace::isEnabled()
+{
+    return enabled;
+}
+
+void StartupTrace::mark(const char *phase)
+{
+    if (!enabled)
+        return;
+    const qint64 now = offsetMs + timer.elapsed();
+    std::fprintf(stderr, "startup: %-12s %6lld ms (+%lld ms)\n", phase, now, now - lastMs);
+    std::fflush(stderr);
+    lastMs = now;
+}
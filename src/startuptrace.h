@@ -0,0 +1,14 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+// Замер запуска по флагу --trace-startup: время каждой фазы от старта
+// процесса (main, окно, первая отрисовка, готовность к вводу)
+// печатается в stderr. Без флага mark() ничего не делает.
+class StartupTrace {
+public:
+    static void start(int argc, char *argv[]); // первым делом в main()
+    static bool isEnabled();
+    static void mark(const char *phase);
+};
+
+#endif // STARTUPTRACE_H
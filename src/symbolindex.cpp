@@ -0,0 +1,310 @@
+#include "symbolindex.h"
+#include <QDir>
+#include <QHash>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+struct SymbolIndex::Header {
+    char magic[8];
+    quint32 version;
+    quint32 fileCount;
+    quint32 symbolCount;
+    quint32 rootOffset;
+    quint32 rootLength;
+    quint32 reserved;
+    quint64 filesOffset;
+    quint64 symbolsOffset;
+    quint64 nameIndexOffset;
+    quint64 stringsOffset;
+    quint64 stringsSize;
+};
+
+struct SymbolIndex::FileRecord {
+    quint32 pathOffset;
+    quint32 pathLength;
+    qint64 mtime;
+    qint64 size;
+    quint32 firstSymbol;
+    quint32 symbolCount;
+};
+
+struct SymbolIndex::SymbolRecord {
+    quint32 nameOffset;
+    quint32 nameLength;
+    quint32 file;
+    quint32 line;
+    quint32 kind;
+};
+
+namespace {
+
+constexpr char Magic[8] = {'P', 'G', 'T', 'I', 'D', 'X', '\0', '\0'};
+constexpr quint32 Version = 1;
+
+inline uchar fold(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? uchar(c + ('a' - 'A')) : c;
+}
+
+// Сравнение UTF-8 без учёта регистра ASCII.
+int compareFolded(const char *a, qsizetype aLength, const char *b, qsizetype bLength)
+{
+    const qsizetype length = qMin(aLength, bLength);
+    for (qsizetype i = 0; i < length; ++i)
+    {
+        const uchar x = fold(uchar(a[i]));
+        const uchar y = fold(uchar(b[i]));
+        if (x != y)
+            return x < y ? -1 : 1;
+    }
+    return aLength == bLength ? 0 : (aLength < bLength ? -1 : 1);
+}
+
+bool startsWithFolded(const char *name, qsizetype nameLength, const QByteArray &prefix)
+{
+    return nameLength >= prefix.size() && compareFolded(name, prefix.size(), prefix.constData(), prefix.size()) == 0;
+}
+
+} // namespace
+
+bool SymbolIndex::open(const QString &fileName)
+{
+    close();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    dataSize = file.size();
+    if (dataSize < qint64(sizeof(Header)))
+    {
+        close();
+        return false;
+    }
+    data = file.map(0, dataSize);
+    if (!data)
+    {
+        close();
+        return false;
+    }
+
+    const Header *h = header();
+    const bool valid = std::memcmp(h->magic, Magic, sizeof(Magic)) == 0 && h->version == Version
+                       && h->filesOffset + quint64(h->fileCount) * sizeof(FileRecord) <= quint64(dataSize)
+                       && h->symbolsOffset + quint64(h->symbolCount) * sizeof(SymbolRecord) <= quint64(dataSize)
+                       && h->nameIndexOffset + quint64(h->symbolCount) * sizeof(quint32) <= quint64(dataSize)
+                       && h->stringsOffset + h->stringsSize <= quint64(dataSize);
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SymbolIndex::close()
+{
+    if (data)
+        file.unmap(const_cast<uchar *>(data));
+    data = nullptr;
+    dataSize = 0;
+    file.close();
+}
+
+const SymbolIndex::Header *SymbolIndex::header() const
+{
+    return reinterpret_cast<const Header *>(data);
+}
+
+const SymbolIndex::FileRecord *SymbolIndex::files() const
+{
+    return reinterpret_cast<const FileRecord *>(data + header()->filesOffset);
+}
+
+const SymbolIndex::SymbolRecord *SymbolIndex::symbols() const
+{
+    return reinterpret_cast<const SymbolRecord *>(data + header()->symbolsOffset);
+}
+
+const quint32 *SymbolIndex::nameIndex() const
+{
+    return reinterpret_cast<const quint32 *>(data + header()->nameIndexOffset);
+}
+
+QByteArray SymbolIndex::string(quint32 offset, quint32 length) const
+{
+    if (quint64(offset) + length > header()->stringsSize)
+        return QByteArray();
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(data + header()->stringsOffset + offset), length);
+}
+
+QString SymbolIndex::root() const
+{
+    return isOpen() ? QString::fromUtf8(string(header()->rootOffset, header()->rootLength)) : QString();
+}
+
+int SymbolIndex::fileCount() const
+{
+    return isOpen() ? int(header()->fileCount) : 0;
+}
+
+int SymbolIndex::symbolCount() const
+{
+    return isOpen() ? int(header()->symbolCount) : 0;
+}
+
+QString SymbolIndex::filePath(int file) const
+{
+    const FileRecord &record = files()[file];
+    return QString::fromUtf8(string(record.pathOffset, record.pathLength));
+}
+
+qint64 SymbolIndex::fileMtime(int file) const
+{
+    return files()[file].mtime;
+}
+
+qint64 SymbolIndex::fileSize(int file) const
+{
+    return files()[file].size;
+}
+
+QVector<IndexedSymbol> SymbolIndex::fileSymbols(int file) const
+{
+    const FileRecord &record = files()[file];
+    QVector<IndexedSymbol> result;
+    result.reserve(record.symbolCount);
+    for (quint32 i = 0; i < record.symbolCount && record.firstSymbol + i < header()->symbolCount; ++i)
+    {
+        const SymbolRecord &symbol = symbols()[record.firstSymbol + i];
+        result.append({QByteArray(string(symbol.nameOffset, symbol.nameLength)), symbol.line, SymbolKind(symbol.kind)});
+    }
+    return result;
+}
+
+SymbolLocation SymbolIndex::location(quint32 symbol) const
+{
+    const SymbolRecord &record = symbols()[symbol];
+    const QString path = record.file < header()->fileCount ? filePath(int(record.file)) : QString();
+    return {QString::fromUtf8(string(record.nameOffset, record.nameLength)),
+            QDir(root()).filePath(path), int(record.line), SymbolKind(record.kind)};
+}
+
+const quint32 *SymbolIndex::lowerBound(const QByteArray &foldedKey) const
+{
+    const quint32 *begin = nameIndex();
+    const quint32 *end = begin + header()->symbolCount;
+    return std::lower_bound(begin, end, foldedKey, [this](quint32 symbol, const QByteArray &key)
+                            {
+                                const SymbolRecord &record = symbols()[symbol];
+                                const QByteArray name = string(record.nameOffset, record.nameLength);
+                                return compareFolded(name.constData(), name.size(), key.constData(), key.size()) < 0; });
+}
+
+QVector<SymbolLocation> SymbolIndex::find(const QString &name, int limit) const
+{
+    QVector<SymbolLocation> result;
+    if (!isOpen() || name.isEmpty())
+        return result;
+
+    const QByteArray key = name.toUtf8();
+    const quint32 *end = nameIndex() + header()->symbolCount;
+    for (const quint32 *it = lowerBound(key); it != end && result.size() < limit; ++it)
+    {
+        const SymbolRecord &record = symbols()[*it];
+        const QByteArray candidate = string(record.nameOffset, record.nameLength);
+        if (compareFolded(candidate.constData(), candidate.size(), key.constData(), key.size()) != 0)
+            break;
+        if (candidate == key)
+            result.append(location(*it));
+    }
+    return result;
+}
+
+QVector<SymbolLocation> SymbolIndex::search(const QString &prefix, int limit) const
+{
+    QVector<SymbolLocation> result;
+    if (!isOpen() || prefix.isEmpty())
+        return result;
+
+    const QByteArray key = prefix.toUtf8();
+    const quint32 *end = nameIndex() + header()->symbolCount;
+    for (const quint32 *it = lowerBound(key); it != end && result.size() < limit; ++it)
+    {
+        const SymbolRecord &record = symbols()[*it];
+        const QByteArray candidate = string(record.nameOffset, record.nameLength);
+        if (!startsWithFolded(candidate.constData(), candidate.size(), key))
+            break;
+        result.append(location(*it));
+    }
+    return result;
+}
+
+bool SymbolIndex::write(const QString &fileName, const QString &root, const QVector<IndexedFile> &indexedFiles)
+{
+    QByteArray strings;
+    QHash<QByteArray, quint32> stringOffsets;
+    auto intern = [&strings, &stringOffsets](const QByteArray &value) -> quint32
+    {
+        auto it = stringOffsets.constFind(value);
+        if (it != stringOffsets.constEnd())
+            return *it;
+        const quint32 offset = quint32(strings.size());
+        strings.append(value);
+        stringOffsets.insert(value, offset);
+        return offset;
+    };
+
+    const QByteArray rootUtf8 = root.toUtf8();
+    Header h = {};
+    std::memcpy(h.magic, Magic, sizeof(Magic));
+    h.version = Version;
+    h.rootOffset = intern(rootUtf8);
+    h.rootLength = quint32(rootUtf8.size());
+
+    QVector<FileRecord> fileRecords;
+    QVector<SymbolRecord> symbolRecords;
+    QVector<const QByteArray *> names;
+    fileRecords.reserve(indexedFiles.size());
+    for (const IndexedFile &indexed : indexedFiles)
+    {
+        const QByteArray path = indexed.path.toUtf8();
+        FileRecord record = {intern(path), quint32(path.size()), indexed.mtime, indexed.size,
+                             quint32(symbolRecords.size()), quint32(indexed.symbols.size())};
+        for (const IndexedSymbol &symbol : indexed.symbols)
+        {
+            symbolRecords.append({intern(symbol.name), quint32(symbol.name.size()), quint32(fileRecords.size()),
+                                  symbol.line, quint32(symbol.kind)});
+            names.append(&symbol.name);
+        }
+        fileRecords.append(record);
+    }
+
+    QVector<quint32> order(symbolRecords.size());
+    for (int i = 0; i < order.size(); ++i)
+        order[i] = quint32(i);
+    std::sort(order.begin(), order.end(), [&names](quint32 a, quint32 b)
+              {
+                  const QByteArray &x = *names[a];
+                  const QByteArray &y = *names[b];
+                  const int folded = compareFolded(x.constData(), x.size(), y.constData(), y.size());
+                  return folded != 0 ? folded < 0 : x < y; });
+
+    h.fileCount = quint32(fileRecords.size());
+    h.symbolCount = quint32(symbolRecords.size());
+    h.filesOffset = sizeof(Header);
+    h.symbolsOffset = h.filesOffset + quint64(fileRecords.size()) * sizeof(FileRecord);
+    h.nameIndexOffset = h.symbolsOffset + quint64(symbolRecords.size()) * sizeof(SymbolRecord);
+    h.stringsOffset = h.nameIndexOffset + quint64(order.size()) * sizeof(quint32);
+    h.stringsSize = quint64(strings.size());
+
+    QSaveFile out(fileName);
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char *>(fileRecords.constData()), fileRecords.size() * sizeof(FileRecord));
+    out.write(reinterpret_cast<const char *>(symbolRecords.constData()), symbolRecords.size() * sizeof(SymbolRecord));
+    out.write(reinterpret_cast<const char *>(order.constData()), order.size() * sizeof(quint32));
+    out.write(strings);
+    return out.commit();
+}
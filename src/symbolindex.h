@@ -0,0 +1,85 @@
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+enum class SymbolKind : quint8 {
+    Class,
+    Function,
+    Macro
+};
+
+struct IndexedSymbol {
+    QByteArray name; // UTF-8
+    quint32 line;    // с единицы
+    SymbolKind kind;
+};
+
+struct IndexedFile {
+    QString path; // относительно корня проекта
+    qint64 mtime;
+    qint64 size;
+    QVector<IndexedSymbol> symbols;
+};
+
+struct SymbolLocation {
+    QString name;
+    QString filePath; // абсолютный
+    int line;
+    SymbolKind kind;
+};
+
+// Компактный индекс символов проекта на диске. Файл рассчитан на
+// отображение в память: заголовок, таблица файлов (путь, mtime, размер,
+// диапазон символов), записи символов, массив номеров символов,
+// отсортированный по имени без учёта регистра, и пул строк UTF-8.
+// Поиск — двоичный по этому массиву, без загрузки индекса в кучу.
+// Порядок байтов — родной: это кэш, при несовпадении заголовка он
+// просто перестраивается.
+class SymbolIndex {
+public:
+    SymbolIndex() = default;
+    SymbolIndex(const SymbolIndex &) = delete;
+    SymbolIndex &operator=(const SymbolIndex &) = delete;
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+
+    QString root() const;
+    int fileCount() const;
+    int symbolCount() const;
+
+    // Для инкрементальной переиндексации.
+    QString filePath(int file) const;
+    qint64 fileMtime(int file) const;
+    qint64 fileSize(int file) const;
+    QVector<IndexedSymbol> fileSymbols(int file) const;
+
+    QVector<SymbolLocation> find(const QString &name, int limit = 50) const;
+    QVector<SymbolLocation> search(const QString &prefix, int limit = 200) const;
+
+    static bool write(const QString &fileName, const QString &root, const QVector<IndexedFile> &files);
+
+private:
+    struct Header;
+    struct FileRecord;
+    struct SymbolRecord;
+
+    const Header *header() const;
+    const FileRecord *files() const;
+    const SymbolRecord *symbols() const;
+    const quint32 *nameIndex() const;
+    QByteArray string(quint32 offset, quint32 length) const;
+    SymbolLocation location(quint32 symbol) const;
+    const quint32 *lowerBound(const QByteArray &foldedKey) const;
+
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 dataSize = 0;
+};
+
+#endif // SYMBOLINDEX_H
@@ -0,0 +1,82 @@
+#include "symbolsearchdialog.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+QString kindName(SymbolKind kind)
+{
+    switch (kind)
+    {
+    case SymbolKind::Class:
+        return "тип";
+    case SymbolKind::Function:
+        return "функция";
+    case SymbolKind::Macro:
+        return "макрос";
+    }
+    return QString();
+}
+
+} // namespace
+
+SymbolSearchDialog::SymbolSearchDialog(const SymbolIndex &index, QWidget *parent)
+    : QDialog(parent), index(index)
+{
+    setWindowTitle("Символ в проекте");
+    resize(600, 400);
+
+    queryEdit = new QLineEdit(this);
+    queryEdit->setPlaceholderText("Имя символа...");
+    resultList = new QListWidget(this);
+    statusLabel = new QLabel(this);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(queryEdit);
+    layout->addWidget(resultList);
+    layout->addWidget(statusLabel);
+
+    connect(queryEdit, &QLineEdit::textChanged, this, &SymbolSearchDialog::updateResults);
+    connect(queryEdit, &QLineEdit::returnPressed, this, &QDialog::accept);
+    connect(resultList, &QListWidget::itemActivated, this, &QDialog::accept);
+
+    if (!index.isOpen())
+        statusLabel->setText("Индекс ещё не построен.");
+}
+
+void SymbolSearchDialog::setQuery(const QString &text)
+{
+    queryEdit->setText(text);
+    queryEdit->selectAll();
+}
+
+SymbolLocation SymbolSearchDialog::selectedLocation() const
+{
+    const int row = resultList->currentRow();
+    return row >= 0 && row < results.size() ? results[row] : SymbolLocation{QString(), QString(), 0, SymbolKind::Class};
+}
+
+void SymbolSearchDialog::updateResults(const QString &text)
+{
+    QElapsedTimer timer;
+    timer.start();
+    results = index.search(text.trimmed());
+    const qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+
+    resultList->clear();
+    for (const SymbolLocation &location : results)
+    {
+        resultList->addItem(QString("%1  [%2]  %3:%4")
+                                .arg(location.name, kindName(location.kind), QFileInfo(location.filePath).fileName())
+                                .arg(location.line));
+        resultList->item(resultList->count() - 1)->setToolTip(location.filePath);
+    }
+    if (!results.isEmpty())
+        resultList->setCurrentRow(0);
+    if (index.isOpen())
+        statusLabel->setText(QString("Найдено: %1 (%2 мкс)").arg(results.size()).arg(elapsedUs));
+}
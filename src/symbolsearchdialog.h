@@ -0,0 +1,34 @@
+#ifndef SYMBOLSEARCHDIALOG_H
+#define SYMBOLSEARCHDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+#include "symbolindex.h"
+
+class QLabel;
+class QLineEdit;
+class QListWidget;
+
+// Поиск символа по проекту: запрос по префиксу имени к индексу на диске
+// на каждое изменение строки, выбор открывает файл на нужной строке.
+class SymbolSearchDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    SymbolSearchDialog(const SymbolIndex &index, QWidget *parent = nullptr);
+
+    void setQuery(const QString &text);
+    SymbolLocation selectedLocation() const;
+
+private slots:
+    void updateResults(const QString &text);
+
+private:
+    const SymbolIndex &index;
+    QLineEdit *queryEdit;
+    QListWidget *resultList;
+    QLabel *statusLabel;
+    QVector<SymbolLocation> results;
+};
+
+#endif // SYMBOLSEARCHDIALOG_H
@@ -1,53 +1,215 @@
 #include "syntaxhighlighter.h"
+#include "blockdata.h"
+#include "highlightcache.h"
+#include "latencytracer.h"
+#include "theme.h"
+#include <QScopedValueRollback>
+#include <QSignalBlocker>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QTimer>
 
+namespace {
+
+// userState блока: младшие два бита — вид состояния, остальные — хеш
+// закрывающей последовательности. Так QSyntaxHighlighter видит смену
+// raw-разделителя и продолжает перекраску, а при совпадении — останавливается.
+int encodeState(const LexerState &state)
+{
+    if (state.kind == LexerState::Normal)
+        return 0;
+    return int(state.kind) | int((qHash(state.closing) & 0x0fffffff) << 2);
+}
+
+} // namespace
+
+// Документ подключается после своего обработчика contentsChange: версия
+// должна вырасти раньше, чем QSyntaxHighlighter начнёт перекраску правки,
+// иначе изменённый блок раскрасился бы устаревшими отрезками кэша.
 SyntaxHighlighter::SyntaxHighlighter(QTextDocument *parent)
-    : QSyntaxHighlighter(parent)
-{
-    QTextCharFormat keywordFormat;
-    keywordFormat.setForeground(Qt::blue);
-    keywordFormat.setFontWeight(QFont::Bold);
-
-    QStringList keywords = {
-        "int", "float", "if", "else", "while", "return", "class",
-        "import", "start", "Class", "print", "give", "function",
-        "Method", "connect", "from", "Path", "OSS", "protocol", "ip",
-        "port", "http", "https", "DNS", "ip-v4", "ip-v6", "break",
-        "open", "close", "mkadir", "rmdir", "delete", "rename",
-        "void", "stdout", "stderr", "list", "lib", "create",
-        "std", "vg", "trs", "exit", "return", "else if"};
-
-    for (const QString &keyword : keywords)
+    : QSyntaxHighlighter(static_cast<QObject *>(parent)), lexer(Lexer::defaultLexer()),
+      cache(new HighlightCache(lexer, this)), snapshotTimer(new QTimer(this))
+{
+    snapshotTimer->setSingleShot(true);
+    snapshotTimer->setInterval(SnapshotDelay);
+    connect(snapshotTimer, &QTimer::timeout, this, &SyntaxHighlighter::takeSnapshot);
+    connect(cache, &HighlightCache::ready, this, [this]
+            {
+                if (!cache->isValid(version))
+                    return; // правка во время сборки: снимок уже запланирован
+                refreshViewport();
+                emit cacheUpdated(); });
+    if (parent)
+    {
+        connect(parent, &QTextDocument::contentsChange, this, &SyntaxHighlighter::onContentsChange);
+        setDocument(parent);
+        snapshotTimer->start();
+    }
+}
+
+bool SyntaxHighlighter::isCacheValid() const
+{
+    return cache->isValid(version);
+}
+
+void SyntaxHighlighter::onContentsChange()
+{
+    if (applying)
+        return;
+    ++version;
+    snapshotTimer->start();
+}
+
+void SyntaxHighlighter::takeSnapshot()
+{
+    QTextDocument *text = document();
+    if (text)
+        cache->rebuild(text->toRawText(), text->blockCount(), version);
+}
+
+bool SyntaxHighlighter::inViewport(int line) const
+{
+    return line >= firstVisible - ViewportMargin && line <= lastVisible + ViewportMargin;
+}
+
+void SyntaxHighlighter::setViewport(const QTextBlock &first, const QTextBlock &last)
+{
+    firstVisible = first.blockNumber();
+    lastVisible = qMax(firstVisible, last.blockNumber());
+    refreshViewport();
+}
+
+// Блоки окна, раскрашенные не последней сборкой кэша (или ничем),
+// подсвечиваются заново. Перекраска своя, поэтому версия не растёт.
+void SyntaxHighlighter::refreshViewport()
+{
+    QTextDocument *text = document();
+    if (!text)
+        return;
+    const bool cached = cache->isValid(version);
+    const int generation = cache->generation();
+    const int last = lastVisible + ViewportMargin;
+    const QScopedValueRollback<bool> guard(applying, true);
+    for (QTextBlock block = text->findBlockByNumber(qMax(0, firstVisible - ViewportMargin));
+         block.isValid() && block.blockNumber() <= last; block = block.next())
     {
-        HighlightingRule rule;
-        rule.pattern = QRegularExpression("\\b" + keyword + "\\b");
-        rule.format = keywordFormat;
-        highlightingRules.append(rule);
+        const BlockData *data = static_cast<BlockData *>(block.userData());
+        const int highlighted = data ? data->highlighted : int(BlockData::Pending);
+        if (highlighted == BlockData::Pending || (cached && highlighted != generation))
+            rehighlightBlock(block);
     }
+}
 
-    QTextCharFormat commentFormat;
-    commentFormat.setForeground(Qt::darkGreen);
-    HighlightingRule commentRule;
-    commentRule.pattern = QRegularExpression("//[^\n]*");
-    commentRule.format = commentFormat;
-    highlightingRules.append(commentRule);
+LexerState SyntaxHighlighter::incomingState() const
+{
+    const int previous = previousBlockState();
+    if (previous <= 0)
+        return LexerState();
 
-    QTextCharFormat stringFormat;
-    stringFormat.setForeground(Qt::darkRed);
-    HighlightingRule stringRule;
-    stringRule.pattern = QRegularExpression("\".*\"");
-    stringRule.format = stringFormat;
-    highlightingRules.append(stringRule);
+    LexerState state;
+    state.kind = LexerState::Kind(previous & 3);
+    if (BlockData *data = static_cast<BlockData *>(currentBlock().previous().userData()))
+        state.closing = data->closing;
+    if (state.closing.isEmpty())
+        return LexerState();
+    return state;
+}
+
+// У раскрашенного блока запоминается поколение темы, чтобы при смене
+// темы перекрашивать только то, что ещё не перекрашено, и чем он
+// раскрашен, чтобы окно знало, что подсветить заново.
+void SyntaxHighlighter::storeOutgoingState(const LexerState &state, int highlighted)
+{
+    BlockData *data = static_cast<BlockData *>(currentBlockUserData());
+    if (!data)
+    {
+        data = new BlockData;
+        setCurrentBlockUserData(data);
+    }
+    data->closing = state.closing;
+    data->theme = Theme::generation();
+    data->highlighted = highlighted;
+    setCurrentBlockState(encodeState(state));
+}
+
+void SyntaxHighlighter::applyCached(int line)
+{
+    int count = 0;
+    const HighlightCache::Span *spans = cache->spans(line, &count);
+    const Theme &theme = Theme::current();
+    for (int i = 0; i < count; ++i)
+        setFormat(int(spans[i].start), int(spans[i].length), theme.format(TokenKind(spans[i].kind)));
+    storeOutgoingState(cache->outgoingState(line), cache->generation());
 }
 
 void SyntaxHighlighter::highlightBlock(const QString &text)
 {
-    for (const HighlightingRule &rule : highlightingRules)
+    const int line = currentBlock().blockNumber();
+    if (cache->isValid(version) && line < cache->lineCount())
+    {
+        applyCached(line);
+        return;
+    }
+    if (!inViewport(line))
     {
-        QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
-        while (matchIterator.hasNext())
+        // Состояние блока не меняется, поэтому QSyntaxHighlighter дальше
+        // по документу не пойдёт; блок подсветится, когда попадёт в окно.
+        BlockData *data = static_cast<BlockData *>(currentBlockUserData());
+        if (!data)
         {
-            QRegularExpressionMatch match = matchIterator.next();
-            setFormat(match.capturedStart(), match.capturedLength(), rule.format);
+            data = new BlockData;
+            setCurrentBlockUserData(data);
         }
+        data->highlighted = BlockData::Pending;
+        return;
     }
-}
\ No newline at end of file
+
+    const LatencyTracer::Scope scope(LatencyTracer::Highlight, line);
+    const LexerState state = lexer.tokenize(text, tokens, incomingState());
+    const Theme &theme = Theme::current();
+    for (const Token &token : tokens)
+    {
+        if (token.kind == TokenKind::Identifier || token.kind == TokenKind::Text)
+            continue;
+        setFormat(token.start, token.length, theme.format(token.kind));
+    }
+    storeOutgoingState(state, BlockData::Lexed);
+}
+
+void SyntaxHighlighter::restyle(const QTextBlock &first, const QTextBlock &last)
+{
+    QTextDocument *text = document();
+    if (!text)
+        return;
+    const Theme &theme = Theme::current();
+    const int generation = Theme::generation();
+    for (QTextBlock block = first; block.isValid(); block = block.next())
+    {
+        BlockData *data = static_cast<BlockData *>(block.userData());
+        if (data && data->theme != generation)
+        {
+            data->theme = generation;
+            QTextLayout *layout = block.layout();
+            QList<QTextLayout::FormatRange> ranges = layout->formats();
+            if (!ranges.isEmpty())
+            {
+                for (QTextLayout::FormatRange &range : ranges)
+                {
+                    if (range.format.hasProperty(Theme::TokenKindProperty))
+                        range.format = theme.format(TokenKind(range.format.intProperty(Theme::TokenKindProperty)));
+                }
+                layout->setFormats(ranges);
+
+                // Раскладку блока нужно пересчитать: жирный и курсив меняют
+                // ширину. Текст не менялся, поэтому сигналы документа на это
+                // время заглушены — ни подсветке, ни истории отмены, ни
+                // индексу слов видеть такую правку незачем.
+                const QSignalBlocker blocker(text);
+                text->markContentsDirty(block.position(), block.length());
+            }
+        }
+        if (block == last)
+            break;
+    }
+}
@@ -2,25 +2,60 @@
 #define SYNTAXHIGHLIGHTER_H
 
 #include <QSyntaxHighlighter>
-#include <QTextCharFormat>
-#include <QRegularExpression>
 #include <QVector>
+#include "lexer.h"
 
+class HighlightCache;
+class QTextBlock;
+class QTimer;
+
+// Подсветка с лексером вне потока GUI. Весь документ разбирает
+// HighlightCache по снимку текста, сделанному через SnapshotDelay мс
+// после последней правки. Пока кэш соответствует версии документа,
+// блоки раскрашиваются готовыми отрезками. Иначе лексер запускается
+// здесь же, но только для видимых блоков и ViewportMargin блоков вокруг;
+// остальные остаются без подсветки и ждут кэша.
 class SyntaxHighlighter : public QSyntaxHighlighter {
     Q_OBJECT
 
 public:
+    static constexpr int ViewportMargin = 64;
+    static constexpr int SnapshotDelay = 150;
+
     explicit SyntaxHighlighter(QTextDocument *parent = nullptr);
 
+    // Перекрашивает блоки first..last, подсвеченные прежней темой:
+    // форматы заменяются по виду токена, лексер не запускается.
+    void restyle(const QTextBlock &first, const QTextBlock &last);
+
+    // Видимые блоки first..last. Ещё не раскрашенные блоки окна
+    // подсвечиваются сразу: из кэша, если он свежий, иначе лексером.
+    void setViewport(const QTextBlock &first, const QTextBlock &last);
+    bool isCacheValid() const;
+
+signals:
+    void cacheUpdated();
+
 protected:
     void highlightBlock(const QString &text) override;
 
 private:
-    struct HighlightingRule {
-        QRegularExpression pattern;
-        QTextCharFormat format;
-    };
-    QVector<HighlightingRule> highlightingRules;
+    LexerState incomingState() const;
+    void storeOutgoingState(const LexerState &state, int highlighted);
+    void applyCached(int line);
+    bool inViewport(int line) const;
+    void refreshViewport();
+    void onContentsChange();
+    void takeSnapshot();
+
+    const Lexer &lexer;
+    QVector<Token> tokens;
+    HighlightCache *cache;
+    QTimer *snapshotTimer;
+    quint64 version = 0;   // растёт с каждой правкой документа
+    int firstVisible = 0;
+    int lastVisible = 0;
+    bool applying = false; // своя перекраска — не правка
 };
 
-#endif // SYNTAXHIGHLIGHTER_H
\ No newline at end of file
+#endif // SYNTAXHIGHLIGHTER_H
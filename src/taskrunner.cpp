@@ -0,0 +1,461 @@
+#include "taskrunner.h"
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <memory>
+#include <windows.h>
+#endif
+
+namespace {
+
+constexpr int KillTimeoutMs = 3000;
+constexpr int SampleIntervalMs = 500;
+
+#ifdef Q_OS_UNIX
+struct ChildUsage {
+    qint64 cpuMs;
+    qint64 maxRssKb;
+};
+
+// Выполняется в дочернем процессе после fork(), поэтому только
+// async-signal-safe вызовы. Процесс делится: потомок возвращается и
+// запускает программу задачи, а этот процесс ждёт его через wait4(),
+// пишет его rusage в usageFd и завершается с тем же статусом.
+// Отмену (SIGTERM группе) он пропускает мимо себя — её получает программа.
+void forkUsageReporter(int usageFd)
+{
+    const pid_t child = ::fork();
+    if (child <= 0)
+        return;
+
+    // Чужие дескрипторы (в том числе канал, по которому QProcess узнаёт
+    // о запуске программы) закрываются, иначе запуск затянулся бы до конца задачи.
+    rlimit limit;
+    int maxFd = 1024;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+        maxFd = int(qMin<rlim_t>(limit.rlim_cur, 65536));
+    for (int fd = 3; fd < maxFd; ++fd)
+    {
+        if (fd != usageFd)
+            ::close(fd);
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = SIG_IGN;
+    ::sigaction(SIGTERM, &action, nullptr);
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGHUP, &action, nullptr);
+    action.sa_handler = SIG_DFL;
+    ::sigaction(SIGCHLD, &action, nullptr);
+
+    int status = 0;
+    rusage usage = {};
+    while (::wait4(child, &status, 0, &usage) < 0)
+    {
+        if (errno != EINTR)
+            ::_exit(127);
+    }
+
+    ChildUsage report;
+    report.cpuMs = (qint64(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000
+        + (qint64(usage.ru_utime.tv_usec) + usage.ru_stime.tv_usec) / 1000;
+#ifdef Q_OS_MACOS
+    report.maxRssKb = usage.ru_maxrss / 1024; // в байтах
+#else
+    report.maxRssKb = usage.ru_maxrss;
+#endif
+    if (::write(usageFd, &report, sizeof(report)) < 0)
+        ::_exit(127);
+
+    if (WIFSIGNALED(status))
+    {
+        ::sigaction(WTERMSIG(status), &action, nullptr);
+        ::kill(::getpid(), WTERMSIG(status));
+    }
+    ::_exit(WIFEXITED(status) ? WEXITSTATUS(status) : 127);
+}
+#endif
+
+} // namespace
+
+TaskRunner::TaskRunner(QObject *parent)
+    : QObject(parent)
+{
+    sampleTimer = new QTimer(this);
+    sampleTimer->setInterval(SampleIntervalMs);
+    connect(sampleTimer, &QTimer::timeout, this, &TaskRunner::sampleMemory);
+}
+
+TaskRunner::~TaskRunner()
+{
+    for (Task &task : tasks)
+    {
+        if (!task.process)
+            continue;
+        disconnect(task.process, nullptr, this, nullptr);
+        killTree(task.process, true);
+        task.process->waitForFinished(KillTimeoutMs);
+        TaskResult ignored;
+        collectUsage(task, ignored);
+    }
+}
+
+void TaskRunner::setMaxParallel(int count)
+{
+    maxParallel = qMax(1, count);
+    schedule();
+}
+
+int TaskRunner::submit(const TaskSpec &spec, int dependsOn)
+{
+    // Проверка раньше отмены: отклонённая задача не должна отменять прежние.
+    int queued = 0;
+    for (const Task &task : std::as_const(tasks))
+    {
+        if (!task.process)
+            ++queued;
+    }
+    if (queued >= MaxQueued)
+        return 0;
+
+    if (!spec.group.isEmpty())
+        cancelGroup(spec.group);
+
+    // Уже закончившаяся зависимость считается выполненной.
+    if (dependsOn && indexOf(dependsOn) < 0)
+        dependsOn = 0;
+
+    const int id = nextId++;
+    tasks.append({id, spec, dependsOn, nullptr, QElapsedTimer(), -1, false});
+    schedule();
+    return id;
+}
+
+void TaskRunner::cancel(int id)
+{
+    const int index = indexOf(id);
+    if (index < 0)
+        return;
+
+    Task &task = tasks[index];
+    if (task.process)
+    {
+        if (task.cancelRequested)
+            return;
+        task.cancelRequested = true;
+        killTree(task.process, false);
+        QTimer::singleShot(KillTimeoutMs, this, [this, id]
+                           {
+                               const int index = indexOf(id);
+                               if (index >= 0 && tasks[index].process)
+                                   killTree(tasks[index].process, true); });
+        return;
+    }
+
+    const Task removed = tasks.takeAt(index);
+    emit taskFinished(id, removed.spec, {false, true, -1, 0, -1, -1});
+    resolveDependents(id, false);
+}
+
+void TaskRunner::cancelGroup(const QString &group)
+{
+    QVector<int> ids;
+    for (const Task &task : std::as_const(tasks))
+    {
+        if (task.spec.group == group)
+            ids.append(task.id);
+    }
+    for (int id : std::as_const(ids))
+        cancel(id);
+}
+
+int TaskRunner::indexOf(int id) const
+{
+    for (int i = 0; i < tasks.size(); ++i)
+    {
+        if (tasks[i].id == id)
+            return i;
+    }
+    return -1;
+}
+
+int TaskRunner::indexOf(const QProcess *process) const
+{
+    for (int i = 0; i < tasks.size(); ++i)
+    {
+        if (tasks[i].process == process)
+            return i;
+    }
+    return -1;
+}
+
+void TaskRunner::schedule()
+{
+    // Задача ждёт, пока не доработает отменённая предшественница из той же группы:
+    // две сборки в одном каталоге друг другу мешают.
+    int running = 0;
+    QSet<QString> busyGroups;
+    for (const Task &task : std::as_const(tasks))
+    {
+        if (!task.process)
+            continue;
+        ++running;
+        if (!task.spec.group.isEmpty())
+            busyGroups.insert(task.spec.group);
+    }
+
+    QVector<int> started;
+    for (Task &task : tasks)
+    {
+        if (running >= maxParallel)
+            break;
+        if (task.process || task.dependsOn || busyGroups.contains(task.spec.group))
+            continue;
+        task.process = takeProcess();
+        task.timer.start();
+        task.process->setWorkingDirectory(task.spec.workingDirectory);
+        startProcess(task);
+        started.append(task.id);
+        ++running;
+    }
+#ifdef Q_OS_LINUX
+    if (running > 0 && !sampleTimer->isActive())
+        sampleTimer->start();
+#endif
+
+    for (int id : std::as_const(started))
+    {
+        const int index = indexOf(id);
+        if (index >= 0)
+            emit taskStarted(id, tasks[index].spec);
+    }
+}
+
+QProcess *TaskRunner::takeProcess()
+{
+    if (!idle.isEmpty())
+        return idle.takeLast();
+
+    QProcess *process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, process]
+            { readOutput(process); });
+    connect(process, &QProcess::finished, this, [this, process](int exitCode, QProcess::ExitStatus status)
+            { onProcessFinished(process, exitCode, status); });
+    // Не запустившийся процесс не присылает finished. Очередью — чтобы
+    // не войти в onProcessFinished изнутри schedule().
+    connect(
+        process, &QProcess::errorOccurred, this, [this, process](QProcess::ProcessError error)
+        {
+            if (error != QProcess::FailedToStart)
+                return;
+            const int index = indexOf(process);
+            if (index >= 0)
+                emit taskOutput(tasks[index].id, QString("Не удалось запустить %1: %2\n")
+                                                     .arg(tasks[index].spec.program, process->errorString())
+                                                     .toUtf8());
+            onProcessFinished(process, -1, QProcess::CrashExit); },
+        Qt::QueuedConnection);
+    return process;
+}
+
+void TaskRunner::startProcess(Task &task)
+{
+#ifdef Q_OS_UNIX
+    int fds[2];
+    int writeFd = -1;
+    if (::pipe(fds) == 0)
+    {
+        ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        task.usageFd = fds[0];
+        writeFd = fds[1];
+    }
+    // Своя группа процессов: отмена должна дойти до всего, что запустила задача.
+    task.process->setChildProcessModifier([writeFd]
+                                          {
+                                              ::setpgid(0, 0);
+                                              if (writeFd >= 0)
+                                                  forkUsageReporter(writeFd); });
+    task.process->start(task.spec.program, task.spec.arguments);
+    if (writeFd >= 0)
+        ::close(writeFd);
+#elif defined(Q_OS_WIN)
+    // Процесс создаётся приостановленным и продолжает работу уже в задании:
+    // всё, что он запустит, попадёт в тот же учёт.
+    task.job = ::CreateJobObjectW(nullptr, nullptr);
+    auto information = std::make_shared<PROCESS_INFORMATION *>(nullptr);
+    task.process->setCreateProcessArgumentsModifier([information](QProcess::CreateProcessArguments *arguments)
+                                                    {
+                                                        arguments->flags |= CREATE_SUSPENDED;
+                                                        *information = arguments->processInformation; });
+    task.process->start(task.spec.program, task.spec.arguments);
+    if (*information && task.process->state() != QProcess::NotRunning)
+    {
+        if (task.job)
+            ::AssignProcessToJobObject(task.job, (*information)->hProcess);
+        ::ResumeThread((*information)->hThread);
+    }
+#else
+    task.process->start(task.spec.program, task.spec.arguments);
+#endif
+}
+
+// Забирает учёт задачи и освобождает его ресурсы; процесс уже завершён.
+void TaskRunner::collectUsage(Task &task, TaskResult &result)
+{
+#ifdef Q_OS_UNIX
+    if (task.usageFd >= 0)
+    {
+        ChildUsage usage;
+        if (::read(task.usageFd, &usage, sizeof(usage)) == sizeof(usage))
+        {
+            result.cpuMs = usage.cpuMs;
+            result.peakRssKb = qMax(result.peakRssKb, usage.maxRssKb);
+        }
+        ::close(task.usageFd);
+        task.usageFd = -1;
+    }
+#elif defined(Q_OS_WIN)
+    if (task.job)
+    {
+        JOBOBJECT_BASIC_ACCOUNTING_INFORMATION accounting;
+        if (::QueryInformationJobObject(task.job, JobObjectBasicAccountingInformation, &accounting, sizeof(accounting), nullptr))
+            result.cpuMs = (accounting.TotalUserTime.QuadPart + accounting.TotalKernelTime.QuadPart) / 10000;
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits;
+        if (::QueryInformationJobObject(task.job, JobObjectExtendedLimitInformation, &limits, sizeof(limits), nullptr))
+            result.peakRssKb = qint64(limits.PeakJobMemoryUsed / 1024);
+        ::CloseHandle(task.job);
+        task.job = nullptr;
+    }
+#else
+    Q_UNUSED(task);
+    Q_UNUSED(result);
+#endif
+}
+
+void TaskRunner::readOutput(QProcess *process)
+{
+    const int index = indexOf(process);
+    if (index < 0)
+        return;
+    const QByteArray bytes = process->readAll();
+    if (!bytes.isEmpty())
+        emit taskOutput(tasks[index].id, bytes);
+}
+
+void TaskRunner::onProcessFinished(QProcess *process, int exitCode, QProcess::ExitStatus status)
+{
+    readOutput(process);
+    const int index = indexOf(process);
+    if (index < 0)
+        return;
+    Task task = tasks.takeAt(index);
+
+    TaskResult result;
+    result.cancelled = task.cancelRequested;
+    result.success = !task.cancelRequested && status == QProcess::NormalExit && exitCode == 0;
+    result.exitCode = exitCode;
+    result.wallMs = task.timer.elapsed();
+    result.cpuMs = -1;
+    result.peakRssKb = task.peakRssKb;
+    collectUsage(task, result);
+
+    if (idle.size() < maxParallel)
+        idle.append(process);
+    else
+        process->deleteLater();
+
+    emit taskFinished(task.id, task.spec, result);
+    resolveDependents(task.id, result.success);
+    schedule();
+}
+
+void TaskRunner::resolveDependents(int id, bool success)
+{
+    QVector<int> dependents;
+    for (Task &task : tasks)
+    {
+        if (task.dependsOn != id)
+            continue;
+        if (success)
+            task.dependsOn = 0;
+        else
+            dependents.append(task.id);
+    }
+    for (int dependent : std::as_const(dependents))
+        cancel(dependent);
+}
+
+void TaskRunner::killTree(QProcess *process, bool force)
+{
+    const qint64 pid = process->processId();
+    if (pid <= 0)
+        return;
+#ifdef Q_OS_UNIX
+    ::kill(-pid_t(pid), force ? SIGKILL : SIGTERM);
+#elif defined(Q_OS_WIN)
+    QStringList arguments = {"/T", "/PID", QString::number(pid)};
+    if (force)
+        arguments.prepend("/F");
+    QProcess::startDetached("taskkill", arguments);
+#else
+    Q_UNUSED(force);
+    process->kill();
+#endif
+}
+
+// Linux: суммарный RSS процессов группы каждой выполняющейся задачи.
+void TaskRunner::sampleMemory()
+{
+#ifdef Q_OS_LINUX
+    QHash<qint64, qint64> rssByGroup;
+    for (const Task &task : std::as_const(tasks))
+    {
+        if (task.process && task.process->processId() > 0)
+            rssByGroup.insert(task.process->processId(), 0);
+    }
+    if (rssByGroup.isEmpty())
+    {
+        sampleTimer->stop();
+        return;
+    }
+
+    const qint64 pageKb = qMax(1L, sysconf(_SC_PAGESIZE) / 1024);
+    const QStringList entries = QDir("/proc").entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &entry : entries)
+    {
+        if (!entry.front().isDigit())
+            continue;
+        QFile file("/proc/" + entry + "/stat");
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+        // pid (comm) state ppid pgrp ... rss — после скобки поля с третьего.
+        const QByteArray stat = file.readAll();
+        const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+        if (fields.size() < 22)
+            continue;
+        const auto group = rssByGroup.find(fields[2].toLongLong());
+        if (group != rssByGroup.end())
+            *group += fields[21].toLongLong() * pageKb;
+    }
+
+    for (Task &task : tasks)
+    {
+        if (task.process)
+            task.peakRssKb = qMax(task.peakRssKb, rssByGroup.value(task.process->processId(), -1));
+    }
+#endif
+}
@@ -0,0 +1,99 @@
+#ifndef TASKRUNNER_H
+#define TASKRUNNER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QTimer;
+
+struct TaskSpec {
+    QString name;
+    QString program;
+    QStringList arguments;
+    QString workingDirectory;
+    QString group; // новая задача группы отменяет незаконченные задачи той же группы
+};
+
+struct TaskResult {
+    bool success;
+    bool cancelled;
+    int exitCode;
+    qint64 wallMs;
+    qint64 cpuMs;     // задача и дождавшиеся её потомки, -1 — неизвестно
+    qint64 peakRssKb; // пик памяти задачи (см. TaskRunner), -1 — неизвестно
+};
+
+// Очередь внешних задач (сборка, запуск). Очередь ограничена,
+// одновременно выполняется не больше maxParallel задач. Задача может
+// ждать успешного окончания другой (сборка, затем запуск) — если та не
+// удалась, ожидающая отменяется. Новая задача группы отменяет прежние
+// и стартует, только когда они доработают. Каждая задача запускается
+// в своей группе процессов, отмена завершает всё дерево. Объекты
+// QProcess переиспользуются. По окончании сообщается время, процессорное
+// время дерева и пик памяти — только самой задачи, не других потомков
+// IDE. В POSIX между QProcess и программой стоит ожидающий процесс:
+// он получает rusage задачи через wait4() и передаёт её по каналу.
+// В Windows задача запускается в своём объекте задания (Job), время и
+// пик выделенной памяти берутся из QueryInformationJobObject. В Linux
+// пик памяти дерева дополнительно уточняется опросом /proc.
+class TaskRunner : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int MaxQueued = 16;
+
+    explicit TaskRunner(QObject *parent = nullptr);
+    ~TaskRunner() override;
+
+    void setMaxParallel(int count);
+
+    // Номер задачи или 0, если очередь переполнена. dependsOn — номер
+    // задачи, которая должна успешно закончиться раньше (0 — нет).
+    int submit(const TaskSpec &spec, int dependsOn = 0);
+    void cancel(int id);
+    void cancelGroup(const QString &group);
+    bool isPending(int id) const { return indexOf(id) >= 0; }
+
+signals:
+    void taskStarted(int id, const TaskSpec &spec);
+    void taskOutput(int id, const QByteArray &bytes);
+    void taskFinished(int id, const TaskSpec &spec, const TaskResult &result);
+
+private:
+    struct Task {
+        int id;
+        TaskSpec spec;
+        int dependsOn;
+        QProcess *process;
+        QElapsedTimer timer;
+        qint64 peakRssKb;
+        bool cancelRequested;
+        int usageFd = -1;          // POSIX: чтение rusage от ожидающего процесса
+        Qt::HANDLE job = nullptr;  // Windows: объект задания
+    };
+
+    int indexOf(int id) const;
+    int indexOf(const QProcess *process) const;
+    void schedule();
+    QProcess *takeProcess();
+    void readOutput(QProcess *process);
+    void onProcessFinished(QProcess *process, int exitCode, QProcess::ExitStatus status);
+    void resolveDependents(int id, bool success);
+    void killTree(QProcess *process, bool force);
+    void sampleMemory();
+    void startProcess(Task &task);
+    void collectUsage(Task &task, TaskResult &result);
+
+    QList<Task> tasks; // в порядке постановки: ожидающие и выполняющиеся
+    QVector<QProcess *> idle;
+    QTimer *sampleTimer;
+    int nextId = 1;
+    int maxParallel = 2;
+};
+
+#endif // TASKRUNNER_H
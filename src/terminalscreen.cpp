@@ -0,0 +1,510 @@
+#include "terminalscreen.h"
+#include <algorithm>
+
+TerminalScreen::TerminalScreen(int columns, int rows)
+    : width(qMax(1, columns)), height(qMax(1, rows)), bottom(height - 1)
+{
+    lines.fill(Line(width), height);
+    damaged.resize(height);
+}
+
+const TerminalScreen::Line &TerminalScreen::line(int index) const
+{
+    if (index >= 0)
+        return lines[index];
+    return history[(historyStart + history.size() + index) % history.size()];
+}
+
+TerminalScreen::Cell TerminalScreen::blank() const
+{
+    // Стирание закрашивает фоном текущего пера (background color erase).
+    Cell cell;
+    cell.bg = penCell.bg;
+    return cell;
+}
+
+TerminalScreen::Line TerminalScreen::blankLine() const
+{
+    return Line(width, blank());
+}
+
+void TerminalScreen::damage(int row)
+{
+    damaged.setBit(row);
+}
+
+void TerminalScreen::damageRange(int first, int last)
+{
+    for (int row = qMax(0, first); row <= qMin(last, height - 1); ++row)
+        damaged.setBit(row);
+}
+
+void TerminalScreen::clampCursor()
+{
+    cursorX = qBound(0, cursorX, width - 1);
+    cursorY = qBound(0, cursorY, height - 1);
+}
+
+void TerminalScreen::setScrollback(int count)
+{
+    count = qMax(0, count);
+    if (count < history.size())
+    {
+        QVector<Line> kept;
+        kept.reserve(count);
+        for (int i = history.size() - count; i < history.size(); ++i)
+            kept.append(line(i - history.size()));
+        history = kept;
+        historyStart = 0;
+        allDamaged = true;
+    }
+    scrollbackLimit = count;
+}
+
+void TerminalScreen::pushHistory(Line line)
+{
+    if (scrollbackLimit == 0)
+        return;
+    if (history.size() < scrollbackLimit)
+    {
+        history.append(std::move(line));
+    }
+    else
+    {
+        history[historyStart] = std::move(line);
+        historyStart = (historyStart + 1) % history.size();
+    }
+    ++historyAdded;
+}
+
+void TerminalScreen::resize(int columns, int rows)
+{
+    columns = qMax(1, columns);
+    rows = qMax(1, rows);
+    if (columns == width && rows == height)
+        return;
+
+    // Лишние строки сверху уходят в историю, чтобы курсор остался на экране.
+    if (rows < height)
+    {
+        const int shift = qMax(0, cursorY - rows + 1);
+        for (int i = 0; i < shift; ++i)
+        {
+            if (!alternate)
+                pushHistory(lines[i]);
+        }
+        lines.remove(0, shift);
+        lines.resize(rows);
+        cursorY -= shift;
+    }
+    else
+    {
+        lines.resize(rows);
+    }
+    for (Line &row : lines)
+        row.resize(columns);
+    if (!savedLines.isEmpty())
+    {
+        savedLines.resize(rows);
+        for (Line &row : savedLines)
+            row.resize(columns);
+    }
+
+    width = columns;
+    height = rows;
+    top = 0;
+    bottom = height - 1;
+    wrapPending = false;
+    clampCursor();
+    damaged.resize(height);
+    allDamaged = true;
+}
+
+TerminalScreen::Update TerminalScreen::takeUpdate()
+{
+    Update update;
+    update.scrolled = scrolled;
+    update.damaged = damaged;
+    update.all = allDamaged;
+    update.historyAdded = historyAdded;
+    damaged.fill(false);
+    scrolled = 0;
+    allDamaged = false;
+    historyAdded = 0;
+    return update;
+}
+
+void TerminalScreen::putCell(char32_t ch)
+{
+    if (wrapPending && autoWrap)
+    {
+        carriageReturn();
+        lineFeed();
+    }
+    wrapPending = false;
+
+    Line &row = lines[cursorY];
+    if (insertMode)
+    {
+        row.insert(cursorX, blank());
+        row.removeLast();
+    }
+    Cell &cell = row[cursorX];
+    cell = penCell;
+    cell.ch = ch;
+    damaged.setBit(cursorY);
+    lastChar = ch;
+    if (cursorX + 1 >= width)
+        wrapPending = true;
+    else
+        ++cursorX;
+}
+
+void TerminalScreen::printAscii(const char *text, int count)
+{
+    for (int i = 0; i < count; ++i)
+        putCell(char32_t(uchar(text[i])));
+}
+
+void TerminalScreen::print(char32_t ch)
+{
+    putCell(ch);
+}
+
+void TerminalScreen::repeatLast(int count)
+{
+    count = qMin(count, width * height);
+    for (int i = 0; i < count; ++i)
+        putCell(lastChar);
+}
+
+void TerminalScreen::lineFeed()
+{
+    wrapPending = false;
+    if (cursorY == bottom)
+        scrollUp(1);
+    else if (cursorY < height - 1)
+        ++cursorY;
+}
+
+void TerminalScreen::reverseIndex()
+{
+    wrapPending = false;
+    if (cursorY == top)
+        scrollDown(1);
+    else if (cursorY > 0)
+        --cursorY;
+}
+
+void TerminalScreen::carriageReturn()
+{
+    cursorX = 0;
+    wrapPending = false;
+}
+
+void TerminalScreen::backspace()
+{
+    wrapPending = false;
+    if (cursorX > 0)
+        --cursorX;
+}
+
+void TerminalScreen::tab(int count)
+{
+    wrapPending = false;
+    for (int i = 0; i < count && cursorX < width - 1; ++i)
+        cursorX = qMin(width - 1, (cursorX / 8 + 1) * 8);
+}
+
+void TerminalScreen::moveCursor(int row, int column)
+{
+    wrapPending = false;
+    if (originMode)
+        cursorY = qBound(top, top + row, bottom);
+    else
+        cursorY = qBound(0, row, height - 1);
+    cursorX = qBound(0, column, width - 1);
+}
+
+// Внутри области прокрутки курсор останавливается на её границах.
+void TerminalScreen::moveCursorBy(int rows, int columns)
+{
+    wrapPending = false;
+    const bool inside = cursorY >= top && cursorY <= bottom;
+    cursorY = inside ? qBound(top, cursorY + rows, bottom) : qBound(0, cursorY + rows, height - 1);
+    cursorX = qBound(0, cursorX + columns, width - 1);
+}
+
+void TerminalScreen::setCursorColumn(int column)
+{
+    wrapPending = false;
+    cursorX = qBound(0, column, width - 1);
+}
+
+void TerminalScreen::setCursorRow(int row)
+{
+    moveCursor(row, cursorX);
+}
+
+void TerminalScreen::eraseInDisplay(int mode)
+{
+    const Cell cell = blank();
+    switch (mode)
+    {
+    case 0:
+        eraseInLine(0);
+        for (int row = cursorY + 1; row < height; ++row)
+            lines[row].fill(cell);
+        damageRange(cursorY, height - 1);
+        break;
+    case 1:
+        eraseInLine(1);
+        for (int row = 0; row < cursorY; ++row)
+            lines[row].fill(cell);
+        damageRange(0, cursorY);
+        break;
+    case 2:
+        for (Line &row : lines)
+            row.fill(cell);
+        damageRange(0, height - 1);
+        break;
+    case 3:
+        history.clear();
+        historyStart = 0;
+        allDamaged = true;
+        break;
+    default:
+        break;
+    }
+}
+
+void TerminalScreen::eraseInLine(int mode)
+{
+    Line &row = lines[cursorY];
+    const Cell cell = blank();
+    const int from = mode == 0 ? cursorX : 0;
+    const int to = mode == 1 ? cursorX + 1 : width;
+    std::fill(row.begin() + from, row.begin() + to, cell);
+    damage(cursorY);
+}
+
+void TerminalScreen::eraseChars(int count)
+{
+    Line &row = lines[cursorY];
+    std::fill(row.begin() + cursorX, row.begin() + qMin(width, cursorX + qMax(1, count)), blank());
+    damage(cursorY);
+}
+
+void TerminalScreen::insertChars(int count)
+{
+    count = qBound(1, count, width - cursorX);
+    Line &row = lines[cursorY];
+    row.insert(cursorX, count, blank());
+    row.resize(width);
+    wrapPending = false;
+    damage(cursorY);
+}
+
+void TerminalScreen::deleteChars(int count)
+{
+    count = qBound(1, count, width - cursorX);
+    Line &row = lines[cursorY];
+    row.remove(cursorX, count);
+    row.insert(row.size(), count, blank());
+    wrapPending = false;
+    damage(cursorY);
+}
+
+void TerminalScreen::insertLines(int count)
+{
+    if (cursorY < top || cursorY > bottom)
+        return;
+    count = qBound(1, count, bottom - cursorY + 1);
+    std::rotate(lines.begin() + cursorY, lines.begin() + bottom + 1 - count, lines.begin() + bottom + 1);
+    for (int row = cursorY; row < cursorY + count; ++row)
+        lines[row] = blankLine();
+    cursorX = 0;
+    wrapPending = false;
+    damageRange(cursorY, bottom);
+}
+
+void TerminalScreen::deleteLines(int count)
+{
+    if (cursorY < top || cursorY > bottom)
+        return;
+    count = qBound(1, count, bottom - cursorY + 1);
+    std::rotate(lines.begin() + cursorY, lines.begin() + cursorY + count, lines.begin() + bottom + 1);
+    for (int row = bottom + 1 - count; row <= bottom; ++row)
+        lines[row] = blankLine();
+    cursorX = 0;
+    wrapPending = false;
+    damageRange(cursorY, bottom);
+}
+
+// Строки, ушедшие с верха основного экрана, попадают в историю. Если
+// прокручивается весь экран, испорченные строки сдвигаются вместе с
+// текстом: виджет сдвинет картинку и дорисует только новое.
+void TerminalScreen::scrollUp(int count)
+{
+    count = qMin(count, bottom - top + 1);
+    if (count <= 0)
+        return;
+    const bool whole = top == 0 && bottom == height - 1;
+    const Cell cell = blank();
+    for (int i = 0; i < count; ++i)
+    {
+        Line &row = lines[top + i];
+        if (top == 0 && !alternate && scrollbackLimit > 0)
+        {
+            // Вытесненная из полной истории строка становится новой пустой.
+            Line recycled;
+            if (history.size() == scrollbackLimit)
+                recycled = std::move(history[historyStart]);
+            pushHistory(std::move(row));
+            row = std::move(recycled);
+        }
+        row.resize(width);
+        row.fill(cell);
+    }
+    std::rotate(lines.begin() + top, lines.begin() + top + count, lines.begin() + bottom + 1);
+
+    if (whole)
+    {
+        scrolled += count;
+        for (int row = 0; row + count < height; ++row)
+            damaged.setBit(row, damaged.testBit(row + count));
+        damageRange(height - count, height - 1);
+    }
+    else
+    {
+        damageRange(top, bottom);
+    }
+}
+
+void TerminalScreen::scrollDown(int count)
+{
+    count = qMin(count, bottom - top + 1);
+    if (count <= 0)
+        return;
+    std::rotate(lines.begin() + top, lines.begin() + bottom + 1 - count, lines.begin() + bottom + 1);
+    for (int row = top; row < top + count; ++row)
+        lines[row] = blankLine();
+    damageRange(top, bottom);
+}
+
+void TerminalScreen::setScrollRegion(int first, int last)
+{
+    first = qMax(0, first);
+    last = qMin(height - 1, last);
+    if (first >= last)
+        return;
+    top = first;
+    bottom = last;
+    moveCursor(0, 0);
+}
+
+void TerminalScreen::saveCursor()
+{
+    saved = SavedCursor{cursorX, cursorY, penCell, originMode};
+}
+
+void TerminalScreen::restoreCursor()
+{
+    cursorX = saved.x;
+    cursorY = saved.y;
+    penCell = saved.pen;
+    originMode = saved.originMode;
+    wrapPending = false;
+    clampCursor();
+}
+
+void TerminalScreen::setAlternate(bool on, bool saveAndClear)
+{
+    if (on == alternate)
+        return;
+    if (on)
+    {
+        if (saveAndClear)
+            savedMain = SavedCursor{cursorX, cursorY, penCell, originMode};
+        savedLines = lines;
+        lines.fill(Line(width), height);
+    }
+    else
+    {
+        lines = savedLines;
+        savedLines.clear();
+        if (saveAndClear)
+        {
+            cursorX = savedMain.x;
+            cursorY = savedMain.y;
+            penCell = savedMain.pen;
+            originMode = savedMain.originMode;
+            clampCursor();
+        }
+    }
+    alternate = on;
+    top = 0;
+    bottom = height - 1;
+    wrapPending = false;
+    allDamaged = true;
+}
+
+void TerminalScreen::setMode(int mode, bool privateMode, bool on)
+{
+    if (!privateMode)
+    {
+        if (mode == 4)
+            insertMode = on;
+        return;
+    }
+    switch (mode)
+    {
+    case 1:
+        appCursorKeys = on;
+        break;
+    case 6:
+        originMode = on;
+        moveCursor(0, 0);
+        break;
+    case 7:
+        autoWrap = on;
+        break;
+    case 25:
+        cursorVisible = on;
+        damage(cursorY);
+        break;
+    case 47:
+    case 1047:
+        setAlternate(on, false);
+        break;
+    case 1049:
+        setAlternate(on, true);
+        break;
+    case 2004:
+        bracketedPasteMode = on;
+        break;
+    default:
+        break;
+    }
+}
+
+void TerminalScreen::reset()
+{
+    penCell = Cell();
+    if (alternate)
+        setAlternate(false, false);
+    lines.fill(Line(width), height);
+    cursorX = 0;
+    cursorY = 0;
+    wrapPending = false;
+    top = 0;
+    bottom = height - 1;
+    saved = SavedCursor();
+    autoWrap = true;
+    originMode = false;
+    insertMode = false;
+    cursorVisible = true;
+    appCursorKeys = false;
+    bracketedPasteMode = false;
+    allDamaged = true;
+}
@@ -0,0 +1,150 @@
+#ifndef TERMINALSCREEN_H
+#define TERMINALSCREEN_H
+
+#include <QBitArray>
+#include <QString>
+#include <QVector>
+
+// Экран терминала: сетка ячеек с атрибутами, область прокрутки,
+// альтернативный экран и ограниченная история строк, ушедших вверх.
+// Изменения копятся как набор испорченных строк плюс число строк, на
+// которое прокрутился весь экран: виджет сдвигает картинку и
+// перерисовывает только испорченные строки. Каждая ячейка занимает одну
+// позицию (широкие символы не удваиваются).
+class TerminalScreen {
+public:
+    static constexpr int DefaultScrollback = 5000;
+
+    // Цвет: 0 — по умолчанию, IndexedColor | n — палитра xterm (0..255),
+    // RgbColor | 0xrrggbb — 24-битный.
+    static constexpr quint32 DefaultColor = 0;
+    static constexpr quint32 IndexedColor = 0x01000000;
+    static constexpr quint32 RgbColor = 0x02000000;
+
+    enum Flag : quint16 {
+        Bold = 1,
+        Faint = 2,
+        Italic = 4,
+        Underline = 8,
+        Inverse = 16,
+        Hidden = 32,
+        Strike = 64
+    };
+
+    struct Cell {
+        char32_t ch = ' ';
+        quint32 fg = DefaultColor;
+        quint32 bg = DefaultColor;
+        quint16 flags = 0;
+
+        bool sameStyle(const Cell &other) const { return fg == other.fg && bg == other.bg && flags == other.flags; }
+    };
+    using Line = QVector<Cell>;
+
+    struct Update {
+        int scrolled = 0;  // строк, на которые прокрутился весь экран
+        QBitArray damaged; // строки экрана после прокрутки
+        bool all = false;
+        int historyAdded = 0;
+    };
+
+    TerminalScreen(int columns = 80, int rows = 24);
+
+    int columns() const { return width; }
+    int rows() const { return height; }
+    int historySize() const { return history.size(); }
+    // index < 0 — строка истории (-1 — последняя ушедшая вверх).
+    const Line &line(int index) const;
+    int cursorRow() const { return cursorY; }
+    int cursorColumn() const { return cursorX; }
+    bool isCursorVisible() const { return cursorVisible; }
+    bool isAlternate() const { return alternate; }
+    bool applicationCursorKeys() const { return appCursorKeys; }
+    bool bracketedPaste() const { return bracketedPasteMode; }
+    QString title() const { return windowTitle; }
+
+    void resize(int columns, int rows);
+    void setScrollback(int lines);
+    Update takeUpdate();
+
+    // Вызывается разборщиком управляющих последовательностей.
+    Cell &pen() { return penCell; }
+    void printAscii(const char *text, int count);
+    void print(char32_t ch);
+    void repeatLast(int count);
+    void lineFeed();
+    void reverseIndex();
+    void carriageReturn();
+    void backspace();
+    void tab(int count = 1);
+    void moveCursor(int row, int column);    // от начала экрана (или области в режиме origin)
+    void moveCursorBy(int rows, int columns);
+    void setCursorColumn(int column);
+    void setCursorRow(int row);
+    void eraseInDisplay(int mode);
+    void eraseInLine(int mode);
+    void eraseChars(int count);
+    void insertChars(int count);
+    void deleteChars(int count);
+    void insertLines(int count);
+    void deleteLines(int count);
+    void scrollUp(int count);
+    void scrollDown(int count);
+    void setScrollRegion(int top, int bottom);
+    void saveCursor();
+    void restoreCursor();
+    void setAlternate(bool on, bool saveAndClear);
+    void setMode(int mode, bool privateMode, bool on);
+    void setTitle(const QString &title) { windowTitle = title; }
+    void reset();
+
+private:
+    Cell blank() const;
+    Line blankLine() const;
+    void clampCursor();
+    void damage(int row);
+    void damageRange(int first, int last);
+    void pushHistory(Line line);
+    void putCell(char32_t ch);
+
+    int width;
+    int height;
+    QVector<Line> lines;
+    QVector<Line> savedLines; // основной экран, пока показан альтернативный
+    QVector<Line> history;    // кольцо: самая старая строка — historyStart
+    int historyStart = 0;
+    int scrollbackLimit = DefaultScrollback;
+
+    Cell penCell;
+    char32_t lastChar = ' ';
+    int cursorX = 0;
+    int cursorY = 0;
+    bool wrapPending = false;
+    int top = 0;
+    int bottom;
+
+    struct SavedCursor {
+        int x = 0;
+        int y = 0;
+        Cell pen;
+        bool originMode = false;
+    };
+    SavedCursor saved;
+    SavedCursor savedMain; // для 1049 на время альтернативного экрана
+
+    bool autoWrap = true;
+    bool originMode = false;
+    bool insertMode = false;
+    bool cursorVisible = true;
+    bool alternate = false;
+    bool appCursorKeys = false;
+    bool bracketedPasteMode = false;
+    QString windowTitle;
+
+    QBitArray damaged;
+    int scrolled = 0;
+    bool allDamaged = true;
+    int historyAdded = 0;
+};
+
+#endif // TERMINALSCREEN_H
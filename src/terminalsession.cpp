@@ -0,0 +1,117 @@
+#include "terminalsession.h"
+#include <QMutexLocker>
+#include <QThread>
+
+TerminalSession::TerminalSession(QObject *parent)
+    : QObject(parent)
+    , parser(terminalScreen)
+{
+}
+
+TerminalSession::~TerminalSession()
+{
+    terminate();
+}
+
+bool TerminalSession::start(const QString &workingDirectory, int columns, int rows, QString *error)
+{
+    terminate();
+    {
+        QMutexLocker locker(&lock);
+        terminalScreen.resize(columns, rows);
+    }
+    if (!pty.start(Pty::defaultShell(), {}, workingDirectory, columns, rows, error))
+        return false;
+    const quint64 id = ++generation;
+    worker = QThread::create([this, id] { run(id); });
+    worker->start();
+    return true;
+}
+
+void TerminalSession::terminate()
+{
+    if (!worker)
+        return;
+    pty.terminate();
+    finishWorker();
+}
+
+void TerminalSession::finishWorker()
+{
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+}
+
+void TerminalSession::write(const QByteArray &bytes)
+{
+    if (worker && !bytes.isEmpty())
+        pty.write(bytes);
+}
+
+void TerminalSession::resize(int columns, int rows)
+{
+    {
+        QMutexLocker locker(&lock);
+        if (columns == terminalScreen.columns() && rows == terminalScreen.rows())
+            return;
+        terminalScreen.resize(columns, rows);
+    }
+    pty.resize(columns, rows);
+    notify();
+}
+
+void TerminalSession::inject(const QByteArray &bytes)
+{
+    {
+        QMutexLocker locker(&lock);
+        parser.feed(bytes.constData(), bytes.size());
+        parser.takeResponse();
+    }
+    notify();
+}
+
+void TerminalSession::notify()
+{
+    if (updatePending.exchange(true))
+        return;
+    QMetaObject::invokeMethod(this, [this]
+                              {
+                                  updatePending = false;
+                                  emit updated();
+                              },
+                              Qt::QueuedConnection);
+}
+
+// Выполняется в рабочем потоке.
+void TerminalSession::run(quint64 id)
+{
+    QByteArray buffer(ReadSize, Qt::Uninitialized);
+    for (;;)
+    {
+        const qint64 count = pty.read(buffer.data(), ReadSize, -1);
+        if (count < 0)
+            break;
+        if (count == 0)
+            continue;
+        QByteArray response;
+        {
+            QMutexLocker locker(&lock);
+            parser.feed(buffer.constData(), count);
+            response = parser.takeResponse();
+        }
+        if (!response.isEmpty())
+            pty.write(response);
+        notify();
+    }
+
+    const int code = pty.exitCode();
+    QMetaObject::invokeMethod(this, [this, id, code]
+                              {
+                                  if (id != generation || !worker)
+                                      return; // уже остановлен через terminate()
+                                  finishWorker();
+                                  emit finished(code);
+                              },
+                              Qt::QueuedConnection);
+}
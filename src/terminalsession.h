@@ -0,0 +1,57 @@
+#ifndef TERMINALSESSION_H
+#define TERMINALSESSION_H
+
+#include "pty.h"
+#include "terminalscreen.h"
+#include "vtparser.h"
+#include <QMutex>
+#include <QObject>
+#include <atomic>
+
+class QThread;
+
+// Оболочка в псевдотерминале. Рабочий поток читает вывод порциями по
+// ReadSize и сразу разбирает его в экран под mutex(); интерфейс узнаёт
+// об изменениях сигналом updated(), который не ставится в очередь
+// повторно, пока предыдущий не обработан. Поэтому скорость вывода
+// ограничена разбором, а не отрисовкой.
+class TerminalSession : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 ReadSize = 64 * 1024;
+
+    explicit TerminalSession(QObject *parent = nullptr);
+    ~TerminalSession() override;
+
+    bool start(const QString &workingDirectory, int columns, int rows, QString *error = nullptr);
+    bool isRunning() const { return worker != nullptr; }
+    void terminate();
+
+    void write(const QByteArray &bytes);
+    void resize(int columns, int rows);
+    // Местный вывод (ответы встроенных команд) поверх вывода оболочки.
+    void inject(const QByteArray &bytes);
+
+    QMutex &mutex() { return lock; }
+    TerminalScreen &screen() { return terminalScreen; }
+
+signals:
+    void updated();
+    void finished(int exitCode);
+
+private:
+    void run(quint64 id);
+    void notify();
+    void finishWorker();
+
+    Pty pty;
+    TerminalScreen terminalScreen;
+    VtParser parser;
+    QMutex lock;
+    QThread *worker = nullptr;
+    quint64 generation = 0;
+    std::atomic<bool> updatePending{false};
+};
+
+#endif // TERMINALSESSION_H
@@ -0,0 +1,618 @@
+#include "terminalwidget.h"
+#include "terminalsession.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTimer>
+#include <algorithm>
+
+namespace {
+
+constexpr QRgb BaseColors[16] = {
+    0x000000, 0xcd0000, 0x00cd00, 0xcdcd00, 0x0000ee, 0xcd00cd, 0x00cdcd, 0xe5e5e5,
+    0x7f7f7f, 0xff0000, 0x00ff00, 0xffff00, 0x5c5cff, 0xff00ff, 0x00ffff, 0xffffff};
+
+// Палитра xterm: 16 основных цветов, куб 6x6x6 и 24 оттенка серого.
+QRgb xtermColor(int index)
+{
+    if (index < 16)
+        return BaseColors[index] | 0xff000000;
+    if (index < 232)
+    {
+        index -= 16;
+        auto level = [](int value) { return value == 0 ? 0 : 55 + value * 40; };
+        return qRgb(level(index / 36), level(index / 6 % 6), level(index % 6));
+    }
+    const int gray = 8 + (index - 232) * 10;
+    return qRgb(gray, gray, gray);
+}
+
+int modifierCode(Qt::KeyboardModifiers modifiers)
+{
+    return 1 + (modifiers & Qt::ShiftModifier ? 1 : 0) + (modifiers & Qt::AltModifier ? 2 : 0)
+        + (modifiers & Qt::ControlModifier ? 4 : 0);
+}
+
+QByteArray finalKey(char final, Qt::KeyboardModifiers modifiers, bool application)
+{
+    const int code = modifierCode(modifiers);
+    if (code > 1)
+        return "\x1b[1;" + QByteArray::number(code) + final;
+    return QByteArray(application ? "\x1bO" : "\x1b[") + final;
+}
+
+QByteArray tildeKey(int number, Qt::KeyboardModifiers modifiers)
+{
+    const int code = modifierCode(modifiers);
+    QByteArray result = "\x1b[" + QByteArray::number(number);
+    if (code > 1)
+        result += ';' + QByteArray::number(code);
+    return result + '~';
+}
+
+// Байты, которые клавиша посылает в терминал xterm.
+QByteArray keySequence(const QKeyEvent *event, bool applicationCursor)
+{
+    const Qt::KeyboardModifiers modifiers =
+        event->modifiers() & (Qt::ShiftModifier | Qt::ControlModifier | Qt::AltModifier);
+    switch (event->key())
+    {
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        return "\r";
+    case Qt::Key_Backspace:
+        return modifiers & Qt::ControlModifier ? "\x08" : "\x7f";
+    case Qt::Key_Tab:
+        return "\t";
+    case Qt::Key_Backtab:
+        return "\x1b[Z";
+    case Qt::Key_Escape:
+        return "\x1b";
+    case Qt::Key_Up:
+        return finalKey('A', modifiers, applicationCursor);
+    case Qt::Key_Down:
+        return finalKey('B', modifiers, applicationCursor);
+    case Qt::Key_Right:
+        return finalKey('C', modifiers, applicationCursor);
+    case Qt::Key_Left:
+        return finalKey('D', modifiers, applicationCursor);
+    case Qt::Key_Home:
+        return finalKey('H', modifiers, applicationCursor);
+    case Qt::Key_End:
+        return finalKey('F', modifiers, applicationCursor);
+    case Qt::Key_Insert:
+        return tildeKey(2, modifiers);
+    case Qt::Key_Delete:
+        return tildeKey(3, modifiers);
+    case Qt::Key_PageUp:
+        return tildeKey(5, modifiers);
+    case Qt::Key_PageDown:
+        return tildeKey(6, modifiers);
+    case Qt::Key_F1:
+        return finalKey('P', modifiers, true);
+    case Qt::Key_F2:
+        return finalKey('Q', modifiers, true);
+    case Qt::Key_F3:
+        return finalKey('R', modifiers, true);
+    case Qt::Key_F4:
+        return finalKey('S', modifiers, true);
+    default:
+        break;
+    }
+    if (event->key() >= Qt::Key_F5 && event->key() <= Qt::Key_F12)
+    {
+        static constexpr int Numbers[] = {15, 17, 18, 19, 20, 21, 23, 24};
+        return tildeKey(Numbers[event->key() - Qt::Key_F5], modifiers);
+    }
+
+    const bool control = modifiers & Qt::ControlModifier;
+    if (control && event->key() >= Qt::Key_A && event->key() <= Qt::Key_Z)
+        return QByteArray(1, char(event->key() - Qt::Key_A + 1));
+    if (control && event->key() == Qt::Key_Space)
+        return QByteArray(1, '\0');
+    QByteArray bytes = event->text().toUtf8();
+    if (!bytes.isEmpty() && (modifiers & Qt::AltModifier))
+        bytes.prepend('\x1b');
+    return bytes;
+}
+
+void appendCodePoint(QString &text, char32_t ch)
+{
+    if (QChar::requiresSurrogates(ch))
+    {
+        text.append(QChar(QChar::highSurrogate(ch)));
+        text.append(QChar(QChar::lowSurrogate(ch)));
+    }
+    else
+    {
+        text.append(QChar(char16_t(ch)));
+    }
+}
+
+} // namespace
+
+TerminalWidget::TerminalWidget(QWidget *parent)
+    : QAbstractScrollArea(parent)
+    , session(new TerminalSession(this))
+    , frameTimer(new QTimer(this))
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    viewport()->setCursor(Qt::IBeamCursor);
+    viewport()->setAttribute(Qt::WA_OpaquePaintEvent);
+    updateMetrics();
+
+    frameTimer->setSingleShot(true);
+    connect(frameTimer, &QTimer::timeout, this, &TerminalWidget::applyUpdate);
+    connect(session, &TerminalSession::updated, this, &TerminalWidget::scheduleUpdate);
+    connect(session, &TerminalSession::finished, this, &TerminalWidget::onFinished);
+}
+
+TerminalWidget::~TerminalWidget()
+{
+    session->terminate();
+}
+
+bool TerminalWidget::start(const QString &workingDirectory, QString *error)
+{
+    directory = workingDirectory;
+    pending.clear();
+    atLineStart = true;
+    const QSize size = gridSize();
+    exited = !session->start(directory, size.width(), size.height(), error);
+    return !exited;
+}
+
+void TerminalWidget::showMessage(const QString &text)
+{
+    QByteArray bytes = text.toUtf8();
+    bytes.replace("\n", "\r\n");
+    if (!bytes.endsWith("\r\n"))
+        bytes += "\r\n";
+    session->inject(bytes);
+}
+
+void TerminalWidget::onFinished(int exitCode)
+{
+    exited = true;
+    pending.clear();
+    showMessage(QString("\n[Оболочка завершилась с кодом %1. Enter — запустить заново]").arg(exitCode));
+}
+
+void TerminalWidget::updateMetrics()
+{
+    const QFont base = font();
+    for (int i = 0; i < 4; ++i)
+    {
+        fonts[i] = base;
+        fonts[i].setBold(i & 1);
+        fonts[i].setItalic(i & 2);
+    }
+    const QFontMetrics metrics(base);
+    cellWidth = qMax(1, metrics.horizontalAdvance(QLatin1Char('M')));
+    lineHeight = qMax(1, metrics.height());
+    ascent = metrics.ascent();
+}
+
+QSize TerminalWidget::gridSize() const
+{
+    // До первой раскладки у viewport нет настоящего размера.
+    if (viewport()->width() < cellWidth * 10 || viewport()->height() < lineHeight * 2)
+        return QSize(80, 24);
+    return QSize(viewport()->width() / cellWidth, viewport()->height() / lineHeight);
+}
+
+void TerminalWidget::updateGridSize()
+{
+    const QSize size = gridSize();
+    session->resize(size.width(), size.height());
+}
+
+QRect TerminalWidget::rowRect(int row) const
+{
+    return QRect(0, row * lineHeight, viewport()->width(), lineHeight);
+}
+
+void TerminalWidget::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateGridSize();
+}
+
+void TerminalWidget::changeEvent(QEvent *event)
+{
+    QAbstractScrollArea::changeEvent(event);
+    if (event->type() == QEvent::FontChange)
+    {
+        updateMetrics();
+        updateGridSize();
+        viewport()->update();
+    }
+    else if (event->type() == QEvent::PaletteChange)
+    {
+        viewport()->update();
+    }
+}
+
+void TerminalWidget::focusInEvent(QFocusEvent *event)
+{
+    QAbstractScrollArea::focusInEvent(event);
+    viewport()->update(rowRect(cursorRow));
+}
+
+void TerminalWidget::focusOutEvent(QFocusEvent *event)
+{
+    QAbstractScrollArea::focusOutEvent(event);
+    viewport()->update(rowRect(cursorRow));
+}
+
+bool TerminalWidget::focusNextPrevChild(bool next)
+{
+    Q_UNUSED(next);
+    return false; // Tab нужен оболочке для дополнения
+}
+
+void TerminalWidget::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    if (!syncingScrollBar)
+        viewport()->update();
+}
+
+// Не больше одного кадра за FrameInterval: при потоке вывода (cat
+// большого файла) интерфейс не отнимает время у разбора, а после паузы
+// первое изменение рисуется сразу, без задержки на таймер.
+void TerminalWidget::scheduleUpdate()
+{
+    if (frameTimer->isActive())
+        return;
+    const qint64 elapsed = lastFrame.isValid() ? lastFrame.elapsed() : FrameInterval;
+    if (elapsed >= FrameInterval)
+        applyUpdate();
+    else
+        frameTimer->start(int(FrameInterval - elapsed));
+}
+
+void TerminalWidget::applyUpdate()
+{
+    lastFrame.start();
+    const int oldCursorRow = cursorRow;
+    TerminalScreen::Update update;
+    int history = 0;
+    int rows = 0;
+    {
+        QMutexLocker locker(&session->mutex());
+        TerminalScreen &screen = session->screen();
+        update = screen.takeUpdate();
+        history = screen.historySize();
+        rows = screen.rows();
+        cursorRow = screen.cursorRow();
+        cursorColumn = screen.cursorColumn();
+        cursorVisible = screen.isCursorVisible();
+
+        // Строки делят данные с экраном, копирование дешёвое.
+        if (update.all || shown.size() != rows || update.scrolled >= rows)
+        {
+            update.all = true;
+            shown.resize(rows);
+            for (int row = 0; row < rows; ++row)
+                shown[row] = screen.line(row);
+        }
+        else
+        {
+            if (update.scrolled > 0)
+                std::rotate(shown.begin(), shown.begin() + update.scrolled, shown.end());
+            for (int row = 0; row < rows; ++row)
+            {
+                if (update.damaged.testBit(row) || row >= rows - update.scrolled)
+                    shown[row] = screen.line(row);
+            }
+        }
+    }
+
+    QScrollBar *bar = verticalScrollBar();
+    const bool live = bar->value() >= bar->maximum();
+    const int oldHistory = bar->maximum();
+    syncingScrollBar = true;
+    bar->setRange(0, history);
+    bar->setPageStep(rows);
+    // Пролистанная назад история остаётся на месте, пока приходит вывод.
+    bar->setValue(live ? history : qMax(0, bar->value() - update.historyAdded + (history - oldHistory)));
+    syncingScrollBar = false;
+    shownHistory = history;
+
+    if (!live || update.all)
+    {
+        viewport()->update();
+        return;
+    }
+    if (update.scrolled > 0)
+        viewport()->scroll(0, -update.scrolled * lineHeight, QRect(0, 0, viewport()->width(), rows * lineHeight));
+    for (int row = 0; row < rows; ++row)
+    {
+        if (update.damaged.testBit(row))
+            viewport()->update(rowRect(row));
+    }
+    viewport()->update(rowRect(oldCursorRow - update.scrolled));
+    viewport()->update(rowRect(cursorRow));
+}
+
+QColor TerminalWidget::cellColor(quint32 color, const QColor &fallback) const
+{
+    if (color & TerminalScreen::RgbColor)
+        return QColor::fromRgb(color & 0xffffff);
+    if (color & TerminalScreen::IndexedColor)
+        return QColor::fromRgb(xtermColor(int(color & 0xff)));
+    return fallback;
+}
+
+void TerminalWidget::drawLine(QPainter &painter, const TerminalScreen::Line &line, int y)
+{
+    const QColor foreground = palette().color(QPalette::Text);
+    const QColor background = palette().color(QPalette::Base);
+    QString text;
+    int start = 0;
+    while (start < line.size())
+    {
+        const TerminalScreen::Cell &style = line[start];
+        int end = start + 1;
+        while (end < line.size() && line[end].sameStyle(style))
+            ++end;
+
+        quint32 fgValue = style.fg;
+        // Жирный текст основными цветами рисуется яркими, как в xterm.
+        if ((style.flags & TerminalScreen::Bold) && (fgValue & TerminalScreen::IndexedColor) && (fgValue & 0xff) < 8)
+            fgValue += 8;
+        QColor fg = cellColor(fgValue, foreground);
+        QColor bg = cellColor(style.bg, background);
+        if (style.flags & TerminalScreen::Inverse)
+            std::swap(fg, bg);
+        if (style.flags & TerminalScreen::Faint)
+            fg = QColor((fg.red() + bg.red()) / 2, (fg.green() + bg.green()) / 2, (fg.blue() + bg.blue()) / 2);
+
+        const QRect rect(start * cellWidth, y, (end - start) * cellWidth, lineHeight);
+        if (bg != background)
+            painter.fillRect(rect, bg);
+        if (!(style.flags & TerminalScreen::Hidden))
+        {
+            text.clear();
+            bool blank = true;
+            for (int i = start; i < end; ++i)
+            {
+                blank = blank && line[i].ch == ' ';
+                appendCodePoint(text, line[i].ch);
+            }
+            if (!blank)
+            {
+                painter.setFont(fonts[(style.flags & TerminalScreen::Bold ? 1 : 0)
+                                      | (style.flags & TerminalScreen::Italic ? 2 : 0)]);
+                painter.setPen(fg);
+                painter.drawText(rect.left(), y + ascent, text);
+            }
+            if (style.flags & TerminalScreen::Underline)
+                painter.fillRect(rect.left(), y + ascent + 1, rect.width(), 1, fg);
+            if (style.flags & TerminalScreen::Strike)
+                painter.fillRect(rect.left(), y + lineHeight / 2, rect.width(), 1, fg);
+        }
+        start = end;
+    }
+}
+
+void TerminalWidget::paintEvent(QPaintEvent *event)
+{
+    const QRect area = event->rect();
+    QPainter painter(viewport());
+    painter.fillRect(area, palette().base());
+
+    const int rows = shown.size();
+    const int first = verticalScrollBar()->value() - shownHistory; // <= 0
+    const int firstRow = qMax(0, area.top() / lineHeight);
+    const int lastRow = qMin(rows - 1, area.bottom() / lineHeight);
+    if (first < 0)
+    {
+        // История читается из экрана: рабочий поток может её дополнять.
+        QMutexLocker locker(&session->mutex());
+        const TerminalScreen &screen = session->screen();
+        for (int row = firstRow; row <= lastRow; ++row)
+        {
+            const int index = first + row;
+            if (index >= 0)
+                drawLine(painter, shown[index], row * lineHeight);
+            else if (index >= -screen.historySize())
+                drawLine(painter, screen.line(index), row * lineHeight);
+        }
+        return;
+    }
+    for (int row = firstRow; row <= lastRow; ++row)
+        drawLine(painter, shown[row], row * lineHeight);
+
+    if (exited || cursorRow >= rows)
+        return;
+
+    const QColor foreground = palette().color(QPalette::Text);
+    const QColor background = palette().color(QPalette::Base);
+    int column = cursorColumn;
+    if (!pending.isEmpty())
+    {
+        // Набранная встроенная команда ещё не ушла в оболочку.
+        const QRect rect(column * cellWidth, cursorRow * lineHeight, pending.size() * cellWidth, lineHeight);
+        painter.fillRect(rect, background);
+        painter.setFont(fonts[0]);
+        painter.setPen(foreground);
+        painter.drawText(rect.left(), rect.top() + ascent, pending);
+        column += pending.size();
+    }
+    if (!cursorVisible)
+        return;
+    const QRect cursor(column * cellWidth, cursorRow * lineHeight, cellWidth, lineHeight);
+    if (hasFocus())
+    {
+        painter.fillRect(cursor, foreground);
+        const TerminalScreen::Line &line = shown[cursorRow];
+        if (pending.isEmpty() && column < line.size() && line[column].ch != ' ')
+        {
+            QString text;
+            appendCodePoint(text, line[column].ch);
+            painter.setFont(fonts[0]);
+            painter.setPen(background);
+            painter.drawText(cursor.left(), cursor.top() + ascent, text);
+        }
+    }
+    else
+    {
+        painter.setPen(foreground);
+        painter.drawRect(cursor.adjusted(0, 0, -1, -1));
+    }
+}
+
+void TerminalWidget::keyPressEvent(QKeyEvent *event)
+{
+    const int key = event->key();
+    const Qt::KeyboardModifiers modifiers = event->modifiers();
+    const bool enter = key == Qt::Key_Return || key == Qt::Key_Enter;
+    if (exited)
+    {
+        if (enter)
+            start(directory);
+        return;
+    }
+    if (modifiers == (Qt::ControlModifier | Qt::ShiftModifier) && key == Qt::Key_V)
+    {
+        paste();
+        return;
+    }
+    if (modifiers == Qt::ShiftModifier && (key == Qt::Key_PageUp || key == Qt::Key_PageDown))
+    {
+        QScrollBar *bar = verticalScrollBar();
+        bar->setValue(bar->value() + (key == Qt::Key_PageUp ? -bar->pageStep() : bar->pageStep()));
+        return;
+    }
+
+    bool alternateScreen = false;
+    bool applicationCursor = false;
+    {
+        QMutexLocker locker(&session->mutex());
+        alternateScreen = session->screen().isAlternate();
+        applicationCursor = session->screen().applicationCursorKeys();
+    }
+
+    // Полноэкранным программам (vim, less) ввод уходит как есть.
+    if (!alternateScreen && !builtins.isEmpty())
+    {
+        const QString text = event->text();
+        const bool printable = !text.isEmpty() && text.at(0).isPrint()
+            && !(modifiers & (Qt::ControlModifier | Qt::AltModifier));
+        if (enter && !pending.isEmpty())
+        {
+            const QString command = pending.trimmed();
+            if (isBuiltin(command))
+            {
+                runBuiltin(command);
+                return;
+            }
+            flushPending();
+        }
+        else if (key == Qt::Key_Backspace && !pending.isEmpty())
+        {
+            pending.chop(1);
+            viewport()->update(rowRect(cursorRow));
+            return;
+        }
+        else if (printable && (atLineStart || !pending.isEmpty()))
+        {
+            pending += text;
+            if (couldBeBuiltin(pending))
+                viewport()->update(rowRect(cursorRow));
+            else
+                flushPending();
+            return;
+        }
+        else if (!pending.isEmpty())
+        {
+            flushPending();
+        }
+    }
+
+    const QByteArray bytes = keySequence(event, applicationCursor);
+    if (bytes.isEmpty())
+    {
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    send(bytes);
+    atLineStart = enter || bytes == "\x03" || bytes == "\x15"; // Enter, Ctrl+C, Ctrl+U
+}
+
+void TerminalWidget::send(const QByteArray &bytes)
+{
+    session->write(bytes);
+    verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+}
+
+void TerminalWidget::paste()
+{
+    QString text = QApplication::clipboard()->text();
+    if (text.isEmpty())
+        return;
+    flushPending();
+    text.replace(QLatin1String("\r\n"), QLatin1String("\r"));
+    text.replace(QLatin1Char('\n'), QLatin1Char('\r'));
+    QByteArray bytes = text.toUtf8();
+    bool bracketed = false;
+    {
+        QMutexLocker locker(&session->mutex());
+        bracketed = session->screen().bracketedPaste();
+    }
+    if (bracketed)
+        bytes = "\x1b[200~" + bytes + "\x1b[201~";
+    send(bytes);
+    atLineStart = false;
+}
+
+bool TerminalWidget::couldBeBuiltin(const QString &text) const
+{
+    for (const QString &command : builtins)
+    {
+        if (command.startsWith(text) || text.startsWith(command + QLatin1Char(' ')))
+            return true;
+    }
+    return false;
+}
+
+bool TerminalWidget::isBuiltin(const QString &text) const
+{
+    for (const QString &command : builtins)
+    {
+        if (text == command || text.startsWith(command + QLatin1Char(' ')))
+            return true;
+    }
+    return false;
+}
+
+void TerminalWidget::flushPending()
+{
+    if (pending.isEmpty())
+        return;
+    send(pending.toUtf8());
+    pending.clear();
+    atLineStart = false;
+    viewport()->update(rowRect(cursorRow));
+}
+
+// Команда «печатается» в терминал, её вывод добавляет обработчик
+// commandEntered через showMessage(), а пустая строка в оболочку
+// выводит новое приглашение.
+void TerminalWidget::runBuiltin(const QString &command)
+{
+    pending.clear();
+    session->inject(command.toUtf8() + "\r\n");
+    emit commandEntered(command);
+    session->write("\r");
+    atLineStart = true;
+}
@@ -0,0 +1,92 @@
+#ifndef TERMINALWIDGET_H
+#define TERMINALWIDGET_H
+
+#include <QAbstractScrollArea>
+#include <QElapsedTimer>
+#include <QFont>
+#include <QStringList>
+#include "terminalscreen.h"
+
+class QTimer;
+class TerminalSession;
+
+// Терминал на псевдотерминале с оболочкой. Изменения экрана собираются
+// не чаще раза в кадр: целиком прокрученный экран сдвигается
+// viewport()->scroll(), перерисовываются только испорченные строки.
+// Вертикальная полоса прокрутки листает историю.
+//
+// Встроенные команды IDE (setBuiltinCommands) перехватываются в начале
+// строки: пока набранное может оказаться такой командой, символы
+// остаются в виджете и рисуются поверх курсора; как только ввод
+// расходится со всеми командами, он уходит в оболочку.
+class TerminalWidget : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    static constexpr int FrameInterval = 16;
+
+    explicit TerminalWidget(QWidget *parent = nullptr);
+    ~TerminalWidget() override;
+
+    bool start(const QString &workingDirectory, QString *error = nullptr);
+    void setBuiltinCommands(const QStringList &commands) { builtins = commands; }
+    // Местный вывод: текст печатается с новой строки, как ответ команды.
+    void showMessage(const QString &text);
+
+signals:
+    void commandEntered(const QString &command);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void focusInEvent(QFocusEvent *event) override;
+    void focusOutEvent(QFocusEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    bool focusNextPrevChild(bool next) override;
+
+private:
+    void scheduleUpdate();
+    void applyUpdate();
+    void onFinished(int exitCode);
+    void updateMetrics();
+    void updateGridSize();
+    QSize gridSize() const;
+    QRect rowRect(int row) const;
+    void drawLine(QPainter &painter, const TerminalScreen::Line &line, int y);
+    QColor cellColor(quint32 color, const QColor &fallback) const;
+
+    void send(const QByteArray &bytes);
+    void paste();
+    bool couldBeBuiltin(const QString &text) const;
+    bool isBuiltin(const QString &text) const;
+    void flushPending();
+    void runBuiltin(const QString &command);
+
+    TerminalSession *session;
+    QTimer *frameTimer;
+    QElapsedTimer lastFrame;
+    QString directory;
+    QStringList builtins;
+    QString pending;          // набранное, пока похоже на встроенную команду
+    bool atLineStart = true;
+    bool exited = false;
+    bool syncingScrollBar = false;
+
+    QFont fonts[4];           // обычный, жирный, курсив, жирный курсив
+    int cellWidth = 1;
+    int lineHeight = 1;
+    int ascent = 0;
+
+    // Копия видимых строк на момент последнего кадра: рисуем из неё,
+    // чтобы картинка совпадала со сдвигом, даже если рабочий поток уже
+    // разобрал следующую порцию вывода.
+    QVector<TerminalScreen::Line> shown;
+    int shownHistory = 0;
+    int cursorRow = 0;
+    int cursorColumn = 0;
+    bool cursorVisible = true;
+};
+
+#endif // TERMINALWIDGET_H
@@ -0,0 +1,207 @@
+#include "theme.h"
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaEnum>
+#include <QStandardPaths>
+#include <QStyle>
+#include <algorithm>
+
+namespace {
+
+struct TokenKey {
+    const char *key;
+    TokenKind kind;
+};
+
+// Цвет задаётся только у видов, которые подсветка размечает;
+// обычный текст и идентификаторы берут цвет Text из палитры.
+constexpr TokenKey TokenKeys[] = {
+    {"keyword", TokenKind::Keyword},
+    {"number", TokenKind::Number},
+    {"string", TokenKind::String},
+    {"comment", TokenKind::Comment},
+};
+
+QString simplified(const QString &text)
+{
+    QString result = text.toLower();
+    result.remove(' ');
+    return result;
+}
+
+void resetFormats(Theme &theme)
+{
+    for (int kind = 0; kind < int(TokenKind::Count); ++kind)
+    {
+        theme.formats[kind] = QTextCharFormat();
+        theme.formats[kind].setProperty(Theme::TokenKindProperty, kind);
+    }
+}
+
+// Цвета, которыми подсветка была раскрашена до появления тем.
+Theme builtinTheme()
+{
+    Theme theme;
+    theme.id = "light";
+    theme.name = "Light";
+    resetFormats(theme);
+    theme.formats[int(TokenKind::Keyword)].setForeground(Qt::blue);
+    theme.formats[int(TokenKind::Keyword)].setFontWeight(QFont::Bold);
+    theme.formats[int(TokenKind::Number)].setForeground(Qt::darkMagenta);
+    theme.formats[int(TokenKind::Comment)].setForeground(Qt::darkGreen);
+    theme.formats[int(TokenKind::String)].setForeground(Qt::darkRed);
+    return theme;
+}
+
+Theme &currentTheme()
+{
+    static Theme theme = builtinTheme();
+    return theme;
+}
+
+int currentGeneration = 0;
+
+bool parseColor(const QJsonValue &value, QColor *color, QString *error)
+{
+    *color = QColor::fromString(value.toString());
+    if (color->isValid())
+        return true;
+    if (error)
+        *error = QString("неверный цвет: %1").arg(value.toString());
+    return false;
+}
+
+} // namespace
+
+bool Theme::matches(const QString &text) const
+{
+    const QString key = simplified(text);
+    return key == simplified(id) || key == simplified(name);
+}
+
+bool Theme::fromJson(const QByteArray &json, Theme &theme, QString *error)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (!document.isObject())
+    {
+        if (error)
+            *error = parseError.error == QJsonParseError::NoError ? QString("ожидался объект JSON")
+                                                                  : parseError.errorString();
+        return false;
+    }
+    const QJsonObject root = document.object();
+    theme.name = root.value("name").toString();
+
+    // Роли палитры называются как в QPalette::ColorRole; не указанные
+    // берутся из стандартной палитры стиля.
+    const QJsonObject palette = root.value("palette").toObject();
+    theme.hasPalette = !palette.isEmpty();
+    theme.palette = QApplication::style()->standardPalette();
+    const QMetaEnum roles = QMetaEnum::fromType<QPalette::ColorRole>();
+    for (auto it = palette.begin(); it != palette.end(); ++it)
+    {
+        bool known = false;
+        const int role = roles.keyToValue(it.key().toLatin1().constData(), &known);
+        if (!known)
+        {
+            if (error)
+                *error = QString("неизвестная роль палитры: %1").arg(it.key());
+            return false;
+        }
+        QColor color;
+        if (!parseColor(it.value(), &color, error))
+            return false;
+        theme.palette.setColor(QPalette::ColorRole(role), color);
+    }
+    for (QPalette::ColorRole role : {QPalette::WindowText, QPalette::Text, QPalette::ButtonText})
+    {
+        if (!theme.hasPalette)
+            break;
+        QColor color = theme.palette.color(QPalette::Active, role);
+        color.setAlpha(128);
+        theme.palette.setColor(QPalette::Disabled, role, color);
+    }
+
+    resetFormats(theme);
+    const QJsonObject tokens = root.value("tokens").toObject();
+    for (const TokenKey &key : TokenKeys)
+    {
+        const QJsonObject style = tokens.value(key.key).toObject();
+        QTextCharFormat &format = theme.formats[int(key.kind)];
+        QColor color;
+        if (style.contains("color"))
+        {
+            if (!parseColor(style.value("color"), &color, error))
+                return false;
+            format.setForeground(color);
+        }
+        if (style.contains("background"))
+        {
+            if (!parseColor(style.value("background"), &color, error))
+                return false;
+            format.setBackground(color);
+        }
+        if (style.value("bold").toBool())
+            format.setFontWeight(QFont::Bold);
+        if (style.value("italic").toBool())
+            format.setFontItalic(true);
+    }
+    return true;
+}
+
+QString Theme::userDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/themes";
+}
+
+// Встроенные темы, затем пользовательские: тема с тем же именем файла
+// заменяет встроенную.
+QVector<Theme> Theme::loadAll()
+{
+    QVector<Theme> themes;
+    for (const QString &directory : {QString(":/themes"), userDirectory()})
+    {
+        const QFileInfoList files = QDir(directory).entryInfoList({"*.json"}, QDir::Files, QDir::Name);
+        for (const QFileInfo &info : files)
+        {
+            QFile file(info.filePath());
+            Theme theme;
+            QString error;
+            if (!file.open(QIODevice::ReadOnly) || !fromJson(file.readAll(), theme, &error))
+            {
+                qWarning("theme %s: %s", qPrintable(info.filePath()), qPrintable(error));
+                continue;
+            }
+            theme.id = info.completeBaseName();
+            if (theme.name.isEmpty())
+                theme.name = theme.id;
+            auto existing = std::find_if(themes.begin(), themes.end(), [&theme](const Theme &other)
+                                         { return other.id == theme.id; });
+            if (existing != themes.end())
+                *existing = theme;
+            else
+                themes.append(theme);
+        }
+    }
+    return themes;
+}
+
+const Theme &Theme::current()
+{
+    return currentTheme();
+}
+
+int Theme::generation()
+{
+    return currentGeneration;
+}
+
+void Theme::setCurrent(const Theme &theme)
+{
+    currentTheme() = theme;
+    ++currentGeneration;
+}
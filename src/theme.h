@@ -0,0 +1,41 @@
+#ifndef THEME_H
+#define THEME_H
+
+#include <QPalette>
+#include <QString>
+#include <QTextCharFormat>
+#include <QVector>
+#include "lexer.h"
+
+// Цветовая тема: палитра окна и форматы подсветки по видам токенов.
+// Темы описываются файлами JSON (встроенные в ресурсах :/themes,
+// пользовательские в <данные приложения>/themes) и разбираются один раз
+// при загрузке, переключение только подставляет готовые значения.
+struct Theme {
+    // Свойство формата с видом токена: по нему при смене темы формат
+    // уже раскрашенного блока заменяется без повторного разбора текста.
+    static constexpr int TokenKindProperty = QTextFormat::UserProperty + 1;
+
+    QString id;   // имя файла без расширения
+    QString name;
+    QPalette palette;
+    bool hasPalette = false; // false — палитра стиля по умолчанию
+    QTextCharFormat formats[int(TokenKind::Count)];
+
+    const QTextCharFormat &format(TokenKind kind) const { return formats[int(kind)]; }
+    bool matches(const QString &text) const;
+
+    // Разбор JSON: {"name", "palette": {"Window": "#rrggbb", ...},
+    // "tokens": {"keyword": {"color", "bold", "italic"}, ...}}.
+    static bool fromJson(const QByteArray &json, Theme &theme, QString *error = nullptr);
+    static QVector<Theme> loadAll();
+    static QString userDirectory();
+
+    // Текущая тема подсветки, общая для всех документов. Поколение
+    // растёт при каждой смене и показывает, какие блоки уже перекрашены.
+    static const Theme &current();
+    static int generation();
+    static void setCurrent(const Theme &theme);
+};
+
+#endif // THEME_H
@@ -0,0 +1,587 @@
+#include "undohistory.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+#include <QTemporaryFile>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextEdit>
+#include <cstring>
+
+namespace {
+
+constexpr qint64 CoalesceMs = 1500;
+constexpr qsizetype PackThreshold = 64 * 1024; // символов в правке
+constexpr int KeepResident = 8;                // последние команды не выгружаются
+constexpr qsizetype MinGap = 4096;
+constexpr qint64 CompactSlack = 16 * 1024 * 1024;
+constexpr quint8 PackVersion = 1;
+
+bool isWordChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == '_';
+}
+
+bool isLineBreak(QChar c)
+{
+    return c == '\n' || c == QChar::ParagraphSeparator || c == QChar::LineSeparator;
+}
+
+// Строки вместе с завершающим разделителем: склейка даёт исходный текст.
+QVector<QStringView> splitLines(QStringView text)
+{
+    QVector<QStringView> lines;
+    qsizetype start = 0;
+    for (qsizetype i = 0; i < text.size(); ++i)
+    {
+        if (isLineBreak(text[i]))
+        {
+            lines.append(text.sliced(start, i + 1 - start));
+            start = i + 1;
+        }
+    }
+    if (start < text.size())
+        lines.append(text.sliced(start));
+    return lines;
+}
+
+QString spillTemplate()
+{
+    return QDir::temp().filePath("pabla-undo-XXXXXX");
+}
+
+} // namespace
+
+void UndoHistory::Shadow::assign(QStringView text)
+{
+    // Новый вектор, а не assign(): прежняя ёмкость освобождается.
+    const char16_t *data = reinterpret_cast<const char16_t *>(text.utf16());
+    std::vector<char16_t> fresh;
+    fresh.reserve(text.size() + MinGap);
+    fresh.assign(data, data + text.size());
+    fresh.resize(text.size() + MinGap);
+    buffer.swap(fresh);
+    gapStart = text.size();
+    gapEnd = qsizetype(buffer.size());
+}
+
+void UndoHistory::Shadow::moveGap(qsizetype position)
+{
+    if (position < gapStart)
+    {
+        const qsizetype count = gapStart - position;
+        std::memmove(buffer.data() + gapEnd - count, buffer.data() + position, count * sizeof(char16_t));
+        gapStart -= count;
+        gapEnd -= count;
+    }
+    else if (position > gapStart)
+    {
+        const qsizetype count = position - gapStart;
+        std::memmove(buffer.data() + gapStart, buffer.data() + gapEnd, count * sizeof(char16_t));
+        gapStart += count;
+        gapEnd += count;
+    }
+}
+
+QString UndoHistory::Shadow::mid(qsizetype position, qsizetype length) const
+{
+    QString result(length, Qt::Uninitialized);
+    char16_t *out = reinterpret_cast<char16_t *>(result.data());
+    const qsizetype beforeGap = qBound(qsizetype(0), gapStart - position, length);
+    std::memcpy(out, buffer.data() + position, beforeGap * sizeof(char16_t));
+    std::memcpy(out + beforeGap, buffer.data() + gapEnd + (position + beforeGap - gapStart),
+                (length - beforeGap) * sizeof(char16_t));
+    return result;
+}
+
+void UndoHistory::Shadow::replace(qsizetype position, qsizetype removed, QStringView inserted)
+{
+    moveGap(position);
+    gapEnd += removed;
+    if (gapEnd - gapStart < inserted.size())
+    {
+        const qsizetype tail = qsizetype(buffer.size()) - gapEnd;
+        const qsizetype gap = inserted.size() + qMax(MinGap, (gapStart + tail) / 8);
+        std::vector<char16_t> grown(gapStart + gap + tail);
+        std::memcpy(grown.data(), buffer.data(), gapStart * sizeof(char16_t));
+        std::memcpy(grown.data() + gapStart + gap, buffer.data() + gapEnd, tail * sizeof(char16_t));
+        buffer.swap(grown);
+        gapEnd = gapStart + gap;
+    }
+    std::memcpy(buffer.data() + gapStart, inserted.utf16(), inserted.size() * sizeof(char16_t));
+    gapStart += inserted.size();
+}
+
+UndoHistory::UndoHistory(QTextEdit *editor, QTextDocument *document, QObject *parent)
+    : QObject(parent), editor(editor)
+{
+    setDocument(document);
+}
+
+UndoHistory::~UndoHistory() = default;
+
+void UndoHistory::setMemoryBudget(qint64 bytes)
+{
+    memoryBudget = qMax(qint64(0), bytes);
+    enforceBudgets();
+    emit usageChanged(memoryBytes, diskBytes);
+}
+
+void UndoHistory::setDiskBudget(qint64 bytes)
+{
+    diskBudget = qMax(qint64(0), bytes);
+    enforceBudgets();
+    emit usageChanged(memoryBytes, diskBytes);
+}
+
+void UndoHistory::setDocument(QTextDocument *newDocument)
+{
+    if (document)
+        disconnect(document, nullptr, this, nullptr);
+    document = newDocument;
+    if (document)
+    {
+        document->setUndoRedoEnabled(false);
+        connect(document, &QTextDocument::contentsChange, this, &UndoHistory::onContentsChange);
+        shadow.assign(document->toRawText());
+    }
+    else
+    {
+        shadow.assign(QStringView());
+    }
+    suspended = false;
+    coalesceAllowed = false;
+}
+
+void UndoHistory::suspend()
+{
+    suspended = true;
+}
+
+void UndoHistory::reset()
+{
+    commands.clear();
+    current = 0;
+    memoryBytes = 0;
+    diskBytes = 0;
+    spillFile.reset();
+    shadow.assign(document ? QStringView(document->toRawText()) : QStringView());
+    suspended = false;
+    coalesceAllowed = false;
+    emit usageChanged(memoryBytes, diskBytes);
+}
+
+void UndoHistory::beginGroup()
+{
+    grouping = true;
+    groupStarted = false;
+    coalesceAllowed = false;
+}
+
+void UndoHistory::endGroup()
+{
+    grouping = false;
+    groupStarted = false;
+    coalesceAllowed = false;
+}
+
+qint64 UndoHistory::cost(const Command &command)
+{
+    return qint64(sizeof(Command)) + (command.removed.capacity() + command.inserted.capacity()) * qint64(sizeof(QChar))
+        + command.packed.capacity();
+}
+
+void UndoHistory::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if (suspended)
+        return;
+
+    // После setPlainText() и на конце документа Qt считает и завершающий
+    // разделитель блока, которого нет в тексте.
+    const qsizetype shadowSize = shadow.size();
+    const qsizetype documentSize = document->characterCount() - 1;
+    const qsizetype removed = qMin(qsizetype(charsRemoved), shadowSize - position);
+    const qsizetype added = qMin(qsizetype(charsAdded), documentSize - position);
+    // setDocumentLayout() сообщает весь текст как вставленный, хотя он не менялся.
+    if (charsRemoved == 0 && position == 0 && shadowSize == documentSize)
+        return;
+    if (position < 0 || removed < 0 || added < 0 || shadowSize - removed + added != documentSize)
+    {
+        // Тень разошлась с документом: начинаем историю заново.
+        reset();
+        emit diverged();
+        return;
+    }
+
+    QString insertedText;
+    if (added > 0)
+    {
+        QTextCursor cursor(document);
+        cursor.setPosition(position);
+        cursor.setPosition(position + added, QTextCursor::KeepAnchor);
+        insertedText = cursor.selectedText();
+    }
+    const QString removedText = shadow.mid(position, removed);
+    shadow.replace(position, removed, insertedText);
+
+    // Смена только оформления приходит с одинаковым текстом.
+    if (removedText == insertedText)
+        return;
+    ++textRevision;
+    emit textChanged(position, int(removed), insertedText);
+    if (!applying)
+        record(position, removedText, insertedText);
+}
+
+void UndoHistory::record(int position, const QString &removed, const QString &inserted)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    truncateRedo();
+    if (!coalesce(position, removed, inserted, now))
+    {
+        Command command{position, int(removed.size()), int(inserted.size()), QString(), QString(), QByteArray(), -1, 0, now};
+        if (removed.size() + inserted.size() > PackThreshold)
+        {
+            command.packed = pack(removed, inserted);
+        }
+        else
+        {
+            command.removed = removed;
+            command.inserted = inserted;
+        }
+        command.joined = grouping && groupStarted;
+        memoryBytes += cost(command);
+        commands.append(command);
+        current = commands.size();
+    }
+    groupStarted = grouping;
+    coalesceAllowed = !grouping;
+    enforceBudgets();
+    emit usageChanged(memoryBytes, diskBytes);
+}
+
+// Набор подряд до начала следующего слова, Backspace и Delete подряд.
+bool UndoHistory::coalesce(int position, const QString &removed, const QString &inserted, qint64 now)
+{
+    if (!coalesceAllowed || current == 0)
+        return false;
+    Command &last = commands[current - 1];
+    if (last.diskOffset >= 0 || !last.packed.isEmpty() || now - last.time > CoalesceMs)
+        return false;
+
+    const qint64 before = cost(last);
+    if (removed.isEmpty() && inserted.size() == 1 && last.insertedLength > 0
+        && position == last.position + last.insertedLength)
+    {
+        const QChar typed = inserted.front();
+        if (isLineBreak(typed) || (isWordChar(typed) && !isWordChar(last.inserted.back())))
+            return false;
+        last.inserted += typed;
+        ++last.insertedLength;
+    }
+    else if (inserted.isEmpty() && removed.size() == 1 && last.insertedLength == 0 && position + 1 == last.position)
+    {
+        last.removed.prepend(removed);
+        last.position = position;
+        ++last.removedLength;
+    }
+    else if (inserted.isEmpty() && removed.size() == 1 && last.insertedLength == 0 && position == last.position)
+    {
+        last.removed += removed;
+        ++last.removedLength;
+    }
+    else
+    {
+        return false;
+    }
+    last.time = now;
+    memoryBytes += cost(last) - before;
+    return true;
+}
+
+void UndoHistory::undo()
+{
+    // Группа отменяется целиком, с последней команды.
+    while (undoStep() && current > 0 && commands[current].joined)
+    {
+    }
+}
+
+void UndoHistory::redo()
+{
+    while (redoStep() && current < commands.size() && commands[current].joined)
+    {
+    }
+}
+
+bool UndoHistory::undoStep()
+{
+    if (!canUndo() || !document)
+        return false;
+    const Command command = commands[current - 1];
+    QString removed;
+    QString inserted;
+    if (!payload(command, removed, inserted))
+    {
+        // Файл выгрузки недоступен: более старая история потеряна.
+        for (int i = 0; i < current; ++i)
+            memoryBytes -= cost(commands[i]);
+        commands.remove(0, current);
+        current = 0;
+        emit usageChanged(memoryBytes, diskBytes);
+        return false;
+    }
+    apply(command.position, command.insertedLength, removed);
+    --current;
+    coalesceAllowed = false;
+    emit usageChanged(memoryBytes, diskBytes);
+    return true;
+}
+
+bool UndoHistory::redoStep()
+{
+    if (!canRedo() || !document)
+        return false;
+    const Command command = commands[current];
+    QString removed;
+    QString inserted;
+    if (!payload(command, removed, inserted))
+        return false;
+    apply(command.position, command.removedLength, inserted);
+    ++current;
+    coalesceAllowed = false;
+    emit usageChanged(memoryBytes, diskBytes);
+    return true;
+}
+
+bool UndoHistory::payload(const Command &command, QString &removed, QString &inserted) const
+{
+    if (command.diskOffset >= 0)
+    {
+        if (!spillFile || !spillFile->seek(command.diskOffset))
+            return false;
+        const QByteArray bytes = spillFile->read(command.diskSize);
+        return bytes.size() == command.diskSize && unpack(bytes, removed, inserted);
+    }
+    if (!command.packed.isEmpty())
+        return unpack(command.packed, removed, inserted);
+    removed = command.removed;
+    inserted = command.inserted;
+    return true;
+}
+
+void UndoHistory::apply(int position, int length, const QString &text)
+{
+    applying = true;
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    cursor.setPosition(position);
+    cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+    if (text.isEmpty())
+        cursor.removeSelectedText();
+    else
+        cursor.insertText(text);
+    cursor.endEditBlock();
+    applying = false;
+    if (editor->document() == document)
+        editor->setTextCursor(cursor);
+}
+
+void UndoHistory::truncateRedo()
+{
+    for (int i = current; i < commands.size(); ++i)
+    {
+        memoryBytes -= cost(commands[i]);
+        if (commands[i].diskOffset >= 0)
+            diskBytes -= commands[i].diskSize;
+    }
+    commands.resize(current);
+}
+
+void UndoHistory::enforceBudgets()
+{
+    bool spillFailed = false;
+    for (int i = 0; memoryBytes > memoryBudget && i < current - KeepResident; ++i)
+    {
+        if (commands[i].diskOffset >= 0)
+            continue;
+        if (!spill(commands[i]))
+        {
+            spillFailed = true;
+            break;
+        }
+    }
+
+    // Сверх бюджета диска (или если выгрузить не удалось) старые команды забываются.
+    int evicted = 0;
+    while (evicted < current - KeepResident)
+    {
+        const Command &oldest = commands[evicted];
+        if (diskBytes <= diskBudget && !(spillFailed && memoryBytes > memoryBudget))
+            break;
+        memoryBytes -= cost(oldest);
+        if (oldest.diskOffset >= 0)
+            diskBytes -= oldest.diskSize;
+        ++evicted;
+    }
+    if (evicted > 0)
+    {
+        commands.remove(0, evicted);
+        current -= evicted;
+    }
+
+    if (spillFile && spillFile->size() > 2 * diskBytes + CompactSlack)
+        compactSpillFile();
+}
+
+bool UndoHistory::spill(Command &command)
+{
+    if (!spillFile)
+    {
+        spillFile = std::make_unique<QTemporaryFile>(spillTemplate());
+        if (!spillFile->open())
+        {
+            spillFile.reset();
+            return false;
+        }
+    }
+
+    const QByteArray bytes = command.packed.isEmpty() ? pack(command.removed, command.inserted) : command.packed;
+    const qint64 offset = spillFile->size();
+    if (!spillFile->seek(offset) || spillFile->write(bytes) != bytes.size())
+        return false;
+
+    memoryBytes -= cost(command);
+    command.removed = QString();
+    command.inserted = QString();
+    command.packed = QByteArray();
+    command.diskOffset = offset;
+    command.diskSize = qint32(bytes.size());
+    memoryBytes += cost(command);
+    diskBytes += bytes.size();
+    return true;
+}
+
+// Файл выгрузки только дописывается; когда живых данных в нём меньше
+// половины, они переписываются в новый файл.
+void UndoHistory::compactSpillFile()
+{
+    std::unique_ptr<QTemporaryFile> fresh = std::make_unique<QTemporaryFile>(spillTemplate());
+    if (!fresh->open())
+        return;
+    for (Command &command : commands)
+    {
+        if (command.diskOffset < 0)
+            continue;
+        spillFile->seek(command.diskOffset);
+        const QByteArray bytes = spillFile->read(command.diskSize);
+        command.diskOffset = fresh->pos();
+        fresh->write(bytes);
+    }
+    spillFile = std::move(fresh);
+}
+
+// Формат (после qCompress): версия, удалённый текст, затем вставленный
+// как список операций: 0 — скопировать строки удалённого текста
+// (первая, количество), 1 — вставить литерал.
+QByteArray UndoHistory::pack(const QString &removed, const QString &inserted)
+{
+    const QVector<QStringView> removedLines = splitLines(removed);
+    QHash<QStringView, int> lineIndex;
+    lineIndex.reserve(removedLines.size());
+    for (int i = removedLines.size() - 1; i >= 0; --i)
+        lineIndex.insert(removedLines[i], i);
+
+    struct Op {
+        int first;          // копия: первая строка
+        int count;          // копия: число строк, 0 — литерал
+        qsizetype start;    // литерал: начало во вставленном тексте
+        qsizetype length;
+    };
+    QVector<Op> ops;
+    int next = 0;
+    qsizetype offset = 0;
+    for (QStringView line : splitLines(inserted))
+    {
+        int match = -1;
+        if (next < removedLines.size() && removedLines[next] == line)
+        {
+            match = next;
+        }
+        else
+        {
+            const auto found = lineIndex.constFind(line);
+            if (found != lineIndex.constEnd())
+                match = *found;
+        }
+
+        if (match >= 0)
+        {
+            if (!ops.isEmpty() && ops.last().count > 0 && ops.last().first + ops.last().count == match)
+                ++ops.last().count;
+            else
+                ops.append({match, 1, 0, 0});
+            next = match + 1;
+        }
+        else if (!ops.isEmpty() && ops.last().count == 0)
+        {
+            ops.last().length += line.size();
+        }
+        else
+        {
+            ops.append({0, 0, offset, line.size()});
+        }
+        offset += line.size();
+    }
+
+    QByteArray raw;
+    QDataStream out(&raw, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << PackVersion << removed << quint32(ops.size());
+    for (const Op &op : std::as_const(ops))
+    {
+        if (op.count > 0)
+            out << quint8(0) << qint32(op.first) << qint32(op.count);
+        else
+            out << quint8(1) << inserted.mid(op.start, op.length);
+    }
+    return qCompress(raw, 1);
+}
+
+bool UndoHistory::unpack(const QByteArray &packed, QString &removed, QString &inserted)
+{
+    const QByteArray raw = qUncompress(packed);
+    QDataStream in(raw);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint8 version = 0;
+    quint32 count = 0;
+    in >> version >> removed >> count;
+    if (in.status() != QDataStream::Ok || version != PackVersion)
+        return false;
+
+    const QVector<QStringView> lines = splitLines(removed);
+    inserted.clear();
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        quint8 kind = 0;
+        in >> kind;
+        if (kind == 0)
+        {
+            qint32 first = 0;
+            qint32 lineCount = 0;
+            in >> first >> lineCount;
+            if (first < 0 || lineCount < 0 || first + lineCount > lines.size())
+                return false;
+            for (int line = first; line < first + lineCount; ++line)
+                inserted += lines[line];
+        }
+        else
+        {
+            QString literal;
+            in >> literal;
+            inserted += literal;
+        }
+    }
+    return in.status() == QDataStream::Ok;
+}
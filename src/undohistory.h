@@ -0,0 +1,141 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+class QTemporaryFile;
+class QTextDocument;
+class QTextEdit;
+
+// История правок редактора вместо встроенного стека QTextDocument,
+// который растёт без ограничений. Правки снимаются по contentsChange,
+// удалённый текст берётся из теневой копии документа (буфер с разрывом,
+// поэтому набор в одном месте не двигает весь текст). Нажатия подряд
+// склеиваются в одну команду до границы слова, большие правки хранятся
+// сжатыми: удалённый текст целиком, вставленный — как разница с ним по
+// строкам. Сверх бюджета памяти старые команды выгружаются во временный
+// файл, сверх бюджета диска — забываются. История может быть отвязана
+// от документа (вкладка выгружена) и привязана к его новой копии.
+class UndoHistory : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 DefaultMemoryBudget = 32 * 1024 * 1024;
+    static constexpr qint64 DefaultDiskBudget = 256 * 1024 * 1024;
+
+    explicit UndoHistory(QTextEdit *editor, QTextDocument *document = nullptr, QObject *parent = nullptr);
+    ~UndoHistory() override;
+
+    void setMemoryBudget(qint64 bytes);
+    void setDiskBudget(qint64 bytes);
+
+    // Привязка к документу с тем же текстом; команды сохраняются.
+    // nullptr отвязывает историю и освобождает теневую копию.
+    void setDocument(QTextDocument *document);
+    bool isAttached() const { return document != nullptr; }
+
+    // На время загрузки файла правки не записываются; reset() начинает
+    // пустую историю от текущего текста документа.
+    void suspend();
+    void reset();
+
+    // Правки между beginGroup() и endGroup() отменяются и повторяются
+    // вместе, как одна команда.
+    void beginGroup();
+    void endGroup();
+
+    // Растёт с каждой правкой текста, пока история привязана к документу.
+    quint64 revision() const { return textRevision; }
+
+    bool canUndo() const { return current > 0; }
+    bool canRedo() const { return current < commands.size(); }
+    int count() const { return commands.size(); }
+    qint64 memoryUsage() const { return memoryBytes; }
+    qint64 diskUsage() const { return diskBytes; }
+
+    // Сжатое представление правки и обратно; открыто для замеров.
+    static QByteArray pack(const QString &removed, const QString &inserted);
+    static bool unpack(const QByteArray &packed, QString &removed, QString &inserted);
+
+public slots:
+    void undo();
+    void redo();
+
+signals:
+    void usageChanged(qint64 memoryBytes, qint64 diskBytes);
+    // Каждая правка текста, включая отмену и повтор; position — в
+    // символах toRawText(). diverged() — тень разошлась с документом и
+    // правки между ними потеряны.
+    void textChanged(int position, int removedLength, const QString &inserted);
+    void diverged();
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    struct Command {
+        int position;
+        int removedLength;
+        int insertedLength;
+        QString removed;        // у упакованной и выгруженной команды пусто
+        QString inserted;
+        QByteArray packed;      // pack(removed, inserted) для больших правок
+        qint64 diskOffset;      // >= 0 — команда выгружена в файл
+        qint32 diskSize;
+        qint64 time;            // мс, для склейки нажатий
+        bool joined = false;    // отменяется вместе с предыдущей
+    };
+
+    // Текст документа буфером с разрывом в месте последней правки.
+    class Shadow {
+    public:
+        void assign(QStringView text);
+        qsizetype size() const { return qsizetype(buffer.size()) - (gapEnd - gapStart); }
+        QString mid(qsizetype position, qsizetype length) const;
+        void replace(qsizetype position, qsizetype removed, QStringView inserted);
+
+    private:
+        void moveGap(qsizetype position);
+
+        std::vector<char16_t> buffer;
+        qsizetype gapStart = 0;
+        qsizetype gapEnd = 0;
+    };
+
+    static qint64 cost(const Command &command);
+    void record(int position, const QString &removed, const QString &inserted);
+    bool coalesce(int position, const QString &removed, const QString &inserted, qint64 now);
+    bool payload(const Command &command, QString &removed, QString &inserted) const;
+    bool undoStep();
+    bool redoStep();
+    void apply(int position, int length, const QString &text);
+    void truncateRedo();
+    void enforceBudgets();
+    bool spill(Command &command);
+    void compactSpillFile();
+
+    QTextEdit *editor;
+    QTextDocument *document = nullptr;
+    Shadow shadow;
+    QVector<Command> commands; // [0, current) — отмена, [current, size) — повтор
+    int current = 0;
+    qint64 memoryBytes = 0;
+    qint64 diskBytes = 0;
+    qint64 memoryBudget = DefaultMemoryBudget;
+    qint64 diskBudget = DefaultDiskBudget;
+    std::unique_ptr<QTemporaryFile> spillFile;
+    bool suspended = false;
+    bool applying = false;
+    bool coalesceAllowed = false;
+    quint64 textRevision = 0;
+    bool grouping = false;
+    bool groupStarted = false; // в группе уже есть команда
+};
+
+#endif // UNDOHISTORY_H
@@ -0,0 +1,584 @@
+#include "vtparser.h"
+#include "terminalscreen.h"
+
+namespace {
+
+constexpr int MaxParams = 32;
+constexpr int MaxOscLength = 4096;
+constexpr char32_t Replacement = 0xfffd;
+
+// Графика DEC для символов 0x60..0x7e (рамки в mc, tmux, dialog).
+constexpr char32_t LineDrawing[] = {
+    0x25c6, 0x2592, 0x2409, 0x240c, 0x240d, 0x240a, 0x00b0, 0x00b1, 0x2424, 0x240b, 0x2518, 0x2510,
+    0x250c, 0x2514, 0x253c, 0x23ba, 0x23bb, 0x2500, 0x23bc, 0x23bd, 0x251c, 0x2524, 0x2534, 0x252c,
+    0x2502, 0x2264, 0x2265, 0x03c0, 0x2260, 0x00a3, 0x00b7};
+
+bool isCancel(uchar c)
+{
+    return c == 0x18 || c == 0x1a; // CAN, SUB
+}
+
+} // namespace
+
+VtParser::VtParser(TerminalScreen &screen)
+    : screen(screen)
+{
+}
+
+QByteArray VtParser::takeResponse()
+{
+    QByteArray result;
+    result.swap(response);
+    return result;
+}
+
+void VtParser::clear()
+{
+    params.clear();
+    paramStarted = false;
+    privateMarker = 0;
+    intermediate = 0;
+}
+
+int VtParser::param(int index, int fallback) const
+{
+    return index < params.size() && params[index] != 0 ? params[index] : fallback;
+}
+
+void VtParser::feed(const char *data, qint64 size)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    const uchar *end = p + size;
+    while (p < end)
+    {
+        // Основной поток вывода — печатный ASCII: прогоном, без автомата.
+        if (state == State::Ground && utf8Remaining == 0 && !lineDrawing)
+        {
+            const uchar *run = p;
+            while (p < end && *p >= 0x20 && *p < 0x7f)
+                ++p;
+            if (p != run)
+            {
+                screen.printAscii(reinterpret_cast<const char *>(run), int(p - run));
+                continue;
+            }
+        }
+
+        const uchar c = *p++;
+        switch (state)
+        {
+        case State::Osc:
+            if (oscEscape)
+            {
+                // ESC \ завершает строку, любой другой ESC — тоже, но
+                // начинает новую последовательность.
+                oscEscape = false;
+                oscDispatch();
+                clear();
+                state = State::Escape;
+                if (c == '\\')
+                    state = State::Ground;
+                else
+                    --p;
+            }
+            else if (c == 0x07)
+            {
+                oscDispatch();
+                state = State::Ground;
+            }
+            else if (c == 0x1b)
+            {
+                oscEscape = true;
+            }
+            else if (isCancel(c))
+            {
+                state = State::Ground;
+            }
+            else if (osc.size() < MaxOscLength)
+            {
+                osc.append(char(c));
+            }
+            continue;
+        case State::String:
+            if (c == 0x1b)
+                state = State::StringEscape;
+            else if (isCancel(c))
+                state = State::Ground;
+            continue;
+        case State::StringEscape:
+            clear();
+            state = State::Escape;
+            if (c == '\\')
+                state = State::Ground;
+            else
+                --p;
+            continue;
+        default:
+            break;
+        }
+
+        if (c == 0x1b)
+        {
+            if (utf8Remaining)
+            {
+                utf8Remaining = 0;
+                printCodePoint(Replacement);
+            }
+            clear();
+            state = State::Escape;
+            continue;
+        }
+        if (isCancel(c))
+        {
+            state = State::Ground;
+            continue;
+        }
+        if (c < 0x20)
+        {
+            execute(c); // управляющие символы действуют и внутри последовательностей
+            continue;
+        }
+        if (c == 0x7f)
+            continue;
+
+        switch (state)
+        {
+        case State::Ground:
+            if (c < 0x80)
+            {
+                if (utf8Remaining)
+                {
+                    utf8Remaining = 0;
+                    printCodePoint(Replacement);
+                }
+                printCodePoint(c);
+            }
+            else if ((c & 0xc0) == 0x80)
+            {
+                if (utf8Remaining == 0)
+                {
+                    printCodePoint(Replacement);
+                }
+                else
+                {
+                    codePoint = (codePoint << 6) | (c & 0x3f);
+                    if (--utf8Remaining == 0)
+                        printCodePoint(codePoint);
+                }
+            }
+            else
+            {
+                if (utf8Remaining)
+                    printCodePoint(Replacement);
+                if ((c & 0xe0) == 0xc0)
+                {
+                    codePoint = c & 0x1f;
+                    utf8Remaining = 1;
+                }
+                else if ((c & 0xf0) == 0xe0)
+                {
+                    codePoint = c & 0x0f;
+                    utf8Remaining = 2;
+                }
+                else if ((c & 0xf8) == 0xf0)
+                {
+                    codePoint = c & 0x07;
+                    utf8Remaining = 3;
+                }
+                else
+                {
+                    utf8Remaining = 0;
+                    printCodePoint(Replacement);
+                }
+            }
+            break;
+        case State::Escape:
+            if (c >= 0x20 && c <= 0x2f)
+            {
+                intermediate = char(c);
+                state = State::EscapeIntermediate;
+            }
+            else if (c == '[')
+            {
+                state = State::Csi;
+            }
+            else if (c == ']')
+            {
+                osc.clear();
+                oscEscape = false;
+                state = State::Osc;
+            }
+            else if (c == 'P' || c == 'X' || c == '^' || c == '_')
+            {
+                state = State::String;
+            }
+            else
+            {
+                escapeDispatch(c);
+                state = State::Ground;
+            }
+            break;
+        case State::EscapeIntermediate:
+            if (c >= 0x20 && c <= 0x2f)
+            {
+                intermediate = char(c);
+            }
+            else
+            {
+                escapeDispatch(c);
+                state = State::Ground;
+            }
+            break;
+        case State::Csi:
+            if (c >= '0' && c <= '9')
+            {
+                if (!paramStarted)
+                {
+                    if (params.size() >= MaxParams)
+                    {
+                        state = State::CsiIgnore;
+                        break;
+                    }
+                    params.append(0);
+                    paramStarted = true;
+                }
+                params.last() = qMin(params.last() * 10 + (c - '0'), 65535);
+            }
+            else if (c == ';' || c == ':')
+            {
+                // Пустой параметр — значение по умолчанию (0).
+                if (!paramStarted && params.size() < MaxParams)
+                    params.append(0);
+                paramStarted = false;
+            }
+            else if (c >= 0x3c && c <= 0x3f)
+            {
+                if (params.isEmpty() && !paramStarted && !privateMarker)
+                    privateMarker = char(c);
+                else
+                    state = State::CsiIgnore;
+            }
+            else if (c >= 0x20 && c <= 0x2f)
+            {
+                intermediate = char(c);
+            }
+            else if (c >= 0x40 && c <= 0x7e)
+            {
+                csiDispatch(c);
+                state = State::Ground;
+            }
+            else
+            {
+                state = State::CsiIgnore;
+            }
+            break;
+        case State::CsiIgnore:
+            if (c >= 0x40 && c <= 0x7e)
+                state = State::Ground;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void VtParser::execute(uchar c)
+{
+    switch (c)
+    {
+    case 0x08:
+        screen.backspace();
+        break;
+    case 0x09:
+        screen.tab();
+        break;
+    case 0x0a:
+    case 0x0b:
+    case 0x0c:
+        screen.lineFeed();
+        break;
+    case 0x0d:
+        screen.carriageReturn();
+        break;
+    default:
+        break; // BEL, SO/SI и прочие не нужны
+    }
+}
+
+void VtParser::printCodePoint(char32_t ch)
+{
+    if (lineDrawing && ch >= 0x60 && ch <= 0x7e)
+        ch = LineDrawing[ch - 0x60];
+    screen.print(ch);
+}
+
+void VtParser::escapeDispatch(uchar final)
+{
+    if (intermediate == '(')
+    {
+        lineDrawing = final == '0';
+        return;
+    }
+    if (intermediate)
+        return; // G1..G3, DECALN и пр.
+
+    switch (final)
+    {
+    case '7':
+        screen.saveCursor();
+        break;
+    case '8':
+        screen.restoreCursor();
+        break;
+    case 'D':
+        screen.lineFeed();
+        break;
+    case 'E':
+        screen.carriageReturn();
+        screen.lineFeed();
+        break;
+    case 'M':
+        screen.reverseIndex();
+        break;
+    case 'c':
+        lineDrawing = false;
+        screen.reset();
+        break;
+    default:
+        break;
+    }
+}
+
+void VtParser::csiDispatch(uchar final)
+{
+    if (intermediate)
+        return; // DECSTR, форма курсора и пр.
+
+    if (privateMarker == '?')
+    {
+        if (final == 'h' || final == 'l')
+        {
+            for (int mode : std::as_const(params))
+                screen.setMode(mode, true, final == 'h');
+        }
+        return;
+    }
+    if (privateMarker == '>')
+    {
+        if (final == 'c')
+            response += "\x1b[>0;0;0c";
+        return;
+    }
+    if (privateMarker)
+        return;
+
+    const int n = param(0, 1);
+    switch (final)
+    {
+    case '@':
+        screen.insertChars(n);
+        break;
+    case 'A':
+        screen.moveCursorBy(-n, 0);
+        break;
+    case 'B':
+    case 'e':
+        screen.moveCursorBy(n, 0);
+        break;
+    case 'C':
+    case 'a':
+        screen.moveCursorBy(0, n);
+        break;
+    case 'D':
+        screen.moveCursorBy(0, -n);
+        break;
+    case 'E':
+        screen.moveCursorBy(n, 0);
+        screen.carriageReturn();
+        break;
+    case 'F':
+        screen.moveCursorBy(-n, 0);
+        screen.carriageReturn();
+        break;
+    case 'G':
+    case '`':
+        screen.setCursorColumn(n - 1);
+        break;
+    case 'H':
+    case 'f':
+        screen.moveCursor(param(0, 1) - 1, param(1, 1) - 1);
+        break;
+    case 'I':
+        screen.tab(n);
+        break;
+    case 'J':
+        screen.eraseInDisplay(param(0, 0));
+        break;
+    case 'K':
+        screen.eraseInLine(param(0, 0));
+        break;
+    case 'L':
+        screen.insertLines(n);
+        break;
+    case 'M':
+        screen.deleteLines(n);
+        break;
+    case 'P':
+        screen.deleteChars(n);
+        break;
+    case 'S':
+        screen.scrollUp(n);
+        break;
+    case 'T':
+        screen.scrollDown(n);
+        break;
+    case 'X':
+        screen.eraseChars(n);
+        break;
+    case 'b':
+        screen.repeatLast(n);
+        break;
+    case 'c':
+        response += "\x1b[?1;2c";
+        break;
+    case 'd':
+        screen.setCursorRow(n - 1);
+        break;
+    case 'h':
+    case 'l':
+        for (int mode : std::as_const(params))
+            screen.setMode(mode, false, final == 'h');
+        break;
+    case 'm':
+        selectGraphicRendition();
+        break;
+    case 'n':
+        if (param(0, 0) == 5)
+            response += "\x1b[0n";
+        else if (param(0, 0) == 6)
+            response += "\x1b[" + QByteArray::number(screen.cursorRow() + 1) + ';'
+                + QByteArray::number(screen.cursorColumn() + 1) + 'R';
+        break;
+    case 'r':
+        screen.setScrollRegion(param(0, 1) - 1, param(1, screen.rows()) - 1);
+        break;
+    case 's':
+        screen.saveCursor();
+        break;
+    case 'u':
+        screen.restoreCursor();
+        break;
+    default:
+        break;
+    }
+}
+
+void VtParser::selectGraphicRendition()
+{
+    TerminalScreen::Cell &pen = screen.pen();
+    if (params.isEmpty())
+    {
+        pen = TerminalScreen::Cell();
+        return;
+    }
+    for (int i = 0; i < params.size(); ++i)
+    {
+        const int p = params[i];
+        switch (p)
+        {
+        case 0:
+            pen = TerminalScreen::Cell();
+            break;
+        case 1:
+            pen.flags |= TerminalScreen::Bold;
+            break;
+        case 2:
+            pen.flags |= TerminalScreen::Faint;
+            break;
+        case 3:
+            pen.flags |= TerminalScreen::Italic;
+            break;
+        case 4:
+        case 21:
+            pen.flags |= TerminalScreen::Underline;
+            break;
+        case 7:
+            pen.flags |= TerminalScreen::Inverse;
+            break;
+        case 8:
+            pen.flags |= TerminalScreen::Hidden;
+            break;
+        case 9:
+            pen.flags |= TerminalScreen::Strike;
+            break;
+        case 22:
+            pen.flags &= ~(TerminalScreen::Bold | TerminalScreen::Faint);
+            break;
+        case 23:
+            pen.flags &= ~TerminalScreen::Italic;
+            break;
+        case 24:
+            pen.flags &= ~TerminalScreen::Underline;
+            break;
+        case 27:
+            pen.flags &= ~TerminalScreen::Inverse;
+            break;
+        case 28:
+            pen.flags &= ~TerminalScreen::Hidden;
+            break;
+        case 29:
+            pen.flags &= ~TerminalScreen::Strike;
+            break;
+        case 39:
+            pen.fg = TerminalScreen::DefaultColor;
+            break;
+        case 49:
+            pen.bg = TerminalScreen::DefaultColor;
+            break;
+        case 38:
+        case 48:
+        {
+            // 38;5;n — палитра, 38;2;r;g;b — 24 бита
+            quint32 color = TerminalScreen::DefaultColor;
+            if (i + 2 < params.size() && params[i + 1] == 5)
+            {
+                color = TerminalScreen::IndexedColor | quint32(params[i + 2] & 0xff);
+                i += 2;
+            }
+            else if (i + 4 < params.size() && params[i + 1] == 2)
+            {
+                color = TerminalScreen::RgbColor | quint32(params[i + 2] & 0xff) << 16
+                    | quint32(params[i + 3] & 0xff) << 8 | quint32(params[i + 4] & 0xff);
+                i += 4;
+            }
+            else
+            {
+                i = params.size();
+                break;
+            }
+            (p == 38 ? pen.fg : pen.bg) = color;
+            break;
+        }
+        default:
+            if (p >= 30 && p <= 37)
+                pen.fg = TerminalScreen::IndexedColor | quint32(p - 30);
+            else if (p >= 40 && p <= 47)
+                pen.bg = TerminalScreen::IndexedColor | quint32(p - 40);
+            else if (p >= 90 && p <= 97)
+                pen.fg = TerminalScreen::IndexedColor | quint32(p - 90 + 8);
+            else if (p >= 100 && p <= 107)
+                pen.bg = TerminalScreen::IndexedColor | quint32(p - 100 + 8);
+            break;
+        }
+    }
+}
+
+void VtParser::oscDispatch()
+{
+    const int separator = osc.indexOf(';');
+    if (separator < 0)
+        return;
+    const QByteArray code = osc.left(separator);
+    if (code == "0" || code == "2")
+        screen.setTitle(QString::fromUtf8(osc.mid(separator + 1)));
+}
@@ -0,0 +1,56 @@
+#ifndef VTPARSER_H
+#define VTPARSER_H
+
+#include <QByteArray>
+#include <QVarLengthArray>
+
+class TerminalScreen;
+
+// Разбор вывода в духе VT100/xterm (конечный автомат по схеме DEC:
+// печать, управляющие символы, ESC, CSI, OSC, строки DCS/APC, которые
+// пропускаются) с декодированием UTF-8. Прогоны печатных ASCII-символов
+// передаются экрану целиком. Ответы терминала (положение курсора,
+// атрибуты устройства) копятся в response() для записи в pty.
+class VtParser {
+public:
+    explicit VtParser(TerminalScreen &screen);
+
+    void feed(const char *data, qint64 size);
+    QByteArray takeResponse();
+
+private:
+    enum class State {
+        Ground,
+        Escape,
+        EscapeIntermediate,
+        Csi,
+        CsiIgnore,
+        Osc,
+        String, // DCS, SOS, PM, APC — содержимое не нужно
+        StringEscape
+    };
+
+    void execute(uchar c);
+    void printCodePoint(char32_t ch);
+    void escapeDispatch(uchar final);
+    void csiDispatch(uchar final);
+    void oscDispatch();
+    void selectGraphicRendition();
+    int param(int index, int fallback) const;
+    void clear();
+
+    TerminalScreen &screen;
+    State state = State::Ground;
+    QVarLengthArray<int, 16> params;
+    bool paramStarted = false;
+    char privateMarker = 0;
+    char intermediate = 0;
+    QByteArray osc;
+    bool oscEscape = false;
+    bool lineDrawing = false; // G0 — графика DEC (ESC ( 0)
+    char32_t codePoint = 0;
+    int utf8Remaining = 0;
+    QByteArray response;
+};
+
+#endif // VTPARSER_H
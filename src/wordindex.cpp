@@ -0,0 +1,451 @@
+#include "wordindex.h"
+#include "blockdata.h"
+#include "lexer.h"
+#include <QSet>
+#include <QtAlgorithms>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int MinWordLength = 3;
+constexpr int MinTypoLength = 3; // с такого префикса допускается одна опечатка
+
+QStringList identifiers(const QString &text, QVector<Token> &tokens)
+{
+    Lexer::defaultLexer().tokenize(text, tokens);
+    QStringList words;
+    for (const Token &token : std::as_const(tokens))
+    {
+        if (token.kind == TokenKind::Identifier && token.length >= MinWordLength)
+            words.append(QString(text.constData() + token.start, token.length)); // копия: text может ссылаться на снимок
+    }
+    return words;
+}
+
+// Бит на букву, цифру и '_', прочие символы делят оставшиеся биты.
+// Слово, в маске которого нет букв запроса, нечётко не подходит.
+quint64 letterMask(const QString &folded)
+{
+    quint64 mask = 0;
+    for (QChar c : folded)
+    {
+        const char16_t u = c.unicode();
+        int bit;
+        if (u >= 'a' && u <= 'z')
+            bit = u - 'a';
+        else if (u >= '0' && u <= '9')
+            bit = 26 + (u - '0');
+        else if (u == '_')
+            bit = 36;
+        else
+            bit = 37 + u % 27;
+        mask |= quint64(1) << bit;
+    }
+    return mask;
+}
+
+// Буквы запроса, кроме skip, идут в слове по порядку: возвращает число
+// пропущенных между ними букв слова, -1 — не идут.
+int fuzzyGaps(const QString &word, const QString &query, int skip)
+{
+    const QChar *data = word.constData();
+    const int length = word.size();
+    int gaps = 0;
+    int i = 0;
+    for (int q = 0; q < query.size(); ++q)
+    {
+        if (q == skip)
+            continue;
+        const QChar c = query.at(q);
+        const int start = i;
+        while (i < length && data[i] != c)
+            ++i;
+        if (i == length)
+            return -1;
+        gaps += i - start;
+        ++i;
+    }
+    return gaps;
+}
+
+} // namespace
+
+WordIndex::WordIndex(QTextDocument *document)
+    : QObject(document), document(document)
+{
+    scanTimer.setSingleShot(true);
+    scanTimer.setInterval(ScanDelay);
+    connect(&scanTimer, &QTimer::timeout, this, &WordIndex::startScan);
+    connect(document, &QTextDocument::contentsChange, this, &WordIndex::onContentsChange);
+    if (document->blockCount() > SyncBlocks)
+        startScan();
+    else
+        indexBlocks(0, document->blockCount() - 1);
+}
+
+WordIndex::~WordIndex()
+{
+    cancelScan();
+}
+
+void WordIndex::addKeywords(const QStringList &keywords)
+{
+    for (const QString &keyword : keywords)
+    {
+        if (!keyword.contains(' '))
+            add(keyword, true);
+    }
+}
+
+bool WordIndex::before(int a, int b) const
+{
+    const Entry &left = entries[a];
+    const Entry &right = entries[b];
+    if (left.folded != right.folded)
+        return left.folded < right.folded;
+    return left.word < right.word;
+}
+
+void WordIndex::add(const QString &word, bool keyword)
+{
+    auto it = lookup.constFind(word);
+    if (it != lookup.constEnd())
+    {
+        Entry &entry = entries[*it];
+        ++entry.count;
+        entry.keyword = entry.keyword || keyword;
+        return;
+    }
+
+    int id;
+    if (!freeEntries.isEmpty())
+    {
+        id = freeEntries.takeLast();
+    }
+    else
+    {
+        id = entries.size();
+        entries.append(Entry());
+        letters.append(0);
+    }
+    Entry &entry = entries[id];
+    entry.word = word;
+    entry.folded = word.toCaseFolded();
+    entry.count = 1;
+    entry.keyword = keyword;
+    letters[id] = letterMask(entry.folded);
+    lookup.insert(word, id);
+    if (!bulk)
+        insertOrdered(id);
+}
+
+void WordIndex::remove(const QString &word)
+{
+    auto it = lookup.find(word);
+    if (it == lookup.end())
+        return;
+    const int id = *it;
+    Entry &entry = entries[id];
+    if (--entry.count > 0 || entry.keyword)
+    {
+        entry.count = qMax(entry.count, 0);
+        return;
+    }
+
+    if (!bulk)
+        eraseOrdered(id);
+    entry = Entry();
+    letters[id] = 0;
+    freeEntries.append(id);
+    lookup.erase(it);
+}
+
+// Вставка и удаление сдвигают хвост массива номеров: для одиночных правок
+// это memmove нескольких сотен килобайт на 100k слов, дешевле любого дерева.
+void WordIndex::insertOrdered(int id)
+{
+    const auto at = std::lower_bound(order.begin(), order.end(), id, [this](int a, int b) { return before(a, b); });
+    order.insert(at, id);
+}
+
+void WordIndex::eraseOrdered(int id)
+{
+    const auto at = std::lower_bound(order.begin(), order.end(), id, [this](int a, int b) { return before(a, b); });
+    if (at != order.end() && *at == id)
+        order.erase(at);
+}
+
+// sorted уже упорядочен рабочим потоком; досортировать остаётся только
+// слова, которых в снимке не было (ключевые, правки во время разбора).
+void WordIndex::rebuildOrder(const QStringList &sorted)
+{
+    QVector<bool> taken(entries.size(), false);
+    QVector<int> primary;
+    primary.reserve(sorted.size());
+    for (const QString &word : sorted)
+    {
+        const int id = lookup.value(word, -1);
+        if (id >= 0 && !taken[id])
+        {
+            taken[id] = true;
+            primary.append(id);
+        }
+    }
+
+    QVector<int> rest;
+    for (int id = 0; id < entries.size(); ++id)
+    {
+        if (!taken[id] && !entries[id].word.isEmpty())
+            rest.append(id);
+    }
+    const auto less = [this](int a, int b) { return before(a, b); };
+    std::sort(rest.begin(), rest.end(), less);
+
+    order.resize(primary.size() + rest.size());
+    std::merge(primary.cbegin(), primary.cend(), rest.cbegin(), rest.cend(), order.begin(), less);
+}
+
+void WordIndex::addWords(const QStringList &words)
+{
+    for (const QString &word : words)
+        add(word);
+}
+
+void WordIndex::removeWords(const QStringList &words)
+{
+    for (const QString &word : words)
+        remove(word);
+}
+
+void WordIndex::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved);
+    const int from = qMax(0, document->findBlock(position).blockNumber());
+    QTextBlock last = document->findBlock(position + charsAdded);
+    if (!last.isValid())
+        last = document->lastBlock();
+    const int to = last.blockNumber();
+
+    if (worker)
+    {
+        // Идёт разбор: изменённые блоки разберутся при его применении.
+        scanHead = qMin(scanHead, from);
+        scanTail = qMin(scanTail, document->blockCount() - 1 - to);
+        return;
+    }
+    if (to - from >= SyncBlocks)
+        scanTimer.start();
+    else
+        indexBlocks(from, to);
+}
+
+void WordIndex::indexBlocks(int from, int to)
+{
+    QVector<Token> tokens;
+    for (QTextBlock block = document->findBlockByNumber(from); block.isValid() && block.blockNumber() <= to;
+         block = block.next())
+        assignWords(block, identifiers(block.text(), tokens));
+}
+
+void WordIndex::assignWords(QTextBlock block, const QStringList &words)
+{
+    BlockData *data = static_cast<BlockData *>(block.userData());
+    if (!data)
+    {
+        if (words.isEmpty())
+            return;
+        data = new BlockData;
+        block.setUserData(data);
+    }
+    if (data->words == words)
+        return;
+    removeWords(data->words);
+    addWords(words);
+    data->words = words;
+    data->wordIndex = this;
+}
+
+void WordIndex::startScan()
+{
+    cancelScan();
+    scanTimer.stop();
+
+    const quint64 id = ++runId;
+    const QString snapshot = document->toRawText();
+    const int blockCount = document->blockCount();
+    scanHead = blockCount;
+    scanTail = blockCount;
+    std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+    cancelled = flag;
+    worker = QThread::create([this, flag, snapshot, blockCount, id] { run(flag, snapshot, blockCount, id); });
+    worker->start();
+}
+
+void WordIndex::cancelScan()
+{
+    if (!worker)
+        return;
+    *cancelled = true;
+    finishWorker();
+    ++runId; // результат, уже стоящий в очереди, будет отброшен
+}
+
+void WordIndex::finishWorker()
+{
+    worker->wait();
+    delete worker;
+    worker = nullptr;
+    cancelled.reset();
+}
+
+// Выполняется в рабочем потоке.
+void WordIndex::run(const std::shared_ptr<std::atomic<bool>> &flag, const QString &snapshot, int blockCount,
+                    quint64 id)
+{
+    std::shared_ptr<ScanResult> result = std::make_shared<ScanResult>();
+    result->lines.reserve(blockCount);
+    QSet<QString> distinct;
+
+    QVector<Token> tokens;
+    const QChar *data = snapshot.constData();
+    const qsizetype size = snapshot.size();
+    qsizetype start = 0;
+    for (int line = 0; line < blockCount; ++line)
+    {
+        if (line % CancelCheckLines == 0 && *flag)
+            return;
+
+        qsizetype end = snapshot.indexOf(QChar::ParagraphSeparator, start);
+        if (end < 0)
+            end = size;
+        const QString text = QString::fromRawData(data + start, end - start);
+        const QStringList words = identifiers(text, tokens);
+        for (const QString &word : words)
+            distinct.insert(word);
+        result->lines.append(words);
+        start = qMin(end + 1, size);
+    }
+
+    QVector<QPair<QString, QString>> keys; // (folded, word)
+    keys.reserve(distinct.size());
+    for (const QString &word : std::as_const(distinct))
+        keys.append({word.toCaseFolded(), word});
+    if (*flag)
+        return;
+    std::sort(keys.begin(), keys.end());
+    result->sorted.reserve(keys.size());
+    for (const auto &key : std::as_const(keys))
+        result->sorted.append(key.second);
+
+    QMetaObject::invokeMethod(this, [this, result, id]
+                              {
+                                  if (id != runId)
+                                      return;
+                                  finishWorker();
+                                  applyScan(*result); }, Qt::QueuedConnection);
+}
+
+// Блоки, не менявшиеся с момента снимка, получают слова из разбора;
+// правки, сделанные во время разбора, разбираются здесь же. Если их
+// набралось больше SyncBlocks, снимок делается заново.
+void WordIndex::applyScan(const ScanResult &result)
+{
+    const int blockCount = document->blockCount();
+    const int lineCount = result.lines.size();
+    const int head = qMin(scanHead, qMin(blockCount, lineCount));
+    const int tail = qMin(scanTail, qMin(blockCount, lineCount) - head);
+    if (blockCount - head - tail > SyncBlocks)
+    {
+        startScan();
+        return;
+    }
+
+    bulk = true;
+    QVector<Token> tokens;
+    QTextBlock block = document->firstBlock();
+    for (int i = 0; i < blockCount && block.isValid(); ++i, block = block.next())
+    {
+        if (i < head)
+            assignWords(block, result.lines[i]);
+        else if (i >= blockCount - tail)
+            assignWords(block, result.lines[lineCount - (blockCount - i)]);
+        else
+            assignWords(block, identifiers(block.text(), tokens));
+    }
+    bulk = false;
+    rebuildOrder(result.sorted);
+    emit ready();
+}
+
+// Чем выше, тем лучше. Частые слова поднимаются, длинные опускаются.
+int WordIndex::rank(const Entry &entry, int base, const QString &prefix) const
+{
+    const int frequency = entry.keyword ? 4 : entry.count;
+    return base + int(std::log2(double(frequency) + 1.0) * 40.0) - int(entry.word.size() - prefix.size());
+}
+
+// Слова не длиннее префикса (в том числе сам набираемый префикс) не
+// предлагаются.
+QStringList WordIndex::complete(const QString &prefix, int limit) const
+{
+    QStringList result;
+    if (prefix.isEmpty())
+        return result;
+
+    const QString foldedPrefix = prefix.toCaseFolded();
+    QVector<QPair<int, int>> ranked; // (оценка, слово)
+
+    auto it = std::lower_bound(order.cbegin(), order.cend(), foldedPrefix,
+                               [this](int id, const QString &key) { return entries[id].folded < key; });
+    for (; it != order.cend() && entries[*it].folded.startsWith(foldedPrefix); ++it)
+    {
+        const Entry &entry = entries[*it];
+        if (entry.word.size() > prefix.size())
+            ranked.append({rank(entry, entry.word.startsWith(prefix) ? 3000 : 2000, prefix), *it});
+    }
+
+    if (ranked.size() < limit)
+    {
+        // Нечёткие совпадения: каждый пропуск снижает оценку, опечатка —
+        // сильнее. Маска отсеивает слова, где не хватает букв запроса.
+        const int typos = foldedPrefix.size() >= MinTypoLength ? 1 : 0;
+        const quint64 wanted = letterMask(foldedPrefix);
+        for (int id = 0; id < entries.size(); ++id)
+        {
+            if (qPopulationCount(wanted & ~letters[id]) > typos)
+                continue;
+            const Entry &entry = entries[id];
+            if (entry.word.size() <= prefix.size() || entry.folded.startsWith(foldedPrefix))
+                continue;
+            int base = -1;
+            int gaps = fuzzyGaps(entry.folded, foldedPrefix, -1);
+            if (gaps >= 0)
+            {
+                base = qMax(1, 1000 - gaps * 20);
+            }
+            else if (typos > 0)
+            {
+                for (int skip = 0; skip < foldedPrefix.size(); ++skip)
+                {
+                    gaps = fuzzyGaps(entry.folded, foldedPrefix, skip);
+                    if (gaps >= 0)
+                        base = qMax(base, qMax(1, 500 - gaps * 20));
+                }
+            }
+            if (base >= 0)
+                ranked.append({rank(entry, base, prefix), id});
+        }
+    }
+
+    const int count = qMin(limit, int(ranked.size()));
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                      [](const QPair<int, int> &a, const QPair<int, int> &b)
+                      { return a.first > b.first; });
+    for (int i = 0; i < count; ++i)
+        result.append(entries[ranked[i].second].word);
+    return result;
+}
@@ -0,0 +1,103 @@
+#ifndef WORDINDEX_H
+#define WORDINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+class QTextBlock;
+class QTextDocument;
+class QThread;
+
+// Индекс идентификаторов документа для автодополнения. Весь документ
+// разбирается в рабочем потоке по снимку текста; дальше индекс
+// обновляется инкрементально по contentsChange: заново разбираются только
+// изменённые блоки, слова удалённых блоков вычитаются из деструктора
+// BlockData. Правка больше SyncBlocks блоков (вставка, загрузка) тоже
+// уходит в рабочий поток.
+//
+// Номера слов упорядочены по тексту со свёрнутым регистром, поэтому слова
+// с префиксом — это отрезок массива, найденный двоичным поиском. Если
+// префиксных совпадений меньше limit, запрос добирает нечёткие: буквы
+// запроса идут в слове по порядку, одна из них может быть опечаткой,
+// в том числе первая. Их ищет проход по всем словам с отсевом по маске букв.
+class WordIndex : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int SyncBlocks = 256;
+    static constexpr int ScanDelay = 150;
+    static constexpr int CancelCheckLines = 1024;
+
+    explicit WordIndex(QTextDocument *document);
+    ~WordIndex() override;
+
+    void addKeywords(const QStringList &keywords);
+    QStringList complete(const QString &prefix, int limit = 20) const;
+    int size() const { return lookup.size(); }
+    // false — разбор документа запланирован или идёт, слова неполные.
+    bool isReady() const { return !worker && !scanTimer.isActive(); }
+
+    void addWords(const QStringList &words);
+    void removeWords(const QStringList &words);
+
+signals:
+    void ready();
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    struct Entry {
+        QString word;
+        QString folded;
+        int count = 0;
+        bool keyword = false;
+    };
+
+    struct ScanResult {
+        QVector<QStringList> lines; // слова каждого блока снимка
+        QStringList sorted;         // все разные слова в порядке order
+    };
+
+    int rank(const Entry &entry, int base, const QString &prefix) const;
+    bool before(int a, int b) const;
+
+    void add(const QString &word, bool keyword = false);
+    void remove(const QString &word);
+    void insertOrdered(int id);
+    void eraseOrdered(int id);
+    void rebuildOrder(const QStringList &sorted);
+    void indexBlocks(int from, int to);
+    void assignWords(QTextBlock block, const QStringList &words);
+
+    void startScan();
+    void cancelScan();
+    void finishWorker();
+    void run(const std::shared_ptr<std::atomic<bool>> &cancelled, const QString &snapshot, int blockCount,
+             quint64 id);
+    void applyScan(const ScanResult &result);
+
+    QTextDocument *document;
+    QVector<Entry> entries;
+    QVector<quint64> letters; // маска букв слова, по номеру
+    QVector<int> freeEntries;
+    QHash<QString, int> lookup;
+    QVector<int> order;  // номера слов по (folded, word)
+    bool bulk = false;   // применяется снимок: order перестраивается в конце
+
+    QTimer scanTimer;
+    QThread *worker = nullptr;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    quint64 runId = 0;
+    // Сколько блоков в начале и в конце документа не менялось с момента
+    // снимка: их слова берутся из разбора, остальные разбираются заново.
+    int scanHead = 0;
+    int scanTail = 0;
+};
+
+#endif // WORDINDEX_H
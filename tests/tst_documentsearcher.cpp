@@ -0,0 +1,156 @@
+#include <QTest>
+#include "documentsearcher.h"
+#include "piecetable.h"
+
+Q_DECLARE_METATYPE(DocumentSearcher::Query)
+
+class TestDocumentSearcher : public QObject {
+    Q_OBJECT
+
+private:
+    static DocumentSearcher::Query query(const QString &pattern, bool regex, bool caseSensitive)
+    {
+        DocumentSearcher::Query result;
+        result.pattern = pattern;
+        result.regex = regex;
+        result.caseSensitive = caseSensitive;
+        return result;
+    }
+
+    static QVector<qint64> positions(const QVector<DocumentSearcher::Match> &matches)
+    {
+        QVector<qint64> result;
+        for (const DocumentSearcher::Match &match : matches)
+            result.append(match.position);
+        return result;
+    }
+
+    // Замена, применённая к тексту, как это делает редактор.
+    static QString applied(const QString &text, const DocumentSearcher::Replacement &replacement)
+    {
+        QString result = text;
+        result.replace(replacement.position, replacement.removed, replacement.text);
+        return result;
+    }
+
+private slots:
+    void findAll_data()
+    {
+        QTest::addColumn<QString>("text");
+        QTest::addColumn<DocumentSearcher::Query>("query");
+        QTest::addColumn<QVector<qint64>>("expected");
+
+        const QString code = "int Value = value;\nvalue += VALUE;";
+        QTest::newRow("literal") << code << query("value", false, true) << QVector<qint64>{12, 19};
+        QTest::newRow("case-insensitive") << code << query("value", false, false) << QVector<qint64>{4, 12, 19, 28};
+        QTest::newRow("no overlap") << QString("aaaa") << query("aa", false, true) << QVector<qint64>{0, 2};
+        QTest::newRow("not ascii") << QString("Ёлка и ёлка") << query("ёлка", false, false) << QVector<qint64>{0, 7};
+        QTest::newRow("regex") << code << query("\\b[Vv]alue", true, true) << QVector<qint64>{4, 12, 19};
+        QTest::newRow("regex empty matches") << QString("ab") << query("x*", true, true) << QVector<qint64>{};
+    }
+
+    void findAll()
+    {
+        QFETCH(QString, text);
+        QFETCH(DocumentSearcher::Query, query);
+        QFETCH(QVector<qint64>, expected);
+        QCOMPARE(positions(DocumentSearcher::findAll(text, query)), expected);
+    }
+
+    // Большой файл ищется по байтам UTF-8.
+    void findAllInTable()
+    {
+        const QByteArray bytes = QString("строка value\nещё VALUE\n").toUtf8();
+        PieceTable table;
+        table.insert(0, bytes);
+        const QVector<DocumentSearcher::Match> matches = DocumentSearcher::findAll(table, query("value", false, false));
+        QCOMPARE(matches.size(), 2);
+        QCOMPARE(matches[0].position, qint64(bytes.indexOf("value")));
+        QCOMPARE(matches[1].position, qint64(bytes.indexOf("VALUE")));
+        QCOMPARE(matches[1].length, qint64(5));
+    }
+
+    void replaceWithGroups()
+    {
+        const QString text = "first(1); second(2);\nthird(3);";
+        const DocumentSearcher::Replacement replacement =
+            DocumentSearcher::buildReplacement(text, query("\\b(\\w+)\\(", true, true), "call_\\1(");
+        QCOMPARE(replacement.count, 3);
+        QCOMPARE(applied(text, replacement), QString("call_first(1); call_second(2);\ncall_third(3);"));
+    }
+
+    void replaceLiteral()
+    {
+        const QString text = "a.b a.b\na.b";
+        const DocumentSearcher::Replacement replacement =
+            DocumentSearcher::buildReplacement(text, query("a.b", false, true), "\\1x");
+        QCOMPARE(replacement.count, 3);
+        QCOMPARE(applied(text, replacement), QString("\\1x \\1x\n\\1x"));
+    }
+
+    void replaceInTable()
+    {
+        const QByteArray bytes = QString("ёлка value; value\n").toUtf8();
+        PieceTable table;
+        table.insert(0, bytes);
+        const DocumentSearcher::Replacement replacement =
+            DocumentSearcher::buildReplacement(table, query("value", false, true), "значение");
+        QCOMPARE(replacement.count, 2);
+        QByteArray result = bytes;
+        result.replace(replacement.position, replacement.removed, replacement.bytes);
+        QCOMPARE(QString::fromUtf8(result), QString("ёлка значение; значение\n"));
+    }
+
+    // Неверный UTF-8 перед совпадением не сдвигает байтовые позиции
+    // выражения, а группы переносятся исходными байтами.
+    void regexInInvalidUtf8()
+    {
+        const QByteArray bytes = QByteArray("\xff\xfe\xc3 call(a)\n\xe2\x82 call(b) \xff\n");
+        PieceTable table;
+        table.insert(0, bytes);
+        const DocumentSearcher::Query regex = query("call\\((\\w)\\)", true, true);
+        const QVector<DocumentSearcher::Match> matches = DocumentSearcher::findAll(table, regex);
+        QCOMPARE(matches.size(), 2);
+        QCOMPARE(matches[0].position, qint64(bytes.indexOf("call(a)")));
+        QCOMPARE(matches[1].position, qint64(bytes.indexOf("call(b)")));
+        QCOMPARE(matches[1].length, qint64(7));
+
+        const DocumentSearcher::Replacement replacement = DocumentSearcher::buildReplacement(table, regex, "f_\\1()");
+        QByteArray result = bytes;
+        result.replace(replacement.position, replacement.removed, replacement.bytes);
+        QCOMPARE(result, QByteArray("\xff\xfe\xc3 f_a()\n\xe2\x82 f_b() \xff\n"));
+    }
+
+    // Замена одного совпадения видит весь текст: якоря и просмотр назад
+    // работают, группы подставляются.
+    void substituteInContext()
+    {
+        const QString text = "x = 1;\nvalue(2);\nvalue(3);";
+        const DocumentSearcher::Query regex = query("(?<=\\n)value\\((\\d)\\);$", true, true);
+        const QVector<DocumentSearcher::Match> matches = DocumentSearcher::findAll(text, regex);
+        QCOMPARE(matches.size(), 2);
+        QCOMPARE(DocumentSearcher::substitute(text, regex, matches[1], "v\\1"), QString("v3"));
+        // Так заменяет FindBar: строка совпадения и строка перед ней.
+        const DocumentSearcher::Match local{matches[1].position - 7, matches[1].length};
+        QCOMPARE(DocumentSearcher::substitute("value(2);\nvalue(3);", regex, local, "v\\1"), QString("v3"));
+
+        PieceTable table;
+        table.insert(0, text.toUtf8());
+        const QVector<DocumentSearcher::Match> byteMatches = DocumentSearcher::findAll(table, query("^value\\((\\d)\\)", true, true));
+        QCOMPARE(byteMatches.size(), 2);
+        QCOMPARE(DocumentSearcher::substitute(table, query("^value\\((\\d)\\)", true, true), byteMatches[0], "v\\1"),
+                 QByteArray("v2"));
+        QCOMPARE(DocumentSearcher::substitute(table, query("value", false, true), byteMatches[0], "\\1"), QByteArray("\\1"));
+    }
+
+    void validity()
+    {
+        QString error;
+        QVERIFY(DocumentSearcher::isValid(query("(a|b)+", true, true), &error));
+        QVERIFY(!DocumentSearcher::isValid(query("(a", true, true), &error));
+        QVERIFY(!error.isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDocumentSearcher)
+#include "tst_documentsearcher.moc"
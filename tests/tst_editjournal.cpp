@@ -0,0 +1,109 @@
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTextCursor>
+#include <QTextEdit>
+#include <memory>
+#include "editjournal.h"
+#include "undohistory.h"
+
+class TestEditJournal : public QObject {
+    Q_OBJECT
+
+private slots:
+    // Набор, отмена и повтор попадают в журнал; восстановленный текст
+    // совпадает с документом.
+    void recoverTyping()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QTextEdit editor;
+        editor.setPlainText("int main()\n{\n    return 0;\n}\n");
+        UndoHistory history(&editor, editor.document());
+        EditJournal journal(dir.path());
+        journal.setDocument(editor.document());
+        connect(&history, &UndoHistory::textChanged, &journal, &EditJournal::record);
+
+        QTextCursor cursor(editor.document());
+        cursor.setPosition(13);
+        cursor.insertText("    int value = 42;\n");
+        journal.sync();
+        for (const QChar ch : QString("    value += 1;\n"))
+            cursor.insertText(ch);
+        cursor.deletePreviousChar();
+        history.undo();
+        history.redo();
+        journal.sync();
+
+        EditJournal::Recovery recovery;
+        QString error;
+        QVERIFY2(EditJournal::recover(journal.fileName(), &recovery, &error), qPrintable(error));
+        QVERIFY(recovery.complete);
+        QVERIFY(recovery.filePath.isEmpty());
+        QCOMPARE(recovery.text, editor.toPlainText());
+    }
+
+    // Снимок хранит формат файла: восстановленный документ сохранится
+    // в той же кодировке и с теми же концами строк.
+    void snapshotKeepsFormat()
+    {
+        QTemporaryDir dir;
+        QTextEdit editor;
+        editor.setPlainText("caf\u00e9\n");
+        TextFormat format;
+        format.encoding = QStringConverter::Latin1;
+        format.lineEnding = "\r\n";
+        EditJournal journal(dir.path());
+        journal.setDocument(editor.document());
+        journal.setFormat(format);
+        journal.checkpoint();
+        QVERIFY(journal.sync());
+
+        EditJournal::Recovery recovery;
+        QString error;
+        QVERIFY2(EditJournal::recover(journal.fileName(), &recovery, &error), qPrintable(error));
+        QCOMPARE(recovery.text, editor.toPlainText());
+        QCOMPARE(recovery.format.encoding, QStringConverter::Latin1);
+        QVERIFY(!recovery.format.bom);
+        QCOMPARE(recovery.format.lineEnding, QString("\r\n"));
+    }
+
+    // Пока владелец жив, журнал не считается брошенным.
+    void orphansSkipLiveJournal()
+    {
+        QTemporaryDir dir;
+        QTextEdit editor;
+        UndoHistory history(&editor, editor.document());
+        auto journal = std::make_unique<EditJournal>(dir.path());
+        journal->setDocument(editor.document());
+        connect(&history, &UndoHistory::textChanged, journal.get(), &EditJournal::record);
+        QTextCursor(editor.document()).insertText("unsaved");
+        journal->sync();
+        const QString fileName = journal->fileName();
+        QVERIFY(!fileName.isEmpty());
+        QVERIFY(!EditJournal::orphans(dir.path()).contains(fileName));
+
+        journal.reset();
+        QVERIFY(EditJournal::orphans(dir.path()).contains(fileName));
+        EditJournal::remove(fileName);
+        QVERIFY(!QFile::exists(fileName));
+    }
+
+    void recoverRejectsGarbage()
+    {
+        QTemporaryDir dir;
+        const QString fileName = dir.filePath("broken.journal");
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("not a journal");
+        file.close();
+
+        EditJournal::Recovery recovery;
+        QString error;
+        QVERIFY(!EditJournal::recover(fileName, &recovery, &error));
+        QVERIFY(!error.isEmpty());
+    }
+};
+
+QTEST_MAIN(TestEditJournal)
+#include "tst_editjournal.moc"
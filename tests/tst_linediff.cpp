@@ -0,0 +1,123 @@
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTest>
+#include "linediff.h"
+
+// Разница проверяется применением: фрагменты, наложенные на старые
+// строки, должны дать новый текст.
+class TestLineDiff : public QObject {
+    Q_OBJECT
+
+private:
+    static QString apply(const QString &oldText, const QString &newText)
+    {
+        const QVector<QStringView> oldLines = LineDiff::split(oldText, '\n');
+        const QVector<QStringView> newLines = LineDiff::split(newText, '\n');
+        QString result;
+        int cursor = 0;
+        for (const LineDiff::Hunk &hunk : LineDiff::compute(oldLines, newLines))
+        {
+            if (hunk.oldStart < cursor)
+                return QStringLiteral("<hunks out of order>");
+            for (; cursor < hunk.oldStart; ++cursor)
+                result += oldLines[cursor];
+            for (int i = 0; i < hunk.newCount; ++i)
+                result += newLines[hunk.newStart + i];
+            cursor += hunk.oldCount;
+        }
+        for (; cursor < oldLines.size(); ++cursor)
+            result += oldLines[cursor];
+        return result;
+    }
+
+    static QStringList numberedLines(int count)
+    {
+        QStringList lines;
+        for (int i = 0; i < count; ++i)
+            lines.append(QString("line %1").arg(i));
+        return lines;
+    }
+
+private slots:
+    void splitKeepsSeparators()
+    {
+        const QString text = "a\nbb\n\nccc";
+        const QVector<QStringView> lines = LineDiff::split(text, '\n');
+        QCOMPARE(lines.size(), 4);
+        QCOMPARE(lines[0].toString(), QString("a\n"));
+        QCOMPARE(lines[2].toString(), QString("\n"));
+        QCOMPARE(lines[3].toString(), QString("ccc"));
+    }
+
+    void identicalTextsHaveNoHunks()
+    {
+        const QString text = numberedLines(100).join('\n');
+        const QVector<QStringView> lines = LineDiff::split(text, '\n');
+        QVERIFY(LineDiff::compute(lines, lines).isEmpty());
+    }
+
+    void singleChanges_data()
+    {
+        QTest::addColumn<QString>("oldText");
+        QTest::addColumn<QString>("newText");
+        QTest::newRow("insert middle") << "a\nb\nc" << "a\nb\nx\nc";
+        QTest::newRow("delete middle") << "a\nb\nc" << "a\nc";
+        QTest::newRow("replace first") << "a\nb\nc" << "z\nb\nc";
+        QTest::newRow("append") << "a\nb" << "a\nb\nc";
+        QTest::newRow("from empty") << "" << "a\nb";
+        QTest::newRow("to empty") << "a\nb" << "";
+        QTest::newRow("last line newline") << "a\nb" << "a\nb\n";
+    }
+
+    void singleChanges()
+    {
+        QFETCH(QString, oldText);
+        QFETCH(QString, newText);
+        QCOMPARE(apply(oldText, newText), newText);
+    }
+
+    void randomEdits()
+    {
+        QRandomGenerator random(17);
+        for (int round = 0; round < 200; ++round)
+        {
+            const QStringList oldLines = numberedLines(random.bounded(1, 300));
+            QStringList newLines = oldLines;
+            const int edits = random.bounded(1, 20);
+            for (int i = 0; i < edits; ++i)
+            {
+                const int at = random.bounded(newLines.size() + 1);
+                switch (random.bounded(3))
+                {
+                case 0:
+                    newLines.insert(at, QString("added %1").arg(i));
+                    break;
+                case 1:
+                    if (at < newLines.size())
+                        newLines.removeAt(at);
+                    break;
+                default:
+                    if (at < newLines.size())
+                        newLines[at] += " changed";
+                    break;
+                }
+            }
+            const QString oldText = oldLines.join('\n');
+            const QString newText = newLines.join('\n');
+            QCOMPARE(apply(oldText, newText), newText);
+        }
+    }
+
+    // Больше MaxCost различий: результат не минимален, но верен.
+    void beyondMaxCost()
+    {
+        QStringList oldLines = numberedLines(20000);
+        QStringList newLines = oldLines;
+        for (int i = 0; i < newLines.size(); i += 3)
+            newLines[i] = QString("rewritten %1").arg(i);
+        QCOMPARE(apply(oldLines.join('\n'), newLines.join('\n')), newLines.join('\n'));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestLineDiff)
+#include "tst_linediff.moc"
@@ -0,0 +1,138 @@
+#include <QByteArray>
+#include <QRandomGenerator>
+#include <QTest>
+#include "lineindex.h"
+
+// Индекс сверяется с наивным подсчётом переводов строк в копии текста,
+// которая правится вместе с ним.
+class TestLineIndex : public QObject {
+    Q_OBJECT
+
+private:
+    static void verify(const LineIndex &index, const QByteArray &text)
+    {
+        QCOMPARE(index.size(), qint64(text.size()));
+        QCOMPARE(index.lineCount(), qint64(text.count('\n')) + 1);
+        // Каждая строка: её начало, первый и последний байт.
+        qint64 line = 0;
+        qint64 start = 0;
+        for (;;)
+        {
+            QCOMPARE(index.lineStart(line), start);
+            QCOMPARE(index.lineOf(start), line);
+            const qint64 newline = text.indexOf('\n', start);
+            if (newline < 0)
+                break;
+            QCOMPARE(index.lineOf(newline), line);
+            start = newline + 1;
+            ++line;
+        }
+        QCOMPARE(index.lineOf(text.size()), line);
+        QCOMPARE(index.lineStart(index.lineCount()), qint64(text.size()));
+    }
+
+    static QByteArray makeText(int lines)
+    {
+        QByteArray text;
+        for (int i = 0; i < lines; ++i)
+            text += "line " + QByteArray::number(i) + '\n';
+        return text;
+    }
+
+private slots:
+    void build_data()
+    {
+        QTest::addColumn<QByteArray>("text");
+        QTest::newRow("empty") << QByteArray();
+        QTest::newRow("no newline") << QByteArray("abc");
+        QTest::newRow("trailing newline") << QByteArray("a\nbb\n");
+        QTest::newRow("empty lines") << QByteArray("\n\n\nx\n\n");
+        QTest::newRow("several blocks") << makeText(3 * LineIndex::BlockLines + 7);
+    }
+
+    void build()
+    {
+        QFETCH(QByteArray, text);
+        LineIndex index;
+        QVERIFY(index.build(text.constData(), text.size()));
+        verify(index, text);
+    }
+
+    void utf8Check()
+    {
+        LineIndex index;
+        const QByteArray valid = "строка\nщ\n";
+        QVERIFY(index.build(valid.constData(), valid.size()));
+        QVERIFY(index.isUtf8());
+        const QByteArray invalid = "ok\n\xff\xfe\n";
+        QVERIFY(index.build(invalid.constData(), invalid.size()));
+        QVERIFY(!index.isUtf8());
+    }
+
+    void cancelled()
+    {
+        const QByteArray text = makeText(100);
+        const std::atomic<bool> stop{true};
+        LineIndex index;
+        QVERIFY(!index.build(text.constData(), text.size(), &stop));
+        QVERIFY(!index.isValid());
+    }
+
+    // Удаление по одной строке из середины каждого блока: опустевшие
+    // блоки сливаются с соседями, индекс остаётся верным.
+    void shrinkingBlocks()
+    {
+        QByteArray text = makeText(6 * LineIndex::BlockLines);
+        LineIndex index;
+        QVERIFY(index.build(text.constData(), text.size()));
+        for (int round = 0; round < 5 * LineIndex::BlockLines; ++round)
+        {
+            const qint64 line = (round * 7919) % (index.lineCount() - 1);
+            const qint64 start = index.lineStart(line);
+            const qint64 length = index.lineStart(line + 1) - start;
+            index.remove(start, length);
+            text.remove(start, length);
+            if (round % 512 == 0)
+                verify(index, text);
+        }
+        verify(index, text);
+    }
+
+    // Случайные вставки и удаления, в том числе через границы блоков.
+    void randomEdits()
+    {
+        QByteArray text = makeText(4 * LineIndex::BlockLines);
+        LineIndex index;
+        QVERIFY(index.build(text.constData(), text.size()));
+
+        QRandomGenerator random(7);
+        for (int round = 0; round < 300; ++round)
+        {
+            const qint64 pos = random.bounded(int(text.size()) + 1);
+            if (random.bounded(2) == 0 || text.isEmpty())
+            {
+                QByteArray inserted;
+                const int lines = random.bounded(0, 2 * LineIndex::BlockLines + 2);
+                for (int i = 0; i < lines; ++i)
+                    inserted += "i" + QByteArray::number(i) + '\n';
+                inserted += "tail";
+                index.insert(pos, inserted.constData(), inserted.size());
+                text.insert(pos, inserted);
+            }
+            else
+            {
+                if (pos >= text.size())
+                    continue;
+                const qint64 length = random.bounded(int(qMin<qint64>(text.size() - pos, 40000))) + 1;
+                index.remove(pos, length);
+                text.remove(pos, length);
+            }
+            if (round % 25 == 0)
+                verify(index, text);
+        }
+        verify(index, text);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestLineIndex)
+#include "tst_lineindex.moc"
@@ -0,0 +1,136 @@
+#include <QTest>
+#include <QTextCursor>
+#include <QTextEdit>
+#include "undohistory.h"
+
+class TestUndoHistory : public QObject {
+    Q_OBJECT
+
+private:
+    static QString makeText(int lines)
+    {
+        QStringList result;
+        for (int i = 0; i < lines; ++i)
+            result.append(QString("    value_%1 = compute(index, %1);").arg(i));
+        return result.join('\n');
+    }
+
+private slots:
+    // Набор с удалениями: отмена всего возвращает исходный текст,
+    // повтор всего — набранный.
+    void typingUndoRedo()
+    {
+        const QString original = makeText(200);
+        QTextEdit editor;
+        editor.setPlainText(original);
+        UndoHistory history(&editor, editor.document());
+
+        QTextCursor cursor(editor.document());
+        cursor.setPosition(original.size() / 2);
+        const QString typed = "total = weight * height;\n";
+        for (int i = 0; i < 500; ++i)
+        {
+            if (i % 9 == 8)
+                cursor.deletePreviousChar();
+            else
+                cursor.insertText(typed.at(i % typed.size()));
+        }
+        const QString edited = editor.toPlainText();
+        QVERIFY(history.canUndo());
+
+        while (history.canUndo())
+            history.undo();
+        QCOMPARE(editor.toPlainText(), original);
+        QVERIFY(history.canRedo());
+
+        while (history.canRedo())
+            history.redo();
+        QCOMPARE(editor.toPlainText(), edited);
+    }
+
+    void groupUndoesAtOnce()
+    {
+        QTextEdit editor;
+        editor.setPlainText("alpha beta gamma");
+        UndoHistory history(&editor, editor.document());
+
+        history.beginGroup();
+        QTextCursor cursor(editor.document());
+        cursor.insertText("one ");
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(" two");
+        history.endGroup();
+        QCOMPARE(editor.toPlainText(), QString("one alpha beta gamma two"));
+
+        history.undo();
+        QCOMPARE(editor.toPlainText(), QString("alpha beta gamma"));
+        QVERIFY(!history.canUndo());
+        history.redo();
+        QCOMPARE(editor.toPlainText(), QString("one alpha beta gamma two"));
+    }
+
+    // Замена всего текста хранится сжатой и отменяется целиком.
+    void largeReplace()
+    {
+        QStringList lines;
+        for (int i = 0; i < 5000; ++i)
+            lines.append(QString("line %1").arg(i));
+        const QString original = lines.join('\n');
+        QTextEdit editor;
+        editor.setPlainText(original);
+        UndoHistory history(&editor, editor.document());
+
+        for (int i = 0; i < lines.size(); i += 50)
+            lines[i] += " // changed";
+        const QString replaced = lines.join('\n');
+        QTextCursor cursor(editor.document());
+        cursor.select(QTextCursor::Document);
+        cursor.insertText(replaced);
+        QVERIFY(history.memoryUsage() < (original.size() + replaced.size()) * qint64(sizeof(QChar)));
+
+        history.undo();
+        QCOMPARE(editor.toPlainText(), original);
+        history.redo();
+        QCOMPARE(editor.toPlainText(), replaced);
+    }
+
+    void resetForgetsCommands()
+    {
+        QTextEdit editor;
+        UndoHistory history(&editor, editor.document());
+        QTextCursor(editor.document()).insertText("text");
+        QVERIFY(history.canUndo());
+        history.reset();
+        QVERIFY(!history.canUndo());
+        QVERIFY(!history.canRedo());
+        QCOMPARE(editor.toPlainText(), QString("text"));
+    }
+
+    void packRoundTrip_data()
+    {
+        QTest::addColumn<QString>("removed");
+        QTest::addColumn<QString>("inserted");
+        const QString text = makeText(300);
+        QString changed = text;
+        changed.replace("compute", "evaluate");
+        QTest::newRow("empty") << QString() << QString();
+        QTest::newRow("insert only") << QString() << text;
+        QTest::newRow("remove only") << text << QString();
+        QTest::newRow("similar") << text << changed;
+        QTest::newRow("unrelated") << QString("короткий текст") << text;
+    }
+
+    void packRoundTrip()
+    {
+        QFETCH(QString, removed);
+        QFETCH(QString, inserted);
+        QString unpackedRemoved;
+        QString unpackedInserted;
+        QVERIFY(UndoHistory::unpack(UndoHistory::pack(removed, inserted), unpackedRemoved, unpackedInserted));
+        QCOMPARE(unpackedRemoved, removed);
+        QCOMPARE(unpackedInserted, inserted);
+    }
+};
+
+QTEST_MAIN(TestUndoHistory)
+#include "tst_undohistory.moc"